@@ -0,0 +1,780 @@
+/**
+ * -----------------------------------------------------------------------------
+ * Project: Fossil Logic
+ *
+ * This file is part of the Fossil Logic project, which aims to develop
+ * high-performance, cross-platform applications and libraries. The code
+ * contained herein is licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. You may obtain
+ * a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * Author: Michael Gene Brockus (Dreamer)
+ * Date: 04/05/2013
+ *
+ * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
+ * -----------------------------------------------------------------------------
+ */
+#include "fossil/media/json.h"
+#include "fossil/media/media.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * JSON microbenchmarks. Each case reports the best of several runs so that
+ * scheduler noise does not dominate; run with `meson test --benchmark`.
+ */
+
+#define BENCH_RUNS 7
+
+static double bench_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static unsigned long bench_rand(unsigned long *state) {
+    *state = *state * 6364136223846793005ul + 1442695040888963407ul;
+    return (unsigned long)(*state >> 33);
+}
+
+static void bench_report(const char *name, double secs, size_t items, size_t bytes) {
+    printf("  %-32s %8.1f ns/item %8.1f MB/s\n", name, secs * 1e9 / (double)items, (double)bytes / secs / 1e6);
+}
+
+// -----------------------------------------------------------------------------
+// Numbers: parse_number vs strtod
+// -----------------------------------------------------------------------------
+
+/* Telemetry-like array: integers, fixed-point readings and full-precision doubles */
+static char *make_numeric_array(size_t count, size_t *len_out) {
+    char *buf = malloc(count * 28 + 2);
+    if (!buf) return NULL;
+    unsigned long st = 42;
+    size_t len = 0;
+    buf[len++] = '[';
+    for (size_t k = 0; k < count; ++k) {
+        if (k) buf[len++] = ',';
+        unsigned long r = bench_rand(&st);
+        switch (r % 4) {
+        case 0: len += (size_t)sprintf(buf + len, "%lu", bench_rand(&st) % 100000); break;
+        case 1: len += (size_t)sprintf(buf + len, "%.2f", (double)(bench_rand(&st) % 1000000) / 100.0 - 5000.0); break;
+        case 2: len += (size_t)sprintf(buf + len, "%.6g", (double)bench_rand(&st) / 4096.0); break;
+        default: len += (size_t)sprintf(buf + len, "%.17g", (double)bench_rand(&st) / (double)(bench_rand(&st) + 1)); break;
+        }
+    }
+    buf[len++] = ']';
+    buf[len] = '\0';
+    *len_out = len;
+    return buf;
+}
+
+static int sum_number(void *user, double value, const char *text, size_t len) {
+    (void)text;
+    (void)len;
+    *(double *)user += value;
+    return 0;
+}
+
+static void bench_numbers(void) {
+    size_t count = 1000000;
+    size_t len = 0;
+    char *text = make_numeric_array(count, &len);
+    if (!text) return;
+
+    fossil_media_json_sax_handler_t h;
+    memset(&h, 0, sizeof(h));
+    h.number = sum_number;
+    double best_parse = 1e30, best_sax = 1e30, best_strtod = 1e30;
+    volatile double sink = 0;
+    for (int r = 0; r < BENCH_RUNS; ++r) {
+        double t0 = bench_now();
+        fossil_media_json_value_t *v = fossil_media_json_parse(text, NULL);
+        double t1 = bench_now();
+        if (!v) { fprintf(stderr, "parse failed\n"); break; }
+        sink += v->u.array.items[count - 1]->u.number;
+        fossil_media_json_free(v);
+        if (t1 - t0 < best_parse) best_parse = t1 - t0;
+
+        /* Lexing and conversion without DOM allocation */
+        double acc = 0;
+        t0 = bench_now();
+        fossil_media_json_parse_sax(text, &h, &acc, NULL);
+        t1 = bench_now();
+        sink += acc;
+        if (t1 - t0 < best_sax) best_sax = t1 - t0;
+
+        /* The previous parse_number: strtod over the same literals */
+        t0 = bench_now();
+        const char *p = text + 1;
+        acc = 0;
+        for (size_t k = 0; k < count; ++k) {
+            char *end;
+            acc += strtod(p, &end);
+            p = end + 1;
+        }
+        t1 = bench_now();
+        sink += acc;
+        if (t1 - t0 < best_strtod) best_strtod = t1 - t0;
+    }
+    (void)sink;
+    printf("numbers: %zu values, %.1f MB\n", count, (double)len / 1e6);
+    bench_report("fossil_media_json_parse", best_parse, count, len);
+    bench_report("fossil_media_json_parse_sax", best_sax, count, len);
+    bench_report("strtod (conversion only)", best_strtod, count, len);
+    free(text);
+}
+
+/* Validation of the same document: scanner vs building and freeing a DOM */
+static void bench_validate(void) {
+    size_t count = 1000000;
+    size_t len = 0;
+    char *text = make_numeric_array(count, &len);
+    if (!text) return;
+
+    double best_validate = 1e30, best_parse = 1e30;
+    for (int r = 0; r < BENCH_RUNS; ++r) {
+        double t0 = bench_now();
+        int rc = fossil_media_json_validate(text, NULL);
+        double t1 = bench_now();
+        if (rc != 0) { fprintf(stderr, "validate failed\n"); break; }
+        if (t1 - t0 < best_validate) best_validate = t1 - t0;
+
+        t0 = bench_now();
+        fossil_media_json_value_t *v = fossil_media_json_parse(text, NULL);
+        fossil_media_json_free(v);
+        t1 = bench_now();
+        if (t1 - t0 < best_parse) best_parse = t1 - t0;
+    }
+    printf("validate: %.1f MB\n", (double)len / 1e6);
+    bench_report("fossil_media_json_validate", best_validate, count, len);
+    bench_report("parse + free", best_parse, count, len);
+    free(text);
+}
+
+// -----------------------------------------------------------------------------
+// Strings: heap, arena and in-situ storage
+// -----------------------------------------------------------------------------
+
+/* Log-like records: short keys, free-text values, an occasional escape */
+static char *make_record_array(size_t count, size_t *len_out) {
+    static const char *words[] = {"request", "served", "from", "cache", "in", "upstream", "timeout", "retrying"};
+    char *buf = malloc(count * 160 + 2);
+    if (!buf) return NULL;
+    unsigned long st = 7;
+    size_t len = 0;
+    buf[len++] = '[';
+    for (size_t k = 0; k < count; ++k) {
+        if (k) buf[len++] = ',';
+        len += (size_t)sprintf(buf + len, "{\"host\":\"node-%lu\",\"level\":\"info\",\"msg\":\"",
+                               bench_rand(&st) % 64);
+        for (int w = 0; w < 8; ++w)
+            len += (size_t)sprintf(buf + len, "%s%s", w ? " " : "", words[bench_rand(&st) % 8]);
+        len += (size_t)sprintf(buf + len, "%s\"}", bench_rand(&st) % 8 ? "" : "\\n");
+    }
+    buf[len++] = ']';
+    buf[len] = '\0';
+    *len_out = len;
+    return buf;
+}
+
+static void bench_strings(void) {
+    size_t count = 200000;
+    size_t len = 0;
+    char *text = make_record_array(count, &len);
+    char *work = malloc(len + 1);
+    if (!text || !work) { free(text); free(work); return; }
+
+    fossil_media_json_parse_options_t opts = {FOSSIL_MEDIA_JSON_PARSE_ARENA, NULL, 0};
+    fossil_media_json_parse_options_t interned = {FOSSIL_MEDIA_JSON_PARSE_INTERN_KEYS, NULL, 0};
+    fossil_media_json_keys_t *keys = fossil_media_json_keys_create();
+    fossil_media_json_parse_options_t shared = {0, keys, 0};
+    double best_heap = 1e30, best_arena = 1e30, best_insitu = 1e30, best_interned = 1e30, best_shared = 1e30;
+    for (int r = 0; r < BENCH_RUNS; ++r) {
+        double t0 = bench_now();
+        fossil_media_json_free(fossil_media_json_parse(text, NULL));
+        double t1 = bench_now();
+        if (t1 - t0 < best_heap) best_heap = t1 - t0;
+
+        t0 = bench_now();
+        fossil_media_json_free(fossil_media_json_parse_ex(text, &opts, NULL));
+        t1 = bench_now();
+        if (t1 - t0 < best_arena) best_arena = t1 - t0;
+
+        memcpy(work, text, len + 1);
+        t0 = bench_now();
+        fossil_media_json_free(fossil_media_json_parse_insitu(work, NULL, NULL));
+        t1 = bench_now();
+        if (t1 - t0 < best_insitu) best_insitu = t1 - t0;
+
+        t0 = bench_now();
+        fossil_media_json_free(fossil_media_json_parse_ex(text, &interned, NULL));
+        t1 = bench_now();
+        if (t1 - t0 < best_interned) best_interned = t1 - t0;
+
+        t0 = bench_now();
+        fossil_media_json_free(fossil_media_json_parse_ex(text, &shared, NULL));
+        t1 = bench_now();
+        if (t1 - t0 < best_shared) best_shared = t1 - t0;
+    }
+    printf("strings: %zu records, %.1f MB (parse + free)\n", count, (double)len / 1e6);
+    bench_report("fossil_media_json_parse", best_heap, count, len);
+    bench_report("parse_ex (arena)", best_arena, count, len);
+    bench_report("fossil_media_json_parse_insitu", best_insitu, count, len);
+    bench_report("parse_ex (interned keys)", best_interned, count, len);
+    bench_report("parse_ex (heap, key table)", best_shared, count, len);
+    fossil_media_json_keys_free(keys);
+    free(work);
+    free(text);
+}
+
+// -----------------------------------------------------------------------------
+// NDJSON: one parse per line vs the threaded batch parser
+// -----------------------------------------------------------------------------
+
+static int drop_record(fossil_media_json_value_t *v, size_t line, const fossil_media_json_error_t *err, void *user) {
+    (void)line;
+    (void)err;
+    *(size_t *)user += v != NULL;
+    fossil_media_json_free(v);
+    return 0;
+}
+
+static void bench_ndjson(void) {
+    size_t count = 500000;
+    size_t len = 0;
+    char *text = make_record_array(count, &len);
+    if (!text) return;
+    /* Turn the array into one record per line */
+    text[0] = ' ';
+    text[len - 1] = '\n';
+    for (char *p = text; (p = strstr(p, "\"},{")) != NULL; p += 3) p[2] = '\n';
+
+    double best_serial = 1e30, best_one = 1e30, best_all = 1e30;
+    size_t seen = 0;
+    for (int r = 0; r < BENCH_RUNS; ++r) {
+        /* Split lines by hand and parse them one at a time */
+        double t0 = bench_now();
+        for (char *p = text, *nl; (nl = strchr(p, '\n')) != NULL; p = nl + 1) {
+            *nl = '\0';
+            fossil_media_json_value_t *v = fossil_media_json_parse(p, NULL);
+            seen += v != NULL;
+            fossil_media_json_free(v);
+            *nl = '\n';
+        }
+        double t1 = bench_now();
+        if (t1 - t0 < best_serial) best_serial = t1 - t0;
+
+        fossil_media_json_ndjson_options_t opts = {1, 0, 0};
+        t0 = bench_now();
+        fossil_media_json_parse_ndjson(text, len, &opts, drop_record, &seen, NULL);
+        t1 = bench_now();
+        if (t1 - t0 < best_one) best_one = t1 - t0;
+
+        opts.threads = 0;
+        t0 = bench_now();
+        fossil_media_json_parse_ndjson(text, len, &opts, drop_record, &seen, NULL);
+        t1 = bench_now();
+        if (t1 - t0 < best_all) best_all = t1 - t0;
+    }
+    printf("ndjson: %zu lines, %.1f MB (%zu parsed)\n", count, (double)len / 1e6, seen / 3 / BENCH_RUNS);
+    bench_report("parse per line", best_serial, count, len);
+    bench_report("parse_ndjson, 1 thread", best_one, count, len);
+    bench_report("parse_ndjson, all CPUs", best_all, count, len);
+    free(text);
+}
+
+/* Cold start from a cached file: parse the JSON text vs map a binary tape */
+static void bench_tape(void) {
+    size_t count = 200000;
+    size_t len = 0;
+    char *text = make_record_array(count, &len);
+    fossil_media_json_value_t *doc = text ? fossil_media_json_parse(text, NULL) : NULL;
+    const char *json_file = "bench_json_tape.json", *tape_file = "bench_json_tape.bin";
+    if (!doc || fossil_media_json_write_file(doc, json_file, 0, NULL) != 0 ||
+        fossil_media_json_tape_write_file(doc, tape_file, NULL) != 0) {
+        fossil_media_json_free(doc);
+        free(text);
+        return;
+    }
+    fossil_media_json_free(doc);
+
+    double best_parse = 1e30, best_open = 1e30, best_rebuild = 1e30;
+    size_t found = 0;
+    for (int r = 0; r < BENCH_RUNS; ++r) {
+        /* Open the cache and read one field of the last record */
+        double t0 = bench_now();
+        fossil_media_json_value_t *v = fossil_media_json_parse_file(json_file, NULL);
+        found += fossil_media_json_get_path_ref(v, "[199999].host") != NULL;
+        fossil_media_json_free(v);
+        double t1 = bench_now();
+        if (t1 - t0 < best_parse) best_parse = t1 - t0;
+
+        t0 = bench_now();
+        fossil_media_json_tape_t *tape = fossil_media_json_tape_open(tape_file, NULL);
+        fossil_media_json_tape_ref_t last = fossil_media_json_tape_index(fossil_media_json_tape_root(tape), count - 1);
+        found += fossil_media_json_tape_get_string(fossil_media_json_tape_get(last, "host"), NULL) != NULL;
+        t1 = bench_now();
+        if (t1 - t0 < best_open) best_open = t1 - t0;
+
+        t0 = bench_now();
+        v = fossil_media_json_tape_to_value(fossil_media_json_tape_root(tape), NULL);
+        fossil_media_json_free(v);
+        t1 = bench_now();
+        if (t1 - t0 < best_rebuild) best_rebuild = t1 - t0;
+        fossil_media_json_tape_close(tape);
+    }
+    printf("tape: %zu records, %.1f MB (%zu lookups)\n", count, (double)len / 1e6, found);
+    bench_report("parse_file + lookup", best_parse, count, len);
+    bench_report("tape_open + lookup", best_open, count, len);
+    bench_report("tape_to_value + free", best_rebuild, count, len);
+    remove(json_file);
+    remove(tape_file);
+    free(text);
+}
+
+/* Stringify of the same document vs formatting each value with %.17g */
+static void bench_stringify_numbers(void) {
+    size_t count = 1000000;
+    size_t len = 0;
+    char *text = make_numeric_array(count, &len);
+    if (!text) return;
+    fossil_media_json_value_t *v = fossil_media_json_parse(text, NULL);
+    free(text);
+    if (!v) return;
+
+    double best_stringify = 1e30, best_printf = 1e30;
+    size_t out_len = 0, printf_len = 0;
+    for (int r = 0; r < BENCH_RUNS; ++r) {
+        double t0 = bench_now();
+        char *s = fossil_media_json_stringify(v, 0, NULL);
+        double t1 = bench_now();
+        if (!s) { fprintf(stderr, "stringify failed\n"); break; }
+        out_len = strlen(s);
+        free(s);
+        if (t1 - t0 < best_stringify) best_stringify = t1 - t0;
+
+        char tmp[32];
+        printf_len = 0;
+        t0 = bench_now();
+        for (size_t k = 0; k < count; ++k)
+            printf_len += (size_t)snprintf(tmp, sizeof(tmp), "%.17g", v->u.array.items[k]->u.number) + 1;
+        t1 = bench_now();
+        if (t1 - t0 < best_printf) best_printf = t1 - t0;
+    }
+    printf("stringify numbers: %zu values, %.1f MB (%.1f MB with %%.17g)\n", count, (double)out_len / 1e6, (double)printf_len / 1e6);
+    bench_report("fossil_media_json_stringify", best_stringify, count, out_len);
+    bench_report("snprintf %.17g (format only)", best_printf, count, printf_len);
+    fossil_media_json_free(v);
+}
+
+// -----------------------------------------------------------------------------
+// Path lookups: cloning, borrowed and compiled
+// -----------------------------------------------------------------------------
+
+static void bench_paths(void) {
+    const char *text =
+        "{\"request\":{\"headers\":{\"host\":\"example\",\"accept\":\"*/*\"},"
+        "\"items\":[{\"id\":1,\"tags\":[\"a\",\"b\"]},{\"id\":2,\"tags\":[\"c\"]}],"
+        "\"user\":{\"name\":\"alice\",\"roles\":[\"admin\"]}}}";
+    const char *expr = "request.items[1].tags[0]";
+    fossil_media_json_value_t *doc = fossil_media_json_parse(text, NULL);
+    fossil_media_json_path_t *path = fossil_media_json_path_compile(expr, NULL);
+    if (!doc || !path) return;
+
+    size_t count = 1000000;
+    double best_clone = 1e30, best_ref = 1e30, best_compiled = 1e30;
+    volatile size_t sink = 0;
+    for (int r = 0; r < BENCH_RUNS; ++r) {
+        double t0 = bench_now();
+        for (size_t k = 0; k < count; ++k) {
+            fossil_media_json_value_t *v = fossil_media_json_get_path(doc, expr);
+            sink += v != NULL;
+            fossil_media_json_free(v);
+        }
+        double t1 = bench_now();
+        if (t1 - t0 < best_clone) best_clone = t1 - t0;
+
+        t0 = bench_now();
+        for (size_t k = 0; k < count; ++k) sink += fossil_media_json_get_path_ref(doc, expr) != NULL;
+        t1 = bench_now();
+        if (t1 - t0 < best_ref) best_ref = t1 - t0;
+
+        t0 = bench_now();
+        for (size_t k = 0; k < count; ++k) sink += fossil_media_json_path_get(path, doc) != NULL;
+        t1 = bench_now();
+        if (t1 - t0 < best_compiled) best_compiled = t1 - t0;
+    }
+    (void)sink;
+    printf("paths: %zu lookups of %s\n", count, expr);
+    bench_report("fossil_media_json_get_path", best_clone, count, count * strlen(expr));
+    bench_report("fossil_media_json_get_path_ref", best_ref, count, count * strlen(expr));
+    bench_report("fossil_media_json_path_get", best_compiled, count, count * strlen(expr));
+    fossil_media_json_path_free(path);
+    fossil_media_json_free(doc);
+}
+
+// -----------------------------------------------------------------------------
+// JSONPath: compiled filter query versus a hand-written loop
+// -----------------------------------------------------------------------------
+
+static void bench_query(void) {
+    size_t count = 200000, len = 0;
+    char *text = malloc(count * 48 + 16);
+    if (!text) return;
+    unsigned long st = 11;
+    len += (size_t)sprintf(text, "{\"items\":[");
+    for (size_t k = 0; k < count; ++k)
+        len += (size_t)sprintf(text + len, "%s{\"id\":%zu,\"price\":%lu.5}", k ? "," : "", k, bench_rand(&st) % 20);
+    len += (size_t)sprintf(text + len, "]}");
+    fossil_media_json_value_t *doc = fossil_media_json_parse(text, NULL);
+    fossil_media_json_query_t *query = fossil_media_json_query_compile("$.items[?@.price > 10].id", NULL);
+    if (!doc || !query) return;
+
+    fossil_media_json_query_result_t result = {0};
+    double best_query = 1e30, best_loop = 1e30;
+    volatile size_t sink = 0;
+    for (int r = 0; r < BENCH_RUNS; ++r) {
+        double t0 = bench_now();
+        fossil_media_json_query_run(query, doc, &result, NULL);
+        sink += result.count;
+        double t1 = bench_now();
+        if (t1 - t0 < best_query) best_query = t1 - t0;
+
+        t0 = bench_now();
+        const fossil_media_json_value_t *items = fossil_media_json_object_get(doc, "items");
+        for (size_t k = 0; k < items->u.array.count; ++k) {
+            const fossil_media_json_value_t *item = items->u.array.items[k];
+            const fossil_media_json_value_t *price = fossil_media_json_object_get(item, "price");
+            if (price && price->type == FOSSIL_MEDIA_JSON_NUMBER && price->u.number > 10)
+                sink += fossil_media_json_object_get(item, "id") != NULL;
+        }
+        t1 = bench_now();
+        if (t1 - t0 < best_loop) best_loop = t1 - t0;
+    }
+    (void)sink;
+    printf("query: $.items[?@.price > 10].id over %zu objects\n", count);
+    bench_report("fossil_media_json_query_run", best_query, count, len);
+    bench_report("object_get loop", best_loop, count, len);
+    fossil_media_json_query_result_free(&result);
+    fossil_media_json_query_free(query);
+    fossil_media_json_free(doc);
+    free(text);
+}
+
+// -----------------------------------------------------------------------------
+// On-demand navigation: a few fields out of a large document
+// -----------------------------------------------------------------------------
+
+static void bench_lazy(void) {
+    size_t count = 100000, len = 0;
+    char *text = malloc(count * 64 + 128);
+    if (!text) return;
+    len += (size_t)sprintf(text, "{\"records\":[");
+    for (size_t k = 0; k < count; ++k)
+        len += (size_t)sprintf(text + len, "%s{\"id\":%zu,\"name\":\"record %zu\",\"tags\":[1,2,3]}", k ? "," : "", k, k);
+    len += (size_t)sprintf(text + len, "],\"meta\":{\"version\":3,\"owner\":\"ops\"}}");
+
+    double best_parse = 1e30, best_lazy = 1e30;
+    volatile size_t sink = 0;
+    for (int r = 0; r < BENCH_RUNS; ++r) {
+        double t0 = bench_now();
+        fossil_media_json_value_t *doc = fossil_media_json_parse(text, NULL);
+        long long v = 0;
+        fossil_media_json_get_int(fossil_media_json_get_path_ref(doc, "meta.version"), &v);
+        sink += (size_t)v + (fossil_media_json_get_path_ref(doc, "records[10].name") != NULL);
+        fossil_media_json_free(doc);
+        double t1 = bench_now();
+        if (t1 - t0 < best_parse) best_parse = t1 - t0;
+
+        t0 = bench_now();
+        fossil_media_json_lazy_t *lazy = fossil_media_json_lazy_open(text, NULL);
+        fossil_media_json_lazy_ref_t root = fossil_media_json_lazy_root(lazy);
+        fossil_media_json_lazy_get_int(fossil_media_json_lazy_get_path(root, "meta.version"), &v);
+        sink += (size_t)v + (fossil_media_json_lazy_get_path(root, "records[10].name").doc != NULL);
+        fossil_media_json_lazy_close(lazy);
+        t1 = bench_now();
+        if (t1 - t0 < best_lazy) best_lazy = t1 - t0;
+    }
+    (void)sink;
+    printf("lazy: 2 fields out of %zu records\n", count);
+    bench_report("parse + get_path_ref", best_parse, 1, len);
+    bench_report("fossil_media_json_lazy_get_path", best_lazy, 1, len);
+    free(text);
+}
+
+// -----------------------------------------------------------------------------
+// Patches: copy-then-patch versus in place
+// -----------------------------------------------------------------------------
+
+static void bench_patch(void) {
+    size_t len = 0;
+    char *records = make_record_array(200, &len);
+    if (!records) return;
+    char *text = malloc(len + 64);
+    if (!text) { free(records); return; }
+    sprintf(text, "{\"meta\":{\"version\":1,\"owner\":\"ops\"},\"records\":%s}", records);
+    free(records);
+    fossil_media_json_value_t *doc = fossil_media_json_parse(text, NULL);
+    /* Each pair of patches restores the document, so every run sees the same tree */
+    fossil_media_json_value_t *merge[2] = {
+        fossil_media_json_parse("{\"meta\":{\"version\":2,\"owner\":null,\"tag\":\"t\"}}", NULL),
+        fossil_media_json_parse("{\"meta\":{\"version\":1,\"owner\":\"ops\",\"tag\":null}}", NULL)};
+    fossil_media_json_value_t *ops = fossil_media_json_parse(
+        "[{\"op\":\"replace\",\"path\":\"/meta/version\",\"value\":3},"
+        "{\"op\":\"add\",\"path\":\"/records/7/flag\",\"value\":true},"
+        "{\"op\":\"move\",\"from\":\"/records/7/flag\",\"path\":\"/meta/flag\"},"
+        "{\"op\":\"remove\",\"path\":\"/meta/flag\"},"
+        "{\"op\":\"replace\",\"path\":\"/meta/version\",\"value\":1}]", NULL);
+    free(text);
+    if (!doc || !merge[0] || !merge[1] || !ops) return;
+
+    size_t count = 20000;
+    double best_copy = 1e30, best_merge = 1e30, best_patch = 1e30;
+    volatile size_t sink = 0;
+    for (int r = 0; r < BENCH_RUNS; ++r) {
+        double t0 = bench_now();
+        for (size_t k = 0; k < count; ++k) {
+            fossil_media_json_value_t *copy = fossil_media_json_clone(doc);
+            sink += fossil_media_json_apply_merge_patch(copy, merge[k & 1], NULL) == 0;
+            fossil_media_json_free(copy);
+        }
+        double t1 = bench_now();
+        if (t1 - t0 < best_copy) best_copy = t1 - t0;
+
+        t0 = bench_now();
+        for (size_t k = 0; k < count; ++k) sink += fossil_media_json_apply_merge_patch(doc, merge[k & 1], NULL) == 0;
+        t1 = bench_now();
+        if (t1 - t0 < best_merge) best_merge = t1 - t0;
+
+        t0 = bench_now();
+        for (size_t k = 0; k < count; ++k) sink += fossil_media_json_apply_patch(doc, ops, NULL) == 0;
+        t1 = bench_now();
+        if (t1 - t0 < best_patch) best_patch = t1 - t0;
+    }
+    (void)sink;
+    printf("patches: %zu applications to a %zu-byte document\n", count, len);
+    bench_report("clone + merge patch", best_copy, count, count * len);
+    bench_report("apply_merge_patch (in place)", best_merge, count, count * len);
+    bench_report("apply_patch, 5 ops (in place)", best_patch, count, count * len);
+    fossil_media_json_free(ops);
+    fossil_media_json_free(merge[0]);
+    fossil_media_json_free(merge[1]);
+    fossil_media_json_free(doc);
+}
+
+// -----------------------------------------------------------------------------
+// Hashing: structural hash and equality on read-only documents
+// -----------------------------------------------------------------------------
+
+static void bench_hash(void) {
+    size_t len = 0;
+    char *a = make_record_array(20000, &len);
+    if (!a) return;
+    char *b = malloc(len + 1);
+    if (!b) { free(a); return; }
+    memcpy(b, a, len + 1);
+    /* The documents differ in the host of the last record only */
+    char *host = b + len;
+    while (host > b && strncmp(host, "node-", 5) != 0) host--;
+    host[5] = host[5] == '9' ? '8' : '9';
+    fossil_media_json_parse_options_t opts = {FOSSIL_MEDIA_JSON_PARSE_ARENA, NULL, 0};
+    fossil_media_json_value_t *x = fossil_media_json_parse_ex(a, &opts, NULL);
+    fossil_media_json_value_t *y = fossil_media_json_parse_ex(b, &opts, NULL);
+    free(a);
+    free(b);
+    if (!x || !y) return;
+
+    size_t count = 100;
+    double best_walk = 1e30, best_first = 1e30, best_cached = 1e30, best_reject = 1e30;
+    volatile uint64_t sink = 0;
+    for (int r = 0; r < BENCH_RUNS; ++r) {
+        double t0 = bench_now();
+        for (size_t k = 0; k < count; ++k) sink += (uint64_t)fossil_media_json_equals(x, y);
+        double t1 = bench_now();
+        if (t1 - t0 < best_walk) best_walk = t1 - t0;
+    }
+    /* The first hash fills the caches; it runs once per document */
+    double t0 = bench_now();
+    sink += fossil_media_json_hash(x) ^ fossil_media_json_hash(y);
+    best_first = (bench_now() - t0) / 2;
+    for (int r = 0; r < BENCH_RUNS; ++r) {
+        t0 = bench_now();
+        for (size_t k = 0; k < count; ++k) sink += fossil_media_json_hash(x);
+        double t1 = bench_now();
+        if (t1 - t0 < best_cached) best_cached = t1 - t0;
+
+        t0 = bench_now();
+        for (size_t k = 0; k < count; ++k) sink += (uint64_t)fossil_media_json_equals(x, y);
+        t1 = bench_now();
+        if (t1 - t0 < best_reject) best_reject = t1 - t0;
+    }
+    (void)sink;
+    printf("hash: 20000 records, %.1f MB per document\n", (double)len / 1e6);
+    bench_report("equals (full walk)", best_walk, count, count * len);
+    bench_report("fossil_media_json_hash, first", best_first, 1, len);
+    bench_report("fossil_media_json_hash, cached", best_cached, count, count * len);
+    bench_report("equals with cached hashes", best_reject, count, count * len);
+    fossil_media_json_free(x);
+    fossil_media_json_free(y);
+}
+
+/* Reading a file into a buffer vs parsing from its mapping, copied or in situ */
+static void bench_parse_file(void) {
+    size_t count = 200000;
+    size_t len = 0;
+    char *text = make_record_array(count, &len);
+    const char *file = "bench_json_file.json";
+    FILE *f = text ? fopen(file, "wb") : NULL;
+    if (!f) {
+        free(text);
+        return;
+    }
+    fwrite(text, 1, len, f);
+    fclose(f);
+    free(text);
+
+    fossil_media_json_parse_options_t arena = {FOSSIL_MEDIA_JSON_PARSE_ARENA, NULL, 0};
+    fossil_media_json_parse_options_t insitu = {FOSSIL_MEDIA_JSON_PARSE_INSITU, NULL, 0};
+    double best_read = 1e30, best_map = 1e30, best_insitu = 1e30;
+    size_t found = 0;
+    for (int r = 0; r < BENCH_RUNS; ++r) {
+        double t0 = bench_now();
+        char *buf = fossil_media_read_file(file, NULL);
+        fossil_media_json_value_t *v = fossil_media_json_parse_ex(buf, &arena, NULL);
+        free(buf);
+        found += v != NULL;
+        fossil_media_json_free(v);
+        double t1 = bench_now();
+        if (t1 - t0 < best_read) best_read = t1 - t0;
+
+        t0 = bench_now();
+        v = fossil_media_json_parse_file_ex(file, &arena, NULL);
+        found += v != NULL;
+        fossil_media_json_free(v);
+        t1 = bench_now();
+        if (t1 - t0 < best_map) best_map = t1 - t0;
+
+        t0 = bench_now();
+        v = fossil_media_json_parse_file_ex(file, &insitu, NULL);
+        found += v != NULL;
+        fossil_media_json_free(v);
+        t1 = bench_now();
+        if (t1 - t0 < best_insitu) best_insitu = t1 - t0;
+    }
+    printf("parse_file: %zu records, %.1f MB (%zu parsed)\n", count, (double)len / 1e6, found);
+    bench_report("read_file + parse (arena)", best_read, count, len);
+    bench_report("parse_file_ex (arena)", best_map, count, len);
+    bench_report("parse_file_ex (in situ)", best_insitu, count, len);
+    remove(file);
+}
+
+/* One 1M-record array written serially vs split across threads */
+static void bench_stringify_parallel(void) {
+    size_t count = 1000000;
+    size_t len = 0;
+    char *text = make_record_array(count, &len);
+    fossil_media_json_value_t *doc = text ? fossil_media_json_parse(text, NULL) : NULL;
+    free(text);
+    if (!doc) return;
+
+    fossil_media_json_parallel_options_t opts = {0, 0};
+    double best_serial = 1e30, best_split = 1e30;
+    size_t same = 0;
+    for (int r = 0; r < BENCH_RUNS; ++r) {
+        double t0 = bench_now();
+        char *a = fossil_media_json_stringify(doc, 0, NULL);
+        double t1 = bench_now();
+        if (t1 - t0 < best_serial) best_serial = t1 - t0;
+
+        t0 = bench_now();
+        char *b = fossil_media_json_stringify_ex(doc, 0, &opts, NULL);
+        t1 = bench_now();
+        if (t1 - t0 < best_split) best_split = t1 - t0;
+        same += a && b && strcmp(a, b) == 0;
+        free(a);
+        free(b);
+    }
+    printf("stringify_parallel: %zu records, %.1f MB (%zu identical)\n", count, (double)len / 1e6, same);
+    bench_report("stringify", best_serial, count, len);
+    bench_report("stringify_ex (threads per CPU)", best_split, count, len);
+    fossil_media_json_free(doc);
+}
+
+/* Long free-text strings, some with escapes: parse, validate and stringify */
+static void bench_text(void) {
+    static const char *words[] = {"lorem", "ipsum", "dolor", "sit", "amet,", "consectetur", "adipiscing", "elit.",
+                                  "Sed", "do", "eiusmod", "tempor", "incididunt", "ut", "labore", "et"};
+    size_t count = 50000;
+    char *text = malloc(count * 520 + 2);
+    if (!text) return;
+    unsigned long st = 7;
+    size_t len = 0;
+    text[len++] = '[';
+    for (size_t k = 0; k < count; ++k) {
+        if (k) text[len++] = ',';
+        text[len++] = '"';
+        for (size_t w = 0; w < 64; ++w) {
+            len += (size_t)sprintf(text + len, "%s ", words[bench_rand(&st) % 16]);
+            unsigned long r = bench_rand(&st) % 64;
+            if (r == 0) len += (size_t)sprintf(text + len, "\\n");
+            else if (r == 1) len += (size_t)sprintf(text + len, "\\\"quoted\\\" ");
+            else if (r == 2) len += (size_t)sprintf(text + len, "caf\\u00e9 ");
+        }
+        text[len++] = '"';
+    }
+    text[len++] = ']';
+    text[len] = '\0';
+
+    double best_parse = 1e30, best_validate = 1e30, best_stringify = 1e30;
+    fossil_media_json_value_t *doc = fossil_media_json_parse(text, NULL);
+    for (int r = 0; doc && r < BENCH_RUNS; ++r) {
+        double t0 = bench_now();
+        fossil_media_json_free(fossil_media_json_parse(text, NULL));
+        double t1 = bench_now();
+        if (t1 - t0 < best_parse) best_parse = t1 - t0;
+
+        t0 = bench_now();
+        (void)fossil_media_json_validate(text, NULL);
+        t1 = bench_now();
+        if (t1 - t0 < best_validate) best_validate = t1 - t0;
+
+        t0 = bench_now();
+        free(fossil_media_json_stringify(doc, 0, NULL));
+        t1 = bench_now();
+        if (t1 - t0 < best_stringify) best_stringify = t1 - t0;
+    }
+    printf("text: %zu strings, %.1f MB\n", count, (double)len / 1e6);
+    bench_report("parse + free", best_parse, count, len);
+    bench_report("validate", best_validate, count, len);
+    bench_report("stringify", best_stringify, count, len);
+    fossil_media_json_free(doc);
+    free(text);
+}
+
+int main(void) {
+    bench_numbers();
+    bench_validate();
+    bench_strings();
+    bench_text();
+    bench_ndjson();
+    bench_tape();
+    bench_stringify_numbers();
+    bench_paths();
+    bench_query();
+    bench_lazy();
+    bench_patch();
+    bench_hash();
+    bench_parse_file();
+    bench_stringify_parallel();
+    return 0;
+}
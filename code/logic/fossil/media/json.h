@@ -43,9 +43,13 @@ typedef enum {
     FOSSIL_MEDIA_JSON_OBJECT
 } fossil_media_json_type_t;
 
+/* Error codes (fossil_media_json_error_t.code) */
+#define FOSSIL_MEDIA_JSON_ERROR        1  /* malformed input, allocation failure or misuse */
+#define FOSSIL_MEDIA_JSON_ERROR_DEPTH  2  /* nesting deeper than the configured max_depth */
+
 /* Error struct */
 typedef struct {
-    int code;             /* 0 = OK, non-zero = error */
+    int code;             /* 0 = OK, else a FOSSIL_MEDIA_JSON_ERROR* code */
     size_t position;      /* char offset in input (if applicable) */
     char message[128];    /* short error message (truncated) */
 } fossil_media_json_error_t;
@@ -53,11 +57,165 @@ typedef struct {
 /* Forward declaration */
 typedef struct fossil_media_json_value fossil_media_json_value_t;
 
-/* JSON value */
+/* Parse flags (fossil_media_json_parse_options_t.flags) */
+#define FOSSIL_MEDIA_JSON_PARSE_ARENA        0x0001u  /* place the whole document in one bump arena */
+#define FOSSIL_MEDIA_JSON_PARSE_INTERN_KEYS  0x0002u  /* store each distinct key once (implies ARENA) */
+#define FOSSIL_MEDIA_JSON_PARSE_INSITU       0x0004u  /* parse_file_ex: strings point into the mapped file (implies ARENA) */
+
+/* Shared key table (opaque) */
+typedef struct fossil_media_json_keys fossil_media_json_keys_t;
+
+/* Parse options */
+typedef struct {
+    unsigned int flags;              /* FOSSIL_MEDIA_JSON_PARSE_* bits */
+    fossil_media_json_keys_t *keys;  /* caller-owned key table, or NULL */
+    size_t max_depth;                /* maximum nesting of arrays and objects; 0 = unlimited */
+} fossil_media_json_parse_options_t;
+
+/* Validation flags (fossil_media_json_validate_options_t.flags) */
+#define FOSSIL_MEDIA_JSON_VALIDATE_NO_UTF8  0x0001u  /* accept any bytes >= 0x80 inside strings */
+
+/* Validation limits; zero means unlimited */
+typedef struct {
+    size_t max_depth;     /* maximum nesting of arrays and objects */
+    size_t max_size;      /* maximum input length in bytes */
+    unsigned int flags;   /* FOSSIL_MEDIA_JSON_VALIDATE_* bits */
+} fossil_media_json_validate_options_t;
+
+/*
+ * Event handler for fossil_media_json_parse_sax(). Any callback may be NULL.
+ * A callback returning nonzero aborts the parse. String and key views are
+ * not NUL-terminated; they point into the input when the string has no
+ * escapes, otherwise into a scratch buffer valid only during the call.
+ * Numbers also carry the view of their source text.
+ */
+typedef struct {
+    int (*start_object)(void *user);
+    int (*end_object)(void *user);
+    int (*start_array)(void *user);
+    int (*end_array)(void *user);
+    int (*key)(void *user, const char *str, size_t len);
+    int (*string)(void *user, const char *str, size_t len);
+    int (*number)(void *user, double value, const char *text, size_t len);
+    int (*boolean)(void *user, int value);
+    int (*null)(void *user);
+} fossil_media_json_sax_handler_t;
+
+/* Incremental parser (opaque) */
+typedef struct fossil_media_json_stream fossil_media_json_stream_t;
+
+/*
+ * Receives each completed top-level value of a stream. The callback owns
+ * `value` and must free it. Return 0 to continue, nonzero to stop the stream.
+ */
+typedef int (*fossil_media_json_stream_fn)(fossil_media_json_value_t *value, void *user);
+
+/*
+ * Receives the records of an NDJSON batch in input order. `line` is 1-based
+ * and counts blank lines, which produce no call. For a parsed line `value`
+ * is the record (owned by the callback, which must free it) and `err` is
+ * NULL; for a malformed line `value` is NULL and `err` describes the problem,
+ * with `position` relative to the start of the line. Return 0 to continue,
+ * nonzero to stop.
+ */
+typedef int (*fossil_media_json_ndjson_fn)(fossil_media_json_value_t *value, size_t line,
+                                           const fossil_media_json_error_t *err, void *user);
+
+/* NDJSON batch options */
+typedef struct {
+    size_t threads;       /* parser threads; 0 means one per online CPU */
+    unsigned int flags;   /* FOSSIL_MEDIA_JSON_PARSE_* bits applied to every record */
+    size_t max_depth;     /* maximum nesting within a record; 0 = unlimited */
+} fossil_media_json_ndjson_options_t;
+
+/* Parallel serialization options */
+typedef struct {
+    size_t threads;       /* writer threads; 0 means one per online CPU, 1 means serial */
+    size_t min_items;     /* split only containers with this many children; 0 means 4096 */
+} fossil_media_json_parallel_options_t;
+
+/*
+ * Receives serialized output from a writer, `len` bytes at a time (never
+ * NUL-terminated). Return 0 on success, nonzero to fail the writer.
+ */
+typedef int (*fossil_media_json_sink_fn)(void *user, const char *data, size_t len);
+
+/* Streaming serializer (opaque) */
+typedef struct fossil_media_json_writer fossil_media_json_writer_t;
+
+/* Pre-parsed path for repeated lookups (opaque) */
+typedef struct fossil_media_json_path fossil_media_json_path_t;
+
+/* Compiled JSONPath query (opaque) */
+typedef struct fossil_media_json_query fossil_media_json_query_t;
+
+/*
+ * Nodes selected by a query, borrowed from the queried document. Zero it
+ * before first use; each run overwrites the list and reuses its storage.
+ */
+typedef struct {
+    fossil_media_json_value_t **items;  /* selected nodes, in RFC 9535 order */
+    size_t count;
+    size_t capacity;
+} fossil_media_json_query_result_t;
+
+/* Binary tape opened from a file or buffer (opaque) */
+typedef struct fossil_media_json_tape fossil_media_json_tape_t;
+
+/* A value on a tape; `tape` is NULL when a lookup fails */
+typedef struct {
+    const fossil_media_json_tape_t *tape;
+    size_t pos;                          /* word index (internal) */
+} fossil_media_json_tape_ref_t;
+
+/* Cursor over the elements of a tape array or the members of a tape object */
+typedef struct {
+    fossil_media_json_tape_ref_t value;  /* current element or member value */
+    const char *key;                     /* current member key, NULL in arrays */
+    size_t key_len;
+    const fossil_media_json_tape_t *tape;  /* internal */
+    size_t next, end;                      /* internal */
+    int object;                            /* internal */
+} fossil_media_json_tape_iter_t;
+
+/* Document navigated on demand over borrowed text (opaque) */
+typedef struct fossil_media_json_lazy fossil_media_json_lazy_t;
+
+/* A value in a lazy document; `doc` is NULL when a lookup fails */
+typedef struct {
+    const fossil_media_json_lazy_t *doc;
+    size_t pos;                          /* offset of the value in the text (internal) */
+} fossil_media_json_lazy_ref_t;
+
+/* Cursor over the elements of a lazy array or the members of a lazy object */
+typedef struct {
+    fossil_media_json_lazy_ref_t value;  /* current element or member value */
+    const char *key;                     /* current member key as written (escapes not decoded), NULL in arrays */
+    size_t key_len;
+    const fossil_media_json_lazy_t *doc;   /* internal */
+    size_t next;                           /* internal */
+    int object;                            /* internal */
+} fossil_media_json_lazy_iter_t;
+
+/*
+ * JSON value. On LP64 targets a node is 40 bytes: `flags` sits in the
+ * padding after `type`, and the key index of large objects is kept outside
+ * the node.
+ */
 struct fossil_media_json_value {
     fossil_media_json_type_t type;
+    unsigned int flags;         /* internal storage flags, do not modify */
     union {
-        double number;
+        double number;          /* numeric value; nearest double for integers.
+                                   Assigning it directly drops exact-integer
+                                   storage unless the value is unchanged */
+        struct {
+            double number;      /* same storage as u.number */
+            union {
+                int64_t i64;
+                uint64_t u64;   /* only for values above INT64_MAX */
+            } exact;
+        } integer;              /* numbers with fossil_media_json_is_integer() */
         int boolean;            /* 0 or 1 */
         char *string;           /* NUL-terminated, heap allocated */
         struct {
@@ -65,6 +223,11 @@ struct fossil_media_json_value {
             size_t count;
             size_t capacity;
         } array;
+        /*
+         * Object members are read-only: change them through the object API.
+         * Lookups notice a keys[] array or count changed by hand and rebuild
+         * their index, but not a key string replaced in place.
+         */
         struct {
             char **keys;                         /* keys[i] -> values[i] */
             fossil_media_json_value_t **values;
@@ -92,10 +255,232 @@ struct fossil_media_json_value {
  */
 fossil_media_json_value_t *fossil_media_json_parse(const char *json_text, fossil_media_json_error_t *err_out);
 
+/**
+ * @brief Parse JSON text into a DOM tree with explicit options.
+ *
+ * Behaves like fossil_media_json_parse(), with storage controlled by `opts`.
+ * With FOSSIL_MEDIA_JSON_PARSE_ARENA every node, key array and string of the
+ * document is placed in a single per-document bump arena: parsing performs a
+ * handful of large allocations instead of one per node, and freeing the root
+ * releases the whole document at once. Arena documents keep the regular
+ * fossil_media_json_value_t layout and can be read, stringified, cloned and
+ * compared like any other tree, but they are read-only: set/append/remove/
+ * reserve calls on their nodes fail.
+ *
+ * Object keys can be interned so that every distinct key is stored once and
+ * all occurrences share one pointer. FOSSIL_MEDIA_JSON_PARSE_INTERN_KEYS does
+ * this per document (in its arena). A table from fossil_media_json_keys_create()
+ * in `opts->keys` is shared across documents instead, heap or arena; it must
+ * outlive every document parsed with it. Changing an object of a heap
+ * document gives that object private copies of its keys first.
+ *
+ * Parsing never recurses, so nesting depth is bounded by memory only. Set
+ * `opts->max_depth` to reject deeper input early: the error then carries
+ * FOSSIL_MEDIA_JSON_ERROR_DEPTH and the position of the offending bracket.
+ *
+ * @param json_text  Input JSON text (must be valid UTF-8 and NUL-terminated).
+ * @param opts       Parse options, or NULL for the defaults.
+ * @param err_out    Optional pointer to a fossil_media_json_error_t to store error details.
+ * @return Pointer to the parsed JSON value on success, or NULL on failure.
+ *
+ * @note The returned value must be freed with fossil_media_json_free().
+ */
+fossil_media_json_value_t *fossil_media_json_parse_ex(const char *json_text,
+                                                      const fossil_media_json_parse_options_t *opts,
+                                                      fossil_media_json_error_t *err_out);
+
+/**
+ * @brief Create an empty key table for interning keys across documents.
+ *
+ * Pass the table in fossil_media_json_parse_options_t.keys. A table is not
+ * thread-safe: parse with it from one thread at a time.
+ *
+ * @return New table, or NULL on allocation failure.
+ *
+ * @note The table must be freed with fossil_media_json_keys_free() after
+ *       every document parsed with it.
+ */
+fossil_media_json_keys_t *fossil_media_json_keys_create(void);
+
+/**
+ * @brief Free a key table. Safe with NULL.
+ *
+ * @param keys  Table to free.
+ */
+void fossil_media_json_keys_free(fossil_media_json_keys_t *keys);
+
+/**
+ * @brief Get the table's copy of a key, adding it if needed.
+ *
+ * Looking members up with the returned pointer lets
+ * fossil_media_json_object_get() match interned keys by address.
+ *
+ * @param keys  Key table.
+ * @param key   NUL-terminated key.
+ * @return Interned key (valid until the table is freed), or NULL on error.
+ */
+const char *fossil_media_json_keys_intern(fossil_media_json_keys_t *keys, const char *key);
+
+/**
+ * @brief Number of distinct keys in a table.
+ *
+ * @param keys  Key table (may be NULL).
+ * @return Distinct key count.
+ */
+size_t fossil_media_json_keys_count(const fossil_media_json_keys_t *keys);
+
+/**
+ * @brief Parse JSON text in situ, reusing the caller's buffer for strings.
+ *
+ * Like fossil_media_json_parse_ex() with FOSSIL_MEDIA_JSON_PARSE_ARENA, except
+ * that strings and object keys are not copied: each one is NUL-terminated (and
+ * unescaped, if needed) inside `json_text`, and the document points into it.
+ * This suits buffers the caller owns anyway, such as those returned by
+ * fossil_media_read_file(), and leaves nodes and key arrays as the only
+ * allocations.
+ *
+ * The buffer is modified: it no longer holds valid JSON afterwards, and after
+ * a failed parse its contents are unspecified. It must stay alive and
+ * unchanged until the document is freed. The document is read-only, like any
+ * arena document.
+ *
+ * @param json_text  Mutable, NUL-terminated input JSON text.
+ * @param opts       Parse options, or NULL for the defaults.
+ * @param err_out    Optional pointer to error details.
+ * @return Pointer to the parsed JSON value on success, or NULL on failure.
+ *
+ * @note The returned value must be freed with fossil_media_json_free(), which
+ *       does not free `json_text`.
+ */
+fossil_media_json_value_t *fossil_media_json_parse_insitu(char *json_text,
+                                                          const fossil_media_json_parse_options_t *opts,
+                                                          fossil_media_json_error_t *err_out);
+
+/**
+ * @brief Parse JSON text as a stream of events, without building a DOM.
+ *
+ * Accepts exactly the grammar of fossil_media_json_parse() and reports the
+ * same errors, but calls `handler` for each value in document order instead
+ * of allocating nodes. No heap memory is used unless a string has escapes.
+ *
+ * @param json_text  Input JSON text (must be valid UTF-8 and NUL-terminated).
+ * @param handler    Event callbacks (must not be NULL).
+ * @param user       Opaque pointer passed to every callback.
+ * @param err_out    Optional pointer to error details.
+ * @return 0 on success, nonzero on error or when a callback aborts.
+ */
+int fossil_media_json_parse_sax(const char *json_text,
+                                const fossil_media_json_sax_handler_t *handler,
+                                void *user,
+                                fossil_media_json_error_t *err_out);
+
+/**
+ * @brief Create a push parser for chunked input.
+ *
+ * The stream accepts a sequence of whitespace-separated JSON values (a single
+ * document, NDJSON, or concatenated values) delivered in arbitrary chunks.
+ * Objects, arrays and strings end themselves, so the next value may follow
+ * directly; a number or literal must be followed by whitespace, and `42"s"`
+ * is a syntax error.
+ * Chunk boundaries may fall anywhere, including inside strings, escapes and
+ * numbers. Each top-level value is handed to `cb` as soon as its last byte
+ * arrives, so memory is bounded by the largest single value rather than by
+ * the whole stream.
+ *
+ * @param opts  Parse options applied to every value, or NULL for the defaults.
+ * @param cb    Callback receiving completed values (must not be NULL).
+ * @param user  Opaque pointer passed to `cb`.
+ * @return New stream, or NULL on allocation failure.
+ *
+ * @note The stream must be released with fossil_media_json_stream_free().
+ */
+fossil_media_json_stream_t *fossil_media_json_stream_create(const fossil_media_json_parse_options_t *opts,
+                                                            fossil_media_json_stream_fn cb,
+                                                            void *user);
+
+/**
+ * @brief Feed the next chunk of input to a stream.
+ *
+ * Error positions are byte offsets from the start of the stream. After an
+ * error (or a callback requesting a stop) every further call fails.
+ *
+ * @param stream   Stream created by fossil_media_json_stream_create().
+ * @param data     Chunk bytes (not NUL-terminated; embedded NULs are errors).
+ * @param len      Number of bytes in `data`.
+ * @param err_out  Optional pointer to error details.
+ * @return 0 on success, nonzero on error.
+ */
+int fossil_media_json_stream_feed(fossil_media_json_stream_t *stream,
+                                  const char *data, size_t len,
+                                  fossil_media_json_error_t *err_out);
+
+/**
+ * @brief Signal end of input.
+ *
+ * Completes a trailing top-level number or literal, and reports an error if
+ * the input ends inside a value.
+ *
+ * @param stream   Stream created by fossil_media_json_stream_create().
+ * @param err_out  Optional pointer to error details.
+ * @return 0 on success, nonzero on error.
+ */
+int fossil_media_json_stream_finish(fossil_media_json_stream_t *stream, fossil_media_json_error_t *err_out);
+
+/**
+ * @brief Release a stream and any partially buffered value. Safe with NULL.
+ *
+ * @param stream  Stream to free.
+ */
+void fossil_media_json_stream_free(fossil_media_json_stream_t *stream);
+
+/**
+ * @brief Parse newline-delimited JSON (JSON Lines) on several threads.
+ *
+ * Each line of `data` is parsed as one document. The input is split into
+ * batches of whole lines that worker threads parse concurrently, while the
+ * calling thread invokes `cb` for every record strictly in input order; only
+ * a few batches per worker are held ahead of the callback. A malformed line
+ * is reported through `cb` and does not stop the batch. Lines may end in
+ * "\n" or "\r\n"; blank lines are skipped.
+ *
+ * @param data     Input bytes (need not be NUL-terminated).
+ * @param len      Number of bytes in `data`.
+ * @param opts     Thread count and parse flags, or NULL for the defaults.
+ * @param cb       Record callback (must not be NULL), always called on the
+ *                 calling thread.
+ * @param user     Opaque pointer passed to `cb`.
+ * @param err_out  Optional pointer to details of the earliest problem: the
+ *                 first malformed line (position is an offset into `data`),
+ *                 or else the stop or allocation failure.
+ * @return 0 if every line parsed, nonzero if any line failed or `cb` stopped.
+ */
+int fossil_media_json_parse_ndjson(const char *data, size_t len,
+                                   const fossil_media_json_ndjson_options_t *opts,
+                                   fossil_media_json_ndjson_fn cb, void *user,
+                                   fossil_media_json_error_t *err_out);
+
+/**
+ * @brief Parse an NDJSON file with fossil_media_json_parse_ndjson().
+ *
+ * @param filename  Path to the file.
+ * @param opts      Thread count and parse flags, or NULL for the defaults.
+ * @param cb        Record callback (must not be NULL).
+ * @param user      Opaque pointer passed to `cb`.
+ * @param err_out   Optional pointer to error details.
+ * @return 0 if every line parsed, nonzero otherwise or if the file cannot be read.
+ */
+int fossil_media_json_parse_ndjson_file(const char *filename,
+                                        const fossil_media_json_ndjson_options_t *opts,
+                                        fossil_media_json_ndjson_fn cb, void *user,
+                                        fossil_media_json_error_t *err_out);
+
 /**
  * @brief Free a JSON DOM tree.
  *
- * Recursively frees a JSON value and all its children. Safe to call with NULL.
+ * Frees a JSON value and all its children, without recursion or allocation
+ * at any depth. Safe to call with NULL.
+ * For arena documents, freeing the root releases the whole arena in O(1);
+ * freeing any other node of an arena document is a no-op.
  *
  * @param v  Pointer to the JSON value to free.
  */
@@ -173,6 +558,10 @@ int fossil_media_json_object_set(fossil_media_json_value_t *obj, const char *key
 /**
  * @brief Get a value from a JSON object by key.
  *
+ * Objects with more than a few keys build a hash index on first lookup, so
+ * lookups are O(1) on average; members keep their insertion order. Building
+ * the index is safe when several threads read the same object.
+ *
  * @param obj  JSON object value (must be of type OBJECT).
  * @param key  Key string (UTF-8).
  * @return Pointer to the JSON value, or NULL if not found.
@@ -234,10 +623,33 @@ size_t fossil_media_json_array_size(const fossil_media_json_value_t *arr);
  * @param err_out  Optional pointer to store error details.
  * @return Newly allocated NUL-terminated string on success, or NULL on failure.
  *
+ * Numbers are written as the shortest decimal that parses back to the same
+ * double (0.1 becomes "0.1", 1e21 becomes "1e21"); integral values below 2^53
+ * are written as plain integers. NaN and infinities are written as null.
+ *
  * @note Caller must free the returned string using free().
  */
 char *fossil_media_json_stringify(const fossil_media_json_value_t *v, int pretty, fossil_media_json_error_t *err_out);
 
+/**
+ * @brief Convert a JSON value to a string, writing large containers in parallel.
+ *
+ * Each array or object with at least `opts->min_items` children is cut into
+ * runs of children that are serialized on worker threads and joined in
+ * order. The output is byte-for-byte the same as fossil_media_json_stringify();
+ * only arrays and objects at least that large use the threads. The document
+ * must not be modified during the call.
+ *
+ * @param v        JSON value to stringify.
+ * @param pretty   Nonzero for human-readable output with indentation.
+ * @param opts     Thread count and split threshold; NULL writes serially.
+ * @param err_out  Optional pointer to store error details.
+ * @return Newly allocated NUL-terminated string on success, or NULL on failure.
+ */
+char *fossil_media_json_stringify_ex(const fossil_media_json_value_t *v, int pretty,
+                                     const fossil_media_json_parallel_options_t *opts,
+                                     fossil_media_json_error_t *err_out);
+
 /**
  * @brief Parse JSON text and then stringify it back.
  *
@@ -260,6 +672,120 @@ char *fossil_media_json_roundtrip(const char *json_text, int pretty, fossil_medi
  */
 const char *fossil_media_json_type_name(fossil_media_json_type_t t);
 
+/** @name Streaming Writer
+ *  @{
+ */
+
+/**
+ * @brief Create a writer that serializes to a sink.
+ *
+ * Output is collected in a fixed internal buffer (64 KiB) and passed to
+ * `sink` each time it fills, so documents of any size can be written without
+ * a contiguous copy. A document is produced either from a DOM with
+ * fossil_media_json_writer_value() or piece by piece with the begin/end,
+ * key and scalar calls, which may be mixed. The output is byte-for-byte the
+ * same as fossil_media_json_stringify() with the same `pretty` setting.
+ *
+ * Every call returns 0 on success and nonzero on error. Errors are sticky:
+ * after a sink failure or an out-of-order call (a value where a key is
+ * required, an unbalanced end, a second top-level value) all further calls
+ * fail, and fossil_media_json_writer_finish() reports the first error.
+ *
+ * @param sink    Output callback (must not be NULL).
+ * @param user    Opaque pointer passed to `sink`.
+ * @param pretty  Nonzero for human-readable indentation.
+ * @return New writer, or NULL on allocation failure.
+ *
+ * @note The writer must be released with fossil_media_json_writer_free().
+ */
+fossil_media_json_writer_t *fossil_media_json_writer_create(fossil_media_json_sink_fn sink, void *user, int pretty);
+
+/**
+ * @brief Sink writing to a stdio stream; pass the FILE* as `user`.
+ */
+int fossil_media_json_sink_file(void *file, const char *data, size_t len);
+
+/** @brief Open an object. */
+int fossil_media_json_writer_begin_object(fossil_media_json_writer_t *w);
+
+/** @brief Close the innermost object. */
+int fossil_media_json_writer_end_object(fossil_media_json_writer_t *w);
+
+/** @brief Open an array. */
+int fossil_media_json_writer_begin_array(fossil_media_json_writer_t *w);
+
+/** @brief Close the innermost array. */
+int fossil_media_json_writer_end_array(fossil_media_json_writer_t *w);
+
+/** @brief Write an object member name; the next call must write its value. */
+int fossil_media_json_writer_key(fossil_media_json_writer_t *w, const char *key);
+
+/** @brief Write a string value. */
+int fossil_media_json_writer_string(fossil_media_json_writer_t *w, const char *s);
+
+/** @brief Write a number value (NaN and infinities are written as null). */
+int fossil_media_json_writer_number(fossil_media_json_writer_t *w, double value);
+
+/** @brief Write a signed integer value exactly. */
+int fossil_media_json_writer_int(fossil_media_json_writer_t *w, long long value);
+
+/** @brief Write an unsigned integer value exactly. */
+int fossil_media_json_writer_uint(fossil_media_json_writer_t *w, unsigned long long value);
+
+/** @brief Write a boolean value. */
+int fossil_media_json_writer_bool(fossil_media_json_writer_t *w, int value);
+
+/** @brief Write a null value. */
+int fossil_media_json_writer_null(fossil_media_json_writer_t *w);
+
+/**
+ * @brief Write a whole DOM tree as one value.
+ *
+ * @param w  Writer.
+ * @param v  Value to serialize; usable anywhere a scalar call would be.
+ * @return 0 on success, nonzero on error.
+ */
+int fossil_media_json_writer_value(fossil_media_json_writer_t *w, const fossil_media_json_value_t *v);
+
+/**
+ * @brief Let later fossil_media_json_writer_value() calls use worker threads.
+ *
+ * Large containers are split as in fossil_media_json_stringify_ex(); the
+ * sink still receives the output in order, from the calling thread only.
+ *
+ * @param w     Writer.
+ * @param opts  Thread count and split threshold; NULL goes back to serial.
+ * @return 0 on success, nonzero if `w` is NULL.
+ */
+int fossil_media_json_writer_set_parallel(fossil_media_json_writer_t *w,
+                                          const fossil_media_json_parallel_options_t *opts);
+
+/**
+ * @brief Pass buffered output to the sink now.
+ *
+ * @param w  Writer.
+ * @return 0 on success, nonzero on error.
+ */
+int fossil_media_json_writer_flush(fossil_media_json_writer_t *w);
+
+/**
+ * @brief Check that exactly one complete value was written and flush it.
+ *
+ * @param w        Writer.
+ * @param err_out  Optional pointer to details of the first error.
+ * @return 0 on success, nonzero on error.
+ */
+int fossil_media_json_writer_finish(fossil_media_json_writer_t *w, fossil_media_json_error_t *err_out);
+
+/**
+ * @brief Release a writer without flushing. Safe with NULL.
+ *
+ * @param w  Writer to free.
+ */
+void fossil_media_json_writer_free(fossil_media_json_writer_t *w);
+
+/** @} */
+
 /** @name Clone & Equality
  *  @{
  */
@@ -278,7 +804,12 @@ fossil_media_json_clone(const fossil_media_json_value_t *src);
 /**
  * @brief Compare two JSON values for equality.
  *
- * Performs a deep structural and value comparison.
+ * Performs a deep structural and value comparison. Object members match by
+ * key in any order; duplicate keys pair up in order of appearance (the
+ * first "a" of one object with the first "a" of the other, and so on).
+ * Containers of read-only documents whose hashes were already computed with
+ * fossil_media_json_hash() are told apart by hash without visiting their
+ * children.
  *
  * @param a  First JSON value.
  * @param b  Second JSON value.
@@ -287,6 +818,22 @@ fossil_media_json_clone(const fossil_media_json_value_t *src);
 int fossil_media_json_equals(const fossil_media_json_value_t *a,
                              const fossil_media_json_value_t *b);
 
+/**
+ * @brief 64-bit structural hash of a JSON value.
+ *
+ * Values that compare equal with fossil_media_json_equals() hash equally:
+ * numbers hash by value (1, 1.0 and 1e0 alike), arrays in order and object
+ * members in any order. The hash does not depend on the host, so it can key
+ * caches or deduplicate documents without serializing them.
+ *
+ * Containers of read-only (arena) documents cache their hash, making later
+ * calls O(1). Mutable trees are hashed in full on every call.
+ *
+ * @param v  JSON value.
+ * @return Nonzero hash, or 0 if `v` is NULL or memory runs out.
+ */
+uint64_t fossil_media_json_hash(const fossil_media_json_value_t *v);
+
 /** @} */
 
 /** @name Type Helpers
@@ -354,7 +901,7 @@ int fossil_media_json_object_reserve(fossil_media_json_value_t *obj, size_t capa
 /**
  * @brief Parse a JSON file into a DOM tree.
  *
- * Reads the entire file and parses it into an internal DOM structure.
+ * Same as fossil_media_json_parse_file_ex() with default options.
  *
  * @param filename Path to JSON file.
  * @param err_out  Optional pointer to error details.
@@ -363,10 +910,34 @@ int fossil_media_json_object_reserve(fossil_media_json_value_t *obj, size_t capa
 fossil_media_json_value_t *
 fossil_media_json_parse_file(const char *filename, fossil_media_json_error_t *err_out);
 
+/**
+ * @brief Parse a JSON file with options, straight from a memory mapping.
+ *
+ * The file is mapped rather than copied into a buffer where the platform
+ * allows it; files that cannot be mapped, and files whose size is an exact
+ * multiple of the page size, are read into a buffer instead. Parsing stops at
+ * the first NUL byte, as it does for a string.
+ *
+ * By default the document copies what it keeps and the mapping is released
+ * before this returns. With FOSSIL_MEDIA_JSON_PARSE_INSITU the file is mapped
+ * copy-on-write and parsed as by fossil_media_json_parse_insitu(): strings
+ * point into the mapping, which stays alive until the document is freed. The
+ * file itself is never modified.
+ *
+ * @param filename Path to JSON file.
+ * @param opts     Parse options, or NULL for the defaults.
+ * @param err_out  Optional pointer to error details.
+ * @return Pointer to the parsed JSON value, or NULL on failure.
+ */
+fossil_media_json_value_t *fossil_media_json_parse_file_ex(const char *filename,
+                                                           const fossil_media_json_parse_options_t *opts,
+                                                           fossil_media_json_error_t *err_out);
+
 /**
  * @brief Write a JSON value to a file.
  *
- * Serializes the JSON value and writes it to the given file.
+ * Serializes the JSON value straight to the file through a streaming
+ * writer, without building the whole string in memory.
  *
  * @param v        JSON value to write.
  * @param filename Path to output file.
@@ -381,82 +952,696 @@ int fossil_media_json_write_file(const fossil_media_json_value_t *v,
 
 /** @} */
 
-/** @name Number Handling
+/** @name Binary Tape
  *  @{
  */
 
 /**
- * @brief Create a JSON integer value.
+ * @brief Flatten a JSON value into a relocatable binary tape.
  *
- * Stores an integer in a JSON number node (lossless if within range).
+ * A tape is a contiguous array of tagged 64-bit words plus a pool of
+ * strings, in which every distinct string is stored once. It is meant as a
+ * cache of a parsed document: fossil_media_json_tape_open() maps it back in
+ * without parsing, and the tape_* accessors read it in place. Integers keep
+ * their exact 64-bit values. Tapes use the host byte order.
  *
- * @param i  Integer value.
- * @return Newly allocated JSON number value, or NULL if allocation fails.
+ * @param v        JSON value to encode.
+ * @param len_out  Receives the tape size in bytes (optional).
+ * @param err_out  Optional pointer to error details.
+ * @return Heap-allocated tape, or NULL on failure. Release with free().
  */
-fossil_media_json_value_t *fossil_media_json_new_int(long long i);
+void *fossil_media_json_tape_encode(const fossil_media_json_value_t *v, size_t *len_out,
+                                    fossil_media_json_error_t *err_out);
 
 /**
- * @brief Get an integer from a JSON number.
+ * @brief Encode a JSON value and write the tape to a file.
  *
- * @param v    JSON number value.
- * @param out  Output pointer to receive integer value.
- * @return 0 on success, nonzero if not a number or out of range.
+ * @param v        JSON value to encode.
+ * @param filename Path to output file.
+ * @param err_out  Optional pointer to error details.
+ * @return 0 on success, nonzero on error.
  */
-int fossil_media_json_get_int(const fossil_media_json_value_t *v, long long *out);
+int fossil_media_json_tape_write_file(const fossil_media_json_value_t *v, const char *filename,
+                                      fossil_media_json_error_t *err_out);
 
-/** @} */
-
-/** @name Debug & Validation
- *  @{
+/**
+ * @brief Map a tape file read-only.
+ *
+ * Only the header is checked here, so opening costs the same for any size
+ * of file and pages are read as they are visited. Every accessor is
+ * bounds-checked, so a damaged file yields failed lookups, never reads
+ * outside the mapping.
+ *
+ * @param filename Path to a file written by fossil_media_json_tape_write_file().
+ * @param err_out  Optional pointer to error details.
+ * @return Tape handle, or NULL on failure.
+ *
+ * @note The tape must be closed with fossil_media_json_tape_close().
  */
+fossil_media_json_tape_t *fossil_media_json_tape_open(const char *filename, fossil_media_json_error_t *err_out);
 
 /**
- * @brief Print a debug dump of a JSON value.
+ * @brief Read a tape from memory without copying it.
  *
- * Dumps the JSON tree in a human-readable indented format for debugging.
+ * Like fossil_media_json_tape_open() for a buffer such as the result of
+ * fossil_media_json_tape_encode(). The buffer needs no particular alignment
+ * and must outlive the tape.
  *
- * @param v      JSON value to dump.
- * @param indent Starting indentation level.
+ * @param data     Tape bytes.
+ * @param len      Size of `data` in bytes.
+ * @param err_out  Optional pointer to error details.
+ * @return Tape handle, or NULL on failure.
+ *
+ * @note The tape must be closed with fossil_media_json_tape_close().
  */
-void fossil_media_json_debug_dump(const fossil_media_json_value_t *v, int indent);
+fossil_media_json_tape_t *fossil_media_json_tape_load(const void *data, size_t len,
+                                                      fossil_media_json_error_t *err_out);
 
 /**
- * @brief Validate JSON text without building a DOM.
+ * @brief Close a tape, unmapping its file. Safe with NULL.
  *
- * Parses the text and discards the result, returning only validity status.
+ * @param tape  Tape to close. References into it become invalid.
+ */
+void fossil_media_json_tape_close(fossil_media_json_tape_t *tape);
+
+/**
+ * @brief Reference to the top-level value of a tape.
  *
- * @param json_text  Input JSON text (NUL-terminated).
- * @param err_out    Optional pointer to error details.
- * @return 0 if valid, nonzero if invalid.
+ * @param tape  Open tape.
+ * @return Root reference (with a NULL `tape` if `tape` is NULL).
  */
-int fossil_media_json_validate(const char *json_text, fossil_media_json_error_t *err_out);
+fossil_media_json_tape_ref_t fossil_media_json_tape_root(const fossil_media_json_tape_t *tape);
 
-/** @} */
+/**
+ * @brief Type of a tape value.
+ *
+ * @param ref  Tape reference.
+ * @return Value type; FOSSIL_MEDIA_JSON_NULL for a failed reference.
+ */
+fossil_media_json_type_t fossil_media_json_tape_type(fossil_media_json_tape_ref_t ref);
 
-/** @name Path Access
- *  @{
+/**
+ * @brief Number of elements of a tape array or members of a tape object.
+ *
+ * @param ref  Tape reference.
+ * @return Element or member count, 0 for other values.
  */
+size_t fossil_media_json_tape_size(fossil_media_json_tape_ref_t ref);
 
 /**
- * @brief Get a JSON value using a dotted path expression.
+ * @brief Element of a tape array.
  *
- * Supports object keys and array indices, e.g. "user.name" or "items[2].id".
+ * Skips the preceding elements, one jump per nested container, so the cost
+ * grows with `index`. Use an iterator to visit every element.
  *
- * @param root  Root JSON value.
- * @param path  Path string (UTF-8, cannot be NULL).
- * @return Pointer to the JSON value, or NULL if not found.
+ * @param arr    Array reference.
+ * @param index  Element index.
+ * @return Element reference; its `tape` is NULL if out of range.
  */
-fossil_media_json_value_t *
-fossil_media_json_get_path(const fossil_media_json_value_t *root, const char *path);
+fossil_media_json_tape_ref_t fossil_media_json_tape_index(fossil_media_json_tape_ref_t arr, size_t index);
 
-/** @} */
+/**
+ * @brief Member of a tape object by key (first match).
+ *
+ * @param obj  Object reference.
+ * @param key  NUL-terminated key.
+ * @return Member value reference; its `tape` is NULL if the key is absent.
+ */
+fossil_media_json_tape_ref_t fossil_media_json_tape_get(fossil_media_json_tape_ref_t obj, const char *key);
 
+/**
+ * @brief Start iterating over a tape array or object.
+ *
+ * Each successful fossil_media_json_tape_iter_next() call moves `it->value`
+ * (and, for objects, `it->key`/`it->key_len`) to the next item.
+ *
+ * @param container  Array or object reference.
+ * @param it         Iterator to initialize.
+ * @return 0 on success, nonzero if `container` is not an array or object.
+ */
+int fossil_media_json_tape_iter_init(fossil_media_json_tape_ref_t container, fossil_media_json_tape_iter_t *it);
 
-#ifdef __cplusplus
-}
-#include <string>
-#include <stdexcept>
-#include <utility>
+/**
+ * @brief Advance a tape iterator.
+ *
+ * @param it  Iterator from fossil_media_json_tape_iter_init().
+ * @return 1 if positioned on an item, 0 at the end.
+ */
+int fossil_media_json_tape_iter_next(fossil_media_json_tape_iter_t *it);
+
+/**
+ * @brief String of a tape value, pointing into the tape.
+ *
+ * @param ref      Tape reference.
+ * @param len_out  Receives the length in bytes (optional).
+ * @return NUL-terminated string valid until the tape is closed, or NULL if
+ *         `ref` is not a string.
+ */
+const char *fossil_media_json_tape_get_string(fossil_media_json_tape_ref_t ref, size_t *len_out);
+
+/**
+ * @brief Number of a tape value as a double.
+ *
+ * @param ref  Tape reference.
+ * @param out  Receives the value.
+ * @return 0 on success, nonzero if `ref` is not a number.
+ */
+int fossil_media_json_tape_get_number(fossil_media_json_tape_ref_t ref, double *out);
+
+/**
+ * @brief Integer of a tape number, as fossil_media_json_get_int().
+ *
+ * @param ref  Tape reference.
+ * @param out  Receives the value.
+ * @return 0 on success, nonzero if not a number or out of range.
+ */
+int fossil_media_json_tape_get_int(fossil_media_json_tape_ref_t ref, long long *out);
+
+/**
+ * @brief Unsigned integer of a tape number, as fossil_media_json_get_uint().
+ *
+ * @param ref  Tape reference.
+ * @param out  Receives the value.
+ * @return 0 on success, nonzero if not a number or out of range.
+ */
+int fossil_media_json_tape_get_uint(fossil_media_json_tape_ref_t ref, unsigned long long *out);
+
+/**
+ * @brief Boolean of a tape value.
+ *
+ * @param ref  Tape reference.
+ * @param out  Receives 0 or 1.
+ * @return 0 on success, nonzero if `ref` is not a boolean.
+ */
+int fossil_media_json_tape_get_bool(fossil_media_json_tape_ref_t ref, int *out);
+
+/**
+ * @brief Rebuild a tape value (and everything below it) as a DOM tree.
+ *
+ * @param ref      Tape reference.
+ * @param err_out  Optional pointer to error details.
+ * @return New heap value, or NULL on failure.
+ *
+ * @note The returned value must be freed with fossil_media_json_free().
+ */
+fossil_media_json_value_t *fossil_media_json_tape_to_value(fossil_media_json_tape_ref_t ref,
+                                                           fossil_media_json_error_t *err_out);
+
+/** @} */
+
+/** @name Number Handling
+ *  @{
+ */
+
+/**
+ * @brief Create a JSON integer value.
+ *
+ * Stores the exact 64-bit integer in a JSON number node (u.number holds the
+ * nearest double), so values above 2^53 survive get_int() and stringify.
+ *
+ * @param i  Integer value.
+ * @return Newly allocated JSON number value, or NULL if allocation fails.
+ */
+fossil_media_json_value_t *fossil_media_json_new_int(long long i);
+
+/**
+ * @brief Create a JSON unsigned integer value.
+ *
+ * Like fossil_media_json_new_int(), for the full unsigned 64-bit range.
+ *
+ * @param u  Unsigned integer value.
+ * @return Newly allocated JSON number value, or NULL if allocation fails.
+ */
+fossil_media_json_value_t *fossil_media_json_new_uint(unsigned long long u);
+
+/**
+ * @brief Check whether a number holds an exact integer.
+ *
+ * True for values from fossil_media_json_new_int()/new_uint() and for parsed
+ * integer literals (no fraction or exponent) within [-2^63, 2^64), as long
+ * as u.number has not since been assigned a different value.
+ *
+ * @param v  JSON value.
+ * @return 1 if `v` is a number with exact integer storage, else 0.
+ */
+int fossil_media_json_is_integer(const fossil_media_json_value_t *v);
+
+/**
+ * @brief Get an integer from a JSON number.
+ *
+ * Exact integers are returned as stored; other numbers are truncated toward
+ * zero.
+ *
+ * @param v    JSON number value.
+ * @param out  Output pointer to receive integer value.
+ * @return 0 on success, nonzero if not a number or out of range.
+ */
+int fossil_media_json_get_int(const fossil_media_json_value_t *v, long long *out);
+
+/**
+ * @brief Get an unsigned integer from a JSON number.
+ *
+ * @param v    JSON number value.
+ * @param out  Output pointer to receive the value.
+ * @return 0 on success, nonzero if not a number, negative or out of range.
+ */
+int fossil_media_json_get_uint(const fossil_media_json_value_t *v, unsigned long long *out);
+
+/** @} */
+
+/** @name Debug & Validation
+ *  @{
+ */
+
+/**
+ * @brief Print a debug dump of a JSON value.
+ *
+ * Dumps the JSON tree in a human-readable indented format for debugging.
+ *
+ * @param v      JSON value to dump.
+ * @param indent Starting indentation level.
+ */
+void fossil_media_json_debug_dump(const fossil_media_json_value_t *v, int indent);
+
+/**
+ * @brief Validate JSON text without building a DOM.
+ *
+ * Scans the text against the grammar of fossil_media_json_parse() without
+ * allocating, and reports the same error message and position the parser
+ * would. String contents must also be well-formed UTF-8.
+ *
+ * @param json_text  Input JSON text (NUL-terminated).
+ * @param err_out    Optional pointer to error details.
+ * @return 0 if valid, nonzero if invalid.
+ */
+int fossil_media_json_validate(const char *json_text, fossil_media_json_error_t *err_out);
+
+/**
+ * @brief Validate JSON text with explicit limits.
+ *
+ * Behaves like fossil_media_json_validate(), and additionally rejects input
+ * longer than `max_size` bytes ("Input exceeds maximum size", reported at
+ * offset max_size without reading further) and containers nested deeper
+ * than `max_depth` ("Maximum nesting depth exceeded", at the opening
+ * bracket). No memory is allocated unless max_depth is zero and the input
+ * nests more than 4096 levels deep.
+ *
+ * @param json_text  Input JSON text (NUL-terminated).
+ * @param opts       Limits and flags, or NULL for the defaults.
+ * @param err_out    Optional pointer to error details.
+ * @return 0 if valid, nonzero if invalid.
+ */
+int fossil_media_json_validate_ex(const char *json_text,
+                                  const fossil_media_json_validate_options_t *opts,
+                                  fossil_media_json_error_t *err_out);
+
+/** @} */
+
+/** @name Path Access
+ *  @{
+ */
+
+/**
+ * @brief Get a JSON value using a dotted path expression.
+ *
+ * Supports object keys and array indices, e.g. "user.name" or "items[2].id".
+ * Quoted keys ("key.with.dots") may contain dots and brackets.
+ *
+ * @param root  Root JSON value.
+ * @param path  Path string (UTF-8, cannot be NULL).
+ * @return Deep copy of the JSON value, or NULL if not found.
+ *
+ * @note The returned copy must be freed with fossil_media_json_free(). Use
+ *       fossil_media_json_get_path_ref() to avoid the copy.
+ */
+fossil_media_json_value_t *
+fossil_media_json_get_path(const fossil_media_json_value_t *root, const char *path);
+
+/**
+ * @brief Borrowed variant of fossil_media_json_get_path().
+ *
+ * Same syntax, but returns the node inside `root` itself and allocates
+ * nothing. The result stays valid until that node is removed or `root`
+ * is freed.
+ *
+ * @param root  Root JSON value.
+ * @param path  Path string (UTF-8, cannot be NULL).
+ * @return Pointer into `root`, or NULL if not found or the path is malformed.
+ */
+fossil_media_json_value_t *
+fossil_media_json_get_path_ref(const fossil_media_json_value_t *root, const char *path);
+
+/**
+ * @brief Pre-parse a path for repeated lookups.
+ *
+ * Splits the path into key and index segments once, hashing each key, so
+ * that fossil_media_json_path_get() only walks the tree. A compiled path is
+ * immutable and may be shared between threads.
+ *
+ * @param path     Path string in the syntax of fossil_media_json_get_path().
+ * @param err_out  Optional pointer to error details for a malformed path.
+ * @return Compiled path, or NULL on error.
+ *
+ * @note The compiled path must be released with fossil_media_json_path_free().
+ */
+fossil_media_json_path_t *
+fossil_media_json_path_compile(const char *path, fossil_media_json_error_t *err_out);
+
+/**
+ * @brief Look up a compiled path (borrowed result, no allocation).
+ *
+ * @param path  Compiled path.
+ * @param root  Root JSON value.
+ * @return Pointer into `root`, or NULL if not found.
+ */
+fossil_media_json_value_t *
+fossil_media_json_path_get(const fossil_media_json_path_t *path, const fossil_media_json_value_t *root);
+
+/**
+ * @brief Release a compiled path. Safe with NULL.
+ *
+ * @param path  Compiled path to free.
+ */
+void fossil_media_json_path_free(fossil_media_json_path_t *path);
+
+/** @} */
+
+/** @name JSONPath Queries
+ *  @{
+ */
+
+/**
+ * @brief Compile an RFC 9535 JSONPath query.
+ *
+ * Supports member names (.name, ['name']), wildcards (.*, [*]), indices
+ * ([0], [-1]), slices ([1:10:2]), descendant segments (..name, ..[0]),
+ * unions ([0,'a']) and filters such as [?@.price > 10 && @.tags] or
+ * [?(@.kind == 'book')]. Function extensions (length(), match(), ...) are
+ * not supported. A compiled query is immutable and may be run against any
+ * number of documents, from several threads at once.
+ *
+ * @param expr     Query text starting with '$'.
+ * @param err_out  Optional pointer to error details; position is the offset
+ *                 in `expr` of the offending character.
+ * @return Compiled query, or NULL on error.
+ *
+ * @note The query must be released with fossil_media_json_query_free().
+ */
+fossil_media_json_query_t *
+fossil_media_json_query_compile(const char *expr, fossil_media_json_error_t *err_out);
+
+/**
+ * @brief Run a compiled query against a document.
+ *
+ * The selected nodes are stored in `out`, replacing its previous contents.
+ * They point into `root` and are not copied. Intermediate results are not
+ * materialised, so a run allocates only to grow `out` (and a walk stack for
+ * descendant segments).
+ *
+ * @param query    Compiled query.
+ * @param root     Document to query.
+ * @param out      Result list, zeroed or reused from an earlier run.
+ * @param err_out  Optional pointer to error details.
+ * @return 0 on success (possibly with no results), nonzero on error.
+ */
+int fossil_media_json_query_run(const fossil_media_json_query_t *query,
+                                const fossil_media_json_value_t *root,
+                                fossil_media_json_query_result_t *out,
+                                fossil_media_json_error_t *err_out);
+
+/**
+ * @brief Release a result list's storage and zero it. Safe with NULL.
+ *
+ * @param result  Result list to release; the selected nodes are not freed.
+ */
+void fossil_media_json_query_result_free(fossil_media_json_query_result_t *result);
+
+/**
+ * @brief Release a compiled query. Safe with NULL.
+ *
+ * @param query  Query to free.
+ */
+void fossil_media_json_query_free(fossil_media_json_query_t *query);
+
+/** @} */
+
+/** @name On-demand Navigation
+ *  @{
+ */
+
+/**
+ * @brief Open a document for on-demand reading, without parsing it.
+ *
+ * Lookups scan only the containers they pass through: values that are not
+ * navigated into are skipped with a bracket-matching scan and never
+ * allocated or converted. Skipped values are only checked for balanced
+ * brackets and terminated strings, so malformed content that is never read
+ * may go unreported; values that are read are checked like the parser does.
+ * Use fossil_media_json_validate() first when the input is untrusted.
+ *
+ * @param json_text  NUL-terminated JSON text; borrowed, must outlive the document.
+ * @param err_out    Optional pointer to error details.
+ * @return Document handle, or NULL if the text does not start with a value.
+ *
+ * @note The document must be closed with fossil_media_json_lazy_close().
+ */
+fossil_media_json_lazy_t *fossil_media_json_lazy_open(const char *json_text, fossil_media_json_error_t *err_out);
+
+/**
+ * @brief Close a lazy document. Safe with NULL.
+ *
+ * @param doc  Document to close. References into it become invalid.
+ */
+void fossil_media_json_lazy_close(fossil_media_json_lazy_t *doc);
+
+/**
+ * @brief Reference to the top-level value.
+ *
+ * @param doc  Open document.
+ * @return Root reference (with a NULL `doc` if `doc` is NULL).
+ */
+fossil_media_json_lazy_ref_t fossil_media_json_lazy_root(const fossil_media_json_lazy_t *doc);
+
+/**
+ * @brief Type of a lazy value, from its first character.
+ *
+ * @param ref  Lazy reference.
+ * @return Value type; FOSSIL_MEDIA_JSON_NULL for a failed reference.
+ */
+fossil_media_json_type_t fossil_media_json_lazy_type(fossil_media_json_lazy_ref_t ref);
+
+/**
+ * @brief Number of elements or members, counted by skipping each of them.
+ *
+ * @param ref  Lazy reference.
+ * @return Item count, or 0 for scalars and failed references.
+ */
+size_t fossil_media_json_lazy_size(fossil_media_json_lazy_ref_t ref);
+
+/**
+ * @brief Element of a lazy array; earlier elements are skipped.
+ *
+ * @param arr    Array reference.
+ * @param index  Zero-based position.
+ * @return Element reference; its `doc` is NULL if out of range.
+ */
+fossil_media_json_lazy_ref_t fossil_media_json_lazy_index(fossil_media_json_lazy_ref_t arr, size_t index);
+
+/**
+ * @brief Member of a lazy object by key (first match); other members are skipped.
+ *
+ * @param obj  Object reference.
+ * @param key  Key to look up.
+ * @return Member value reference; its `doc` is NULL if the key is absent.
+ */
+fossil_media_json_lazy_ref_t fossil_media_json_lazy_get(fossil_media_json_lazy_ref_t obj, const char *key);
+
+/**
+ * @brief Value at a dotted path, as fossil_media_json_get_path_ref().
+ *
+ * @param ref   Starting reference.
+ * @param path  Path string, e.g. "user.items[2].id".
+ * @return Value reference; its `doc` is NULL if the path does not resolve.
+ */
+fossil_media_json_lazy_ref_t fossil_media_json_lazy_get_path(fossil_media_json_lazy_ref_t ref, const char *path);
+
+/**
+ * @brief Start iterating over a lazy array or object.
+ *
+ * Each successful fossil_media_json_lazy_iter_next() call skips the previous
+ * item and moves `it->value` (and, for objects, `it->key`/`it->key_len`) to
+ * the next one.
+ *
+ * @param container  Array or object reference.
+ * @param it         Iterator to initialize.
+ * @return 0 on success, nonzero if `container` is not an array or object.
+ */
+int fossil_media_json_lazy_iter_init(fossil_media_json_lazy_ref_t container, fossil_media_json_lazy_iter_t *it);
+
+/**
+ * @brief Advance a lazy iterator.
+ *
+ * @param it  Iterator from fossil_media_json_lazy_iter_init().
+ * @return 1 if positioned on an item, 0 at the end (or on malformed input).
+ */
+int fossil_media_json_lazy_iter_next(fossil_media_json_lazy_iter_t *it);
+
+/**
+ * @brief Decoded copy of a lazy string.
+ *
+ * @param ref      Lazy reference.
+ * @param len_out  Receives the length in bytes (optional).
+ * @return NUL-terminated heap copy, or NULL if `ref` is not a well-formed
+ *         string. Release with free().
+ */
+char *fossil_media_json_lazy_get_string(fossil_media_json_lazy_ref_t ref, size_t *len_out);
+
+/**
+ * @brief Number of a lazy value as a double.
+ *
+ * @param ref  Lazy reference.
+ * @param out  Receives the value.
+ * @return 0 on success, nonzero if `ref` is not a well-formed number.
+ */
+int fossil_media_json_lazy_get_number(fossil_media_json_lazy_ref_t ref, double *out);
+
+/**
+ * @brief Integer of a lazy number, as fossil_media_json_get_int().
+ *
+ * @param ref  Lazy reference.
+ * @param out  Receives the value.
+ * @return 0 on success, nonzero if `ref` is not a number or is out of range.
+ */
+int fossil_media_json_lazy_get_int(fossil_media_json_lazy_ref_t ref, long long *out);
+
+/**
+ * @brief Unsigned integer of a lazy number, as fossil_media_json_get_uint().
+ *
+ * @param ref  Lazy reference.
+ * @param out  Receives the value.
+ * @return 0 on success, nonzero if `ref` is not a number or is out of range.
+ */
+int fossil_media_json_lazy_get_uint(fossil_media_json_lazy_ref_t ref, unsigned long long *out);
+
+/**
+ * @brief Boolean of a lazy value.
+ *
+ * @param ref  Lazy reference.
+ * @param out  Receives 0 or 1.
+ * @return 0 on success, nonzero if `ref` is not a boolean.
+ */
+int fossil_media_json_lazy_get_bool(fossil_media_json_lazy_ref_t ref, int *out);
+
+/**
+ * @brief Parse a lazy value (and everything below it) into a DOM tree.
+ *
+ * @param ref      Lazy reference.
+ * @param err_out  Optional pointer to error details; positions are offsets
+ *                 in the document text.
+ * @return New heap value, or NULL on failure.
+ *
+ * @note The returned value must be freed with fossil_media_json_free().
+ */
+fossil_media_json_value_t *fossil_media_json_lazy_to_value(fossil_media_json_lazy_ref_t ref,
+                                                           fossil_media_json_error_t *err_out);
+
+/** @} */
+
+/** @name Patching
+ *  @{
+ */
+
+/**
+ * @brief Apply a JSON Merge Patch (RFC 7386) to `target` in place.
+ *
+ * Members of an object patch are merged recursively, null members remove
+ * keys, and any other patch replaces the target's contents. Only values
+ * taken from the patch are copied. The `target` pointer stays valid even
+ * when its type changes.
+ *
+ * @param target   Heap-allocated value to modify (arena documents are read-only).
+ * @param patch    Merge patch; it is not modified.
+ * @param err_out  Optional pointer to error details.
+ * @return 0 on success, nonzero on error. On allocation failure the target
+ *         may be partly patched.
+ */
+int fossil_media_json_apply_merge_patch(fossil_media_json_value_t *target,
+                                        const fossil_media_json_value_t *patch,
+                                        fossil_media_json_error_t *err_out);
+
+/**
+ * @brief Apply a JSON Patch (RFC 6902) to `target` in place.
+ *
+ * Supports add, remove, replace, move, copy and test with JSON Pointer
+ * (RFC 6901) paths. Moves relink nodes instead of copying them. The patch is
+ * atomic: if any operation fails, the target is restored to its state
+ * before the call.
+ *
+ * @param target   Heap-allocated value to modify (arena documents are read-only).
+ * @param patch    Array of operation objects; it is not modified.
+ * @param err_out  Optional pointer to error details; `position` is the index
+ *                 of the failing operation.
+ * @return 0 on success, nonzero on error.
+ */
+int fossil_media_json_apply_patch(fossil_media_json_value_t *target,
+                                  const fossil_media_json_value_t *patch,
+                                  fossil_media_json_error_t *err_out);
+
+/** @} */
+
+/** @name Diagnostics
+ *  @{
+ */
+
+/**
+ * @brief Name of the structural indexer selected for this CPU.
+ *
+ * Large inputs are tokenized by a vectorized first pass chosen at runtime.
+ *
+ * @return "avx2", "sse2" or "scalar".
+ */
+const char *fossil_media_json_simd_backend(void);
+
+/**
+ * @brief Force a structural indexer, or go back to detecting one.
+ *
+ * Later parses use the named indexer; NULL forgets the choice so the next
+ * parse detects the CPU again. Meant for benchmarks and tests.
+ *
+ * @param name  "avx2", "sse2", "scalar" or NULL.
+ * @return 0 on success, -1 if the name is unknown or this CPU lacks it.
+ */
+int fossil_media_json_simd_select(const char *name);
+
+/**
+ * @brief Make the library's allocations fail, for out-of-memory tests.
+ *
+ * The next `after` allocations succeed and every one after them fails,
+ * until this is called again with a negative value. Not thread-safe.
+ *
+ * @param after  Allocations to allow, or negative to stop failing.
+ */
+void fossil_media_json_debug_fail_alloc(long after);
+
+/** @} */
+
+
+#ifdef __cplusplus
+}
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <utility>
+#include <functional>
+#include <exception>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#include <optional>
+#include <tuple>
+#include <charconv>
+#include <cmath>
 
 namespace fossil {
 
@@ -475,6 +1660,274 @@ namespace fossil {
                 : std::runtime_error(msg) {}
         };
         
+        class Json;
+        class JsonView;
+        class JsonRef;
+
+        /**
+         * @brief Position in an array or object, yielding borrowed children.
+         *
+         * `View` is JsonView or JsonRef. Dereferencing gives the element (or
+         * member value); key() gives the member name, or nullptr in arrays.
+         */
+        template <typename View, typename Ptr>
+        class JsonIterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = View;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = View;
+
+            JsonIterator() noexcept : parent_(nullptr), index_(0) {}
+            JsonIterator(Ptr parent, size_t index) noexcept : parent_(parent), index_(index) {}
+
+            View operator*() const noexcept {
+                return View(parent_->type == FOSSIL_MEDIA_JSON_OBJECT ? parent_->u.object.values[index_]
+                                                                      : parent_->u.array.items[index_]);
+            }
+
+            const char* key() const noexcept {
+                return parent_->type == FOSSIL_MEDIA_JSON_OBJECT ? parent_->u.object.keys[index_] : nullptr;
+            }
+
+            JsonIterator& operator++() noexcept { ++index_; return *this; }
+            JsonIterator operator++(int) noexcept { JsonIterator old = *this; ++index_; return old; }
+            bool operator==(const JsonIterator& o) const noexcept { return index_ == o.index_ && parent_ == o.parent_; }
+            bool operator!=(const JsonIterator& o) const noexcept { return !(*this == o); }
+
+        private:
+            Ptr parent_;
+            size_t index_;
+        };
+
+        /**
+         * @brief An object member seen through a view: its key and value.
+         */
+        template <typename View>
+        struct JsonMember {
+            const char* key;
+            View value;
+        };
+
+        /**
+         * @brief Range over the members of an object, from members().
+         */
+        template <typename View, typename Ptr>
+        class JsonMembers {
+        public:
+            class iterator {
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = JsonMember<View>;
+                using difference_type = std::ptrdiff_t;
+                using pointer = void;
+                using reference = JsonMember<View>;
+
+                explicit iterator(JsonIterator<View, Ptr> it) noexcept : it_(it) {}
+                JsonMember<View> operator*() const noexcept { return JsonMember<View>{it_.key(), *it_}; }
+                iterator& operator++() noexcept { ++it_; return *this; }
+                iterator operator++(int) noexcept { iterator old = *this; ++it_; return old; }
+                bool operator==(const iterator& o) const noexcept { return it_ == o.it_; }
+                bool operator!=(const iterator& o) const noexcept { return it_ != o.it_; }
+
+            private:
+                JsonIterator<View, Ptr> it_;
+            };
+
+            JsonMembers(JsonIterator<View, Ptr> b, JsonIterator<View, Ptr> e) noexcept : begin_(b), end_(e) {}
+            iterator begin() const noexcept { return iterator(begin_); }
+            iterator end() const noexcept { return iterator(end_); }
+
+        private:
+            JsonIterator<View, Ptr> begin_, end_;
+        };
+
+        /**
+         * @brief Read access shared by JsonView and JsonRef.
+         *
+         * A view is a bare pointer into a document owned elsewhere (usually
+         * a Json): copying it copies the pointer, and it must not outlive
+         * the document. Lookups never copy; a missing element or key gives
+         * an empty view, so lookups chain, and reading an empty view throws.
+         */
+        template <typename Self, typename Ptr>
+        class BasicJsonView {
+        public:
+            using iterator = JsonIterator<Self, Ptr>;
+
+            BasicJsonView() noexcept : value_(nullptr) {}
+            explicit BasicJsonView(Ptr value) noexcept : value_(value) {}
+
+            /** @brief Underlying C value, or nullptr for an empty view. */
+            Ptr get() const noexcept { return value_; }
+
+            /** @brief True unless the view is empty (a failed lookup). */
+            bool valid() const noexcept { return value_ != nullptr; }
+            explicit operator bool() const noexcept { return value_ != nullptr; }
+
+            /** @brief Type of the value; throws on an empty view. */
+            fossil_media_json_type_t type() const { return checked()->type; }
+
+            bool is_null() const noexcept { return is(FOSSIL_MEDIA_JSON_NULL); }
+            bool is_bool() const noexcept { return is(FOSSIL_MEDIA_JSON_BOOL); }
+            bool is_number() const noexcept { return is(FOSSIL_MEDIA_JSON_NUMBER); }
+            bool is_string() const noexcept { return is(FOSSIL_MEDIA_JSON_STRING); }
+            bool is_array() const noexcept { return is(FOSSIL_MEDIA_JSON_ARRAY); }
+            bool is_object() const noexcept { return is(FOSSIL_MEDIA_JSON_OBJECT); }
+
+            /** @brief Elements of an array or members of an object; 0 otherwise. */
+            size_t size() const noexcept {
+                if (is_array()) return value_->u.array.count;
+                if (is_object()) return value_->u.object.count;
+                return 0;
+            }
+
+            /** @brief Array element, or an empty view if out of range or not an array. */
+            Self operator[](size_t index) const noexcept {
+                return Self(is_array() && index < value_->u.array.count ? value_->u.array.items[index] : nullptr);
+            }
+
+            /** @brief Object member, or an empty view if missing or not an object. */
+            Self operator[](const char* key) const noexcept {
+                return Self(is_object() && key ? fossil_media_json_object_get(value_, key) : nullptr);
+            }
+
+            Self operator[](const std::string& key) const noexcept { return (*this)[key.c_str()]; }
+
+            /* Any integer is an index; without this, a literal 0 could also be a const char* */
+            template <typename I, std::enable_if_t<std::is_integral_v<I>, int> = 0>
+            Self operator[](I index) const noexcept { return (*this)[static_cast<size_t>(index)]; }
+
+            /** @brief Array element; throws if out of range. */
+            Self at(size_t index) const {
+                Self v = (*this)[index];
+                if (!v) throw JsonError("Array index out of range");
+                return v;
+            }
+
+            /** @brief Object member; throws if missing. */
+            Self at(const std::string& key) const {
+                Self v = (*this)[key.c_str()];
+                if (!v) throw JsonError("Key not found: " + key);
+                return v;
+            }
+
+            /**
+             * @brief Value at a dotted path (see fossil_media_json_get_path_ref()).
+             * @return The value, or an empty view if the path does not resolve.
+             */
+            Self path(const std::string& expr) const noexcept {
+                return Self(value_ ? fossil_media_json_get_path_ref(value_, expr.c_str()) : nullptr);
+            }
+
+            /**
+             * @brief Read the value as `T` without copying the document.
+             *
+             * `T` may be bool, any arithmetic type (integers are range
+             * checked), std::string, or the borrowed std::string_view and
+             * const char*, which point into the document. Integer types
+             * accept only whole numbers (2 and 2.0, not 1.5).
+             *
+             * @throws JsonError if the view is empty, the type does not match
+             *         or the number is not a whole number that fits `T`.
+             */
+            template <typename T>
+            T as() const {
+                const fossil_media_json_value_t* v = checked();
+                if constexpr (std::is_same_v<T, bool>) {
+                    if (v->type != FOSSIL_MEDIA_JSON_BOOL) throw JsonError("Expected a boolean");
+                    return v->u.boolean != 0;
+                } else if constexpr (std::is_integral_v<T>) {
+                    if constexpr (std::is_signed_v<T>) {
+                        long long out = 0;
+                        if (fossil_media_json_get_int(v, &out) != 0 || !whole(v, static_cast<double>(out)) ||
+                            out < (long long)std::numeric_limits<T>::min() ||
+                            out > (long long)std::numeric_limits<T>::max())
+                            throw JsonError("Expected an integer in range");
+                        return static_cast<T>(out);
+                    } else {
+                        unsigned long long out = 0;
+                        if (fossil_media_json_get_uint(v, &out) != 0 || !whole(v, static_cast<double>(out)) ||
+                            out > (unsigned long long)std::numeric_limits<T>::max())
+                            throw JsonError("Expected an unsigned integer in range");
+                        return static_cast<T>(out);
+                    }
+                } else if constexpr (std::is_floating_point_v<T>) {
+                    if (v->type != FOSSIL_MEDIA_JSON_NUMBER) throw JsonError("Expected a number");
+                    return static_cast<T>(v->u.number);
+                } else if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view> ||
+                                     std::is_same_v<T, const char*>) {
+                    if (v->type != FOSSIL_MEDIA_JSON_STRING) throw JsonError("Expected a string");
+                    return T(v->u.string ? v->u.string : "");
+                } else {
+                    static_assert(std::is_same_v<T, bool>, "unsupported type for as<T>()");
+                }
+            }
+
+            /** @brief Elements of an array or member values of an object. */
+            iterator begin() const noexcept { return iterator(value_, 0); }
+            iterator end() const noexcept { return iterator(value_, size()); }
+
+            /** @brief Key/value pairs of an object (empty for other types). */
+            JsonMembers<Self, Ptr> members() const noexcept {
+                return JsonMembers<Self, Ptr>(iterator(value_, 0), iterator(value_, is_object() ? size() : 0));
+            }
+
+            /** @brief Deep copy into an owning Json. */
+            Json clone() const;
+
+            /** @brief Compact or pretty JSON text of the value. */
+            std::string stringify(bool pretty = false) const;
+
+        protected:
+            Ptr value_;
+
+        private:
+            bool is(fossil_media_json_type_t t) const noexcept { return value_ && value_->type == t; }
+
+            Ptr checked() const {
+                if (!value_) throw JsonError("Empty JSON view");
+                return value_;
+            }
+
+            /* get_int()/get_uint() truncate; exact integers, and doubles equal to the result, are whole */
+            static bool whole(const fossil_media_json_value_t* v, double truncated) noexcept {
+                return fossil_media_json_is_integer(v) || v->u.number == truncated;
+            }
+        };
+
+        /**
+         * @brief Non-owning, read-only reference to a value inside a document.
+         */
+        class JsonView : public BasicJsonView<JsonView, const fossil_media_json_value_t*> {
+        public:
+            using BasicJsonView::BasicJsonView;
+        };
+
+        /**
+         * @brief Non-owning reference to a value that can also change it.
+         *
+         * Mutations go through the C API, so set() and append() throw on
+         * read-only arena documents. Views into a container may dangle after
+         * members are added or removed.
+         */
+        class JsonRef : public BasicJsonView<JsonRef, fossil_media_json_value_t*> {
+        public:
+            using BasicJsonView::BasicJsonView;
+
+            operator JsonView() const noexcept { return JsonView(value_); }
+
+            /** @brief Set an object member, taking ownership of `val`. */
+            void set(const std::string& key, Json&& val);
+
+            /** @brief Append to an array, taking ownership of `val`. */
+            void append(Json&& val);
+
+            /** @brief Remove an object member and return it (a null Json if missing). */
+            Json remove(const std::string& key);
+        };
+
         /**
          * @brief C++ RAII wrapper around fossil_media_json_value_t from the C API.
          * 
@@ -533,9 +1986,42 @@ namespace fossil {
              * @return Parsed Json object.
              * @throws JsonError if parsing fails.
              */
-            static Json parse(const std::string& text) {
+            static Json parse(const std::string& text) {
+                fossil_media_json_error_t err{};
+                fossil_media_json_value_t* val = fossil_media_json_parse(text.c_str(), &err);
+                if (!val) {
+                    throw JsonError(std::string("Parse error: ") + err.message);
+                }
+                return Json(val);
+            }
+
+            /**
+             * @brief Parse JSON text into an arena-backed, read-only Json object.
+             * @param text NUL-terminated JSON string.
+             * @return Parsed Json object.
+             * @throws JsonError if parsing fails.
+             */
+            static Json parse_arena(const std::string& text) {
+                fossil_media_json_error_t err{};
+                fossil_media_json_parse_options_t opts{};
+                opts.flags = FOSSIL_MEDIA_JSON_PARSE_ARENA;
+                fossil_media_json_value_t* val = fossil_media_json_parse_ex(text.c_str(), &opts, &err);
+                if (!val) {
+                    throw JsonError(std::string("Parse error: ") + err.message);
+                }
+                return Json(val);
+            }
+
+            /**
+             * @brief Parse a mutable buffer in situ into a read-only Json object.
+             * @param buffer NUL-terminated JSON text; it is modified and must
+             *               outlive the returned object.
+             * @return Parsed Json object whose strings point into `buffer`.
+             * @throws JsonError if parsing fails.
+             */
+            static Json parse_insitu(char* buffer) {
                 fossil_media_json_error_t err{};
-                fossil_media_json_value_t* val = fossil_media_json_parse(text.c_str(), &err);
+                fossil_media_json_value_t* val = fossil_media_json_parse_insitu(buffer, nullptr, &err);
                 if (!val) {
                     throw JsonError(std::string("Parse error: ") + err.message);
                 }
@@ -598,17 +2084,42 @@ namespace fossil {
             }
         
             /**
-             * @brief Get element at index in JSON array.
+             * @brief Copy of the element at index in JSON array.
              * @param index Zero-based index.
-             * @return Json element at index (shared, no ownership transfer).
+             * @return Deep copy of the element; use view()[index] to borrow it instead.
+             * @throws JsonError if out of range or the copy fails.
              */
             Json array_get(size_t index) const {
                 fossil_media_json_value_t* v = fossil_media_json_array_get(value_, index);
                 if (!v) {
                     throw JsonError("Array index out of range");
                 }
-                return Json(fossil_media_json_new_string(fossil_media_json_stringify(v, 0, nullptr))); // Copy via stringify
+                return JsonView(v).clone();
+            }
+
+            /**
+             * @brief Borrowed read-only view of this value.
+             * @return View valid until this Json is destroyed or modified.
+             */
+            JsonView view() const noexcept {
+                return JsonView(value_);
+            }
+
+            /**
+             * @brief Borrowed mutable reference to this value.
+             * @return Reference valid until this Json is destroyed.
+             */
+            JsonRef ref() noexcept {
+                return JsonRef(value_);
             }
+
+            /** @brief Borrowed array element (empty view if out of range). */
+            JsonView operator[](size_t index) const noexcept { return view()[index]; }
+            JsonRef operator[](size_t index) noexcept { return ref()[index]; }
+
+            /** @brief Borrowed object member (empty view if missing). */
+            JsonView operator[](const std::string& key) const noexcept { return view()[key]; }
+            JsonRef operator[](const std::string& key) noexcept { return ref()[key]; }
         
             /**
              * @brief Set key-value in JSON object.
@@ -641,164 +2152,1071 @@ namespace fossil {
             }
 
             /**
-             * @brief Deep copy this JSON value.
-             * @return A new Json object that is a clone of this value.
-             * @throws JsonError if cloning fails.
+             * @brief Serialize JSON to string, writing large containers on several threads.
+             * @param pretty  If true, output with indentation.
+             * @param threads Worker threads; 0 means one per online CPU.
+             * @return Serialized JSON string, identical to stringify(pretty).
+             * @throws JsonError if stringify fails.
+             */
+            std::string stringify_parallel(bool pretty = false, size_t threads = 0) const {
+                fossil_media_json_error_t err{};
+                fossil_media_json_parallel_options_t opts{};
+                opts.threads = threads;
+                char* s = fossil_media_json_stringify_ex(value_, pretty ? 1 : 0, &opts, &err);
+                if (!s) {
+                    throw JsonError(std::string("Stringify error: ") + err.message);
+                }
+                std::string result(s);
+                free(s);
+                return result;
+            }
+
+            /**
+             * @brief Deep copy this JSON value.
+             * @return A new Json object that is a clone of this value.
+             * @throws JsonError if cloning fails.
+             */
+            Json clone() const {
+                fossil_media_json_value_t* v = fossil_media_json_clone(value_);
+                if (!v) {
+                    throw JsonError("Failed to clone JSON value");
+                }
+                return Json(v);
+            }
+
+            /**
+             * @brief Compare this JSON value to another for equality.
+             * @param other The other Json object to compare.
+             * @return true if equal, false otherwise.
+             * @throws JsonError if comparison fails.
+             */
+            bool equals(const Json& other) const {
+                int result = fossil_media_json_equals(value_, other.value_);
+                if (result == -1) {
+                    throw JsonError("Failed to compare JSON values");
+                }
+                return result == 1;
+            }
+
+            /**
+             * @brief Structural hash, equal for values that compare equal.
+             * @return 64-bit hash of this value.
+             * @throws JsonError if hashing runs out of memory.
+             */
+            uint64_t hash() const {
+                uint64_t h = fossil_media_json_hash(value_);
+                if (!h) {
+                    throw JsonError("Failed to hash JSON value");
+                }
+                return h;
+            }
+
+            /**
+             * @brief Check if this value is null.
+             * @return true if null, false otherwise.
+             */
+            bool is_null() const {
+                return fossil_media_json_is_null(value_) == 1;
+            }
+
+            /**
+             * @brief Check if this value is an array.
+             * @return true if array, false otherwise.
+             */
+            bool is_array() const {
+                return fossil_media_json_is_array(value_) == 1;
+            }
+
+            /**
+             * @brief Check if this value is an object.
+             * @return true if object, false otherwise.
+             */
+            bool is_object() const {
+                return fossil_media_json_is_object(value_) == 1;
+            }
+
+            /**
+             * @brief Reserve capacity for a JSON array.
+             * @param capacity Desired capacity.
+             * @throws JsonError if not an array or reserve fails.
+             */
+            void array_reserve(size_t capacity) {
+                if (fossil_media_json_array_reserve(value_, capacity) != 0) {
+                    throw JsonError("Failed to reserve array capacity");
+                }
+            }
+
+            /**
+             * @brief Reserve capacity for a JSON object.
+             * @param capacity Desired capacity.
+             * @throws JsonError if not an object or reserve fails.
+             */
+            void object_reserve(size_t capacity) {
+                if (fossil_media_json_object_reserve(value_, capacity) != 0) {
+                    throw JsonError("Failed to reserve object capacity");
+                }
+            }
+
+            /**
+             * @brief Parse a JSON file into a Json object.
+             * @param filename Path to JSON file.
+             * @return Parsed Json object.
+             * @throws JsonError if parsing fails.
+             */
+            static Json parse_file(const std::string& filename) {
+                fossil_media_json_error_t err{};
+                fossil_media_json_value_t* val = fossil_media_json_parse_file(filename.c_str(), &err);
+                if (!val) {
+                    throw JsonError(std::string("Parse file error: ") + err.message);
+                }
+                return Json(val);
+            }
+
+            /**
+             * @brief Parse a JSON file with FOSSIL_MEDIA_JSON_PARSE_* flags.
+             * @param filename Path to JSON file.
+             * @param flags    Parse flags, e.g. FOSSIL_MEDIA_JSON_PARSE_INSITU.
+             * @return Parsed Json object.
+             * @throws JsonError if parsing fails.
+             */
+            static Json parse_file(const std::string& filename, unsigned int flags) {
+                fossil_media_json_error_t err{};
+                fossil_media_json_parse_options_t opts{};
+                opts.flags = flags;
+                fossil_media_json_value_t* val = fossil_media_json_parse_file_ex(filename.c_str(), &opts, &err);
+                if (!val) {
+                    throw JsonError(std::string("Parse file error: ") + err.message);
+                }
+                return Json(val);
+            }
+
+            /**
+             * @brief Write this JSON value to a file.
+             * @param filename Path to output file.
+             * @param pretty If true, output with indentation.
+             * @throws JsonError if writing fails.
+             */
+            void write_file(const std::string& filename, bool pretty = false) const {
+                fossil_media_json_error_t err{};
+                int rc = fossil_media_json_write_file(value_, filename.c_str(), pretty ? 1 : 0, &err);
+                if (rc != 0) {
+                    throw JsonError(std::string("Write file error: ") + err.message);
+                }
+            }
+
+            /**
+             * @brief Write this JSON value to a binary tape file.
+             * @param filename Path to output file (read back with JsonTape).
+             * @throws JsonError if encoding or writing fails.
+             */
+            void write_tape(const std::string& filename) const {
+                fossil_media_json_error_t err{};
+                if (fossil_media_json_tape_write_file(value_, filename.c_str(), &err) != 0) {
+                    throw JsonError(std::string("Write tape error: ") + err.message);
+                }
+            }
+
+            /**
+             * @brief Create a JSON integer value.
+             * @param i Integer value.
+             * @return Json object holding an integer.
+             */
+            static Json new_int(long long i) {
+                return Json(fossil_media_json_new_int(i));
+            }
+
+            /**
+             * @brief Create a JSON unsigned integer value.
+             * @param u Unsigned integer value.
+             * @return Json object holding an integer.
+             */
+            static Json new_uint(unsigned long long u) {
+                return Json(fossil_media_json_new_uint(u));
+            }
+
+            /**
+             * @brief Check whether this value is a number with exact integer storage.
+             */
+            bool is_integer() const {
+                return fossil_media_json_is_integer(value_) != 0;
+            }
+
+            /**
+             * @brief Get integer value from this JSON number.
+             * @return Integer value.
+             * @throws JsonError if not a number or out of range.
+             */
+            long long get_int() const {
+                long long out = 0;
+                if (fossil_media_json_get_int(value_, &out) != 0) {
+                    throw JsonError("Failed to get integer from JSON value");
+                }
+                return out;
+            }
+
+            /**
+             * @brief Get unsigned integer value from this JSON number.
+             * @return Unsigned integer value.
+             * @throws JsonError if not a number, negative or out of range.
+             */
+            unsigned long long get_uint() const {
+                unsigned long long out = 0;
+                if (fossil_media_json_get_uint(value_, &out) != 0) {
+                    throw JsonError("Failed to get unsigned integer from JSON value");
+                }
+                return out;
+            }
+
+            /**
+             * @brief Print a debug dump of this JSON value.
+             * @param indent Starting indentation level.
+             */
+            void debug_dump(int indent = 0) const {
+                fossil_media_json_debug_dump(value_, indent);
+            }
+
+            /**
+             * @brief Validate JSON text without building a DOM.
+             * @param text Input JSON text.
+             * @return true if valid, false otherwise.
+             */
+            static bool validate(const std::string& text) {
+                fossil_media_json_error_t err{};
+                return fossil_media_json_validate(text.c_str(), &err) == 0;
+            }
+
+            /**
+             * @brief Copy of the JSON value at a dotted path expression.
+             * @param path Path string (e.g., "user.name" or "items[2].id").
+             * @return Deep copy of the value at the path; view().path() borrows it instead.
+             * @throws JsonError if not found.
+             */
+            Json get_path(const std::string& path) const {
+                fossil_media_json_value_t* v = fossil_media_json_get_path(value_, path.c_str());
+                if (!v) {
+                    // Return a null Json object if path not found
+                    return Json(fossil_media_json_new_null());
+                }
+                return Json(v);
+            }
+
+            /**
+             * @brief Apply a JSON Merge Patch (RFC 7386) to this value in place.
+             * @param patch Merge patch document.
+             * @throws JsonError if the patch cannot be applied.
+             */
+            void merge_patch(const Json& patch) {
+                fossil_media_json_error_t err{};
+                if (fossil_media_json_apply_merge_patch(value_, patch.value_, &err) != 0) {
+                    throw JsonError(std::string("Merge patch error: ") + err.message);
+                }
+            }
+
+            /**
+             * @brief Apply a JSON Patch (RFC 6902) to this value in place.
+             * @param patch Array of patch operations.
+             * @throws JsonError if any operation fails; the value is then unchanged.
+             */
+            void apply_patch(const Json& patch) {
+                fossil_media_json_error_t err{};
+                if (fossil_media_json_apply_patch(value_, patch.value_, &err) != 0) {
+                    throw JsonError(std::string("Patch error: ") + err.message);
+                }
+            }
+
+        private:
+            friend class JsonRef;
+            fossil_media_json_value_t* value_;
+        };
+
+        template <typename Self, typename Ptr>
+        inline Json BasicJsonView<Self, Ptr>::clone() const {
+            fossil_media_json_value_t* v = fossil_media_json_clone(checked());
+            if (!v) {
+                throw JsonError("Failed to clone JSON value");
+            }
+            return Json(v);
+        }
+
+        template <typename Self, typename Ptr>
+        inline std::string BasicJsonView<Self, Ptr>::stringify(bool pretty) const {
+            fossil_media_json_error_t err{};
+            char* s = fossil_media_json_stringify(checked(), pretty ? 1 : 0, &err);
+            if (!s) {
+                throw JsonError(std::string("Stringify error: ") + err.message);
+            }
+            std::string result(s);
+            free(s);
+            return result;
+        }
+
+        inline void JsonRef::set(const std::string& key, Json&& val) {
+            if (!value_ || fossil_media_json_object_set(value_, key.c_str(), val.value_) != 0) {
+                throw JsonError("Failed to set key in object");
+            }
+            val.value_ = nullptr; // Ownership transferred
+        }
+
+        inline void JsonRef::append(Json&& val) {
+            if (!value_ || fossil_media_json_array_append(value_, val.value_) != 0) {
+                throw JsonError("Failed to append to array");
+            }
+            val.value_ = nullptr; // Ownership transferred
+        }
+
+        inline Json JsonRef::remove(const std::string& key) {
+            if (!is_object()) {
+                throw JsonError("Failed to remove key from object");
+            }
+            fossil_media_json_value_t* v = fossil_media_json_object_remove(value_, key.c_str());
+            return v ? Json(v) : Json();
+        }
+
+        /**
+         * @brief Push parser for chunked JSON input.
+         *
+         * Wraps fossil_media_json_stream_t: every completed top-level value is
+         * passed to the handler as an owning Json. The handler returns false to
+         * stop the stream (the pending feed()/finish() then throws); exceptions
+         * it throws propagate out of feed()/finish().
+         */
+        class JsonStream {
+        public:
+            using Handler = std::function<bool(Json&&)>;
+
+            /**
+             * @brief Create a stream delivering values to `handler`.
+             * @param handler Called once per completed top-level value.
+             * @throws JsonError if the stream cannot be allocated.
+             */
+            explicit JsonStream(Handler handler)
+                : handler_(std::move(handler)),
+                  stream_(fossil_media_json_stream_create(nullptr, &JsonStream::dispatch, this)) {
+                if (!stream_) throw JsonError("Failed to create JSON stream");
+            }
+
+            ~JsonStream() { fossil_media_json_stream_free(stream_); }
+
+            JsonStream(const JsonStream&) = delete;
+            JsonStream& operator=(const JsonStream&) = delete;
+
+            /**
+             * @brief Feed the next chunk.
+             * @param data Chunk bytes.
+             * @throws JsonError on malformed input.
+             */
+            void feed(const std::string& data) {
+                fossil_media_json_error_t err{};
+                check(fossil_media_json_stream_feed(stream_, data.data(), data.size(), &err), err);
+            }
+
+            /**
+             * @brief Signal end of input.
+             * @throws JsonError if the input ends inside a value.
              */
-            Json clone() const {
-                fossil_media_json_value_t* v = fossil_media_json_clone(value_);
-                if (!v) {
-                    throw JsonError("Failed to clone JSON value");
+            void finish() {
+                fossil_media_json_error_t err{};
+                check(fossil_media_json_stream_finish(stream_, &err), err);
+            }
+
+        private:
+            static int dispatch(fossil_media_json_value_t* value, void* user) {
+                JsonStream* self = static_cast<JsonStream*>(user);
+                try {
+                    return self->handler_(Json(value)) ? 0 : 1;
+                } catch (...) {
+                    self->pending_ = std::current_exception();
+                    return 1;
                 }
-                return Json(v);
             }
 
-            /**
-             * @brief Compare this JSON value to another for equality.
-             * @param other The other Json object to compare.
-             * @return true if equal, false otherwise.
-             * @throws JsonError if comparison fails.
-             */
-            bool equals(const Json& other) const {
-                int result = fossil_media_json_equals(value_, other.value_);
-                if (result == -1) {
-                    throw JsonError("Failed to compare JSON values");
+            void check(int rc, const fossil_media_json_error_t& err) {
+                if (pending_) {
+                    std::exception_ptr e = pending_;
+                    pending_ = nullptr;
+                    std::rethrow_exception(e);
                 }
-                return result == 1;
+                if (rc != 0) throw JsonError(std::string("Parse error: ") + err.message);
             }
 
+            Handler handler_;
+            fossil_media_json_stream_t* stream_;
+            std::exception_ptr pending_;
+        };
+
+        /**
+         * @brief Read-only view of a binary tape file.
+         *
+         * Wraps fossil_media_json_tape_t: the file is mapped on construction
+         * and unmapped on destruction. Navigate from root() with the
+         * fossil_media_json_tape_* accessors, or rebuild a tree with to_json().
+         */
+        class JsonTape {
+        public:
             /**
-             * @brief Check if this value is null.
-             * @return true if null, false otherwise.
+             * @brief Map a tape file.
+             * @param filename Path to a file written by Json::write_tape().
+             * @throws JsonError if the file cannot be mapped or is not a tape.
              */
-            bool is_null() const {
-                return fossil_media_json_is_null(value_) == 1;
+            explicit JsonTape(const std::string& filename) {
+                fossil_media_json_error_t err{};
+                tape_ = fossil_media_json_tape_open(filename.c_str(), &err);
+                if (!tape_) throw JsonError(std::string("Tape error: ") + err.message);
             }
 
+            ~JsonTape() { fossil_media_json_tape_close(tape_); }
+
+            JsonTape(const JsonTape&) = delete;
+            JsonTape& operator=(const JsonTape&) = delete;
+
             /**
-             * @brief Check if this value is an array.
-             * @return true if array, false otherwise.
+             * @brief Reference to the top-level value.
              */
-            bool is_array() const {
-                return fossil_media_json_is_array(value_) == 1;
+            fossil_media_json_tape_ref_t root() const {
+                return fossil_media_json_tape_root(tape_);
             }
 
             /**
-             * @brief Check if this value is an object.
-             * @return true if object, false otherwise.
+             * @brief Rebuild a value from the tape as an owning Json.
+             * @param ref Value to rebuild (the root by default).
+             * @throws JsonError if `ref` is invalid or allocation fails.
              */
-            bool is_object() const {
-                return fossil_media_json_is_object(value_) == 1;
+            Json to_json(fossil_media_json_tape_ref_t ref) const {
+                fossil_media_json_error_t err{};
+                fossil_media_json_value_t* val = fossil_media_json_tape_to_value(ref, &err);
+                if (!val) throw JsonError(std::string("Tape error: ") + err.message);
+                return Json(val);
             }
 
+            Json to_json() const { return to_json(root()); }
+
+        private:
+            fossil_media_json_tape_t* tape_;
+        };
+
+        /**
+         * @brief Compiled JSONPath query.
+         *
+         * Wraps fossil_media_json_query_t: compile once, then run against any
+         * number of documents. Results are views borrowed from the queried
+         * document and stay valid while it does.
+         */
+        class JsonQuery {
+        public:
             /**
-             * @brief Reserve capacity for a JSON array.
-             * @param capacity Desired capacity.
-             * @throws JsonError if not an array or reserve fails.
+             * @brief Compile a query.
+             * @param expr RFC 9535 query text, e.g. "$.items[?@.price > 10].id".
+             * @throws JsonError if the query is malformed.
              */
-            void array_reserve(size_t capacity) {
-                if (fossil_media_json_array_reserve(value_, capacity) != 0) {
-                    throw JsonError("Failed to reserve array capacity");
-                }
+            explicit JsonQuery(const std::string& expr) {
+                fossil_media_json_error_t err{};
+                query_ = fossil_media_json_query_compile(expr.c_str(), &err);
+                if (!query_) throw JsonError(std::string("Query error: ") + err.message);
             }
 
+            ~JsonQuery() { fossil_media_json_query_free(query_); }
+
+            JsonQuery(const JsonQuery&) = delete;
+            JsonQuery& operator=(const JsonQuery&) = delete;
+
             /**
-             * @brief Reserve capacity for a JSON object.
-             * @param capacity Desired capacity.
-             * @throws JsonError if not an object or reserve fails.
+             * @brief Nodes selected from `root`, in document order.
+             * @return Borrowed views; empty when `root` is empty or nothing matches.
+             * @throws JsonError on allocation failure.
              */
-            void object_reserve(size_t capacity) {
-                if (fossil_media_json_object_reserve(value_, capacity) != 0) {
-                    throw JsonError("Failed to reserve object capacity");
+            std::vector<JsonView> run(JsonView root) const {
+                std::vector<JsonView> out;
+                if (!root) return out;
+                fossil_media_json_query_result_t res{};
+                fossil_media_json_error_t err{};
+                int rc = fossil_media_json_query_run(query_, root.get(), &res, &err);
+                try {
+                    out.reserve(res.count);
+                    for (size_t i = 0; i < res.count; ++i) out.emplace_back(res.items[i]);
+                } catch (...) {
+                    fossil_media_json_query_result_free(&res);
+                    throw;
                 }
+                fossil_media_json_query_result_free(&res);
+                if (rc != 0) throw JsonError(std::string("Query error: ") + err.message);
+                return out;
+            }
+
+            std::vector<JsonView> run(const Json& doc) const { return run(doc.view()); }
+
+        private:
+            fossil_media_json_query_t* query_;
+        };
+
+        /**
+         * @brief A value inside a JsonLazy document, read on demand.
+         *
+         * Like a view, a reference is a borrowed position: lookups give an
+         * empty reference when they fail, so they chain, and reading an empty
+         * reference throws. It must not outlive its JsonLazy.
+         */
+        class JsonLazyRef {
+        public:
+            JsonLazyRef() noexcept : ref_{nullptr, 0} {}
+            explicit JsonLazyRef(fossil_media_json_lazy_ref_t ref) noexcept : ref_(ref) {}
+
+            /** @brief Underlying C reference. */
+            fossil_media_json_lazy_ref_t get() const noexcept { return ref_; }
+
+            bool valid() const noexcept { return ref_.doc != nullptr; }
+            explicit operator bool() const noexcept { return ref_.doc != nullptr; }
+
+            /** @brief Type of the value; throws on an empty reference. */
+            fossil_media_json_type_t type() const { return fossil_media_json_lazy_type(checked()); }
+
+            /** @brief Elements of an array or members of an object; 0 otherwise. */
+            size_t size() const noexcept { return fossil_media_json_lazy_size(ref_); }
+
+            /** @brief Array element, or an empty reference. */
+            JsonLazyRef operator[](size_t index) const noexcept {
+                return JsonLazyRef(fossil_media_json_lazy_index(ref_, index));
+            }
+
+            /** @brief Object member, or an empty reference. */
+            JsonLazyRef operator[](const char* key) const noexcept {
+                return key ? JsonLazyRef(fossil_media_json_lazy_get(ref_, key)) : JsonLazyRef();
+            }
+
+            JsonLazyRef operator[](const std::string& key) const noexcept { return (*this)[key.c_str()]; }
+
+            /* Any integer is an index, so a literal 0 is not read as a const char* */
+            template <typename I, std::enable_if_t<std::is_integral_v<I>, int> = 0>
+            JsonLazyRef operator[](I index) const noexcept { return (*this)[static_cast<size_t>(index)]; }
+
+            /** @brief Value at a dotted path, or an empty reference. */
+            JsonLazyRef path(const std::string& expr) const noexcept {
+                return JsonLazyRef(fossil_media_json_lazy_get_path(ref_, expr.c_str()));
+            }
+
+            /** @brief Decoded string; throws if the value is not a string. */
+            std::string get_string() const {
+                size_t len = 0;
+                char* s = fossil_media_json_lazy_get_string(checked(), &len);
+                if (!s) throw JsonError("Expected a string");
+                std::string out;
+                try { out.assign(s, len); } catch (...) { free(s); throw; }
+                free(s);
+                return out;
+            }
+
+            /** @brief Number as a double; throws if the value is not a number. */
+            double get_number() const {
+                double out = 0;
+                if (fossil_media_json_lazy_get_number(checked(), &out) != 0) throw JsonError("Expected a number");
+                return out;
+            }
+
+            /** @brief Integer; throws if the value is not an integer in range. */
+            long long get_int() const {
+                long long out = 0;
+                if (fossil_media_json_lazy_get_int(checked(), &out) != 0) throw JsonError("Expected an integer");
+                return out;
+            }
+
+            /** @brief Boolean; throws if the value is not a boolean. */
+            bool get_bool() const {
+                int out = 0;
+                if (fossil_media_json_lazy_get_bool(checked(), &out) != 0) throw JsonError("Expected a boolean");
+                return out != 0;
             }
 
             /**
-             * @brief Parse a JSON file into a Json object.
-             * @param filename Path to JSON file.
-             * @return Parsed Json object.
-             * @throws JsonError if parsing fails.
+             * @brief Parse this value into an owned tree.
+             * @throws JsonError if the reference is empty or the value is malformed.
              */
-            static Json parse_file(const std::string& filename) {
+            Json to_json() const {
                 fossil_media_json_error_t err{};
-                fossil_media_json_value_t* val = fossil_media_json_parse_file(filename.c_str(), &err);
-                if (!val) {
-                    throw JsonError(std::string("Parse file error: ") + err.message);
-                }
-                return Json(val);
+                fossil_media_json_value_t* v = fossil_media_json_lazy_to_value(checked(), &err);
+                if (!v) throw JsonError(std::string("Lazy error: ") + err.message);
+                return Json(v);
+            }
+
+        private:
+            fossil_media_json_lazy_ref_t checked() const {
+                if (!ref_.doc) throw JsonError("Empty lazy reference");
+                return ref_;
             }
 
+            fossil_media_json_lazy_ref_t ref_;
+        };
+
+        /**
+         * @brief A document that is only parsed where it is navigated.
+         *
+         * Keeps its own copy of the text; values that are never reached are
+         * skipped by bracket matching and never allocated.
+         */
+        class JsonLazy {
+        public:
             /**
-             * @brief Write this JSON value to a file.
-             * @param filename Path to output file.
-             * @param pretty If true, output with indentation.
-             * @throws JsonError if writing fails.
+             * @brief Open `text` for on-demand reading.
+             * @throws JsonError if the text does not start with a JSON value.
              */
-            void write_file(const std::string& filename, bool pretty = false) const {
+            explicit JsonLazy(std::string text) : text_(std::move(text)) {
                 fossil_media_json_error_t err{};
-                int rc = fossil_media_json_write_file(value_, filename.c_str(), pretty ? 1 : 0, &err);
-                if (rc != 0) {
-                    throw JsonError(std::string("Write file error: ") + err.message);
+                doc_ = fossil_media_json_lazy_open(text_.c_str(), &err);
+                if (!doc_) throw JsonError(std::string("Lazy error: ") + err.message);
+            }
+
+            ~JsonLazy() { fossil_media_json_lazy_close(doc_); }
+
+            JsonLazy(const JsonLazy&) = delete;
+            JsonLazy& operator=(const JsonLazy&) = delete;
+
+            /** @brief The top-level value. */
+            JsonLazyRef root() const noexcept { return JsonLazyRef(fossil_media_json_lazy_root(doc_)); }
+
+            JsonLazyRef operator[](const char* key) const noexcept { return root()[key]; }
+            JsonLazyRef operator[](const std::string& key) const noexcept { return root()[key]; }
+            JsonLazyRef operator[](size_t index) const noexcept { return root()[index]; }
+            template <typename I, std::enable_if_t<std::is_integral_v<I>, int> = 0>
+            JsonLazyRef operator[](I index) const noexcept { return root()[index]; }
+
+            /** @brief Value at a dotted path from the root, or an empty reference. */
+            JsonLazyRef path(const std::string& expr) const noexcept { return root().path(expr); }
+
+        private:
+            std::string text_;
+            fossil_media_json_lazy_t* doc_;
+        };
+
+
+        /**
+         * @brief One bound member: its JSON key and a pointer to the member.
+         *
+         * Built with json_field() inside a struct's member list:
+         *
+         *     struct Point {
+         *         int x = 0, y = 0;
+         *         static constexpr auto json_fields = std::make_tuple(
+         *             fossil::media::json_field("x", &Point::x),
+         *             fossil::media::json_field("y", &Point::y));
+         *     };
+         */
+        template <typename C, typename M>
+        struct JsonField {
+            const char* name;
+            M C::* member;
+        };
+
+        template <typename C, typename M>
+        constexpr JsonField<C, M> json_field(const char* name, M C::* member) noexcept {
+            return JsonField<C, M>{name, member};
+        }
+
+        /**
+         * @brief True when T declares a `json_fields` member list.
+         */
+        template <typename T, typename = void>
+        struct JsonBound : std::false_type {};
+
+        template <typename T>
+        struct JsonBound<T, std::void_t<decltype(T::json_fields)>> : std::true_type {};
+
+        template <typename T>
+        struct JsonBindVector : std::false_type {};
+
+        template <typename T, typename A>
+        struct JsonBindVector<std::vector<T, A>> : std::true_type {};
+
+        template <typename T>
+        struct JsonBindOptional : std::false_type {};
+
+        template <typename T>
+        struct JsonBindOptional<std::optional<T>> : std::true_type {};
+
+        /**
+         * @brief A scalar event from the SAX parser, as seen by a binding.
+         */
+        struct JsonBindScalar {
+            fossil_media_json_type_t type;
+            std::string_view text;  ///< String contents, or the number's source text
+            double number;
+            bool boolean;
+        };
+
+        struct JsonBindOps;
+
+        /**
+         * @brief A typed destination for the next value: an object and its ops.
+         *
+         * A slot with no ops swallows the value (unknown keys are skipped).
+         */
+        struct JsonBindSlot {
+            void* target;
+            const JsonBindOps* ops;
+        };
+
+        /**
+         * @brief Type-erased decoding operations for one bindable type.
+         *
+         * One static table per type lets the SAX callbacks, which only see
+         * `void*`, route each event to the right member without a DOM.
+         */
+        struct JsonBindOps {
+            enum Kind { SCALAR, OBJECT, ARRAY } kind;
+            const char* expect;                                          ///< Type name used in errors
+            bool (*scalar)(void* target, const JsonBindScalar& value);   ///< Store a scalar; false on mismatch
+            JsonBindSlot (*open)(void* target);                          ///< Prepare for a container; resolves optionals
+            JsonBindSlot (*member)(void* target, std::string_view key);  ///< Objects: slot for a key
+            JsonBindSlot (*element)(void* target);                       ///< Arrays: slot for a new element
+        };
+
+        /**
+         * @brief Element slot for std::vector<bool>, whose elements have no address.
+         *
+         * The slot targets the vector itself and appends each boolean as it
+         * arrives instead of binding into a new element.
+         */
+        template <typename V>
+        struct JsonBindBoolElement {
+            static bool scalar(void* target, const JsonBindScalar& s) {
+                if (s.type != FOSSIL_MEDIA_JSON_BOOL) return false;
+                static_cast<V*>(target)->push_back(s.boolean);
+                return true;
+            }
+            static JsonBindSlot open(void* target) { return JsonBindSlot{target, &ops}; }
+            static JsonBindSlot member(void*, std::string_view) { return JsonBindSlot{nullptr, nullptr}; }
+            static JsonBindSlot element(void*) { return JsonBindSlot{nullptr, nullptr}; }
+
+            static constexpr JsonBindOps ops{JsonBindOps::SCALAR, "boolean", &scalar, &open, &member, &element};
+        };
+
+        /**
+         * @brief Encoding and decoding rules for one type.
+         *
+         * Supported types are bool, the integer and floating-point types,
+         * std::string, std::vector and std::optional of supported types, and
+         * structs with a `json_fields` list. An empty optional is written as
+         * null, and null reads back as an empty optional; any other value read
+         * into an engaged optional updates the value it holds.
+         */
+        template <typename T>
+        struct JsonBindTraits {
+            static_assert(std::is_same_v<T, bool> || std::is_arithmetic_v<T> ||
+                          std::is_same_v<T, std::string> || JsonBindVector<T>::value ||
+                          JsonBindOptional<T>::value || JsonBound<T>::value,
+                          "type has no JSON binding; declare a json_fields member list");
+
+            static void write(fossil_media_json_writer_t* w, const T& v) {
+                if constexpr (std::is_same_v<T, bool>) {
+                    fossil_media_json_writer_bool(w, v ? 1 : 0);
+                } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+                    fossil_media_json_writer_int(w, static_cast<long long>(v));
+                } else if constexpr (std::is_integral_v<T>) {
+                    fossil_media_json_writer_uint(w, static_cast<unsigned long long>(v));
+                } else if constexpr (std::is_floating_point_v<T>) {
+                    // The writer spells NaN and infinity as null, which would not read back
+                    if (!std::isfinite(v)) throw JsonError("Stringify error: non-finite number");
+                    fossil_media_json_writer_number(w, static_cast<double>(v));
+                } else if constexpr (std::is_same_v<T, std::string>) {
+                    fossil_media_json_writer_string(w, v.c_str());
+                } else if constexpr (JsonBindVector<T>::value) {
+                    fossil_media_json_writer_begin_array(w);
+                    for (const auto& item : v) {
+                        JsonBindTraits<typename T::value_type>::write(w, item);
+                    }
+                    fossil_media_json_writer_end_array(w);
+                } else if constexpr (JsonBindOptional<T>::value) {
+                    if (v) JsonBindTraits<typename T::value_type>::write(w, *v);
+                    else fossil_media_json_writer_null(w);
+                } else {
+                    fossil_media_json_writer_begin_object(w);
+                    std::apply([&](const auto&... f) {
+                        ((fossil_media_json_writer_key(w, f.name),
+                          JsonBindTraits<std::decay_t<decltype(v.*(f.member))>>::write(w, v.*(f.member))), ...);
+                    }, T::json_fields);
+                    fossil_media_json_writer_end_object(w);
                 }
             }
 
-            /**
-             * @brief Create a JSON integer value.
-             * @param i Integer value.
-             * @return Json object holding an integer.
-             */
-            static Json new_int(long long i) {
-                return Json(fossil_media_json_new_int(i));
+            static bool scalar(void* target, const JsonBindScalar& s) {
+                T& v = *static_cast<T*>(target);
+                if constexpr (std::is_same_v<T, bool>) {
+                    if (s.type != FOSSIL_MEDIA_JSON_BOOL) return false;
+                    v = s.boolean;
+                    return true;
+                } else if constexpr (std::is_integral_v<T>) {
+                    // Parse the source text so 64-bit values stay exact. A fraction or
+                    // exponent is accepted only when it spells a whole number (2.0, 1e3),
+                    // as JsonView::as() does; out-of-range values are rejected.
+                    if (s.type != FOSSIL_MEDIA_JSON_NUMBER) return false;
+                    T out{};
+                    const char* end = s.text.data() + s.text.size();
+                    std::from_chars_result r = std::from_chars(s.text.data(), end, out);
+                    if (r.ec == std::errc() && r.ptr == end) {
+                        v = out;
+                        return true;
+                    }
+                    double d = s.number;
+                    if (!(d > -9007199254740992.0 && d < 9007199254740992.0)) return false;
+                    long long whole = static_cast<long long>(d);
+                    if (static_cast<double>(whole) != d) return false;
+                    if constexpr (std::is_signed_v<T>) {
+                        if (whole < (long long)std::numeric_limits<T>::min() ||
+                            whole > (long long)std::numeric_limits<T>::max()) return false;
+                    } else {
+                        if (whole < 0 || (unsigned long long)whole > (unsigned long long)std::numeric_limits<T>::max())
+                            return false;
+                    }
+                    v = static_cast<T>(whole);
+                    return true;
+                } else if constexpr (std::is_floating_point_v<T>) {
+                    if (s.type != FOSSIL_MEDIA_JSON_NUMBER) return false;
+                    v = static_cast<T>(s.number);
+                    return true;
+                } else if constexpr (std::is_same_v<T, std::string>) {
+                    if (s.type != FOSSIL_MEDIA_JSON_STRING) return false;
+                    v.assign(s.text.data(), s.text.size());
+                    return true;
+                } else if constexpr (JsonBindOptional<T>::value) {
+                    if (s.type == FOSSIL_MEDIA_JSON_NULL) {
+                        v.reset();
+                        return true;
+                    }
+                    return JsonBindTraits<typename T::value_type>::scalar(v ? &*v : &v.emplace(), s);
+                } else {
+                    return false;
+                }
             }
 
-            /**
-             * @brief Get integer value from this JSON number.
-             * @return Integer value.
-             * @throws JsonError if not a number or out of range.
-             */
-            long long get_int() const {
-                long long out = 0;
-                if (fossil_media_json_get_int(value_, &out) != 0) {
-                    throw JsonError("Failed to get integer from JSON value");
+            static JsonBindSlot open(void* target) {
+                if constexpr (JsonBindOptional<T>::value) {
+                    // An engaged optional is bound in place, so missing keys keep their values
+                    using U = typename T::value_type;
+                    T& v = *static_cast<T*>(target);
+                    return JsonBindTraits<U>::open(v ? &*v : &v.emplace());
+                } else {
+                    if constexpr (JsonBindVector<T>::value) static_cast<T*>(target)->clear();
+                    return JsonBindSlot{target, &ops};
+                }
+            }
+
+            static JsonBindSlot member(void* target, std::string_view key) {
+                JsonBindSlot slot{nullptr, nullptr};
+                if constexpr (JsonBound<T>::value) {
+                    T& v = *static_cast<T*>(target);
+                    std::apply([&](const auto&... f) {
+                        (void)((key == f.name
+                                    ? (slot = JsonBindSlot{&(v.*(f.member)),
+                                                           &JsonBindTraits<std::decay_t<decltype(v.*(f.member))>>::ops},
+                                       true)
+                                    : false) || ...);
+                    }, T::json_fields);
+                } else {
+                    (void)target;
+                    (void)key;
+                }
+                return slot;
+            }
+
+            static JsonBindSlot element(void* target) {
+                if constexpr (JsonBindVector<T>::value) {
+                    using U = typename T::value_type;
+                    if constexpr (std::is_same_v<U, bool>) return JsonBindSlot{target, &JsonBindBoolElement<T>::ops};
+                    else return JsonBindSlot{&static_cast<T*>(target)->emplace_back(), &JsonBindTraits<U>::ops};
+                } else {
+                    (void)target;
+                    return JsonBindSlot{nullptr, nullptr};
                 }
-                return out;
             }
 
+            static constexpr JsonBindOps::Kind kind() {
+                if constexpr (JsonBound<T>::value) return JsonBindOps::OBJECT;
+                else if constexpr (JsonBindVector<T>::value) return JsonBindOps::ARRAY;
+                else return JsonBindOps::SCALAR;
+            }
+
+            static constexpr const char* expect() {
+                if constexpr (std::is_same_v<T, bool>) return "boolean";
+                else if constexpr (std::is_integral_v<T>) return "integer";
+                else if constexpr (std::is_floating_point_v<T>) return "number";
+                else if constexpr (std::is_same_v<T, std::string>) return "string";
+                else if constexpr (JsonBindVector<T>::value) return "array";
+                else if constexpr (JsonBindOptional<T>::value) return JsonBindTraits<typename T::value_type>::expect();
+                else return "object";
+            }
+
+            static constexpr JsonBindOps ops{kind(), expect(), &scalar, &open, &member, &element};
+        };
+
+        /**
+         * @brief Direct conversion between JSON text and a bound type.
+         *
+         * stringify() walks the struct through a fossil_media_json_writer_t and
+         * parse() fills it from fossil_media_json_parse_sax() events; neither
+         * builds a fossil_media_json_value_t tree. On parse, missing keys keep
+         * their current values, unknown keys are skipped and a repeated array
+         * key replaces the earlier elements.
+         */
+        template <typename T>
+        class JsonBinding {
+        public:
             /**
-             * @brief Print a debug dump of this JSON value.
-             * @param indent Starting indentation level.
+             * @brief Serialize `value` to JSON text.
+             * @param value Value to write.
+             * @param pretty Indent the output.
+             * @throws JsonError on a non-finite number or allocation failure.
              */
-            void debug_dump(int indent = 0) const {
-                fossil_media_json_debug_dump(value_, indent);
+            static std::string stringify(const T& value, bool pretty = false) {
+                std::string out;
+                fossil_media_json_writer_t* w = fossil_media_json_writer_create(&append, &out, pretty ? 1 : 0);
+                if (!w) throw JsonError("Failed to create JSON writer");
+                try {
+                    JsonBindTraits<T>::write(w, value);
+                } catch (...) {
+                    fossil_media_json_writer_free(w);
+                    throw;
+                }
+                fossil_media_json_error_t err{};
+                int rc = fossil_media_json_writer_finish(w, &err);
+                fossil_media_json_writer_free(w);
+                if (rc != 0) throw JsonError(std::string("Stringify error: ") + err.message);
+                return out;
             }
 
             /**
-             * @brief Validate JSON text without building a DOM.
-             * @param text Input JSON text.
-             * @return true if valid, false otherwise.
+             * @brief Parse JSON text into `out`, updating it in place.
+             * @throws JsonError on malformed input or a value of the wrong type.
              */
-            static bool validate(const std::string& text) {
+            static void parse(const std::string& text, T& out) {
+                Decoder d(JsonBindSlot{&out, &JsonBindTraits<T>::ops});
                 fossil_media_json_error_t err{};
-                return fossil_media_json_validate(text.c_str(), &err) == 0;
+                int rc = fossil_media_json_parse_sax(text.c_str(), &Decoder::handler, &d, &err);
+                if (d.pending) std::rethrow_exception(d.pending);
+                if (rc != 0) throw JsonError(std::string("Parse error: ") + err.message);
             }
 
             /**
-             * @brief Get a JSON value using a dotted path expression.
-             * @param path Path string (e.g., "user.name" or "items[2].id").
-             * @return Json object at the path.
-             * @throws JsonError if not found.
+             * @brief Parse JSON text into a default-constructed T.
+             * @throws JsonError on malformed input or a value of the wrong type.
              */
-            Json get_path(const std::string& path) const {
-                fossil_media_json_value_t* v = fossil_media_json_get_path(value_, path.c_str());
-                if (!v) {
-                    // Return a null Json object if path not found
-                    return Json(fossil_media_json_new_null());
-                }
-                return Json(v);
+            static T parse(const std::string& text) {
+                T out{};
+                parse(text, out);
+                return out;
             }
-        
+
         private:
-            fossil_media_json_value_t* value_;
+            static int append(void* user, const char* data, size_t len) {
+                try {
+                    static_cast<std::string*>(user)->append(data, len);
+                    return 0;
+                } catch (...) {
+                    return 1;
+                }
+            }
+
+            // One frame per open container; a frame with no ops is a skipped subtree.
+            // The key lives in its object's frame, so it is gone once that object closes.
+            struct Frame {
+                JsonBindSlot self;
+                JsonBindSlot next;  // object frames: slot selected by the last key
+                std::string key;    // object frames: the last key
+            };
+
+            struct Decoder {
+                explicit Decoder(JsonBindSlot root_slot) : root(root_slot) {}
+
+                JsonBindSlot root;
+                std::vector<Frame> stack;
+                std::exception_ptr pending;
+
+                JsonBindSlot slot() {
+                    if (stack.empty()) return root;
+                    Frame& f = stack.back();
+                    if (!f.self.ops) return JsonBindSlot{nullptr, nullptr};
+                    if (f.self.ops->kind == JsonBindOps::ARRAY) return f.self.ops->element(f.self.target);
+                    return f.next;
+                }
+
+                // Names the member being decoded, or the member holding the array
+                // whose element is; the root and nested array elements get no name.
+                [[noreturn]] void mismatch(const JsonBindOps* ops) {
+                    std::string msg = std::string("Bind error: expected ") + ops->expect;
+                    size_t n = stack.size();
+                    if (n > 0 && stack[n - 1].self.ops->kind == JsonBindOps::OBJECT)
+                        msg += " for \"" + stack[n - 1].key + "\"";
+                    else if (n > 1 && stack[n - 2].self.ops->kind == JsonBindOps::OBJECT)
+                        msg += " for an element of \"" + stack[n - 2].key + "\"";
+                    throw JsonError(msg);
+                }
+
+                void scalar(const JsonBindScalar& s) {
+                    JsonBindSlot to = slot();
+                    if (to.ops && !to.ops->scalar(to.target, s)) mismatch(to.ops);
+                }
+
+                void open(JsonBindOps::Kind kind) {
+                    JsonBindSlot to = slot();
+                    if (to.ops) {
+                        const JsonBindOps* declared = to.ops;
+                        to = to.ops->open(to.target);
+                        if (to.ops->kind != kind) mismatch(declared);
+                    }
+                    stack.push_back(Frame{to, JsonBindSlot{nullptr, nullptr}, std::string()});
+                }
+
+                template <typename F>
+                static int guard(void* user, F&& fn) {
+                    Decoder* d = static_cast<Decoder*>(user);
+                    try {
+                        fn(*d);
+                        return 0;
+                    } catch (...) {
+                        d->pending = std::current_exception();
+                        return 1;
+                    }
+                }
+
+                static int on_start_object(void* u) {
+                    return guard(u, [](Decoder& d) { d.open(JsonBindOps::OBJECT); });
+                }
+                static int on_start_array(void* u) {
+                    return guard(u, [](Decoder& d) { d.open(JsonBindOps::ARRAY); });
+                }
+                static int on_end(void* u) {
+                    static_cast<Decoder*>(u)->stack.pop_back();
+                    return 0;
+                }
+                static int on_key(void* u, const char* str, size_t len) {
+                    return guard(u, [&](Decoder& d) {
+                        Frame& f = d.stack.back();
+                        f.key.assign(str, len);
+                        f.next = f.self.ops ? f.self.ops->member(f.self.target, std::string_view(str, len))
+                                            : JsonBindSlot{nullptr, nullptr};
+                    });
+                }
+                static int on_string(void* u, const char* str, size_t len) {
+                    return guard(u, [&](Decoder& d) {
+                        d.scalar(JsonBindScalar{FOSSIL_MEDIA_JSON_STRING, std::string_view(str, len), 0.0, false});
+                    });
+                }
+                static int on_number(void* u, double value, const char* text, size_t len) {
+                    return guard(u, [&](Decoder& d) {
+                        d.scalar(JsonBindScalar{FOSSIL_MEDIA_JSON_NUMBER, std::string_view(text, len), value, false});
+                    });
+                }
+                static int on_boolean(void* u, int value) {
+                    return guard(u, [&](Decoder& d) {
+                        d.scalar(JsonBindScalar{FOSSIL_MEDIA_JSON_BOOL, std::string_view(), 0.0, value != 0});
+                    });
+                }
+                static int on_null(void* u) {
+                    return guard(u, [](Decoder& d) {
+                        d.scalar(JsonBindScalar{FOSSIL_MEDIA_JSON_NULL, std::string_view(), 0.0, false});
+                    });
+                }
+
+                static constexpr fossil_media_json_sax_handler_t handler{
+                    &on_start_object, &on_end, &on_start_array, &on_end,
+                    &on_key, &on_string, &on_number, &on_boolean, &on_null};
+            };
         };
 
     } // namespace media
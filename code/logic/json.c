@@ -22,6 +22,10 @@
  * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
  * -----------------------------------------------------------------------------
  */
+#if defined(__APPLE__) && !defined(_DARWIN_C_SOURCE)
+/* Strict POSIX modes hide sysconf(_SC_NPROCESSORS_ONLN) on Darwin */
+#define _DARWIN_C_SOURCE 1
+#endif
 #include "fossil/media/json.h"
 #include "fossil/media/media.h"
 #include <stdlib.h>
@@ -30,11 +34,49 @@
 #include <ctype.h>
 #include <stdio.h>
 #include <math.h>
+#include <float.h>
+
+#if !defined(FOSSIL_MEDIA_JSON_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64) || \
+    ((defined(__i386__) || defined(_M_IX86)) && defined(__SSE2__)))
+#define JSON_SIMD_X86 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/* Allocations left before injected failures, -1 = off (fossil_media_json_debug_fail_alloc) */
+static long json_alloc_budget = -1;
+
+static int fm_out_of_budget(void) {
+    if (json_alloc_budget < 0) return 0;
+    if (json_alloc_budget == 0) return 1;
+    json_alloc_budget--;
+    return 0;
+}
 
 /* Internal helpers and allocator wrappers */
-static void *fm_malloc(size_t n){ return malloc(n); }
+static void *fm_malloc(size_t n){ return fm_out_of_budget() ? NULL : malloc(n); }
 static void fm_free(void *p){ free(p); }
-static void *fm_realloc(void *p, size_t n){ return realloc(p, n); }
+static void *fm_realloc(void *p, size_t n){ return fm_out_of_budget() ? NULL : realloc(p, n); }
+
+/* Value storage flags (fossil_media_json_value_t.flags) */
+#define JSON_FLAG_ARENA       0x0001u  /* node lives in a document arena */
+#define JSON_FLAG_ARENA_ROOT  0x0002u  /* node is the root slot of its arena */
+#define JSON_FLAG_SHARED_KEYS 0x0004u  /* object keys belong to a key table */
+#define JSON_FLAG_INT64       0x0008u  /* number holds an exact int64 (u.integer.exact.i64) */
+#define JSON_FLAG_UINT64      0x0010u  /* number holds an exact uint64 above INT64_MAX */
+#define JSON_FLAG_INTEGER     (JSON_FLAG_INT64 | JSON_FLAG_UINT64)
 
 /* Error helpers */
 static void set_error(fossil_media_json_error_t *err, int code, size_t pos, const char *fmt, ...) {
@@ -47,10 +89,560 @@ static void set_error(fossil_media_json_error_t *err, int code, size_t pos, cons
     va_end(ap);
 }
 
+/* Threads and locks (NDJSON workers, parallel stringify, the key index registry) */
+#if defined(_WIN32)
+typedef HANDLE json_thread_t;
+typedef CRITICAL_SECTION json_mutex_t;
+typedef CONDITION_VARIABLE json_cond_t;
+#define json_mutex_init(m)    InitializeCriticalSection(m)
+#define json_mutex_destroy(m) DeleteCriticalSection(m)
+#define json_mutex_lock(m)    EnterCriticalSection(m)
+#define json_mutex_unlock(m)  LeaveCriticalSection(m)
+#define json_cond_init(c)     InitializeConditionVariable(c)
+#define json_cond_destroy(c)  ((void)(c))
+#define json_cond_wait(c, m)  SleepConditionVariableCS(c, m, INFINITE)
+#define json_cond_broadcast(c) WakeAllConditionVariable(c)
+#else
+typedef pthread_t json_thread_t;
+typedef pthread_mutex_t json_mutex_t;
+typedef pthread_cond_t json_cond_t;
+#define json_mutex_init(m)    pthread_mutex_init(m, NULL)
+#define json_mutex_destroy(m) pthread_mutex_destroy(m)
+#define json_mutex_lock(m)    pthread_mutex_lock(m)
+#define json_mutex_unlock(m)  pthread_mutex_unlock(m)
+#define json_cond_init(c)     pthread_cond_init(c, NULL)
+#define json_cond_destroy(c)  pthread_cond_destroy(c)
+#define json_cond_wait(c, m)  pthread_cond_wait(c, m)
+#define json_cond_broadcast(c) pthread_cond_broadcast(c)
+#endif
+
+// -----------------------------------------------------------------------------
+// Document arena
+// -----------------------------------------------------------------------------
+
+#define JSON_ARENA_MIN_CHUNK  ((size_t)16 * 1024)
+#define JSON_ARENA_MAX_CHUNK  ((size_t)16 * 1024 * 1024)
+
+typedef struct json_arena_chunk {
+    struct json_arena_chunk *next;
+    size_t size;
+} json_arena_chunk_t;
+
+/* The root value is embedded in the arena header so freeing it can find the arena. */
+typedef struct {
+    json_arena_chunk_t *chunks;
+    char *ptr;
+    char *end;
+    size_t next_size;
+    void (*release)(void *);  /* frees input the document borrows, or NULL */
+    void *release_arg;
+    fossil_media_json_value_t root;
+} json_arena_t;
+
+#define JSON_ARENA_CHUNK_HDR  ((sizeof(json_arena_chunk_t) + 15) & ~(size_t)15)
+
+static json_arena_t *arena_create(size_t hint) {
+    json_arena_t *a = fm_malloc(sizeof(*a));
+    if (!a) return NULL;
+    memset(a, 0, sizeof(*a));
+    if (hint < JSON_ARENA_MIN_CHUNK) hint = JSON_ARENA_MIN_CHUNK;
+    if (hint > JSON_ARENA_MAX_CHUNK) hint = JSON_ARENA_MAX_CHUNK;
+    a->next_size = hint;
+    return a;
+}
+
+static void arena_destroy(json_arena_t *a) {
+    if (!a) return;
+    json_arena_chunk_t *ch = a->chunks;
+    while (ch) {
+        json_arena_chunk_t *next = ch->next;
+        fm_free(ch);
+        ch = next;
+    }
+    if (a->release) a->release(a->release_arg);
+    fm_free(a);
+}
+
+static void *arena_alloc(json_arena_t *a, size_t n) {
+    n = (n + 7) & ~(size_t)7;
+    if ((size_t)(a->end - a->ptr) < n) {
+        size_t size = a->next_size;
+        if (size < n) size = n;
+        json_arena_chunk_t *ch = fm_malloc(JSON_ARENA_CHUNK_HDR + size);
+        if (!ch) return NULL;
+        ch->next = a->chunks;
+        ch->size = size;
+        a->chunks = ch;
+        a->ptr = (char *)ch + JSON_ARENA_CHUNK_HDR;
+        a->end = a->ptr + size;
+        if (a->next_size < JSON_ARENA_MAX_CHUNK) a->next_size *= 2;
+    }
+    void *p = a->ptr;
+    a->ptr += n;
+    return p;
+}
+
+static json_arena_t *arena_of_root(fossil_media_json_value_t *root) {
+    return (json_arena_t *)((char *)root - offsetof(json_arena_t, root));
+}
+
+/* Arena documents are read-only; mutators refuse their nodes. */
+#define JSON_IS_ARENA(v) (((v)->flags & JSON_FLAG_ARENA) != 0)
+
+// -----------------------------------------------------------------------------
+// Structural index (stage 1)
+// -----------------------------------------------------------------------------
+//
+// Large inputs are classified 64 bytes at a time into bitmasks (quotes,
+// backslashes, structural characters, whitespace). Escapes and string state are
+// resolved with carried bits, and the resulting token positions (structural
+// characters, quotes and the first byte of every number or literal) drive the
+// grammar (stage 2): whitespace is never visited and strings are delimited by
+// their two quote tokens. Stage 1 runs ahead of stage 2 in fixed windows, so
+// index memory is bounded. Stage 2 gives up on the first surprise and the
+// byte-at-a-time parser reruns the input to report the exact error.
+
+#define JSON_INDEX_MIN_LEN    ((size_t)4096)
+#define JSON_INDEX_WINDOW     ((size_t)4096)   /* bytes classified per refill */
+
+typedef struct {
+    uint64_t quote;
+    uint64_t bslash;
+    uint64_t op;
+    uint64_t ws;
+} json_block_t;
+
+/* Classify `nblocks` consecutive 64-byte blocks starting at p */
+typedef void (*json_classify_fn)(const unsigned char *p, size_t nblocks, json_block_t *out);
+
+typedef struct {
+    const char *s;
+    size_t len;
+    size_t scanned;          /* bytes classified so far */
+    uint64_t in_string;      /* all ones when the previous block ended inside a string */
+    uint64_t escaped;        /* bit 0 set when the next block starts with an escaped byte */
+    uint64_t after_scalar;   /* bit 0 set when the previous block ended inside a scalar */
+    size_t base;             /* input offset of the current window */
+    uint32_t *pos;           /* token offsets relative to base */
+    size_t count;
+    size_t cur;
+    size_t cap;
+    int done;                /* sentinel (len) emitted */
+} json_index_t;
+
+static void classify_scalar(const unsigned char *p, size_t nblocks, json_block_t *out) {
+    for (size_t blk = 0; blk < nblocks; ++blk, p += 64) {
+        uint64_t quote = 0, bslash = 0, op = 0, ws = 0;
+        for (int k = 0; k < 64; ++k) {
+            uint64_t bit = (uint64_t)1 << k;
+            switch (p[k]) {
+                case '"': quote |= bit; break;
+                case '\\': bslash |= bit; break;
+                case '{': case '}': case '[': case ']': case ':': case ',': op |= bit; break;
+                case ' ': case '\t': case '\n': case '\r': ws |= bit; break;
+                default: break;
+            }
+        }
+        out[blk].quote = quote; out[blk].bslash = bslash; out[blk].op = op; out[blk].ws = ws;
+    }
+}
+
+#ifdef JSON_SIMD_X86
+#if defined(__GNUC__) || defined(__clang__)
+#define JSON_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define JSON_TARGET_AVX2
+#endif
+
+static void classify_sse2(const unsigned char *p, size_t nblocks, json_block_t *out) {
+    const __m128i c_quote = _mm_set1_epi8('"'), c_bslash = _mm_set1_epi8('\\');
+    const __m128i c_lbrace = _mm_set1_epi8('{'), c_rbrace = _mm_set1_epi8('}');
+    const __m128i c_lbrack = _mm_set1_epi8('['), c_rbrack = _mm_set1_epi8(']');
+    const __m128i c_colon = _mm_set1_epi8(':'), c_comma = _mm_set1_epi8(',');
+    const __m128i c_sp = _mm_set1_epi8(' '), c_tab = _mm_set1_epi8('\t');
+    const __m128i c_lf = _mm_set1_epi8('\n'), c_cr = _mm_set1_epi8('\r');
+    for (size_t blk = 0; blk < nblocks; ++blk, p += 64) {
+        uint64_t quote = 0, bslash = 0, op = 0, ws = 0;
+        for (int k = 0; k < 4; ++k) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(p + 16 * k));
+            __m128i o = _mm_or_si128(
+                _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, c_lbrace), _mm_cmpeq_epi8(v, c_rbrace)),
+                             _mm_or_si128(_mm_cmpeq_epi8(v, c_lbrack), _mm_cmpeq_epi8(v, c_rbrack))),
+                _mm_or_si128(_mm_cmpeq_epi8(v, c_colon), _mm_cmpeq_epi8(v, c_comma)));
+            __m128i w = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, c_sp), _mm_cmpeq_epi8(v, c_tab)),
+                                     _mm_or_si128(_mm_cmpeq_epi8(v, c_lf), _mm_cmpeq_epi8(v, c_cr)));
+            int sh = 16 * k;
+            quote |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, c_quote)) << sh;
+            bslash |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, c_bslash)) << sh;
+            op |= (uint64_t)(uint16_t)_mm_movemask_epi8(o) << sh;
+            ws |= (uint64_t)(uint16_t)_mm_movemask_epi8(w) << sh;
+        }
+        out[blk].quote = quote; out[blk].bslash = bslash; out[blk].op = op; out[blk].ws = ws;
+    }
+}
+
+/* Nibble lookup: bits 0-2 flag structural characters, bits 3-4 whitespace */
+JSON_TARGET_AVX2
+static void classify_avx2(const unsigned char *p, size_t nblocks, json_block_t *out) {
+    const __m256i lo_tab = _mm256_setr_epi8(16, 0, 0, 0, 0, 0, 0, 0, 0, 8, 12, 1, 2, 9, 0, 0,
+                                            16, 0, 0, 0, 0, 0, 0, 0, 0, 8, 12, 1, 2, 9, 0, 0);
+    const __m256i hi_tab = _mm256_setr_epi8(8, 0, 18, 4, 0, 1, 0, 1, 0, 0, 0, 3, 2, 1, 0, 0,
+                                            8, 0, 18, 4, 0, 1, 0, 1, 0, 0, 0, 3, 2, 1, 0, 0);
+    const __m256i nib = _mm256_set1_epi8(0x0F);
+    const __m256i op_bits = _mm256_set1_epi8(7);
+    const __m256i ws_bits = _mm256_set1_epi8(24);
+    const __m256i c_quote = _mm256_set1_epi8('"');
+    const __m256i c_bslash = _mm256_set1_epi8('\\');
+    const __m256i zero = _mm256_setzero_si256();
+    for (size_t blk = 0; blk < nblocks; ++blk, p += 64) {
+        __m256i v0 = _mm256_loadu_si256((const __m256i *)p);
+        __m256i v1 = _mm256_loadu_si256((const __m256i *)(p + 32));
+        __m256i k0 = _mm256_and_si256(_mm256_shuffle_epi8(lo_tab, v0),
+                                      _mm256_shuffle_epi8(hi_tab, _mm256_and_si256(_mm256_srli_epi16(v0, 4), nib)));
+        __m256i k1 = _mm256_and_si256(_mm256_shuffle_epi8(lo_tab, v1),
+                                      _mm256_shuffle_epi8(hi_tab, _mm256_and_si256(_mm256_srli_epi16(v1, 4), nib)));
+        uint64_t op0 = (uint32_t)~_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(k0, op_bits), zero));
+        uint64_t op1 = (uint32_t)~_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(k1, op_bits), zero));
+        uint64_t ws0 = (uint32_t)~_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(k0, ws_bits), zero));
+        uint64_t ws1 = (uint32_t)~_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(k1, ws_bits), zero));
+        uint64_t q0 = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v0, c_quote));
+        uint64_t q1 = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v1, c_quote));
+        uint64_t b0 = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v0, c_bslash));
+        uint64_t b1 = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v1, c_bslash));
+        out[blk].quote = q0 | (q1 << 32);
+        out[blk].bslash = b0 | (b1 << 32);
+        out[blk].op = op0 | (op1 << 32);
+        out[blk].ws = ws0 | (ws1 << 32);
+    }
+}
+
+static int cpu_has_avx2(void) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+    int r[4];
+    __cpuid(r, 0);
+    if (r[0] < 7) return 0;
+    __cpuid(r, 1);
+    if (!(r[2] & (1 << 27))) return 0;                  /* OSXSAVE */
+    if ((_xgetbv(0) & 0x6) != 0x6) return 0;            /* XMM and YMM state enabled */
+    __cpuidex(r, 7, 0);
+    return (r[1] & (1 << 5)) != 0;
+#else
+    return 0;
+#endif
+}
+#endif
+
+typedef struct {
+    json_classify_fn classify;
+    const char *name;
+} json_backend_t;
+
+static const json_backend_t json_backends[] = {
+    {classify_scalar, "scalar"},
+#ifdef JSON_SIMD_X86
+    {classify_sse2, "sse2"},
+    {classify_avx2, "avx2"},
+#endif
+};
+
+/* Selected indexer, NULL until first use; published with release/acquire */
+static const json_backend_t *json_backend;
+
+static const json_backend_t *backend_load(void) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __atomic_load_n(&json_backend, __ATOMIC_ACQUIRE);
+#else
+    return *(const json_backend_t *volatile *)&json_backend;
+#endif
+}
+
+static void backend_store(const json_backend_t *b) {
+#if defined(_MSC_VER)
+    _InterlockedExchangePointer((void *volatile *)&json_backend, (void *)b);
+#elif defined(__GNUC__) || defined(__clang__)
+    __atomic_store_n(&json_backend, b, __ATOMIC_RELEASE);
+#else
+    json_backend = b;
+#endif
+}
+
+static int backend_supported(const json_backend_t *b) {
+#ifdef JSON_SIMD_X86
+    if (b->classify == classify_avx2) return cpu_has_avx2();
+#endif
+    (void)b;
+    return 1;
+}
+
+static json_classify_fn select_classifier(void) {
+    const json_backend_t *b = backend_load();
+    if (!b) {
+        /* Callers racing on first use all detect the same CPU and store the same entry */
+        b = &json_backends[sizeof(json_backends) / sizeof(json_backends[0]) - 1];
+        while (!backend_supported(b)) --b;
+        backend_store(b);
+    }
+    return b->classify;
+}
+
+const char *fossil_media_json_simd_backend(void) {
+    select_classifier();
+    return backend_load()->name;
+}
+
+int fossil_media_json_simd_select(const char *name) {
+    if (!name) { backend_store(NULL); return 0; }
+    for (size_t k = 0; k < sizeof(json_backends) / sizeof(json_backends[0]); ++k) {
+        if (strcmp(json_backends[k].name, name) == 0 && backend_supported(&json_backends[k])) {
+            backend_store(&json_backends[k]);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void fossil_media_json_debug_fail_alloc(long after) {
+    json_alloc_budget = after < 0 ? -1 : after;
+}
+
+static unsigned json_ctz64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctzll(x);
+#else
+    unsigned n = 0;
+    while (!(x & 1)) { x >>= 1; n++; }
+    return n;
+#endif
+}
+
+static unsigned json_popcount64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_popcountll(x);
+#else
+    unsigned n = 0;
+    while (x) { x &= x - 1; n++; }
+    return n;
+#endif
+}
+
+/* Bytes escaped by a backslash in this block; *carry holds bit 0 for the next block */
+static inline uint64_t json_escaped_bits(uint64_t bslash, uint64_t *carry) {
+    /* A backslash escapes the byte after it, unless it is itself escaped */
+    uint64_t escaped = *carry;
+    uint64_t bs = bslash & ~escaped;
+    *carry = 0;
+    while (bs) {
+        unsigned k = json_ctz64(bs);
+        if (k == 63) { *carry = 1; break; }
+        uint64_t next = (uint64_t)1 << (k + 1);
+        escaped |= next;
+        bs &= ~(((uint64_t)1 << k) | next);
+    }
+    return escaped;
+}
+
+/* Bytes from each opening quote up to (not including) its closing quote */
+static inline uint64_t json_string_bits(uint64_t quote, uint64_t *carry) {
+    /* Prefix XOR; *carry is all ones when the block ends inside a string */
+    uint64_t in_str = quote;
+    in_str ^= in_str << 1;
+    in_str ^= in_str << 2;
+    in_str ^= in_str << 4;
+    in_str ^= in_str << 8;
+    in_str ^= in_str << 16;
+    in_str ^= in_str << 32;
+    in_str ^= *carry;
+    *carry = (uint64_t)0 - (in_str >> 63);
+    return in_str;
+}
+
+// -----------------------------------------------------------------------------
+// String runs
+// -----------------------------------------------------------------------------
+//
+// Strings are copied a run at a time: json_plain_run() finds the next byte
+// that needs attention and everything before it moves in one memcpy. The
+// SSE2 version reads whole aligned 16-byte blocks, which never reach into the
+// page after the terminator; bytes past the NUL are read but ignored.
+//
+// That over-read is page-safe but not object-safe: the tail of the last
+// block may belong to another allocation, possibly one another thread is
+// writing. Its bytes never affect the result, so the functions that do it
+// (json_plain_run() and the lazy container skip) are marked JSON_NO_SANITIZE
+// to keep AddressSanitizer, ThreadSanitizer and MemorySanitizer off their
+// loads. Valgrind cannot be told per function; its default
+// --partial-loads-ok=yes already accepts aligned loads that straddle the end
+// of a block. Builds without JSON_SIMD_X86 read byte by byte and stop at the
+// NUL.
+
+#define JSON_RUN_CTL   0x1   /* also stop at control characters */
+#define JSON_RUN_HIGH  0x2   /* also stop at bytes >= 0x80 */
+
+#if defined(__clang__)
+#define JSON_NO_SANITIZE __attribute__((no_sanitize("address", "thread", "memory")))
+#elif defined(__GNUC__)
+#define JSON_NO_SANITIZE __attribute__((no_sanitize_address, no_sanitize_thread))
+#else
+#define JSON_NO_SANITIZE
+#endif
+
+#ifdef JSON_SIMD_X86
+/* Bit k set when byte k of v ends a run */
+static inline unsigned json_run_mask(__m128i v, unsigned flags) {
+    const __m128i c_quote = _mm_set1_epi8('"'), c_bslash = _mm_set1_epi8('\\');
+    __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, c_quote), _mm_cmpeq_epi8(v, c_bslash));
+    if (flags & JSON_RUN_CTL)
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(_mm_subs_epu8(v, _mm_set1_epi8(0x1F)), _mm_setzero_si128()));
+    else
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+    unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+    if (flags & JSON_RUN_HIGH) mask |= (unsigned)_mm_movemask_epi8(v);
+    return mask;
+}
+#endif
+
+/* Bytes before the first '"', '\\' or NUL, or a byte in one of the JSON_RUN_* classes */
+JSON_NO_SANITIZE
+static inline size_t json_plain_run(const char *s, unsigned flags) {
+#ifdef JSON_SIMD_X86
+    size_t off = (size_t)((uintptr_t)s & 15);
+    const __m128i *p = (const __m128i *)(const void *)(s - off);
+    unsigned mask = json_run_mask(_mm_load_si128(p), flags) >> off;
+    if (mask) return json_ctz64(mask);
+    for (size_t n = 16 - off;; n += 16) {
+        mask = json_run_mask(_mm_load_si128(++p), flags);
+        if (mask) return n + json_ctz64(mask);
+    }
+#else
+    const unsigned char *u = (const unsigned char *)s;
+    for (size_t n = 0;; ++n) {
+        unsigned char ch = u[n];
+        if (ch == '"' || ch == '\\' || ch == 0) return n;
+        if ((flags & JSON_RUN_CTL) && ch < 0x20) return n;
+        if ((flags & JSON_RUN_HIGH) && ch >= 0x80) return n;
+    }
+#endif
+}
+
+/* Classify the next window of input and refill the position buffer */
+static void index_fill(json_index_t *ix) {
+    json_classify_fn classify = select_classifier();
+    json_block_t blocks[JSON_INDEX_WINDOW / 64];
+    size_t at = ix->scanned;
+    size_t len = ix->len;
+    size_t span = len - at < JSON_INDEX_WINDOW ? len - at : JSON_INDEX_WINDOW;
+    size_t full = span / 64;
+    size_t rest = span % 64;
+    if (full) classify((const unsigned char *)ix->s + at, full, blocks);
+    if (rest) {
+        /* Pad the final partial block with whitespace */
+        unsigned char tail[64];
+        memcpy(tail, ix->s + at + full * 64, rest);
+        memset(tail + rest, ' ', 64 - rest);
+        classify(tail, 1, blocks + full);
+    }
+
+    uint64_t prev_in_string = ix->in_string;
+    uint64_t prev_escaped = ix->escaped;
+    uint64_t prev_scalar = ix->after_scalar;
+    uint32_t *out = ix->pos;
+    size_t n = 0;
+    size_t nblocks = full + (rest ? 1 : 0);
+    for (size_t blk = 0; blk < nblocks; ++blk) {
+        const json_block_t *b = &blocks[blk];
+
+        uint64_t quote = b->quote & ~json_escaped_bits(b->bslash, &prev_escaped);
+        uint64_t in_str = json_string_bits(quote, &prev_in_string);
+
+        /* Any other byte outside a string belongs to a number or literal */
+        uint64_t scalar = ~(b->op | b->quote | b->ws);
+        uint64_t scalar_start = scalar & ~((scalar << 1) | prev_scalar);
+        prev_scalar = scalar >> 63;
+        uint64_t tokens = ((b->op | scalar_start) & ~in_str) | quote;
+        if (blk == full) tokens &= ((uint64_t)1 << rest) - 1;
+
+        /* Emit positions four at a time; the window buffer has slack for this */
+        uint32_t *o = out + n;
+        uint32_t rel = (uint32_t)(blk * 64);
+        n += json_popcount64(tokens);
+        while (tokens) {
+            o[0] = rel + json_ctz64(tokens); tokens &= tokens - 1;
+            o[1] = rel + (tokens ? json_ctz64(tokens) : 0); tokens &= tokens - 1;
+            o[2] = rel + (tokens ? json_ctz64(tokens) : 0); tokens &= tokens - 1;
+            o[3] = rel + (tokens ? json_ctz64(tokens) : 0); tokens &= tokens - 1;
+            o += 4;
+        }
+    }
+    ix->base = at;
+    ix->scanned = at + span;
+    ix->in_string = prev_in_string;
+    ix->escaped = prev_escaped;
+    ix->after_scalar = prev_scalar;
+    ix->count = n;
+    ix->cur = 0;
+    if (ix->scanned >= len && !ix->done) {
+        ix->pos[ix->count++] = (uint32_t)(len - at);
+        ix->done = 1;
+    }
+}
+
+/* Position of the next token without consuming it (len once exhausted) */
+static size_t index_peek(json_index_t *ix) {
+    while (ix->cur >= ix->count) {
+        if (ix->done) return ix->len;
+        index_fill(ix);
+    }
+    return ix->base + ix->pos[ix->cur];
+}
+
+static inline size_t index_take(json_index_t *ix) {
+    if (ix->cur < ix->count) return ix->base + ix->pos[ix->cur++];
+    size_t p = index_peek(ix);
+    if (ix->cur < ix->count) ix->cur++;
+    return p;
+}
+
+static int index_init(json_index_t *ix, const char *s, size_t len) {
+    memset(ix, 0, sizeof(*ix));
+    ix->s = s;
+    ix->len = len;
+    ix->cap = JSON_INDEX_WINDOW + 64 + 1;
+    ix->pos = fm_malloc(sizeof(*ix->pos) * ix->cap);
+    return ix->pos ? 0 : -1;
+}
+
 /* Forward parse functions */
+typedef struct {
+    char *key;
+    fossil_media_json_value_t *val;
+} json_slot_t;
+
+/* An array or object being parsed; its children collect on ctx_t.stack */
+typedef struct {
+    fossil_media_json_value_t *v;
+    size_t base;           /* first child slot on the stack */
+    char *key;             /* key of v in the enclosing object, else NULL */
+} json_frame_t;
+
 typedef struct {
     const char *s;
     size_t i;
+    json_arena_t *arena;   /* NULL for heap-allocated documents */
+    json_slot_t *stack;    /* children of the containers being parsed */
+    size_t top;
+    size_t stack_cap;
+    json_frame_t *frames;  /* open containers, innermost last */
+    size_t depth;
+    size_t frames_cap;
+    size_t max_depth;      /* 0 = unlimited */
+    char *sbuf;            /* scratch for unescaped strings */
+    size_t sbuf_cap;
+    json_index_t *idx;     /* structural index, NULL for short inputs */
+    int insitu;            /* strings are terminated/unescaped inside s */
+    fossil_media_json_keys_t *keys;  /* key table, NULL unless interning */
 } ctx_t;
 
 static void skip_ws(ctx_t *c) {
@@ -68,23 +660,24 @@ static fossil_media_json_value_t *alloc_value(void) {
     return v;
 }
 
-/* Free helpers */
-void fossil_media_json_free(fossil_media_json_value_t *v) {
+static void keymap_forget(const fossil_media_json_value_t *obj);
+
+/* Release one node whose children are already gone */
+static void release_node(fossil_media_json_value_t *v) {
     if (!v) return;
-    size_t k;
+    if (JSON_IS_ARENA(v)) {
+        if (v->flags & JSON_FLAG_ARENA_ROOT) arena_destroy(arena_of_root(v));
+        return;
+    }
     switch (v->type) {
         case FOSSIL_MEDIA_JSON_STRING:
             fm_free(v->u.string);
             break;
         case FOSSIL_MEDIA_JSON_ARRAY:
-            for (k = 0; k < v->u.array.count; ++k) fossil_media_json_free(v->u.array.items[k]);
             fm_free(v->u.array.items);
             break;
         case FOSSIL_MEDIA_JSON_OBJECT:
-            for (k = 0; k < v->u.object.count; ++k) {
-                fm_free(v->u.object.keys[k]);
-                fossil_media_json_free(v->u.object.values[k]);
-            }
+            keymap_forget(v);
             fm_free(v->u.object.keys);
             fm_free(v->u.object.values);
             break;
@@ -93,6 +686,39 @@ void fossil_media_json_free(fossil_media_json_value_t *v) {
     fm_free(v);
 }
 
+/*
+ * Free helpers. Children are released last to first. Stepping down into a
+ * child parks the parent pointer in the slot the child leaves, and stepping
+ * back up reads it from there, so any depth is freed without recursion or
+ * allocation.
+ */
+void fossil_media_json_free(fossil_media_json_value_t *v) {
+    fossil_media_json_value_t *parent = NULL;
+    for (;;) {
+        if (v && !JSON_IS_ARENA(v)) {
+            fossil_media_json_value_t **slots = NULL;
+            size_t *count = NULL;
+            if (v->type == FOSSIL_MEDIA_JSON_ARRAY) { slots = v->u.array.items; count = &v->u.array.count; }
+            else if (v->type == FOSSIL_MEDIA_JSON_OBJECT) { slots = v->u.object.values; count = &v->u.object.count; }
+            if (count && *count) {
+                size_t k = --*count;
+                if (v->type == FOSSIL_MEDIA_JSON_OBJECT && !(v->flags & JSON_FLAG_SHARED_KEYS))
+                    fm_free(v->u.object.keys[k]);
+                fossil_media_json_value_t *child = slots[k];
+                slots[k] = parent;
+                parent = v;
+                v = child;
+                continue;
+            }
+        }
+        release_node(v);
+        if (!parent) return;
+        v = parent;
+        fossil_media_json_value_t **slots = v->type == FOSSIL_MEDIA_JSON_ARRAY ? v->u.array.items : v->u.object.values;
+        parent = slots[v->type == FOSSIL_MEDIA_JSON_ARRAY ? v->u.array.count : v->u.object.count];
+    }
+}
+
 /* Constructors */
 fossil_media_json_value_t *fossil_media_json_new_null(void) {
     fossil_media_json_value_t *v = alloc_value();
@@ -112,6 +738,32 @@ fossil_media_json_value_t *fossil_media_json_new_number(double n) {
     return v;
 }
 
+/* Exact integer storage; u.number keeps the nearest double for plain readers */
+static void set_int64(fossil_media_json_value_t *v, int64_t i) {
+    v->u.integer.number = (double)i;
+    v->u.integer.exact.i64 = i;
+    v->flags = (v->flags & ~JSON_FLAG_INTEGER) | JSON_FLAG_INT64;
+}
+
+static void set_uint64(fossil_media_json_value_t *v, uint64_t u) {
+    if (u <= (uint64_t)INT64_MAX) { set_int64(v, (int64_t)u); return; }
+    v->u.integer.number = (double)u;
+    v->u.integer.exact.u64 = u;
+    v->flags = (v->flags & ~JSON_FLAG_INTEGER) | JSON_FLAG_UINT64;
+}
+
+/*
+ * The exact-integer flag of a number, or 0 once u.number no longer matches
+ * it (the caller assigned u.number directly). Readers go through this, never
+ * through the raw flags.
+ */
+static unsigned number_kind(const fossil_media_json_value_t *v) {
+    unsigned k = v->flags & JSON_FLAG_INTEGER;
+    if (k == JSON_FLAG_INT64) return v->u.integer.number == (double)v->u.integer.exact.i64 ? k : 0;
+    if (k == JSON_FLAG_UINT64) return v->u.integer.number == (double)v->u.integer.exact.u64 ? k : 0;
+    return 0;
+}
+
 fossil_media_json_value_t *fossil_media_json_new_string(const char *s) {
     fossil_media_json_value_t *v = alloc_value();
     if (!v) return NULL;
@@ -147,60 +799,450 @@ static char *dupe_string(const char *s) {
     return r;
 }
 
-/* Object set helper (replaces existing) */
-int fossil_media_json_object_set(fossil_media_json_value_t *obj, const char *key, fossil_media_json_value_t *val) {
-    if (!obj || obj->type != FOSSIL_MEDIA_JSON_OBJECT || !key) return -1;
-    size_t i;
-    for (i = 0; i < obj->u.object.count; ++i) {
-        if (strcmp(obj->u.object.keys[i], key) == 0) {
-            fossil_media_json_free(obj->u.object.values[i]);
-            obj->u.object.values[i] = val;
-            return 0;
+// -----------------------------------------------------------------------------
+// Object key index
+// -----------------------------------------------------------------------------
+//
+// Objects with JSON_KEYMAP_MIN keys or more get an open-addressing (linear
+// probing) table mapping key hashes to positions in keys[]. The keys/values
+// arrays stay the source of truth and keep insertion order; the table only
+// accelerates lookup and always refers to the first occurrence of a key.
+//
+// The table is not part of the public node. Arena documents are read-only,
+// build it while parsing and keep it in a word in front of keys[]. Heap
+// objects build it on first lookup into a registry keyed by node address,
+// split into locked stripes so readers of different objects rarely meet.
+// A heap table remembers the keys[] array and count it was built for, and a
+// lookup that finds either changed (a caller filled the public arrays by
+// hand) rebuilds it instead of trusting stale positions.
+
+#define JSON_KEYMAP_MIN     ((size_t)16)
+#define JSON_KEYMAP_STRIPES 16
+
+typedef struct {
+    uint32_t hash;
+    uint32_t pos;            /* index into keys[] plus one, 0 = empty */
+} json_keymap_slot_t;
+
+typedef struct json_keymap {
+    const fossil_media_json_value_t *owner;  /* heap object it indexes, NULL in arenas */
+    struct json_keymap *next;                /* registry chain */
+    char **keys;             /* keys[] and count the table describes */
+    size_t count;
+    size_t mask;             /* slot count minus one (power of two) */
+    json_keymap_slot_t slots[];
+} json_keymap_t;
+
+static uint32_t keymap_hash(const char *k) {
+    uint32_t h = 2166136261u;      /* FNV-1a */
+    while (*k) { h ^= (unsigned char)*k++; h *= 16777619u; }
+    return h;
+}
+
+static uint32_t keymap_hash_n(const char *k, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; ++i) { h ^= (unsigned char)k[i]; h *= 16777619u; }
+    return h;
+}
+
+static size_t keymap_bytes(size_t slots) {
+    return sizeof(json_keymap_t) + slots * sizeof(json_keymap_slot_t);
+}
+
+/* Slots for `count` keys at a load factor of at most one half */
+static size_t keymap_slots_for(size_t count) {
+    size_t n = 32;
+    while (n < count * 2) n *= 2;
+    return n;
+}
+
+/* Insert keys[pos] unless an earlier duplicate already owns the key */
+static void keymap_insert(json_keymap_t *m, char **keys, size_t pos, uint32_t h) {
+    size_t at = h & m->mask;
+    while (m->slots[at].pos) {
+        const json_keymap_slot_t *sl = &m->slots[at];
+        if (sl->hash == h && strcmp(keys[sl->pos - 1], keys[pos]) == 0) return;
+        at = (at + 1) & m->mask;
+    }
+    m->slots[at].hash = h;
+    m->slots[at].pos = (uint32_t)(pos + 1);
+}
+
+static void keymap_fill(json_keymap_t *m, size_t slots, char **keys, size_t count) {
+    m->owner = NULL;
+    m->next = NULL;
+    m->keys = keys;
+    m->count = count;
+    m->mask = slots - 1;
+    memset(m->slots, 0, slots * sizeof(json_keymap_slot_t));
+    for (size_t k = 0; k < count; ++k) keymap_insert(m, keys, k, keymap_hash(keys[k]));
+}
+
+static json_keymap_t *keymap_build(char **keys, size_t count, size_t want) {
+    if (count >= UINT32_MAX || want >= UINT32_MAX) return NULL;
+    size_t slots = keymap_slots_for(want > count ? want : count);
+    json_keymap_t *m = fm_malloc(keymap_bytes(slots));
+    if (m) keymap_fill(m, slots, keys, count);
+    return m;
+}
+
+/* Position of the first member named `key`, or -1 */
+static ptrdiff_t keymap_probe(const json_keymap_t *m, char **keys, const char *key, uint32_t h) {
+    for (size_t at = h & m->mask; m->slots[at].pos; at = (at + 1) & m->mask) {
+        const json_keymap_slot_t *sl = &m->slots[at];
+        const char *k = keys[sl->pos - 1];
+        if (sl->hash == h && (k == key || strcmp(k, key) == 0)) return (ptrdiff_t)sl->pos - 1;
+    }
+    return -1;
+}
+
+static ptrdiff_t keymap_probe_n(const json_keymap_t *m, char **keys, const char *key, size_t len, uint32_t h) {
+    for (size_t at = h & m->mask; m->slots[at].pos; at = (at + 1) & m->mask) {
+        const json_keymap_slot_t *sl = &m->slots[at];
+        const char *k = keys[sl->pos - 1];
+        if (sl->hash == h && strncmp(k, key, len) == 0 && k[len] == '\0') return (ptrdiff_t)sl->pos - 1;
+    }
+    return -1;
+}
+
+/* Table of an arena object, stored in front of its keys[] by finish_object() */
+static const json_keymap_t *arena_keymap(const fossil_media_json_value_t *obj) {
+    if (obj->u.object.count < JSON_KEYMAP_MIN || obj->u.object.count >= UINT32_MAX) return NULL;
+    return ((json_keymap_t *const *)(const void *)obj->u.object.keys)[-1];
+}
+
+typedef struct {
+    json_mutex_t lock;
+    json_keymap_t **buckets;  /* chains by owner address */
+    size_t nbuckets;          /* power of two, or 0 */
+    size_t count;
+} json_keymap_stripe_t;
+
+static json_keymap_stripe_t json_keymaps[JSON_KEYMAP_STRIPES];
+static long json_keymap_live;  /* registered tables; lets frees skip the locks */
+
+static void keymap_registry_init(void) {
+    for (size_t k = 0; k < JSON_KEYMAP_STRIPES; ++k) json_mutex_init(&json_keymaps[k].lock);
+}
+
+#if defined(_WIN32)
+static INIT_ONCE json_keymap_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK keymap_registry_init_once(PINIT_ONCE once, PVOID param, PVOID *ctx) {
+    (void)once; (void)param; (void)ctx;
+    keymap_registry_init();
+    return TRUE;
+}
+#else
+static pthread_once_t json_keymap_once = PTHREAD_ONCE_INIT;
+#endif
+
+static void keymap_live_add(long d) {
+#if defined(_MSC_VER)
+    _InterlockedExchangeAdd((volatile long *)&json_keymap_live, d);
+#elif defined(__GNUC__) || defined(__clang__)
+    __atomic_add_fetch(&json_keymap_live, d, __ATOMIC_RELAXED);
+#else
+    json_keymap_live += d;
+#endif
+}
+
+/* Zero only if no heap object has a table; the object's own writer sees its table */
+static long keymap_live(void) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __atomic_load_n(&json_keymap_live, __ATOMIC_RELAXED);
+#else
+    return *(volatile long *)&json_keymap_live;
+#endif
+}
+
+static size_t keymap_addr_hash(const void *p) {
+    uint64_t x = (uint64_t)(uintptr_t)p * 0x9E3779B97F4A7C15ull;
+    return (size_t)(x >> 32);
+}
+
+static json_keymap_stripe_t *keymap_lock(const fossil_media_json_value_t *obj) {
+#if defined(_WIN32)
+    InitOnceExecuteOnce(&json_keymap_once, keymap_registry_init_once, NULL, NULL);
+#else
+    pthread_once(&json_keymap_once, keymap_registry_init);
+#endif
+    json_keymap_stripe_t *st = &json_keymaps[keymap_addr_hash(obj) & (JSON_KEYMAP_STRIPES - 1)];
+    json_mutex_lock(&st->lock);
+    return st;
+}
+
+/* Link that holds obj's table, or the empty link ending its chain; NULL before any bucket exists */
+static json_keymap_t **keymap_link(json_keymap_stripe_t *st, const fossil_media_json_value_t *obj) {
+    if (!st->nbuckets) return NULL;
+    json_keymap_t **link = &st->buckets[(keymap_addr_hash(obj) >> 8) & (st->nbuckets - 1)];
+    while (*link && (*link)->owner != obj) link = &(*link)->next;
+    return link;
+}
+
+static json_keymap_t *keymap_registered(json_keymap_stripe_t *st, const fossil_media_json_value_t *obj) {
+    json_keymap_t **link = keymap_link(st, obj);
+    return link ? *link : NULL;
+}
+
+static void keymap_detach(json_keymap_stripe_t *st, const fossil_media_json_value_t *obj) {
+    json_keymap_t **link = keymap_link(st, obj);
+    if (!link || !*link) return;
+    json_keymap_t *m = *link;
+    *link = m->next;
+    st->count--;
+    keymap_live_add(-1);
+    fm_free(m);
+}
+
+/* Make m (may be NULL) obj's table in place of any old one; NULL leaves it unindexed */
+static json_keymap_t *keymap_attach(json_keymap_stripe_t *st, const fossil_media_json_value_t *obj, json_keymap_t *m) {
+    keymap_detach(st, obj);
+    if (!m) return NULL;
+    if (st->count >= st->nbuckets) {
+        size_t n = st->nbuckets ? st->nbuckets * 2 : 16;
+        json_keymap_t **b = fm_malloc(n * sizeof(*b));
+        if (b) {
+            memset(b, 0, n * sizeof(*b));
+            for (size_t k = 0; k < st->nbuckets; ++k) {
+                for (json_keymap_t *e = st->buckets[k], *next; e; e = next) {
+                    next = e->next;
+                    json_keymap_t **head = &b[(keymap_addr_hash(e->owner) >> 8) & (n - 1)];
+                    e->next = *head;
+                    *head = e;
+                }
+            }
+            fm_free(st->buckets);
+            st->buckets = b;
+            st->nbuckets = n;
+        } else if (!st->nbuckets) {
+            fm_free(m);
+            return NULL;
+        }
+    }
+    m->owner = obj;
+    json_keymap_t **head = &st->buckets[(keymap_addr_hash(obj) >> 8) & (st->nbuckets - 1)];
+    m->next = *head;
+    *head = m;
+    st->count++;
+    keymap_live_add(1);
+    return m;
+}
+
+/* Drop the table of a heap object that is being freed or reordered */
+static void keymap_forget(const fossil_media_json_value_t *obj) {
+    if (!keymap_live()) return;
+    json_keymap_stripe_t *st = keymap_lock(obj);
+    keymap_detach(st, obj);
+    json_mutex_unlock(&st->lock);
+}
+
+/* Heap object table matching keys[] and count, (re)built as needed; stripe locked */
+static json_keymap_t *keymap_current(json_keymap_stripe_t *st, const fossil_media_json_value_t *obj) {
+    json_keymap_t *m = keymap_registered(st, obj);
+    char **keys = obj->u.object.keys;
+    size_t count = obj->u.object.count;
+    if (m && m->keys == keys && m->count == count) return m;
+    return keymap_attach(st, obj, keymap_build(keys, count, count));
+}
+
+/* Position of the first member named `key`, or -1 */
+static ptrdiff_t object_find(const fossil_media_json_value_t *obj, const char *key) {
+    size_t count = obj->u.object.count;
+    char **keys = obj->u.object.keys;
+    if (count >= JSON_KEYMAP_MIN) {
+        uint32_t h = keymap_hash(key);
+        if (JSON_IS_ARENA(obj)) {
+            const json_keymap_t *m = arena_keymap(obj);
+            if (m) return keymap_probe(m, keys, key, h);
+        } else {
+            json_keymap_stripe_t *st = keymap_lock(obj);
+            json_keymap_t *m = keymap_current(st, obj);
+            ptrdiff_t at = m ? keymap_probe(m, keys, key, h) : -2;
+            json_mutex_unlock(&st->lock);
+            if (at != -2) return at;
+        }
+    }
+    /* Interned keys usually match by address before any strcmp */
+    for (size_t i = 0; i < count; ++i)
+        if (keys[i] == key || strcmp(keys[i], key) == 0) return (ptrdiff_t)i;
+    return -1;
+}
+
+/* object_find() for a key that is not NUL-terminated, with its hash precomputed */
+static ptrdiff_t object_find_n(const fossil_media_json_value_t *obj, const char *key, size_t len, uint32_t h) {
+    size_t count = obj->u.object.count;
+    char **keys = obj->u.object.keys;
+    if (count >= JSON_KEYMAP_MIN) {
+        if (JSON_IS_ARENA(obj)) {
+            const json_keymap_t *m = arena_keymap(obj);
+            if (m) return keymap_probe_n(m, keys, key, len, h);
+        } else {
+            json_keymap_stripe_t *st = keymap_lock(obj);
+            json_keymap_t *m = keymap_current(st, obj);
+            ptrdiff_t at = m ? keymap_probe_n(m, keys, key, len, h) : -2;
+            json_mutex_unlock(&st->lock);
+            if (at != -2) return at;
+        }
+    }
+    for (size_t i = 0; i < count; ++i)
+        if (strncmp(keys[i], key, len) == 0 && keys[i][len] == '\0') return (ptrdiff_t)i;
+    return -1;
+}
+
+/* Record the member just appended at keys[count - 1] */
+static void keymap_appended(fossil_media_json_value_t *obj) {
+    if (!keymap_live()) return;
+    json_keymap_stripe_t *st = keymap_lock(obj);
+    json_keymap_t *m = keymap_registered(st, obj);
+    size_t count = obj->u.object.count;
+    char **keys = obj->u.object.keys;
+    if (m && (m->count != count - 1 || count * 2 > m->mask + 1 || count >= UINT32_MAX)) {
+        /* Out of date or full: rebuild (or give up and fall back to scanning) */
+        keymap_attach(st, obj, keymap_build(keys, count, count));
+    } else if (m) {
+        keymap_insert(m, keys, count - 1, keymap_hash(keys[count - 1]));
+        m->keys = keys;
+        m->count = count;
+    }
+    json_mutex_unlock(&st->lock);
+}
+
+/* Re-number the table after keys[pos] (named `key`) was removed and the tail shifted down */
+static void keymap_removed(fossil_media_json_value_t *obj, size_t pos, const char *key) {
+    if (!keymap_live()) return;
+    json_keymap_stripe_t *st = keymap_lock(obj);
+    json_keymap_t *m = keymap_registered(st, obj);
+    char **keys = obj->u.object.keys;
+    size_t count = obj->u.object.count;
+    if (m && (count < JSON_KEYMAP_MIN || m->count != count + 1)) {
+        keymap_detach(st, obj);
+        m = NULL;
+    }
+    if (!m) { json_mutex_unlock(&st->lock); return; }
+    uint32_t h = keymap_hash(key);
+    size_t at = h & m->mask;
+    while (m->slots[at].pos && m->slots[at].pos != pos + 1) at = (at + 1) & m->mask;
+    /* A shadowed duplicate has no slot of its own */
+    int visible = m->slots[at].pos != 0;
+    if (visible) {
+        /* Backward-shift deletion keeps every probe chain unbroken */
+        size_t hole = at;
+        for (size_t nx = (hole + 1) & m->mask; m->slots[nx].pos; nx = (nx + 1) & m->mask) {
+            size_t home = m->slots[nx].hash & m->mask;
+            if (((nx - home) & m->mask) >= ((nx - hole) & m->mask)) {
+                m->slots[hole] = m->slots[nx];
+                hole = nx;
+            }
+        }
+        m->slots[hole].pos = 0;
+    }
+    /* Members after `pos` moved down one; renumber their slots */
+    if (count - pos < (m->mask + 1) / 4) {
+        /* Short tail: probe for each moved member rather than sweep the table */
+        for (size_t k = pos; k < count; ++k) {
+            uint32_t hk = keymap_hash(keys[k]);
+            for (size_t s = hk & m->mask; m->slots[s].pos; s = (s + 1) & m->mask)
+                if (m->slots[s].pos == k + 2) { m->slots[s].pos--; break; }
+        }
+    } else {
+        for (size_t k = 0; k <= m->mask; ++k)
+            if (m->slots[k].pos > pos + 1) m->slots[k].pos--;
+    }
+    /* A later duplicate of the removed key becomes the visible one */
+    if (visible) {
+        for (size_t k = pos; k < count; ++k)
+            if (strcmp(keys[k], key) == 0) { keymap_insert(m, keys, k, h); break; }
+    }
+    m->keys = keys;
+    m->count = count;
+    json_mutex_unlock(&st->lock);
+}
+
+/* Follow keys[] after the object reserved room; size the table for `capacity` members */
+static void keymap_reserved(fossil_media_json_value_t *obj, size_t capacity) {
+    if (!keymap_live()) return;
+    json_keymap_stripe_t *st = keymap_lock(obj);
+    json_keymap_t *m = keymap_registered(st, obj);
+    if (m && m->count == obj->u.object.count) {
+        m->keys = obj->u.object.keys;
+        if (capacity * 2 > m->mask + 1) {
+            json_keymap_t *grown = keymap_build(obj->u.object.keys, obj->u.object.count, capacity);
+            if (grown) keymap_attach(st, obj, grown);
         }
     }
-    if (obj->u.object.count == obj->u.object.capacity) {
-        size_t newcap = obj->u.object.capacity ? obj->u.object.capacity * 2 : 4;
-        char **nk = fm_realloc(obj->u.object.keys, sizeof(*nk) * newcap);
-        fossil_media_json_value_t **nv = fm_realloc(obj->u.object.values, sizeof(*nv) * newcap);
-        if (!nk || !nv) { fm_free(nk); fm_free(nv); return -1; }
-        obj->u.object.keys = nk;
-        obj->u.object.values = nv;
-        obj->u.object.capacity = newcap;
+    json_mutex_unlock(&st->lock);
+}
+
+/* Give an object whose keys belong to a key table its own copies before it changes */
+static int object_own_keys(fossil_media_json_value_t *obj) {
+    if (!(obj->flags & JSON_FLAG_SHARED_KEYS)) return 0;
+    size_t count = obj->u.object.count;
+    size_t cap = obj->u.object.capacity;
+    char **keys = fm_malloc(sizeof(*keys) * (cap ? cap : 1));
+    if (!keys) return -1;
+    for (size_t k = 0; k < count; ++k) {
+        if (!(keys[k] = dupe_string(obj->u.object.keys[k]))) {
+            while (k) fm_free(keys[--k]);
+            fm_free(keys);
+            return -1;
+        }
+    }
+    fm_free(obj->u.object.keys);
+    obj->u.object.keys = keys;
+    obj->flags &= ~JSON_FLAG_SHARED_KEYS;
+    return 0;
+}
+
+/* Object set helper (replaces existing) */
+int fossil_media_json_object_set(fossil_media_json_value_t *obj, const char *key, fossil_media_json_value_t *val) {
+    if (!obj || obj->type != FOSSIL_MEDIA_JSON_OBJECT || !key || JSON_IS_ARENA(obj)) return -1;
+    ptrdiff_t found = object_find(obj, key);
+    if (found >= 0) {
+        fossil_media_json_free(obj->u.object.values[found]);
+        obj->u.object.values[found] = val;
+        return 0;
     }
-    obj->u.object.keys[obj->u.object.count] = dupe_string(key);
+    if (object_own_keys(obj) != 0) return -1;
+    if (obj->u.object.count == obj->u.object.capacity &&
+        fossil_media_json_object_reserve(obj, obj->u.object.capacity ? obj->u.object.capacity * 2 : 4) != 0)
+        return -1;
+    char *k = dupe_string(key);
+    if (!k) return -1;
+    obj->u.object.keys[obj->u.object.count] = k;
     obj->u.object.values[obj->u.object.count] = val;
     obj->u.object.count++;
+    keymap_appended(obj);
     return 0;
 }
 
 fossil_media_json_value_t *fossil_media_json_object_get(const fossil_media_json_value_t *obj, const char *key) {
     if (!obj || obj->type != FOSSIL_MEDIA_JSON_OBJECT || !key) return NULL;
-    for (size_t i = 0; i < obj->u.object.count; ++i)
-        if (strcmp(obj->u.object.keys[i], key) == 0) return obj->u.object.values[i];
-    return NULL;
+    ptrdiff_t found = object_find(obj, key);
+    return found >= 0 ? obj->u.object.values[found] : NULL;
 }
 
 fossil_media_json_value_t *fossil_media_json_object_remove(fossil_media_json_value_t *obj, const char *key) {
-    if (!obj || obj->type != FOSSIL_MEDIA_JSON_OBJECT || !key) return NULL;
-    for (size_t i = 0; i < obj->u.object.count; ++i) {
-        if (strcmp(obj->u.object.keys[i], key) == 0) {
-            fossil_media_json_value_t *val = obj->u.object.values[i];
-            fm_free(obj->u.object.keys[i]);
-            /* shift */
-            for (size_t j = i + 1; j < obj->u.object.count; ++j) {
-                obj->u.object.keys[j-1] = obj->u.object.keys[j];
-                obj->u.object.values[j-1] = obj->u.object.values[j];
-            }
-            obj->u.object.count--;
-            return val;
-        }
+    if (!obj || obj->type != FOSSIL_MEDIA_JSON_OBJECT || !key || JSON_IS_ARENA(obj)) return NULL;
+    ptrdiff_t found = object_find(obj, key);
+    if (found < 0 || object_own_keys(obj) != 0) return NULL;
+    size_t i = (size_t)found;
+    fossil_media_json_value_t *val = obj->u.object.values[i];
+    char *removed = obj->u.object.keys[i];
+    /* shift */
+    for (size_t j = i + 1; j < obj->u.object.count; ++j) {
+        obj->u.object.keys[j-1] = obj->u.object.keys[j];
+        obj->u.object.values[j-1] = obj->u.object.values[j];
     }
-    return NULL;
+    obj->u.object.count--;
+    keymap_removed(obj, i, removed);
+    fm_free(removed);
+    return val;
 }
 
 /* Array helpers */
 int fossil_media_json_array_append(fossil_media_json_value_t *arr, fossil_media_json_value_t *val) {
-    if (!arr || arr->type != FOSSIL_MEDIA_JSON_ARRAY) return -1;
+    if (!arr || arr->type != FOSSIL_MEDIA_JSON_ARRAY || JSON_IS_ARENA(arr)) return -1;
     if (arr->u.array.count == arr->u.array.capacity) {
         size_t newcap = arr->u.array.capacity ? arr->u.array.capacity * 2 : 4;
         fossil_media_json_value_t **tmp = fm_realloc(arr->u.array.items, sizeof(*tmp) * newcap);
@@ -223,750 +1265,6505 @@ size_t fossil_media_json_array_size(const fossil_media_json_value_t *arr) {
     return arr->u.array.count;
 }
 
-/* Parsing primitives */
+// -----------------------------------------------------------------------------
+// Key interning
+// -----------------------------------------------------------------------------
+//
+// A key table stores each distinct key once and hands out the same pointer for
+// every occurrence, so lookups and comparisons of interned keys usually end at
+// an address compare. Strings live in a bump arena: the table's own for
+// caller-supplied tables, the document arena for per-document interning (the
+// table itself is then dropped once parsing ends).
 
-/* parse_literal: true/false/null */
-static fossil_media_json_value_t *parse_literal(ctx_t *c, fossil_media_json_error_t *err) {
-    const char *s = c->s;
-    size_t i = c->i;
-    if (strncmp(s + i, "true", 4) == 0) { c->i += 4; return fossil_media_json_new_bool(1); }
-    if (strncmp(s + i, "false", 5) == 0) { c->i += 5; return fossil_media_json_new_bool(0); }
-    if (strncmp(s + i, "null", 4) == 0) { c->i += 4; return fossil_media_json_new_null(); }
-    set_error(err, 1, i, "Unexpected token when parsing literal");
-    return NULL;
-}
+typedef struct {
+    uint32_t hash;
+    uint32_t len;
+    char *key;               /* NULL = empty */
+} json_key_slot_t;
 
-/* parse number: simple implementation using strtod */
-static fossil_media_json_value_t *parse_number(ctx_t *c, fossil_media_json_error_t *err) {
-    const char *s = c->s + c->i;
-    char *endptr = NULL;
-    double val = strtod(s, &endptr);
-    if (endptr == s) {
-        set_error(err, 1, c->i, "Invalid number");
+struct fossil_media_json_keys {
+    json_key_slot_t *slots;
+    size_t mask;             /* slot count minus one (power of two) */
+    size_t count;
+    json_arena_t *pool;      /* where key bytes are stored */
+    int own_pool;
+};
+
+static fossil_media_json_keys_t *keys_create(json_arena_t *pool) {
+    fossil_media_json_keys_t *t = fm_malloc(sizeof(*t));
+    if (!t) return NULL;
+    memset(t, 0, sizeof(*t));
+    t->mask = 63;
+    t->slots = fm_malloc(sizeof(*t->slots) * (t->mask + 1));
+    t->pool = pool ? pool : arena_create(0);
+    t->own_pool = pool == NULL;
+    if (!t->slots || !t->pool) {
+        if (t->own_pool) arena_destroy(t->pool);
+        fm_free(t->slots);
+        fm_free(t);
         return NULL;
     }
-    size_t consumed = (size_t)(endptr - s);
-    c->i += consumed;
-    return fossil_media_json_new_number(val);
+    memset(t->slots, 0, sizeof(*t->slots) * (t->mask + 1));
+    return t;
 }
 
-/* parse string with escapes */
-static fossil_media_json_value_t *parse_string(ctx_t *c, fossil_media_json_error_t *err) {
-    const char *s = c->s;
-    size_t i = c->i;
-    if (s[i] != '"') { set_error(err, 1, i, "Expected '\"'"); return NULL; }
+static int keys_grow(fossil_media_json_keys_t *t) {
+    size_t slots = (t->mask + 1) * 2;
+    json_key_slot_t *ns = fm_malloc(sizeof(*ns) * slots);
+    if (!ns) return -1;
+    memset(ns, 0, sizeof(*ns) * slots);
+    for (size_t k = 0; k <= t->mask; ++k) {
+        if (!t->slots[k].key) continue;
+        size_t at = t->slots[k].hash & (slots - 1);
+        while (ns[at].key) at = (at + 1) & (slots - 1);
+        ns[at] = t->slots[k];
+    }
+    fm_free(t->slots);
+    t->slots = ns;
+    t->mask = slots - 1;
+    return 0;
+}
+
+/* The interned copy of key p[0..n), or NULL; *hash receives its hash */
+static char *keys_lookup(const fossil_media_json_keys_t *t, const char *p, size_t n, uint32_t *hash) {
+    uint32_t h = keymap_hash_n(p, n);
+    *hash = h;
+    for (size_t at = h & t->mask; t->slots[at].key; at = (at + 1) & t->mask) {
+        const json_key_slot_t *sl = &t->slots[at];
+        if (sl->hash == h && sl->len == n && memcmp(sl->key, p, n) == 0) return sl->key;
+    }
+    return NULL;
+}
+
+/*
+ * Add a key known to be absent. `stored` (may be NULL) is a NUL-terminated
+ * copy that lives as long as the table's users and is adopted instead of
+ * copying p[0..n) into the pool.
+ */
+static char *keys_add(fossil_media_json_keys_t *t, const char *p, size_t n, uint32_t h, char *stored) {
+    if (n >= UINT32_MAX) return NULL;
+    if ((t->count + 1) * 2 > t->mask + 1 && keys_grow(t) != 0) return NULL;
+    char *k = stored;
+    if (!k) {
+        if (!(k = arena_alloc(t->pool, n + 1))) return NULL;
+        memcpy(k, p, n);
+        k[n] = '\0';
+    }
+    size_t at = h & t->mask;
+    while (t->slots[at].key) at = (at + 1) & t->mask;
+    t->slots[at].hash = h;
+    t->slots[at].len = (uint32_t)n;
+    t->slots[at].key = k;
+    t->count++;
+    return k;
+}
+
+static void keys_destroy(fossil_media_json_keys_t *t) {
+    if (!t) return;
+    if (t->own_pool) arena_destroy(t->pool);
+    fm_free(t->slots);
+    fm_free(t);
+}
+
+fossil_media_json_keys_t *fossil_media_json_keys_create(void) {
+    return keys_create(NULL);
+}
+
+void fossil_media_json_keys_free(fossil_media_json_keys_t *keys) {
+    keys_destroy(keys);
+}
+
+const char *fossil_media_json_keys_intern(fossil_media_json_keys_t *keys, const char *key) {
+    if (!keys || !key) return NULL;
+    size_t n = strlen(key);
+    uint32_t h;
+    char *k = keys_lookup(keys, key, n, &h);
+    return k ? k : keys_add(keys, key, n, h, NULL);
+}
+
+size_t fossil_media_json_keys_count(const fossil_media_json_keys_t *keys) {
+    return keys ? keys->count : 0;
+}
+
+/* Parsing primitives */
+
+/* Node and string storage: heap by default, the document arena when present */
+static void *ctx_alloc(ctx_t *c, size_t n) {
+    return c->arena ? arena_alloc(c->arena, n) : fm_malloc(n);
+}
+
+static fossil_media_json_value_t *ctx_new_value(ctx_t *c, fossil_media_json_type_t type) {
+    fossil_media_json_value_t *v = ctx_alloc(c, sizeof(*v));
+    if (!v) return NULL;
+    memset(v, 0, sizeof(*v));
+    v->type = type;
+    if (c->arena) v->flags = JSON_FLAG_ARENA;
+    return v;
+}
+
+static char *ctx_store_string(ctx_t *c, const char *p, size_t n) {
+    char *r = ctx_alloc(c, n + 1);
+    if (!r) return NULL;
+    memcpy(r, p, n);
+    r[n] = '\0';
+    return r;
+}
+
+/*
+ * Storage for the string whose opening quote is at `quote`, decoded to p/n by
+ * scan_string. In situ, a plain string is terminated by overwriting its
+ * closing quote and an escaped one is decoded over its own source bytes (the
+ * decoded form is never longer). The index-driven pass only does the former,
+ * which it can undo before a diagnostic rerun.
+ */
+static char *ctx_string(ctx_t *c, size_t quote, const char *p, size_t n) {
+    if (c->insitu) {
+        char *dst = (char *)c->s + quote + 1;
+        if (p == dst) { dst[n] = '\0'; return dst; }
+        if (!c->idx) { memcpy(dst, p, n); dst[n] = '\0'; return dst; }
+    }
+    return ctx_store_string(c, p, n);
+}
+
+/* Object key storage: the string rules above, or the key table when interning */
+static char *ctx_key(ctx_t *c, size_t quote, const char *p, size_t n) {
+    if (!c->keys) return ctx_string(c, quote, p, n);
+    uint32_t h;
+    char *k = keys_lookup(c->keys, p, n, &h);
+    if (k) return k;
+    /* A per-document table adopts the document's own copy of the first occurrence */
+    char *stored = NULL;
+    if (!c->keys->own_pool && !(stored = ctx_string(c, quote, p, n))) return NULL;
+    return keys_add(c->keys, p, n, h, stored);
+}
+
+/* Release a key that never made it into an object */
+static void ctx_drop_key(ctx_t *c, char *key) {
+    if (!c->arena && !c->keys) fm_free(key);
+}
+
+static int ctx_push(ctx_t *c, char *key, fossil_media_json_value_t *val) {
+    if (c->top == c->stack_cap) {
+        size_t newcap = c->stack_cap ? c->stack_cap * 2 : 64;
+        json_slot_t *tmp = fm_realloc(c->stack, sizeof(*tmp) * newcap);
+        if (!tmp) return -1;
+        c->stack = tmp;
+        c->stack_cap = newcap;
+    }
+    c->stack[c->top].key = key;
+    c->stack[c->top].val = val;
+    c->top++;
+    return 0;
+}
+
+/* Drop the children collected above `base` after an error */
+static void ctx_unwind(ctx_t *c, size_t base) {
+    if (!c->arena) {
+        for (size_t k = base; k < c->top; ++k) {
+            ctx_drop_key(c, c->stack[k].key);
+            fossil_media_json_free(c->stack[k].val);
+        }
+    }
+    c->top = base;
+}
+
+/* Enter a non-empty container; `key` is its member key in the parent, if any */
+static int ctx_open(ctx_t *c, fossil_media_json_value_t *v, char *key) {
+    if (c->depth == c->frames_cap) {
+        size_t newcap = c->frames_cap ? c->frames_cap * 2 : 32;
+        json_frame_t *tmp = fm_realloc(c->frames, sizeof(*tmp) * newcap);
+        if (!tmp) return -1;
+        c->frames = tmp;
+        c->frames_cap = newcap;
+    }
+    c->frames[c->depth].v = v;
+    c->frames[c->depth].base = c->top;
+    c->frames[c->depth].key = key;
+    c->depth++;
+    return 0;
+}
+
+/* Drop every open container and the children collected for it after an error */
+static void ctx_abandon(ctx_t *c) {
+    while (c->depth) {
+        json_frame_t *f = &c->frames[--c->depth];
+        ctx_unwind(c, f->base);
+        ctx_drop_key(c, f->key);
+        fossil_media_json_free(f->v);
+    }
+}
+
+static int ctx_sbuf_reserve(ctx_t *c, size_t need) {
+    if (need <= c->sbuf_cap) return 0;
+    size_t newcap = c->sbuf_cap ? c->sbuf_cap : 64;
+    while (newcap < need) newcap *= 2;
+    char *tmp = fm_realloc(c->sbuf, newcap);
+    if (!tmp) return -1;
+    c->sbuf = tmp;
+    c->sbuf_cap = newcap;
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+// Number conversion
+// -----------------------------------------------------------------------------
+//
+// Locale-independent, correctly rounded decimal-to-double conversion:
+//   - integers of up to 19 digits convert exactly from a uint64_t;
+//   - small exponents with a 53-bit mantissa use exact double arithmetic;
+//   - everything else goes through Eisel-Lemire (a 64x128-bit product with a
+//     table of truncated powers of five). With at most 19 significant digits
+//     the product is always sufficient (Mushtak & Lemire, 2023). Longer inputs
+//     are truncated to 19 digits; when rounding w and w+1 disagree, a big
+//     decimal (Nigel Tao's simple decimal conversion) settles the result.
+
+#define JSON_POW5_MIN (-342)
+#define JSON_POW5_MAX 308
+
+/* 128-bit truncated 5^q for q in [JSON_POW5_MIN, JSON_POW5_MAX], {high, low} */
+static const uint64_t json_pow5_128[][2] = {
+    {0xeef453d6923bd65au,0x113faa2906a13b3fu}, {0x9558b4661b6565f8u,0x4ac7ca59a424c507u},
+    {0xbaaee17fa23ebf76u,0x5d79bcf00d2df649u}, {0xe95a99df8ace6f53u,0xf4d82c2c107973dcu},
+    {0x91d8a02bb6c10594u,0x79071b9b8a4be869u}, {0xb64ec836a47146f9u,0x9748e2826cdee284u},
+    {0xe3e27a444d8d98b7u,0xfd1b1b2308169b25u}, {0x8e6d8c6ab0787f72u,0xfe30f0f5e50e20f7u},
+    {0xb208ef855c969f4fu,0xbdbd2d335e51a935u}, {0xde8b2b66b3bc4723u,0xad2c788035e61382u},
+    {0x8b16fb203055ac76u,0x4c3bcb5021afcc31u}, {0xaddcb9e83c6b1793u,0xdf4abe242a1bbf3du},
+    {0xd953e8624b85dd78u,0xd71d6dad34a2af0du}, {0x87d4713d6f33aa6bu,0x8672648c40e5ad68u},
+    {0xa9c98d8ccb009506u,0x680efdaf511f18c2u}, {0xd43bf0effdc0ba48u,0x0212bd1b2566def2u},
+    {0x84a57695fe98746du,0x014bb630f7604b57u}, {0xa5ced43b7e3e9188u,0x419ea3bd35385e2du},
+    {0xcf42894a5dce35eau,0x52064cac828675b9u}, {0x818995ce7aa0e1b2u,0x7343efebd1940993u},
+    {0xa1ebfb4219491a1fu,0x1014ebe6c5f90bf8u}, {0xca66fa129f9b60a6u,0xd41a26e077774ef6u},
+    {0xfd00b897478238d0u,0x8920b098955522b4u}, {0x9e20735e8cb16382u,0x55b46e5f5d5535b0u},
+    {0xc5a890362fddbc62u,0xeb2189f734aa831du}, {0xf712b443bbd52b7bu,0xa5e9ec7501d523e4u},
+    {0x9a6bb0aa55653b2du,0x47b233c92125366eu}, {0xc1069cd4eabe89f8u,0x999ec0bb696e840au},
+    {0xf148440a256e2c76u,0xc00670ea43ca250du}, {0x96cd2a865764dbcau,0x380406926a5e5728u},
+    {0xbc807527ed3e12bcu,0xc605083704f5ecf2u}, {0xeba09271e88d976bu,0xf7864a44c633682eu},
+    {0x93445b8731587ea3u,0x7ab3ee6afbe0211du}, {0xb8157268fdae9e4cu,0x5960ea05bad82964u},
+    {0xe61acf033d1a45dfu,0x6fb92487298e33bdu}, {0x8fd0c16206306babu,0xa5d3b6d479f8e056u},
+    {0xb3c4f1ba87bc8696u,0x8f48a4899877186cu}, {0xe0b62e2929aba83cu,0x331acdabfe94de87u},
+    {0x8c71dcd9ba0b4925u,0x9ff0c08b7f1d0b14u}, {0xaf8e5410288e1b6fu,0x07ecf0ae5ee44dd9u},
+    {0xdb71e91432b1a24au,0xc9e82cd9f69d6150u}, {0x892731ac9faf056eu,0xbe311c083a225cd2u},
+    {0xab70fe17c79ac6cau,0x6dbd630a48aaf406u}, {0xd64d3d9db981787du,0x092cbbccdad5b108u},
+    {0x85f0468293f0eb4eu,0x25bbf56008c58ea5u}, {0xa76c582338ed2621u,0xaf2af2b80af6f24eu},
+    {0xd1476e2c07286faau,0x1af5af660db4aee1u}, {0x82cca4db847945cau,0x50d98d9fc890ed4du},
+    {0xa37fce126597973cu,0xe50ff107bab528a0u}, {0xcc5fc196fefd7d0cu,0x1e53ed49a96272c8u},
+    {0xff77b1fcbebcdc4fu,0x25e8e89c13bb0f7au}, {0x9faacf3df73609b1u,0x77b191618c54e9acu},
+    {0xc795830d75038c1du,0xd59df5b9ef6a2417u}, {0xf97ae3d0d2446f25u,0x4b0573286b44ad1du},
+    {0x9becce62836ac577u,0x4ee367f9430aec32u}, {0xc2e801fb244576d5u,0x229c41f793cda73fu},
+    {0xf3a20279ed56d48au,0x6b43527578c1110fu}, {0x9845418c345644d6u,0x830a13896b78aaa9u},
+    {0xbe5691ef416bd60cu,0x23cc986bc656d553u}, {0xedec366b11c6cb8fu,0x2cbfbe86b7ec8aa8u},
+    {0x94b3a202eb1c3f39u,0x7bf7d71432f3d6a9u}, {0xb9e08a83a5e34f07u,0xdaf5ccd93fb0cc53u},
+    {0xe858ad248f5c22c9u,0xd1b3400f8f9cff68u}, {0x91376c36d99995beu,0x23100809b9c21fa1u},
+    {0xb58547448ffffb2du,0xabd40a0c2832a78au}, {0xe2e69915b3fff9f9u,0x16c90c8f323f516cu},
+    {0x8dd01fad907ffc3bu,0xae3da7d97f6792e3u}, {0xb1442798f49ffb4au,0x99cd11cfdf41779cu},
+    {0xdd95317f31c7fa1du,0x40405643d711d583u}, {0x8a7d3eef7f1cfc52u,0x482835ea666b2572u},
+    {0xad1c8eab5ee43b66u,0xda3243650005eecfu}, {0xd863b256369d4a40u,0x90bed43e40076a82u},
+    {0x873e4f75e2224e68u,0x5a7744a6e804a291u}, {0xa90de3535aaae202u,0x711515d0a205cb36u},
+    {0xd3515c2831559a83u,0x0d5a5b44ca873e03u}, {0x8412d9991ed58091u,0xe858790afe9486c2u},
+    {0xa5178fff668ae0b6u,0x626e974dbe39a872u}, {0xce5d73ff402d98e3u,0xfb0a3d212dc8128fu},
+    {0x80fa687f881c7f8eu,0x7ce66634bc9d0b99u}, {0xa139029f6a239f72u,0x1c1fffc1ebc44e80u},
+    {0xc987434744ac874eu,0xa327ffb266b56220u}, {0xfbe9141915d7a922u,0x4bf1ff9f0062baa8u},
+    {0x9d71ac8fada6c9b5u,0x6f773fc3603db4a9u}, {0xc4ce17b399107c22u,0xcb550fb4384d21d3u},
+    {0xf6019da07f549b2bu,0x7e2a53a146606a48u}, {0x99c102844f94e0fbu,0x2eda7444cbfc426du},
+    {0xc0314325637a1939u,0xfa911155fefb5308u}, {0xf03d93eebc589f88u,0x793555ab7eba27cau},
+    {0x96267c7535b763b5u,0x4bc1558b2f3458deu}, {0xbbb01b9283253ca2u,0x9eb1aaedfb016f16u},
+    {0xea9c227723ee8bcbu,0x465e15a979c1cadcu}, {0x92a1958a7675175fu,0x0bfacd89ec191ec9u},
+    {0xb749faed14125d36u,0xcef980ec671f667bu}, {0xe51c79a85916f484u,0x82b7e12780e7401au},
+    {0x8f31cc0937ae58d2u,0xd1b2ecb8b0908810u}, {0xb2fe3f0b8599ef07u,0x861fa7e6dcb4aa15u},
+    {0xdfbdcece67006ac9u,0x67a791e093e1d49au}, {0x8bd6a141006042bdu,0xe0c8bb2c5c6d24e0u},
+    {0xaecc49914078536du,0x58fae9f773886e18u}, {0xda7f5bf590966848u,0xaf39a475506a899eu},
+    {0x888f99797a5e012du,0x6d8406c952429603u}, {0xaab37fd7d8f58178u,0xc8e5087ba6d33b83u},
+    {0xd5605fcdcf32e1d6u,0xfb1e4a9a90880a64u}, {0x855c3be0a17fcd26u,0x5cf2eea09a55067fu},
+    {0xa6b34ad8c9dfc06fu,0xf42faa48c0ea481eu}, {0xd0601d8efc57b08bu,0xf13b94daf124da26u},
+    {0x823c12795db6ce57u,0x76c53d08d6b70858u}, {0xa2cb1717b52481edu,0x54768c4b0c64ca6eu},
+    {0xcb7ddcdda26da268u,0xa9942f5dcf7dfd09u}, {0xfe5d54150b090b02u,0xd3f93b35435d7c4cu},
+    {0x9efa548d26e5a6e1u,0xc47bc5014a1a6dafu}, {0xc6b8e9b0709f109au,0x359ab6419ca1091bu},
+    {0xf867241c8cc6d4c0u,0xc30163d203c94b62u}, {0x9b407691d7fc44f8u,0x79e0de63425dcf1du},
+    {0xc21094364dfb5636u,0x985915fc12f542e4u}, {0xf294b943e17a2bc4u,0x3e6f5b7b17b2939du},
+    {0x979cf3ca6cec5b5au,0xa705992ceecf9c42u}, {0xbd8430bd08277231u,0x50c6ff782a838353u},
+    {0xece53cec4a314ebdu,0xa4f8bf5635246428u}, {0x940f4613ae5ed136u,0x871b7795e136be99u},
+    {0xb913179899f68584u,0x28e2557b59846e3fu}, {0xe757dd7ec07426e5u,0x331aeada2fe589cfu},
+    {0x9096ea6f3848984fu,0x3ff0d2c85def7621u}, {0xb4bca50b065abe63u,0x0fed077a756b53a9u},
+    {0xe1ebce4dc7f16dfbu,0xd3e8495912c62894u}, {0x8d3360f09cf6e4bdu,0x64712dd7abbbd95cu},
+    {0xb080392cc4349decu,0xbd8d794d96aacfb3u}, {0xdca04777f541c567u,0xecf0d7a0fc5583a0u},
+    {0x89e42caaf9491b60u,0xf41686c49db57244u}, {0xac5d37d5b79b6239u,0x311c2875c522ced5u},
+    {0xd77485cb25823ac7u,0x7d633293366b828bu}, {0x86a8d39ef77164bcu,0xae5dff9c02033197u},
+    {0xa8530886b54dbdebu,0xd9f57f830283fdfcu}, {0xd267caa862a12d66u,0xd072df63c324fd7bu},
+    {0x8380dea93da4bc60u,0x4247cb9e59f71e6du}, {0xa46116538d0deb78u,0x52d9be85f074e608u},
+    {0xcd795be870516656u,0x67902e276c921f8bu}, {0x806bd9714632dff6u,0x00ba1cd8a3db53b6u},
+    {0xa086cfcd97bf97f3u,0x80e8a40eccd228a4u}, {0xc8a883c0fdaf7df0u,0x6122cd128006b2cdu},
+    {0xfad2a4b13d1b5d6cu,0x796b805720085f81u}, {0x9cc3a6eec6311a63u,0xcbe3303674053bb0u},
+    {0xc3f490aa77bd60fcu,0xbedbfc4411068a9cu}, {0xf4f1b4d515acb93bu,0xee92fb5515482d44u},
+    {0x991711052d8bf3c5u,0x751bdd152d4d1c4au}, {0xbf5cd54678eef0b6u,0xd262d45a78a0635du},
+    {0xef340a98172aace4u,0x86fb897116c87c34u}, {0x9580869f0e7aac0eu,0xd45d35e6ae3d4da0u},
+    {0xbae0a846d2195712u,0x8974836059cca109u}, {0xe998d258869facd7u,0x2bd1a438703fc94bu},
+    {0x91ff83775423cc06u,0x7b6306a34627ddcfu}, {0xb67f6455292cbf08u,0x1a3bc84c17b1d542u},
+    {0xe41f3d6a7377eecau,0x20caba5f1d9e4a93u}, {0x8e938662882af53eu,0x547eb47b7282ee9cu},
+    {0xb23867fb2a35b28du,0xe99e619a4f23aa43u}, {0xdec681f9f4c31f31u,0x6405fa00e2ec94d4u},
+    {0x8b3c113c38f9f37eu,0xde83bc408dd3dd04u}, {0xae0b158b4738705eu,0x9624ab50b148d445u},
+    {0xd98ddaee19068c76u,0x3badd624dd9b0957u}, {0x87f8a8d4cfa417c9u,0xe54ca5d70a80e5d6u},
+    {0xa9f6d30a038d1dbcu,0x5e9fcf4ccd211f4cu}, {0xd47487cc8470652bu,0x7647c3200069671fu},
+    {0x84c8d4dfd2c63f3bu,0x29ecd9f40041e073u}, {0xa5fb0a17c777cf09u,0xf468107100525890u},
+    {0xcf79cc9db955c2ccu,0x7182148d4066eeb4u}, {0x81ac1fe293d599bfu,0xc6f14cd848405530u},
+    {0xa21727db38cb002fu,0xb8ada00e5a506a7cu}, {0xca9cf1d206fdc03bu,0xa6d90811f0e4851cu},
+    {0xfd442e4688bd304au,0x908f4a166d1da663u}, {0x9e4a9cec15763e2eu,0x9a598e4e043287feu},
+    {0xc5dd44271ad3cdbau,0x40eff1e1853f29fdu}, {0xf7549530e188c128u,0xd12bee59e68ef47cu},
+    {0x9a94dd3e8cf578b9u,0x82bb74f8301958ceu}, {0xc13a148e3032d6e7u,0xe36a52363c1faf01u},
+    {0xf18899b1bc3f8ca1u,0xdc44e6c3cb279ac1u}, {0x96f5600f15a7b7e5u,0x29ab103a5ef8c0b9u},
+    {0xbcb2b812db11a5deu,0x7415d448f6b6f0e7u}, {0xebdf661791d60f56u,0x111b495b3464ad21u},
+    {0x936b9fcebb25c995u,0xcab10dd900beec34u}, {0xb84687c269ef3bfbu,0x3d5d514f40eea742u},
+    {0xe65829b3046b0afau,0x0cb4a5a3112a5112u}, {0x8ff71a0fe2c2e6dcu,0x47f0e785eaba72abu},
+    {0xb3f4e093db73a093u,0x59ed216765690f56u}, {0xe0f218b8d25088b8u,0x306869c13ec3532cu},
+    {0x8c974f7383725573u,0x1e414218c73a13fbu}, {0xafbd2350644eeacfu,0xe5d1929ef90898fau},
+    {0xdbac6c247d62a583u,0xdf45f746b74abf39u}, {0x894bc396ce5da772u,0x6b8bba8c328eb783u},
+    {0xab9eb47c81f5114fu,0x066ea92f3f326564u}, {0xd686619ba27255a2u,0xc80a537b0efefebdu},
+    {0x8613fd0145877585u,0xbd06742ce95f5f36u}, {0xa798fc4196e952e7u,0x2c48113823b73704u},
+    {0xd17f3b51fca3a7a0u,0xf75a15862ca504c5u}, {0x82ef85133de648c4u,0x9a984d73dbe722fbu},
+    {0xa3ab66580d5fdaf5u,0xc13e60d0d2e0ebbau}, {0xcc963fee10b7d1b3u,0x318df905079926a8u},
+    {0xffbbcfe994e5c61fu,0xfdf17746497f7052u}, {0x9fd561f1fd0f9bd3u,0xfeb6ea8bedefa633u},
+    {0xc7caba6e7c5382c8u,0xfe64a52ee96b8fc0u}, {0xf9bd690a1b68637bu,0x3dfdce7aa3c673b0u},
+    {0x9c1661a651213e2du,0x06bea10ca65c084eu}, {0xc31bfa0fe5698db8u,0x486e494fcff30a62u},
+    {0xf3e2f893dec3f126u,0x5a89dba3c3efccfau}, {0x986ddb5c6b3a76b7u,0xf89629465a75e01cu},
+    {0xbe89523386091465u,0xf6bbb397f1135823u}, {0xee2ba6c0678b597fu,0x746aa07ded582e2cu},
+    {0x94db483840b717efu,0xa8c2a44eb4571cdcu}, {0xba121a4650e4ddebu,0x92f34d62616ce413u},
+    {0xe896a0d7e51e1566u,0x77b020baf9c81d17u}, {0x915e2486ef32cd60u,0x0ace1474dc1d122eu},
+    {0xb5b5ada8aaff80b8u,0x0d819992132456bau}, {0xe3231912d5bf60e6u,0x10e1fff697ed6c69u},
+    {0x8df5efabc5979c8fu,0xca8d3ffa1ef463c1u}, {0xb1736b96b6fd83b3u,0xbd308ff8a6b17cb2u},
+    {0xddd0467c64bce4a0u,0xac7cb3f6d05ddbdeu}, {0x8aa22c0dbef60ee4u,0x6bcdf07a423aa96bu},
+    {0xad4ab7112eb3929du,0x86c16c98d2c953c6u}, {0xd89d64d57a607744u,0xe871c7bf077ba8b7u},
+    {0x87625f056c7c4a8bu,0x11471cd764ad4972u}, {0xa93af6c6c79b5d2du,0xd598e40d3dd89bcfu},
+    {0xd389b47879823479u,0x4aff1d108d4ec2c3u}, {0x843610cb4bf160cbu,0xcedf722a585139bau},
+    {0xa54394fe1eedb8feu,0xc2974eb4ee658828u}, {0xce947a3da6a9273eu,0x733d226229feea32u},
+    {0x811ccc668829b887u,0x0806357d5a3f525fu}, {0xa163ff802a3426a8u,0xca07c2dcb0cf26f7u},
+    {0xc9bcff6034c13052u,0xfc89b393dd02f0b5u}, {0xfc2c3f3841f17c67u,0xbbac2078d443ace2u},
+    {0x9d9ba7832936edc0u,0xd54b944b84aa4c0du}, {0xc5029163f384a931u,0x0a9e795e65d4df11u},
+    {0xf64335bcf065d37du,0x4d4617b5ff4a16d5u}, {0x99ea0196163fa42eu,0x504bced1bf8e4e45u},
+    {0xc06481fb9bcf8d39u,0xe45ec2862f71e1d6u}, {0xf07da27a82c37088u,0x5d767327bb4e5a4cu},
+    {0x964e858c91ba2655u,0x3a6a07f8d510f86fu}, {0xbbe226efb628afeau,0x890489f70a55368bu},
+    {0xeadab0aba3b2dbe5u,0x2b45ac74ccea842eu}, {0x92c8ae6b464fc96fu,0x3b0b8bc90012929du},
+    {0xb77ada0617e3bbcbu,0x09ce6ebb40173744u}, {0xe55990879ddcaabdu,0xcc420a6a101d0515u},
+    {0x8f57fa54c2a9eab6u,0x9fa946824a12232du}, {0xb32df8e9f3546564u,0x47939822dc96abf9u},
+    {0xdff9772470297ebdu,0x59787e2b93bc56f7u}, {0x8bfbea76c619ef36u,0x57eb4edb3c55b65au},
+    {0xaefae51477a06b03u,0xede622920b6b23f1u}, {0xdab99e59958885c4u,0xe95fab368e45ecedu},
+    {0x88b402f7fd75539bu,0x11dbcb0218ebb414u}, {0xaae103b5fcd2a881u,0xd652bdc29f26a119u},
+    {0xd59944a37c0752a2u,0x4be76d3346f0495fu}, {0x857fcae62d8493a5u,0x6f70a4400c562ddbu},
+    {0xa6dfbd9fb8e5b88eu,0xcb4ccd500f6bb952u}, {0xd097ad07a71f26b2u,0x7e2000a41346a7a7u},
+    {0x825ecc24c873782fu,0x8ed400668c0c28c8u}, {0xa2f67f2dfa90563bu,0x728900802f0f32fau},
+    {0xcbb41ef979346bcau,0x4f2b40a03ad2ffb9u}, {0xfea126b7d78186bcu,0xe2f610c84987bfa8u},
+    {0x9f24b832e6b0f436u,0x0dd9ca7d2df4d7c9u}, {0xc6ede63fa05d3143u,0x91503d1c79720dbbu},
+    {0xf8a95fcf88747d94u,0x75a44c6397ce912au}, {0x9b69dbe1b548ce7cu,0xc986afbe3ee11abau},
+    {0xc24452da229b021bu,0xfbe85badce996168u}, {0xf2d56790ab41c2a2u,0xfae27299423fb9c3u},
+    {0x97c560ba6b0919a5u,0xdccd879fc967d41au}, {0xbdb6b8e905cb600fu,0x5400e987bbc1c920u},
+    {0xed246723473e3813u,0x290123e9aab23b68u}, {0x9436c0760c86e30bu,0xf9a0b6720aaf6521u},
+    {0xb94470938fa89bceu,0xf808e40e8d5b3e69u}, {0xe7958cb87392c2c2u,0xb60b1d1230b20e04u},
+    {0x90bd77f3483bb9b9u,0xb1c6f22b5e6f48c2u}, {0xb4ecd5f01a4aa828u,0x1e38aeb6360b1af3u},
+    {0xe2280b6c20dd5232u,0x25c6da63c38de1b0u}, {0x8d590723948a535fu,0x579c487e5a38ad0eu},
+    {0xb0af48ec79ace837u,0x2d835a9df0c6d851u}, {0xdcdb1b2798182244u,0xf8e431456cf88e65u},
+    {0x8a08f0f8bf0f156bu,0x1b8e9ecb641b58ffu}, {0xac8b2d36eed2dac5u,0xe272467e3d222f3fu},
+    {0xd7adf884aa879177u,0x5b0ed81dcc6abb0fu}, {0x86ccbb52ea94baeau,0x98e947129fc2b4e9u},
+    {0xa87fea27a539e9a5u,0x3f2398d747b36224u}, {0xd29fe4b18e88640eu,0x8eec7f0d19a03aadu},
+    {0x83a3eeeef9153e89u,0x1953cf68300424acu}, {0xa48ceaaab75a8e2bu,0x5fa8c3423c052dd7u},
+    {0xcdb02555653131b6u,0x3792f412cb06794du}, {0x808e17555f3ebf11u,0xe2bbd88bbee40bd0u},
+    {0xa0b19d2ab70e6ed6u,0x5b6aceaeae9d0ec4u}, {0xc8de047564d20a8bu,0xf245825a5a445275u},
+    {0xfb158592be068d2eu,0xeed6e2f0f0d56712u}, {0x9ced737bb6c4183du,0x55464dd69685606bu},
+    {0xc428d05aa4751e4cu,0xaa97e14c3c26b886u}, {0xf53304714d9265dfu,0xd53dd99f4b3066a8u},
+    {0x993fe2c6d07b7fabu,0xe546a8038efe4029u}, {0xbf8fdb78849a5f96u,0xde98520472bdd033u},
+    {0xef73d256a5c0f77cu,0x963e66858f6d4440u}, {0x95a8637627989aadu,0xdde7001379a44aa8u},
+    {0xbb127c53b17ec159u,0x5560c018580d5d52u}, {0xe9d71b689dde71afu,0xaab8f01e6e10b4a6u},
+    {0x9226712162ab070du,0xcab3961304ca70e8u}, {0xb6b00d69bb55c8d1u,0x3d607b97c5fd0d22u},
+    {0xe45c10c42a2b3b05u,0x8cb89a7db77c506au}, {0x8eb98a7a9a5b04e3u,0x77f3608e92adb242u},
+    {0xb267ed1940f1c61cu,0x55f038b237591ed3u}, {0xdf01e85f912e37a3u,0x6b6c46dec52f6688u},
+    {0x8b61313bbabce2c6u,0x2323ac4b3b3da015u}, {0xae397d8aa96c1b77u,0xabec975e0a0d081au},
+    {0xd9c7dced53c72255u,0x96e7bd358c904a21u}, {0x881cea14545c7575u,0x7e50d64177da2e54u},
+    {0xaa242499697392d2u,0xdde50bd1d5d0b9e9u}, {0xd4ad2dbfc3d07787u,0x955e4ec64b44e864u},
+    {0x84ec3c97da624ab4u,0xbd5af13bef0b113eu}, {0xa6274bbdd0fadd61u,0xecb1ad8aeacdd58eu},
+    {0xcfb11ead453994bau,0x67de18eda5814af2u}, {0x81ceb32c4b43fcf4u,0x80eacf948770ced7u},
+    {0xa2425ff75e14fc31u,0xa1258379a94d028du}, {0xcad2f7f5359a3b3eu,0x096ee45813a04330u},
+    {0xfd87b5f28300ca0du,0x8bca9d6e188853fcu}, {0x9e74d1b791e07e48u,0x775ea264cf55347eu},
+    {0xc612062576589ddau,0x95364afe032a819eu}, {0xf79687aed3eec551u,0x3a83ddbd83f52205u},
+    {0x9abe14cd44753b52u,0xc4926a9672793543u}, {0xc16d9a0095928a27u,0x75b7053c0f178294u},
+    {0xf1c90080baf72cb1u,0x5324c68b12dd6339u}, {0x971da05074da7beeu,0xd3f6fc16ebca5e04u},
+    {0xbce5086492111aeau,0x88f4bb1ca6bcf585u}, {0xec1e4a7db69561a5u,0x2b31e9e3d06c32e6u},
+    {0x9392ee8e921d5d07u,0x3aff322e62439fd0u}, {0xb877aa3236a4b449u,0x09befeb9fad487c3u},
+    {0xe69594bec44de15bu,0x4c2ebe687989a9b4u}, {0x901d7cf73ab0acd9u,0x0f9d37014bf60a11u},
+    {0xb424dc35095cd80fu,0x538484c19ef38c95u}, {0xe12e13424bb40e13u,0x2865a5f206b06fbau},
+    {0x8cbccc096f5088cbu,0xf93f87b7442e45d4u}, {0xafebff0bcb24aafeu,0xf78f69a51539d749u},
+    {0xdbe6fecebdedd5beu,0xb573440e5a884d1cu}, {0x89705f4136b4a597u,0x31680a88f8953031u},
+    {0xabcc77118461cefcu,0xfdc20d2b36ba7c3eu}, {0xd6bf94d5e57a42bcu,0x3d32907604691b4du},
+    {0x8637bd05af6c69b5u,0xa63f9a49c2c1b110u}, {0xa7c5ac471b478423u,0x0fcf80dc33721d54u},
+    {0xd1b71758e219652bu,0xd3c36113404ea4a9u}, {0x83126e978d4fdf3bu,0x645a1cac083126eau},
+    {0xa3d70a3d70a3d70au,0x3d70a3d70a3d70a4u}, {0xccccccccccccccccu,0xcccccccccccccccdu},
+    {0x8000000000000000u,0x0000000000000000u}, {0xa000000000000000u,0x0000000000000000u},
+    {0xc800000000000000u,0x0000000000000000u}, {0xfa00000000000000u,0x0000000000000000u},
+    {0x9c40000000000000u,0x0000000000000000u}, {0xc350000000000000u,0x0000000000000000u},
+    {0xf424000000000000u,0x0000000000000000u}, {0x9896800000000000u,0x0000000000000000u},
+    {0xbebc200000000000u,0x0000000000000000u}, {0xee6b280000000000u,0x0000000000000000u},
+    {0x9502f90000000000u,0x0000000000000000u}, {0xba43b74000000000u,0x0000000000000000u},
+    {0xe8d4a51000000000u,0x0000000000000000u}, {0x9184e72a00000000u,0x0000000000000000u},
+    {0xb5e620f480000000u,0x0000000000000000u}, {0xe35fa931a0000000u,0x0000000000000000u},
+    {0x8e1bc9bf04000000u,0x0000000000000000u}, {0xb1a2bc2ec5000000u,0x0000000000000000u},
+    {0xde0b6b3a76400000u,0x0000000000000000u}, {0x8ac7230489e80000u,0x0000000000000000u},
+    {0xad78ebc5ac620000u,0x0000000000000000u}, {0xd8d726b7177a8000u,0x0000000000000000u},
+    {0x878678326eac9000u,0x0000000000000000u}, {0xa968163f0a57b400u,0x0000000000000000u},
+    {0xd3c21bcecceda100u,0x0000000000000000u}, {0x84595161401484a0u,0x0000000000000000u},
+    {0xa56fa5b99019a5c8u,0x0000000000000000u}, {0xcecb8f27f4200f3au,0x0000000000000000u},
+    {0x813f3978f8940984u,0x4000000000000000u}, {0xa18f07d736b90be5u,0x5000000000000000u},
+    {0xc9f2c9cd04674edeu,0xa400000000000000u}, {0xfc6f7c4045812296u,0x4d00000000000000u},
+    {0x9dc5ada82b70b59du,0xf020000000000000u}, {0xc5371912364ce305u,0x6c28000000000000u},
+    {0xf684df56c3e01bc6u,0xc732000000000000u}, {0x9a130b963a6c115cu,0x3c7f400000000000u},
+    {0xc097ce7bc90715b3u,0x4b9f100000000000u}, {0xf0bdc21abb48db20u,0x1e86d40000000000u},
+    {0x96769950b50d88f4u,0x1314448000000000u}, {0xbc143fa4e250eb31u,0x17d955a000000000u},
+    {0xeb194f8e1ae525fdu,0x5dcfab0800000000u}, {0x92efd1b8d0cf37beu,0x5aa1cae500000000u},
+    {0xb7abc627050305adu,0xf14a3d9e40000000u}, {0xe596b7b0c643c719u,0x6d9ccd05d0000000u},
+    {0x8f7e32ce7bea5c6fu,0xe4820023a2000000u}, {0xb35dbf821ae4f38bu,0xdda2802c8a800000u},
+    {0xe0352f62a19e306eu,0xd50b2037ad200000u}, {0x8c213d9da502de45u,0x4526f422cc340000u},
+    {0xaf298d050e4395d6u,0x9670b12b7f410000u}, {0xdaf3f04651d47b4cu,0x3c0cdd765f114000u},
+    {0x88d8762bf324cd0fu,0xa5880a69fb6ac800u}, {0xab0e93b6efee0053u,0x8eea0d047a457a00u},
+    {0xd5d238a4abe98068u,0x72a4904598d6d880u}, {0x85a36366eb71f041u,0x47a6da2b7f864750u},
+    {0xa70c3c40a64e6c51u,0x999090b65f67d924u}, {0xd0cf4b50cfe20765u,0xfff4b4e3f741cf6du},
+    {0x82818f1281ed449fu,0xbff8f10e7a8921a4u}, {0xa321f2d7226895c7u,0xaff72d52192b6a0du},
+    {0xcbea6f8ceb02bb39u,0x9bf4f8a69f764490u}, {0xfee50b7025c36a08u,0x02f236d04753d5b4u},
+    {0x9f4f2726179a2245u,0x01d762422c946590u}, {0xc722f0ef9d80aad6u,0x424d3ad2b7b97ef5u},
+    {0xf8ebad2b84e0d58bu,0xd2e0898765a7deb2u}, {0x9b934c3b330c8577u,0x63cc55f49f88eb2fu},
+    {0xc2781f49ffcfa6d5u,0x3cbf6b71c76b25fbu}, {0xf316271c7fc3908au,0x8bef464e3945ef7au},
+    {0x97edd871cfda3a56u,0x97758bf0e3cbb5acu}, {0xbde94e8e43d0c8ecu,0x3d52eeed1cbea317u},
+    {0xed63a231d4c4fb27u,0x4ca7aaa863ee4bddu}, {0x945e455f24fb1cf8u,0x8fe8caa93e74ef6au},
+    {0xb975d6b6ee39e436u,0xb3e2fd538e122b44u}, {0xe7d34c64a9c85d44u,0x60dbbca87196b616u},
+    {0x90e40fbeea1d3a4au,0xbc8955e946fe31cdu}, {0xb51d13aea4a488ddu,0x6babab6398bdbe41u},
+    {0xe264589a4dcdab14u,0xc696963c7eed2dd1u}, {0x8d7eb76070a08aecu,0xfc1e1de5cf543ca2u},
+    {0xb0de65388cc8ada8u,0x3b25a55f43294bcbu}, {0xdd15fe86affad912u,0x49ef0eb713f39ebeu},
+    {0x8a2dbf142dfcc7abu,0x6e3569326c784337u}, {0xacb92ed9397bf996u,0x49c2c37f07965404u},
+    {0xd7e77a8f87daf7fbu,0xdc33745ec97be906u}, {0x86f0ac99b4e8dafdu,0x69a028bb3ded71a3u},
+    {0xa8acd7c0222311bcu,0xc40832ea0d68ce0cu}, {0xd2d80db02aabd62bu,0xf50a3fa490c30190u},
+    {0x83c7088e1aab65dbu,0x792667c6da79e0fau}, {0xa4b8cab1a1563f52u,0x577001b891185938u},
+    {0xcde6fd5e09abcf26u,0xed4c0226b55e6f86u}, {0x80b05e5ac60b6178u,0x544f8158315b05b4u},
+    {0xa0dc75f1778e39d6u,0x696361ae3db1c721u}, {0xc913936dd571c84cu,0x03bc3a19cd1e38e9u},
+    {0xfb5878494ace3a5fu,0x04ab48a04065c723u}, {0x9d174b2dcec0e47bu,0x62eb0d64283f9c76u},
+    {0xc45d1df942711d9au,0x3ba5d0bd324f8394u}, {0xf5746577930d6500u,0xca8f44ec7ee36479u},
+    {0x9968bf6abbe85f20u,0x7e998b13cf4e1ecbu}, {0xbfc2ef456ae276e8u,0x9e3fedd8c321a67eu},
+    {0xefb3ab16c59b14a2u,0xc5cfe94ef3ea101eu}, {0x95d04aee3b80ece5u,0xbba1f1d158724a12u},
+    {0xbb445da9ca61281fu,0x2a8a6e45ae8edc97u}, {0xea1575143cf97226u,0xf52d09d71a3293bdu},
+    {0x924d692ca61be758u,0x593c2626705f9c56u}, {0xb6e0c377cfa2e12eu,0x6f8b2fb00c77836cu},
+    {0xe498f455c38b997au,0x0b6dfb9c0f956447u}, {0x8edf98b59a373fecu,0x4724bd4189bd5eacu},
+    {0xb2977ee300c50fe7u,0x58edec91ec2cb657u}, {0xdf3d5e9bc0f653e1u,0x2f2967b66737e3edu},
+    {0x8b865b215899f46cu,0xbd79e0d20082ee74u}, {0xae67f1e9aec07187u,0xecd8590680a3aa11u},
+    {0xda01ee641a708de9u,0xe80e6f4820cc9495u}, {0x884134fe908658b2u,0x3109058d147fdcddu},
+    {0xaa51823e34a7eedeu,0xbd4b46f0599fd415u}, {0xd4e5e2cdc1d1ea96u,0x6c9e18ac7007c91au},
+    {0x850fadc09923329eu,0x03e2cf6bc604ddb0u}, {0xa6539930bf6bff45u,0x84db8346b786151cu},
+    {0xcfe87f7cef46ff16u,0xe612641865679a63u}, {0x81f14fae158c5f6eu,0x4fcb7e8f3f60c07eu},
+    {0xa26da3999aef7749u,0xe3be5e330f38f09du}, {0xcb090c8001ab551cu,0x5cadf5bfd3072cc5u},
+    {0xfdcb4fa002162a63u,0x73d9732fc7c8f7f6u}, {0x9e9f11c4014dda7eu,0x2867e7fddcdd9afau},
+    {0xc646d63501a1511du,0xb281e1fd541501b8u}, {0xf7d88bc24209a565u,0x1f225a7ca91a4226u},
+    {0x9ae757596946075fu,0x3375788de9b06958u}, {0xc1a12d2fc3978937u,0x0052d6b1641c83aeu},
+    {0xf209787bb47d6b84u,0xc0678c5dbd23a49au}, {0x9745eb4d50ce6332u,0xf840b7ba963646e0u},
+    {0xbd176620a501fbffu,0xb650e5a93bc3d898u}, {0xec5d3fa8ce427affu,0xa3e51f138ab4cebeu},
+    {0x93ba47c980e98cdfu,0xc66f336c36b10137u}, {0xb8a8d9bbe123f017u,0xb80b0047445d4184u},
+    {0xe6d3102ad96cec1du,0xa60dc059157491e5u}, {0x9043ea1ac7e41392u,0x87c89837ad68db2fu},
+    {0xb454e4a179dd1877u,0x29babe4598c311fbu}, {0xe16a1dc9d8545e94u,0xf4296dd6fef3d67au},
+    {0x8ce2529e2734bb1du,0x1899e4a65f58660cu}, {0xb01ae745b101e9e4u,0x5ec05dcff72e7f8fu},
+    {0xdc21a1171d42645du,0x76707543f4fa1f73u}, {0x899504ae72497ebau,0x6a06494a791c53a8u},
+    {0xabfa45da0edbde69u,0x0487db9d17636892u}, {0xd6f8d7509292d603u,0x45a9d2845d3c42b6u},
+    {0x865b86925b9bc5c2u,0x0b8a2392ba45a9b2u}, {0xa7f26836f282b732u,0x8e6cac7768d7141eu},
+    {0xd1ef0244af2364ffu,0x3207d795430cd926u}, {0x8335616aed761f1fu,0x7f44e6bd49e807b8u},
+    {0xa402b9c5a8d3a6e7u,0x5f16206c9c6209a6u}, {0xcd036837130890a1u,0x36dba887c37a8c0fu},
+    {0x802221226be55a64u,0xc2494954da2c9789u}, {0xa02aa96b06deb0fdu,0xf2db9baa10b7bd6cu},
+    {0xc83553c5c8965d3du,0x6f92829494e5acc7u}, {0xfa42a8b73abbf48cu,0xcb772339ba1f17f9u},
+    {0x9c69a97284b578d7u,0xff2a760414536efbu}, {0xc38413cf25e2d70du,0xfef5138519684abau},
+    {0xf46518c2ef5b8cd1u,0x7eb258665fc25d69u}, {0x98bf2f79d5993802u,0xef2f773ffbd97a61u},
+    {0xbeeefb584aff8603u,0xaafb550ffacfd8fau}, {0xeeaaba2e5dbf6784u,0x95ba2a53f983cf38u},
+    {0x952ab45cfa97a0b2u,0xdd945a747bf26183u}, {0xba756174393d88dfu,0x94f971119aeef9e4u},
+    {0xe912b9d1478ceb17u,0x7a37cd5601aab85du}, {0x91abb422ccb812eeu,0xac62e055c10ab33au},
+    {0xb616a12b7fe617aau,0x577b986b314d6009u}, {0xe39c49765fdf9d94u,0xed5a7e85fda0b80bu},
+    {0x8e41ade9fbebc27du,0x14588f13be847307u}, {0xb1d219647ae6b31cu,0x596eb2d8ae258fc8u},
+    {0xde469fbd99a05fe3u,0x6fca5f8ed9aef3bbu}, {0x8aec23d680043beeu,0x25de7bb9480d5854u},
+    {0xada72ccc20054ae9u,0xaf561aa79a10ae6au}, {0xd910f7ff28069da4u,0x1b2ba1518094da04u},
+    {0x87aa9aff79042286u,0x90fb44d2f05d0842u}, {0xa99541bf57452b28u,0x353a1607ac744a53u},
+    {0xd3fa922f2d1675f2u,0x42889b8997915ce8u}, {0x847c9b5d7c2e09b7u,0x69956135febada11u},
+    {0xa59bc234db398c25u,0x43fab9837e699095u}, {0xcf02b2c21207ef2eu,0x94f967e45e03f4bbu},
+    {0x8161afb94b44f57du,0x1d1be0eebac278f5u}, {0xa1ba1ba79e1632dcu,0x6462d92a69731732u},
+    {0xca28a291859bbf93u,0x7d7b8f7503cfdcfeu}, {0xfcb2cb35e702af78u,0x5cda735244c3d43eu},
+    {0x9defbf01b061adabu,0x3a0888136afa64a7u}, {0xc56baec21c7a1916u,0x088aaa1845b8fdd0u},
+    {0xf6c69a72a3989f5bu,0x8aad549e57273d45u}, {0x9a3c2087a63f6399u,0x36ac54e2f678864bu},
+    {0xc0cb28a98fcf3c7fu,0x84576a1bb416a7ddu}, {0xf0fdf2d3f3c30b9fu,0x656d44a2a11c51d5u},
+    {0x969eb7c47859e743u,0x9f644ae5a4b1b325u}, {0xbc4665b596706114u,0x873d5d9f0dde1feeu},
+    {0xeb57ff22fc0c7959u,0xa90cb506d155a7eau}, {0x9316ff75dd87cbd8u,0x09a7f12442d588f2u},
+    {0xb7dcbf5354e9beceu,0x0c11ed6d538aeb2fu}, {0xe5d3ef282a242e81u,0x8f1668c8a86da5fau},
+    {0x8fa475791a569d10u,0xf96e017d694487bcu}, {0xb38d92d760ec4455u,0x37c981dcc395a9acu},
+    {0xe070f78d3927556au,0x85bbe253f47b1417u}, {0x8c469ab843b89562u,0x93956d7478ccec8eu},
+    {0xaf58416654a6babbu,0x387ac8d1970027b2u}, {0xdb2e51bfe9d0696au,0x06997b05fcc0319eu},
+    {0x88fcf317f22241e2u,0x441fece3bdf81f03u}, {0xab3c2fddeeaad25au,0xd527e81cad7626c3u},
+    {0xd60b3bd56a5586f1u,0x8a71e223d8d3b074u}, {0x85c7056562757456u,0xf6872d5667844e49u},
+    {0xa738c6bebb12d16cu,0xb428f8ac016561dbu}, {0xd106f86e69d785c7u,0xe13336d701beba52u},
+    {0x82a45b450226b39cu,0xecc0024661173473u}, {0xa34d721642b06084u,0x27f002d7f95d0190u},
+    {0xcc20ce9bd35c78a5u,0x31ec038df7b441f4u}, {0xff290242c83396ceu,0x7e67047175a15271u},
+    {0x9f79a169bd203e41u,0x0f0062c6e984d386u}, {0xc75809c42c684dd1u,0x52c07b78a3e60868u},
+    {0xf92e0c3537826145u,0xa7709a56ccdf8a82u}, {0x9bbcc7a142b17ccbu,0x88a66076400bb691u},
+    {0xc2abf989935ddbfeu,0x6acff893d00ea435u}, {0xf356f7ebf83552feu,0x0583f6b8c4124d43u},
+    {0x98165af37b2153deu,0xc3727a337a8b704au}, {0xbe1bf1b059e9a8d6u,0x744f18c0592e4c5cu},
+    {0xeda2ee1c7064130cu,0x1162def06f79df73u}, {0x9485d4d1c63e8be7u,0x8addcb5645ac2ba8u},
+    {0xb9a74a0637ce2ee1u,0x6d953e2bd7173692u}, {0xe8111c87c5c1ba99u,0xc8fa8db6ccdd0437u},
+    {0x910ab1d4db9914a0u,0x1d9c9892400a22a2u}, {0xb54d5e4a127f59c8u,0x2503beb6d00cab4bu},
+    {0xe2a0b5dc971f303au,0x2e44ae64840fd61du}, {0x8da471a9de737e24u,0x5ceaecfed289e5d2u},
+    {0xb10d8e1456105dadu,0x7425a83e872c5f47u}, {0xdd50f1996b947518u,0xd12f124e28f77719u},
+    {0x8a5296ffe33cc92fu,0x82bd6b70d99aaa6fu}, {0xace73cbfdc0bfb7bu,0x636cc64d1001550bu},
+    {0xd8210befd30efa5au,0x3c47f7e05401aa4eu}, {0x8714a775e3e95c78u,0x65acfaec34810a71u},
+    {0xa8d9d1535ce3b396u,0x7f1839a741a14d0du}, {0xd31045a8341ca07cu,0x1ede48111209a050u},
+    {0x83ea2b892091e44du,0x934aed0aab460432u}, {0xa4e4b66b68b65d60u,0xf81da84d5617853fu},
+    {0xce1de40642e3f4b9u,0x36251260ab9d668eu}, {0x80d2ae83e9ce78f3u,0xc1d72b7c6b426019u},
+    {0xa1075a24e4421730u,0xb24cf65b8612f81fu}, {0xc94930ae1d529cfcu,0xdee033f26797b627u},
+    {0xfb9b7cd9a4a7443cu,0x169840ef017da3b1u}, {0x9d412e0806e88aa5u,0x8e1f289560ee864eu},
+    {0xc491798a08a2ad4eu,0xf1a6f2bab92a27e2u}, {0xf5b5d7ec8acb58a2u,0xae10af696774b1dbu},
+    {0x9991a6f3d6bf1765u,0xacca6da1e0a8ef29u}, {0xbff610b0cc6edd3fu,0x17fd090a58d32af3u},
+    {0xeff394dcff8a948eu,0xddfc4b4cef07f5b0u}, {0x95f83d0a1fb69cd9u,0x4abdaf101564f98eu},
+    {0xbb764c4ca7a4440fu,0x9d6d1ad41abe37f1u}, {0xea53df5fd18d5513u,0x84c86189216dc5edu},
+    {0x92746b9be2f8552cu,0x32fd3cf5b4e49bb4u}, {0xb7118682dbb66a77u,0x3fbc8c33221dc2a1u},
+    {0xe4d5e82392a40515u,0x0fabaf3feaa5334au}, {0x8f05b1163ba6832du,0x29cb4d87f2a7400eu},
+    {0xb2c71d5bca9023f8u,0x743e20e9ef511012u}, {0xdf78e4b2bd342cf6u,0x914da9246b255416u},
+    {0x8bab8eefb6409c1au,0x1ad089b6c2f7548eu}, {0xae9672aba3d0c320u,0xa184ac2473b529b1u},
+    {0xda3c0f568cc4f3e8u,0xc9e5d72d90a2741eu}, {0x8865899617fb1871u,0x7e2fa67c7a658892u},
+    {0xaa7eebfb9df9de8du,0xddbb901b98feeab7u}, {0xd51ea6fa85785631u,0x552a74227f3ea565u},
+    {0x8533285c936b35deu,0xd53a88958f87275fu}, {0xa67ff273b8460356u,0x8a892abaf368f137u},
+    {0xd01fef10a657842cu,0x2d2b7569b0432d85u}, {0x8213f56a67f6b29bu,0x9c3b29620e29fc73u},
+    {0xa298f2c501f45f42u,0x8349f3ba91b47b8fu}, {0xcb3f2f7642717713u,0x241c70a936219a73u},
+    {0xfe0efb53d30dd4d7u,0xed238cd383aa0110u}, {0x9ec95d1463e8a506u,0xf4363804324a40aau},
+    {0xc67bb4597ce2ce48u,0xb143c6053edcd0d5u}, {0xf81aa16fdc1b81dau,0xdd94b7868e94050au},
+    {0x9b10a4e5e9913128u,0xca7cf2b4191c8326u}, {0xc1d4ce1f63f57d72u,0xfd1c2f611f63a3f0u},
+    {0xf24a01a73cf2dccfu,0xbc633b39673c8cecu}, {0x976e41088617ca01u,0xd5be0503e085d813u},
+    {0xbd49d14aa79dbc82u,0x4b2d8644d8a74e18u}, {0xec9c459d51852ba2u,0xddf8e7d60ed1219eu},
+    {0x93e1ab8252f33b45u,0xcabb90e5c942b503u}, {0xb8da1662e7b00a17u,0x3d6a751f3b936243u},
+    {0xe7109bfba19c0c9du,0x0cc512670a783ad4u}, {0x906a617d450187e2u,0x27fb2b80668b24c5u},
+    {0xb484f9dc9641e9dau,0xb1f9f660802dedf6u}, {0xe1a63853bbd26451u,0x5e7873f8a0396973u},
+    {0x8d07e33455637eb2u,0xdb0b487b6423e1e8u}, {0xb049dc016abc5e5fu,0x91ce1a9a3d2cda62u},
+    {0xdc5c5301c56b75f7u,0x7641a140cc7810fbu}, {0x89b9b3e11b6329bau,0xa9e904c87fcb0a9du},
+    {0xac2820d9623bf429u,0x546345fa9fbdcd44u}, {0xd732290fbacaf133u,0xa97c177947ad4095u},
+    {0x867f59a9d4bed6c0u,0x49ed8eabcccc485du}, {0xa81f301449ee8c70u,0x5c68f256bfff5a74u},
+    {0xd226fc195c6a2f8cu,0x73832eec6fff3111u}, {0x83585d8fd9c25db7u,0xc831fd53c5ff7eabu},
+    {0xa42e74f3d032f525u,0xba3e7ca8b77f5e55u}, {0xcd3a1230c43fb26fu,0x28ce1bd2e55f35ebu},
+    {0x80444b5e7aa7cf85u,0x7980d163cf5b81b3u}, {0xa0555e361951c366u,0xd7e105bcc332621fu},
+    {0xc86ab5c39fa63440u,0x8dd9472bf3fefaa7u}, {0xfa856334878fc150u,0xb14f98f6f0feb951u},
+    {0x9c935e00d4b9d8d2u,0x6ed1bf9a569f33d3u}, {0xc3b8358109e84f07u,0x0a862f80ec4700c8u},
+    {0xf4a642e14c6262c8u,0xcd27bb612758c0fau}, {0x98e7e9cccfbd7dbdu,0x8038d51cb897789cu},
+    {0xbf21e44003acdd2cu,0xe0470a63e6bd56c3u}, {0xeeea5d5004981478u,0x1858ccfce06cac74u},
+    {0x95527a5202df0ccbu,0x0f37801e0c43ebc8u}, {0xbaa718e68396cffdu,0xd30560258f54e6bau},
+    {0xe950df20247c83fdu,0x47c6b82ef32a2069u}, {0x91d28b7416cdd27eu,0x4cdc331d57fa5441u},
+    {0xb6472e511c81471du,0xe0133fe4adf8e952u}, {0xe3d8f9e563a198e5u,0x58180fddd97723a6u},
+    {0x8e679c2f5e44ff8fu,0x570f09eaa7ea7648u}
+};
+
+static uint64_t json_mul128(uint64_t a, uint64_t b, uint64_t *lo) {
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 r = (unsigned __int128)a * b;
+    *lo = (uint64_t)r;
+    return (uint64_t)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    uint64_t hi;
+    *lo = _umul128(a, b, &hi);
+    return hi;
+#else
+    uint64_t a0 = (uint32_t)a, a1 = a >> 32, b0 = (uint32_t)b, b1 = b >> 32;
+    uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+    uint64_t mid = (p00 >> 32) + (uint32_t)p01 + (uint32_t)p10;
+    *lo = (mid << 32) | (uint32_t)p00;
+    return p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+#endif
+}
+
+static unsigned json_clz64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_clzll(x);
+#else
+    unsigned n = 0;
+    while (!(x & ((uint64_t)1 << 63))) { x <<= 1; n++; }
+    return n;
+#endif
+}
+
+/* Biased exponent and 52-bit mantissa of w * 10^q (w != 0, q in table range) */
+static void json_eisel_lemire(uint64_t w, int q, uint64_t *mant, int *exp2) {
+    unsigned lz = json_clz64(w);
+    w <<= lz;
+    const uint64_t *p5 = json_pow5_128[q - JSON_POW5_MIN];
+    uint64_t lo;
+    uint64_t hi = json_mul128(w, p5[0], &lo);
+    if ((hi & 0x1FF) == 0x1FF) {
+        uint64_t lo2;
+        uint64_t hi2 = json_mul128(w, p5[1], &lo2);
+        (void)lo2;
+        lo += hi2;
+        if (hi2 > lo) hi++;
+    }
+    int upper = (int)(hi >> 63);
+    int shift = upper + 9;
+    uint64_t m = hi >> shift;
+    /* floor(q * log2(10)) + 63, plus the normalisation, rebased on the bias */
+    int e = (int)(((int64_t)(152170 + 65536) * q) >> 16) + 63 + upper - (int)lz + 1023;
+    if (e <= 0) {
+        /* Subnormal (or zero) */
+        if (-e + 1 >= 64) { *mant = 0; *exp2 = 0; return; }
+        m >>= -e + 1;
+        m += m & 1;
+        m >>= 1;
+        *mant = m & (((uint64_t)1 << 52) - 1);
+        *exp2 = m < ((uint64_t)1 << 52) ? 0 : 1;
+        return;
+    }
+    /* Exactly halfway between two doubles: round to even */
+    if (lo <= 1 && q >= -4 && q <= 23 && (m & 3) == 1 && (m << shift) == hi) m &= ~(uint64_t)1;
+    m += m & 1;
+    m >>= 1;
+    if (m >= ((uint64_t)2 << 52)) { m = (uint64_t)1 << 52; e++; }
+    m &= ~((uint64_t)1 << 52);
+    if (e >= 0x7FF) { e = 0x7FF; m = 0; }
+    *mant = m;
+    *exp2 = e;
+}
+
+static double json_make_double(int neg, uint64_t mant, int exp2) {
+    uint64_t bits = mant | ((uint64_t)exp2 << 52) | ((uint64_t)(neg != 0) << 63);
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+/* Big decimal fallback: digits d[0..nd) represent 0.d * 10^dp */
+#define JSON_DECIMAL_DIGITS 800
+#define JSON_DECIMAL_MAX_SHIFT 60
+
+typedef struct {
+    unsigned char d[JSON_DECIMAL_DIGITS];
+    int nd;
+    int dp;
+    int trunc;               /* nonzero digits were dropped */
+} json_decimal_t;
+
+/* Digits gained by a left shift of k, and 5^k to tell whether one fewer suffices */
+static const struct { int delta; const char *cutoff; } json_left_cheats[] = {
+    {0, ""},
+    {1, "5"},
+    {1, "25"},
+    {1, "125"},
+    {2, "625"},
+    {2, "3125"},
+    {2, "15625"},
+    {3, "78125"},
+    {3, "390625"},
+    {3, "1953125"},
+    {4, "9765625"},
+    {4, "48828125"},
+    {4, "244140625"},
+    {4, "1220703125"},
+    {5, "6103515625"},
+    {5, "30517578125"},
+    {5, "152587890625"},
+    {6, "762939453125"},
+    {6, "3814697265625"},
+    {6, "19073486328125"},
+    {7, "95367431640625"},
+    {7, "476837158203125"},
+    {7, "2384185791015625"},
+    {7, "11920928955078125"},
+    {8, "59604644775390625"},
+    {8, "298023223876953125"},
+    {8, "1490116119384765625"},
+    {9, "7450580596923828125"},
+    {9, "37252902984619140625"},
+    {9, "186264514923095703125"},
+    {10, "931322574615478515625"},
+    {10, "4656612873077392578125"},
+    {10, "23283064365386962890625"},
+    {10, "116415321826934814453125"},
+    {11, "582076609134674072265625"},
+    {11, "2910383045673370361328125"},
+    {11, "14551915228366851806640625"},
+    {12, "72759576141834259033203125"},
+    {12, "363797880709171295166015625"},
+    {12, "1818989403545856475830078125"},
+    {13, "9094947017729282379150390625"},
+    {13, "45474735088646411895751953125"},
+    {13, "227373675443232059478759765625"},
+    {13, "1136868377216160297393798828125"},
+    {14, "5684341886080801486968994140625"},
+    {14, "28421709430404007434844970703125"},
+    {14, "142108547152020037174224853515625"},
+    {15, "710542735760100185871124267578125"},
+    {15, "3552713678800500929355621337890625"},
+    {15, "17763568394002504646778106689453125"},
+    {16, "88817841970012523233890533447265625"},
+    {16, "444089209850062616169452667236328125"},
+    {16, "2220446049250313080847263336181640625"},
+    {16, "11102230246251565404236316680908203125"},
+    {17, "55511151231257827021181583404541015625"},
+    {17, "277555756156289135105907917022705078125"},
+    {17, "1387778780781445675529539585113525390625"},
+    {18, "6938893903907228377647697925567626953125"},
+    {18, "34694469519536141888238489627838134765625"},
+    {18, "173472347597680709441192448139190673828125"},
+    {19, "867361737988403547205962240695953369140625"}
+};
+
+static void decimal_trim(json_decimal_t *a) {
+    while (a->nd > 0 && a->d[a->nd - 1] == 0) a->nd--;
+    if (a->nd == 0) a->dp = 0;
+}
+
+static void decimal_right_shift(json_decimal_t *a, unsigned k) {
+    int r = 0, w = 0;
+    uint64_t n = 0;
+    for (; (n >> k) == 0; r++) {
+        if (r >= a->nd) {
+            if (n == 0) { a->nd = 0; return; }
+            while ((n >> k) == 0) { n *= 10; r++; }
+            break;
+        }
+        n = n * 10 + a->d[r];
+    }
+    a->dp -= r - 1;
+    uint64_t mask = ((uint64_t)1 << k) - 1;
+    for (; r < a->nd; r++) {
+        uint64_t dig = n >> k;
+        n &= mask;
+        a->d[w++] = (unsigned char)dig;
+        n = n * 10 + a->d[r];
+    }
+    while (n > 0) {
+        uint64_t dig = n >> k;
+        n &= mask;
+        if (w < JSON_DECIMAL_DIGITS) a->d[w++] = (unsigned char)dig;
+        else if (dig > 0) a->trunc = 1;
+        n *= 10;
+    }
+    a->nd = w;
+    decimal_trim(a);
+}
+
+static void decimal_left_shift(json_decimal_t *a, unsigned k) {
+    int delta = json_left_cheats[k].delta;
+    const char *cut = json_left_cheats[k].cutoff;
+    for (int i = 0; cut[i]; ++i) {
+        if (i >= a->nd) { delta--; break; }
+        if (a->d[i] != cut[i] - '0') { if (a->d[i] < cut[i] - '0') delta--; break; }
+    }
+    int r = a->nd, w = a->nd + delta;
+    uint64_t n = 0;
+    for (r--; r >= 0; r--) {
+        n += (uint64_t)a->d[r] << k;
+        uint64_t quo = n / 10, rem = n - 10 * quo;
+        w--;
+        if (w < JSON_DECIMAL_DIGITS) a->d[w] = (unsigned char)rem;
+        else if (rem != 0) a->trunc = 1;
+        n = quo;
+    }
+    while (n > 0) {
+        uint64_t quo = n / 10, rem = n - 10 * quo;
+        w--;
+        if (w < JSON_DECIMAL_DIGITS) a->d[w] = (unsigned char)rem;
+        else if (rem != 0) a->trunc = 1;
+        n = quo;
+    }
+    a->nd += delta;
+    if (a->nd >= JSON_DECIMAL_DIGITS) a->nd = JSON_DECIMAL_DIGITS;
+    a->dp += delta;
+    decimal_trim(a);
+}
+
+static void decimal_shift(json_decimal_t *a, int k) {
+    if (a->nd == 0) return;
+    if (k > 0) {
+        for (; k > JSON_DECIMAL_MAX_SHIFT; k -= JSON_DECIMAL_MAX_SHIFT) decimal_left_shift(a, JSON_DECIMAL_MAX_SHIFT);
+        decimal_left_shift(a, (unsigned)k);
+    } else if (k < 0) {
+        for (; k < -JSON_DECIMAL_MAX_SHIFT; k += JSON_DECIMAL_MAX_SHIFT) decimal_right_shift(a, JSON_DECIMAL_MAX_SHIFT);
+        decimal_right_shift(a, (unsigned)-k);
+    }
+}
+
+static uint64_t decimal_rounded_integer(const json_decimal_t *a) {
+    if (a->dp > 20) return ~(uint64_t)0;
+    int i = 0;
+    uint64_t n = 0;
+    for (; i < a->dp && i < a->nd; i++) n = n * 10 + a->d[i];
+    for (; i < a->dp; i++) n *= 10;
+    int up = 0;
+    if (a->dp >= 0 && a->dp < a->nd) {
+        if (a->d[a->dp] == 5 && a->dp + 1 == a->nd)
+            up = a->trunc || (a->dp > 0 && (a->d[a->dp - 1] & 1));   /* halfway: to even */
+        else
+            up = a->d[a->dp] >= 5;
+    }
+    return n + (uint64_t)up;
+}
+
+/* Correctly rounded value of a JSON number lexeme (already validated) */
+static double json_decimal_to_double(const char *p, const char *end) {
+    static const int powtab[] = {1, 3, 6, 9, 13, 16, 19, 23, 26};
+    json_decimal_t a;
+    int neg = 0, sawdot = 0;
+    a.nd = a.dp = a.trunc = 0;
+    if (*p == '-') { neg = 1; p++; }
+    for (; p < end && *p != 'e' && *p != 'E'; ++p) {
+        if (*p == '.') { sawdot = 1; a.dp = a.nd; continue; }
+        if (*p == '0' && a.nd == 0) { a.dp--; continue; }
+        if (a.nd < JSON_DECIMAL_DIGITS) a.d[a.nd++] = (unsigned char)(*p - '0');
+        else if (*p != '0') a.trunc = 1;
+    }
+    if (!sawdot) a.dp = a.nd;
+    if (p < end) {
+        int esign = 1, e = 0;
+        p++;
+        if (*p == '+' || *p == '-') { if (*p == '-') esign = -1; p++; }
+        for (; p < end; ++p) if (e < 10000) e = e * 10 + (*p - '0');
+        a.dp += esign * e;
+    }
+    decimal_trim(&a);
+    if (a.nd == 0 || a.dp < -330) return json_make_double(neg, 0, 0);
+    if (a.dp > 310) return json_make_double(neg, 0, 0x7FF);
+
+    int exp2 = 0;
+    while (a.dp > 0) {
+        int n = a.dp >= 9 ? 27 : powtab[a.dp];
+        decimal_shift(&a, -n);
+        exp2 += n;
+    }
+    while (a.dp < 0 || (a.dp == 0 && a.d[0] < 5)) {
+        int n = -a.dp >= 9 ? 27 : powtab[-a.dp];
+        decimal_shift(&a, n);
+        exp2 -= n;
+    }
+    /* Now in [0.5, 1) * 2^exp2; doubles normalise to [1, 2) */
+    exp2--;
+    if (exp2 < -1022) {
+        int n = -1022 - exp2;
+        decimal_shift(&a, -n);
+        exp2 += n;
+    }
+    if (exp2 + 1023 >= 0x7FF) return json_make_double(neg, 0, 0x7FF);
+    decimal_shift(&a, 53);
+    uint64_t mant = decimal_rounded_integer(&a);
+    if (mant == ((uint64_t)2 << 52)) {
+        mant >>= 1;
+        exp2++;
+        if (exp2 + 1023 >= 0x7FF) return json_make_double(neg, 0, 0x7FF);
+    }
+    int biased = (mant & ((uint64_t)1 << 52)) ? exp2 + 1023 : 0;
+    return json_make_double(neg, mant & (((uint64_t)1 << 52) - 1), biased);
+}
+
+/*
+ * Value of a lexeme whose first 19 significant digits are w with decimal
+ * exponent q. `many` is set when further nonzero digits were dropped.
+ */
+static double json_number_value(int neg, uint64_t w, int64_t q, int many, const char *p, const char *end) {
+    static const double p10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    if (!many) {
+        if (q == 0) {
+            /* Integer: the conversion of a uint64_t is correctly rounded */
+            double d = (double)w;
+            return neg ? -d : d;
+        }
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+        if (q >= -22 && q <= 22 && w <= ((uint64_t)1 << 53)) {
+            /* Both operands are exact, so one IEEE operation rounds correctly */
+            double d = (double)w;
+            d = q < 0 ? d / p10[-q] : d * p10[q];
+            return neg ? -d : d;
+        }
+#endif
+    }
+    if (w == 0 || q < JSON_POW5_MIN) return json_make_double(neg, 0, 0);
+    if (q > JSON_POW5_MAX) return json_make_double(neg, 0, 0x7FF);
+    uint64_t m;
+    int e;
+    json_eisel_lemire(w, (int)q, &m, &e);
+    if (many) {
+        /* The true value lies between w and w+1 units: both must round alike */
+        uint64_t m2;
+        int e2;
+        json_eisel_lemire(w + 1, (int)q, &m2, &e2);
+        if (m != m2 || e != e2) return json_decimal_to_double(p, end);
+    }
+    return json_make_double(neg, m, e);
+}
+
+/*
+ * Lex the JSON number at c->i. When `exact` is given, integer literals that
+ * fit in 64 bits also report their magnitude there and return the sign in
+ * *int_kind (1 positive, -1 negative; 0 for any other number).
+ */
+static int scan_number(ctx_t *c, fossil_media_json_error_t *err, double *out, uint64_t *exact, int *int_kind) {
+    const char *s = c->s;
+    size_t start = c->i;
+    size_t i = start;
+    int neg = 0;
+    if (s[i] == '-') { neg = 1; i++; }
+    if (s[i] < '0' || s[i] > '9') goto invalid;
+    size_t digits = i;
+    uint64_t w = 0;
+    if (s[i] == '0') i++;
+    else while (s[i] >= '0' && s[i] <= '9') w = w * 10 + (uint64_t)(s[i++] - '0');
+    size_t nint = i - digits;
+    int64_t q = 0;
+    size_t nfrac = 0;
+    if (s[i] == '.') {
+        size_t f = ++i;
+        if (s[i] < '0' || s[i] > '9') goto invalid;
+        while (s[i] >= '0' && s[i] <= '9') w = w * 10 + (uint64_t)(s[i++] - '0');
+        nfrac = i - f;
+        q = -(int64_t)nfrac;
+    }
+    size_t mant_end = i;
+    if (s[i] == 'e' || s[i] == 'E') {
+        int esign = 1;
+        int64_t e = 0;
+        i++;
+        if (s[i] == '+' || s[i] == '-') { if (s[i] == '-') esign = -1; i++; }
+        if (s[i] < '0' || s[i] > '9') goto invalid;
+        while (s[i] >= '0' && s[i] <= '9') {
+            if (e < 100000) e = e * 10 + (s[i] - '0');
+            i++;
+        }
+        q += esign * e;
+    }
+    c->i = i;
+    if (int_kind) {
+        *int_kind = 0;
+        /* Integer literal (not "-0", which only a double can spell) */
+        if (i == mant_end && !nfrac && (w || !neg)) {
+            if (nint <= 19) { *exact = w; *int_kind = neg ? -1 : 1; }
+            else if (nint == 20) {
+                uint64_t v = 0;
+                size_t k = digits;
+                for (; k < digits + 20; ++k) {
+                    unsigned d = (unsigned)(s[k] - '0');
+                    if (v > (UINT64_MAX - d) / 10) break;
+                    v = v * 10 + d;
+                }
+                if (k == digits + 20) { *exact = v; *int_kind = neg ? -1 : 1; }
+            }
+            if (*int_kind < 0 && *exact > (uint64_t)1 << 63) *int_kind = 0;
+        }
+    }
+    int many = 0;
+    if (nint + nfrac > 19) {
+        /* Count significant digits, skipping leading zeros (and the dot) */
+        const char *p = s + digits;
+        while (*p == '0' || *p == '.') p++;
+        size_t sig = (size_t)((s + mant_end) - p) - (p < s + digits + nint ? (nfrac ? 1 : 0) : 0);
+        if (sig > 19) {
+            /* Keep the first 19 and remember whether the rest were nonzero */
+            size_t taken = 0;
+            const char *dot = nfrac ? s + digits + nint : NULL;
+            w = 0;
+            for (; taken < 19; ++p) {
+                if (p == dot) continue;
+                w = w * 10 + (uint64_t)(*p - '0');
+                taken++;
+            }
+            /* Decimal exponent of the last digit kept */
+            size_t int_left = (dot && p <= dot) ? (size_t)(dot - p) : (dot ? 0 : (size_t)((s + mant_end) - p));
+            size_t frac_used = (dot && p > dot) ? (size_t)(p - dot - 1) : 0;
+            q = q + (int64_t)nfrac + (int64_t)int_left - (int64_t)frac_used;
+            for (; p < s + mant_end; ++p) if (*p != '0' && *p != '.') { many = 1; break; }
+        }
+    }
+    *out = json_number_value(neg, w, q, many, s + start, s + i);
+    return 0;
+invalid:
+    set_error(err, 1, start, "Invalid number");
+    return -1;
+}
+
+/* Lex true/false/null at c->i; yields FOSSIL_MEDIA_JSON_BOOL (with *b) or _NULL */
+static int scan_literal(ctx_t *c, fossil_media_json_error_t *err, int *b) {
+    const char *s = c->s;
+    size_t i = c->i;
+    if (strncmp(s + i, "true", 4) == 0) { c->i += 4; *b = 1; return FOSSIL_MEDIA_JSON_BOOL; }
+    if (strncmp(s + i, "false", 5) == 0) { c->i += 5; *b = 0; return FOSSIL_MEDIA_JSON_BOOL; }
+    if (strncmp(s + i, "null", 4) == 0) { c->i += 4; return FOSSIL_MEDIA_JSON_NULL; }
+    set_error(err, 1, i, "Unexpected token when parsing literal");
+    return -1;
+}
+
+/* parse_literal: true/false/null */
+static fossil_media_json_value_t *parse_literal(ctx_t *c, fossil_media_json_error_t *err) {
+    size_t i = c->i;
+    int b = 0;
+    int type = scan_literal(c, err, &b);
+    if (type < 0) return NULL;
+    fossil_media_json_value_t *v = ctx_new_value(c, (fossil_media_json_type_t)type);
+    if (!v) { set_error(err, 1, i, "OOM"); return NULL; }
+    if (type == FOSSIL_MEDIA_JSON_BOOL) v->u.boolean = b;
+    return v;
+}
+
+/* parse number */
+static fossil_media_json_value_t *parse_number(ctx_t *c, fossil_media_json_error_t *err) {
+    size_t i = c->i;
+    double val;
+    uint64_t mag = 0;
+    int kind = 0;
+    if (scan_number(c, err, &val, &mag, &kind) != 0) return NULL;
+    fossil_media_json_value_t *v = ctx_new_value(c, FOSSIL_MEDIA_JSON_NUMBER);
+    if (!v) { set_error(err, 1, i, "OOM"); return NULL; }
+    if (kind > 0) set_uint64(v, mag);
+    else if (kind < 0) set_int64(v, mag > (uint64_t)INT64_MAX ? INT64_MIN : -(int64_t)mag);
+    else v->u.number = val;
+    return v;
+}
+
+/* Decoded byte for each single-character escape, 0 for the rest */
+static const char json_unescape[256] = {
+    ['"'] = '"', ['\\'] = '\\', ['/'] = '/', ['b'] = '\b',
+    ['f'] = '\f', ['n'] = '\n', ['r'] = '\r', ['t'] = '\t',
+};
+
+/*
+ * Scan the string at c->i. On success out/outlen describe the decoded bytes:
+ * a view into the input when the string has no escapes, else c->sbuf.
+ */
+static int scan_string(ctx_t *c, fossil_media_json_error_t *err, const char **out, size_t *outlen) {
+    const char *s = c->s;
+    size_t i = c->i;
+    if (s[i] != '"') { set_error(err, 1, i, "Expected '\"'"); return -1; }
     i++;
     size_t start = i;
-    /* Build result in a temp buffer */
-    size_t cap = 32;
-    char *buf = fm_malloc(cap);
-    if (!buf) return NULL;
-    size_t len = 0;
-    while (s[i]) {
+    i += json_plain_run(s + i, 0);
+    if (s[i] == '"') {
+        *out = s + start;
+        *outlen = i - start;
+        c->i = i + 1;
+        return 0;
+    }
+    /* Escapes present: decode into the scratch buffer, a run at a time */
+    size_t len = 0, run = start;
+    for (;;) {
+        /* s[run, i) needs no decoding and s[i] is '"', '\\' or NUL */
+        if (ctx_sbuf_reserve(c, len + (i - run) + 4) != 0) { set_error(err, 1, i, "OOM"); return -1; }
+        memcpy(c->sbuf + len, s + run, i - run);
+        len += i - run;
         char ch = s[i++];
         if (ch == '"') {
-            buf[len] = '\0';
+            *out = c->sbuf;
+            *outlen = len;
             c->i = i;
-            fossil_media_json_value_t *v = fossil_media_json_new_string(buf);
-            fm_free(buf);
-            return v;
-        } else if (ch == '\\') {
-            char esc = s[i++];
-            char out = 0;
-            if (!esc) break;
-            if (esc == '"' || esc == '\\' || esc == '/') out = esc;
-            else if (esc == 'b') out = '\b';
-            else if (esc == 'f') out = '\f';
-            else if (esc == 'n') out = '\n';
-            else if (esc == 'r') out = '\r';
-            else if (esc == 't') out = '\t';
-            else if (esc == 'u') {
-                /* Unicode escape: \uXXXX -> encode as UTF-8 */
-                unsigned int code = 0;
-                for (int k = 0; k < 4; ++k) {
-                    char ch2 = s[i++];
-                    if (!ch2) { set_error(err, 1, i, "Truncated \\u escape"); fm_free(buf); return NULL; }
-                    int digit = -1;
-                    if (ch2 >= '0' && ch2 <= '9') digit = ch2 - '0';
-                    else if (ch2 >= 'A' && ch2 <= 'F') digit = 10 + (ch2 - 'A');
-                    else if (ch2 >= 'a' && ch2 <= 'f') digit = 10 + (ch2 - 'a');
-                    if (digit < 0) { set_error(err, 1, i, "Invalid \\u hex digit"); fm_free(buf); return NULL; }
-                    code = (code << 4) | digit;
-                }
-                /* encode code in UTF-8 */
-                char tmp[4];
-                int tlen = 0;
-                if (code <= 0x7F) {
-                    tmp[0] = (char)code; tlen = 1;
-                } else if (code <= 0x7FF) {
-                    tmp[0] = (char)(0xC0 | ((code >> 6) & 0x1F));
-                    tmp[1] = (char)(0x80 | (code & 0x3F));
-                    tlen = 2;
-                } else {
-                    tmp[0] = (char)(0xE0 | ((code >> 12) & 0x0F));
-                    tmp[1] = (char)(0x80 | ((code >> 6) & 0x3F));
-                    tmp[2] = (char)(0x80 | (code & 0x3F));
-                    tlen = 3;
+            return 0;
+        }
+        if (!ch) break;
+        char esc = s[i++];
+        if (!esc) break;
+        char out_ch = json_unescape[(unsigned char)esc];
+        if (out_ch) {
+            c->sbuf[len++] = out_ch;
+        } else if (esc == 'u') {
+            /* Unicode escape: \uXXXX -> encode as UTF-8 */
+            unsigned int code = 0;
+            for (int k = 0; k < 4; ++k) {
+                char ch2 = s[i++];
+                if (!ch2) { set_error(err, 1, i, "Truncated \\u escape"); return -1; }
+                int digit = -1;
+                if (ch2 >= '0' && ch2 <= '9') digit = ch2 - '0';
+                else if (ch2 >= 'A' && ch2 <= 'F') digit = 10 + (ch2 - 'A');
+                else if (ch2 >= 'a' && ch2 <= 'f') digit = 10 + (ch2 - 'a');
+                if (digit < 0) { set_error(err, 1, i, "Invalid \\u hex digit"); return -1; }
+                code = (code << 4) | digit;
+            }
+            /* encode code in UTF-8; the reserve above left room for three bytes */
+            if (code <= 0x7F) {
+                c->sbuf[len++] = (char)code;
+            } else if (code <= 0x7FF) {
+                c->sbuf[len++] = (char)(0xC0 | ((code >> 6) & 0x1F));
+                c->sbuf[len++] = (char)(0x80 | (code & 0x3F));
+            } else {
+                c->sbuf[len++] = (char)(0xE0 | ((code >> 12) & 0x0F));
+                c->sbuf[len++] = (char)(0x80 | ((code >> 6) & 0x3F));
+                c->sbuf[len++] = (char)(0x80 | (code & 0x3F));
+            }
+        } else {
+            set_error(err, 1, i, "Invalid escape \\%c", esc); return -1;
+        }
+        run = i;
+        i += json_plain_run(s + i, 0);
+    }
+    set_error(err, 1, start, "Unterminated string");
+    return -1;
+}
+
+/* parse string with escapes */
+static fossil_media_json_value_t *parse_string(ctx_t *c, fossil_media_json_error_t *err) {
+    const char *p;
+    size_t n;
+    size_t pos = c->i;
+    if (scan_string(c, err, &p, &n) != 0) return NULL;
+    fossil_media_json_value_t *v = ctx_new_value(c, FOSSIL_MEDIA_JSON_STRING);
+    if (v) {
+        v->u.string = ctx_string(c, pos, p, n);
+        if (!v->u.string) { if (!c->arena) fm_free(v); v = NULL; }
+    }
+    if (!v) set_error(err, 1, pos, "OOM");
+    return v;
+}
+
+/*
+ * Child slots of a container. In an arena the array is preceded by one word
+ * that caches the container's structural hash (see hash_slot()); read-only
+ * containers never change, so the cache never goes stale.
+ */
+static void *ctx_alloc_slots(ctx_t *c, size_t n) {
+    if (!c->arena) return ctx_alloc(c, n);
+    uint64_t *word = ctx_alloc(c, sizeof(uint64_t) + n);
+    if (!word) return NULL;
+    *word = 0;
+    return word + 1;
+}
+
+/* Move the children collected above `base` into `arr`, sized exactly */
+static int finish_array(ctx_t *c, fossil_media_json_value_t *arr, size_t base) {
+    size_t count = c->top - base;
+    if (count) {
+        fossil_media_json_value_t **items = ctx_alloc_slots(c, sizeof(*items) * count);
+        if (!items) return -1;
+        for (size_t k = 0; k < count; ++k) items[k] = c->stack[base + k].val;
+        arr->u.array.items = items;
+        arr->u.array.count = arr->u.array.capacity = count;
+    }
+    c->top = base;
+    return 0;
+}
+
+static int finish_object(ctx_t *c, fossil_media_json_value_t *obj, size_t base) {
+    size_t count = c->top - base;
+    if (count) {
+        /* Arena nodes cannot index lazily; large ones carry their key index in front of keys[] */
+        int indexed = c->arena && count >= JSON_KEYMAP_MIN && count < UINT32_MAX;
+        char **keys = ctx_alloc(c, sizeof(*keys) * (count + (indexed ? 1 : 0)));
+        fossil_media_json_value_t **vals = ctx_alloc_slots(c, sizeof(*vals) * count);
+        if (!keys || !vals) { if (!c->arena) { fm_free(keys); fm_free(vals); } return -1; }
+        if (indexed) keys++;
+        for (size_t k = 0; k < count; ++k) {
+            keys[k] = c->stack[base + k].key;
+            vals[k] = c->stack[base + k].val;
+        }
+        obj->u.object.keys = keys;
+        obj->u.object.values = vals;
+        obj->u.object.count = obj->u.object.capacity = count;
+        if (c->keys && !c->arena) obj->flags |= JSON_FLAG_SHARED_KEYS;
+        if (indexed) {
+            size_t slots = keymap_slots_for(count);
+            json_keymap_t *m = ctx_alloc(c, keymap_bytes(slots));
+            if (!m) return -1;
+            keymap_fill(m, slots, keys, count);
+            keys[-1] = (char *)(void *)m;
+        }
+    }
+    c->top = base;
+    return 0;
+}
+
+/*
+ * Object member prefix at c->i: a key, then ':'. Leaves c->i at the value.
+ */
+static char *parse_key(ctx_t *c, fossil_media_json_error_t *err) {
+    skip_ws(c);
+    if (c->s[c->i] != '"') { set_error(err,1,c->i,"Expected string key"); return NULL; }
+    const char *kp;
+    size_t kn;
+    size_t kpos = c->i;
+    if (scan_string(c, err, &kp, &kn) != 0) return NULL;
+    char *key = ctx_key(c, kpos, kp, kn);
+    if (!key) { set_error(err,1,kpos,"OOM"); return NULL; }
+    skip_ws(c);
+    if (c->s[c->i] != ':') { ctx_drop_key(c, key); set_error(err,1,c->i,"Expected ':' after key"); return NULL; }
+    c->i++;
+    return key;
+}
+
+/*
+ * Iterative grammar: open containers sit on c->frames and their finished
+ * children on c->stack, so nesting costs heap rather than C stack. A value
+ * is complete when it is a scalar or its closing bracket is read; it is then
+ * pushed onto the enclosing container, which may complete in turn.
+ */
+static fossil_media_json_value_t *parse_value(ctx_t *c, fossil_media_json_error_t *err) {
+    char *key = NULL;   /* member key of the value being parsed */
+    fossil_media_json_value_t *v;
+    for (;;) {
+        skip_ws(c);
+        char ch = c->s[c->i];
+        if (ch == '[' || ch == '{') {
+            int obj = ch == '{';
+            if (c->max_depth && c->depth == c->max_depth) {
+                set_error(err, FOSSIL_MEDIA_JSON_ERROR_DEPTH, c->i, "Maximum nesting depth exceeded");
+                goto fail;
+            }
+            c->i++;
+            skip_ws(c);
+            v = ctx_new_value(c, obj ? FOSSIL_MEDIA_JSON_OBJECT : FOSSIL_MEDIA_JSON_ARRAY);
+            if (!v) { set_error(err,1,c->i,"OOM"); goto fail; }
+            if (c->s[c->i] == (obj ? '}' : ']')) {
+                c->i++;
+            } else {
+                if (ctx_open(c, v, key) != 0) { fossil_media_json_free(v); set_error(err,1,c->i,"OOM"); goto fail; }
+                key = NULL;
+                if (obj && !(key = parse_key(c, err))) goto fail;
+                continue;
+            }
+        } else {
+            if (!ch) { set_error(err,1,c->i,"Unexpected end of input"); goto fail; }
+            if (ch == '"') v = parse_string(c, err);
+            else if (ch == '-' || (ch >= '0' && ch <= '9')) v = parse_number(c, err);
+            else if (ch == 't' || ch == 'f' || ch == 'n') v = parse_literal(c, err);
+            else { set_error(err,1,c->i,"Unexpected token '%c'", ch); goto fail; }
+            if (!v) goto fail;
+        }
+
+        /* v is complete: hand it to the enclosing container */
+        for (;;) {
+            if (!c->depth) return v;
+            json_frame_t *f = &c->frames[c->depth - 1];
+            int obj = f->v->type == FOSSIL_MEDIA_JSON_OBJECT;
+            if (ctx_push(c, key, v) != 0) {
+                fossil_media_json_free(v);
+                set_error(err,1,c->i,"OOM");
+                goto fail;
+            }
+            key = NULL;
+            skip_ws(c);
+            if (c->s[c->i] == ',') {
+                c->i++;
+                skip_ws(c);
+                if (c->s[c->i] == (obj ? '}' : ']')) {
+                    set_error(err,1,c->i, obj ? "Trailing comma in object" : "Trailing comma in array");
+                    goto fail;
                 }
-                if (len + tlen + 1 > cap) { cap = (len + tlen + 1) * 2; buf = fm_realloc(buf, cap); if (!buf) return NULL; }
-                for (int a = 0; a < tlen; ++a) buf[len++] = tmp[a];
+                if (obj && !(key = parse_key(c, err))) goto fail;
+                break;
+            }
+            if (c->s[c->i] != (obj ? '}' : ']')) {
+                set_error(err,1,c->i, obj ? "Expected ',' or '}' in object" : "Expected ',' or ']' in array");
+                goto fail;
+            }
+            c->i++;
+            if ((obj ? finish_object(c, f->v, f->base) : finish_array(c, f->v, f->base)) != 0) {
+                set_error(err,1,c->i,"OOM");
+                goto fail;
+            }
+            v = f->v;
+            key = f->key;
+            c->depth--;
+        }
+    }
+fail:
+    ctx_drop_key(c, key);
+    ctx_abandon(c);
+    return NULL;
+}
+
+/*
+ * Index-driven grammar (stage 2), iterative like parse_value(). Every step
+ * starts at a token already taken from c->idx; anything unexpected returns
+ * NULL without an error message and the caller reruns the byte parser for
+ * diagnostics.
+ */
+
+/* A byte that may legally follow a number or literal */
+static int idx_scalar_end(char ch) {
+    return ch == ',' || ch == ']' || ch == '}' || ch == ' ' || ch == '\n' ||
+           ch == '\r' || ch == '\t' || ch == '\0';
+}
+
+/* String whose opening quote is at p; its closing quote is the next token */
+static int idx_scan_string(ctx_t *c, size_t p, const char **out, size_t *outlen) {
+    const char *s = c->s;
+    size_t q = index_take(c->idx);
+    if (s[q] != '"') return -1;
+    size_t n = q - p - 1;
+    const char *b = s + p + 1;
+    int plain = 1;
+    if (n < 16) {
+        for (size_t k = 0; k < n; ++k) if (b[k] == '\\') { plain = 0; break; }
+    } else {
+        plain = memchr(b, '\\', n) == NULL;
+    }
+    if (plain) { *out = b; *outlen = n; return 0; }
+    fossil_media_json_error_t ignored;
+    c->i = p;
+    if (scan_string(c, &ignored, out, outlen) != 0 || c->i != q + 1) return -1;
+    return 0;
+}
+
+/* Key at token t and the ':' after it */
+static char *idx_parse_key(ctx_t *c, size_t t) {
+    const char *kp;
+    size_t kn;
+    if (c->s[t] != '"' || idx_scan_string(c, t, &kp, &kn) != 0) return NULL;
+    char *key = ctx_key(c, t, kp, kn);
+    if (key && c->s[index_take(c->idx)] != ':') { ctx_drop_key(c, key); key = NULL; }
+    return key;
+}
+
+static fossil_media_json_value_t *idx_parse_scalar(ctx_t *c, size_t p) {
+    fossil_media_json_error_t ignored;
+    fossil_media_json_value_t *v = NULL;
+    char ch = c->s[p];
+    if (ch == '"') {
+        const char *sp;
+        size_t sn;
+        if (idx_scan_string(c, p, &sp, &sn) != 0) return NULL;
+        v = ctx_new_value(c, FOSSIL_MEDIA_JSON_STRING);
+        if (v && !(v->u.string = ctx_string(c, p, sp, sn))) { if (!c->arena) fm_free(v); v = NULL; }
+        return v;
+    }
+    c->i = p;
+    if (ch == '-' || (ch >= '0' && ch <= '9')) v = parse_number(c, &ignored);
+    else if (ch == 't' || ch == 'f' || ch == 'n') v = parse_literal(c, &ignored);
+    if (v && !idx_scalar_end(c->s[c->i])) { fossil_media_json_free(v); v = NULL; }
+    return v;
+}
+
+static fossil_media_json_value_t *idx_parse_value(ctx_t *c, size_t p) {
+    char *key = NULL;
+    fossil_media_json_value_t *v;
+    for (;;) {
+        char ch = c->s[p];
+        if (ch == '[' || ch == '{') {
+            int obj = ch == '{';
+            if (c->max_depth && c->depth == c->max_depth) goto fail;
+            v = ctx_new_value(c, obj ? FOSSIL_MEDIA_JSON_OBJECT : FOSSIL_MEDIA_JSON_ARRAY);
+            if (!v) goto fail;
+            size_t t = index_take(c->idx);
+            if (c->s[t] != (obj ? '}' : ']')) {
+                if (ctx_open(c, v, key) != 0) { fossil_media_json_free(v); goto fail; }
+                key = NULL;
+                if (obj && !(key = idx_parse_key(c, t))) goto fail;
+                p = obj ? index_take(c->idx) : t;
                 continue;
-            } else {
-                set_error(err, 1, i, "Invalid escape \\%c", esc); fm_free(buf); return NULL;
             }
-            if (len + 2 > cap) { cap = (len + 2) * 2; buf = fm_realloc(buf, cap); if (!buf) return NULL; }
-            buf[len++] = out;
+        } else if (!(v = idx_parse_scalar(c, p))) {
+            goto fail;
+        }
+
+        for (;;) {
+            if (!c->depth) return v;
+            json_frame_t *f = &c->frames[c->depth - 1];
+            int obj = f->v->type == FOSSIL_MEDIA_JSON_OBJECT;
+            if (ctx_push(c, key, v) != 0) { fossil_media_json_free(v); goto fail; }
+            key = NULL;
+            size_t t = index_take(c->idx);
+            if (c->s[t] == ',') {
+                t = index_take(c->idx);
+                if (obj && !(key = idx_parse_key(c, t))) goto fail;
+                p = obj ? index_take(c->idx) : t;
+                break;
+            }
+            if (c->s[t] != (obj ? '}' : ']')) goto fail;
+            if ((obj ? finish_object(c, f->v, f->base) : finish_array(c, f->v, f->base)) != 0) goto fail;
+            v = f->v;
+            key = f->key;
+            c->depth--;
+        }
+    }
+fail:
+    ctx_drop_key(c, key);
+    ctx_abandon(c);
+    return NULL;
+}
+
+/* Public parse */
+fossil_media_json_value_t *fossil_media_json_parse(const char *json_text, fossil_media_json_error_t *err_out) {
+    return fossil_media_json_parse_ex(json_text, NULL, err_out);
+}
+
+/*
+ * Shared by parse_ex and parse_insitu. In-situ documents and per-document key
+ * interning always use an arena.
+ */
+static fossil_media_json_value_t *parse_document(const char *json_text, const fossil_media_json_parse_options_t *opts,
+                                                 int insitu, fossil_media_json_error_t *err_out) {
+    fossil_media_json_error_t errtmp = {0,0,""};
+    if (!json_text) { set_error(&errtmp,1,0,"NULL input"); if (err_out) *err_out = errtmp; return NULL; }
+    unsigned int flags = opts ? opts->flags : 0;
+    ctx_t c;
+    memset(&c, 0, sizeof(c));
+    c.s = json_text;
+    c.insitu = insitu;
+    c.keys = opts ? opts->keys : NULL;
+    c.max_depth = opts ? opts->max_depth : 0;
+    int doc_keys = !c.keys && (flags & FOSSIL_MEDIA_JSON_PARSE_INTERN_KEYS) != 0;
+    size_t len = strlen(json_text);
+    int arena = insitu || doc_keys || (flags & FOSSIL_MEDIA_JSON_PARSE_ARENA) != 0;
+    /* Rough DOM-to-text ratio; the arena grows geometrically past this */
+    if (arena && !(c.arena = arena_create(len * 2))) {
+        set_error(&errtmp,1,0,"OOM"); if (err_out) *err_out = errtmp; return NULL;
+    }
+    if (doc_keys && !(c.keys = keys_create(c.arena))) {
+        arena_destroy(c.arena);
+        set_error(&errtmp,1,0,"OOM"); if (err_out) *err_out = errtmp; return NULL;
+    }
+    fossil_media_json_value_t *root = NULL;
+    json_index_t idx;
+    if (len >= JSON_INDEX_MIN_LEN && index_init(&idx, json_text, len) == 0) {
+        c.idx = &idx;
+        root = idx_parse_value(&c, index_take(&idx));
+        if (root && index_take(&idx) != len) { fossil_media_json_free(root); root = NULL; }
+        fm_free(idx.pos);
+        c.idx = NULL;
+        if (!root) {
+            /* Malformed (or out of memory): rerun byte by byte for the error */
+            c.top = 0;
+            c.i = 0;
+            if (insitu) {
+                /* Only closing quotes were overwritten; put them back */
+                char *b = (char *)json_text, *z;
+                while ((z = memchr(b, '\0', len - (size_t)(b - json_text))) != NULL) { *z = '"'; b = z + 1; }
+            }
+            if (arena) {
+                arena_destroy(c.arena);
+                if (doc_keys) keys_destroy(c.keys);
+                c.keys = NULL;
+                if (!(c.arena = arena_create(len * 2)) || (doc_keys && !(c.keys = keys_create(c.arena)))) {
+                    arena_destroy(c.arena);
+                    fm_free(c.stack); fm_free(c.frames); fm_free(c.sbuf);
+                    set_error(&errtmp,1,0,"OOM"); if (err_out) *err_out = errtmp; return NULL;
+                }
+                if (!doc_keys && opts) c.keys = opts->keys;
+            }
+        }
+    }
+    if (!root) {
+        skip_ws(&c);
+        root = parse_value(&c, &errtmp);
+        if (root) {
+            skip_ws(&c);
+            if (c.s[c.i] != '\0') {
+                /* trailing garbage */
+                fossil_media_json_free(root);
+                root = NULL;
+                set_error(&errtmp,1,c.i,"Trailing characters after JSON value");
+            }
+        }
+    }
+    fm_free(c.stack);
+    fm_free(c.frames);
+    fm_free(c.sbuf);
+    if (doc_keys) keys_destroy(c.keys);
+    if (c.arena) {
+        if (root) {
+            c.arena->root = *root;
+            c.arena->root.flags |= JSON_FLAG_ARENA_ROOT;
+            root = &c.arena->root;
+        } else {
+            arena_destroy(c.arena);
+        }
+    }
+    if (err_out) *err_out = errtmp;
+    return root;
+}
+
+fossil_media_json_value_t *fossil_media_json_parse_ex(const char *json_text,
+                                                      const fossil_media_json_parse_options_t *opts,
+                                                      fossil_media_json_error_t *err_out) {
+    return parse_document(json_text, opts, 0, err_out);
+}
+
+fossil_media_json_value_t *fossil_media_json_parse_insitu(char *json_text,
+                                                          const fossil_media_json_parse_options_t *opts,
+                                                          fossil_media_json_error_t *err_out) {
+    return parse_document(json_text, opts, 1, err_out);
+}
+
+// -----------------------------------------------------------------------------
+// Event (SAX) parsing
+// -----------------------------------------------------------------------------
+//
+// Same grammar and lexers as the DOM parser, but values are reported to a
+// handler instead of being materialised. Nothing is allocated unless a string
+// contains escapes (decoded into the reusable scratch buffer).
+
+typedef struct {
+    ctx_t c;
+    const fossil_media_json_sax_handler_t *h;
+    void *user;
+    unsigned char *kinds;  /* 1 per open object, 0 per open array */
+    size_t depth, kinds_cap;
+} sax_t;
+
+static int sax_abort(fossil_media_json_error_t *err, size_t pos) {
+    set_error(err, 1, pos, "Aborted by handler");
+    return -1;
+}
+
+/* Object member prefix at c->i: the key event, then ':' */
+static int sax_key(sax_t *x, fossil_media_json_error_t *err) {
+    ctx_t *c = &x->c;
+    skip_ws(c);
+    if (c->s[c->i] != '"') { set_error(err,1,c->i,"Expected string key"); return -1; }
+    const char *kp;
+    size_t kn;
+    size_t pos = c->i;
+    if (scan_string(c, err, &kp, &kn) != 0) return -1;
+    if (x->h->key && x->h->key(x->user, kp, kn)) return sax_abort(err, pos);
+    skip_ws(c);
+    if (c->s[c->i] != ':') { set_error(err,1,c->i,"Expected ':' after key"); return -1; }
+    c->i++;
+    return 0;
+}
+
+static int sax_scalar(sax_t *x, fossil_media_json_error_t *err) {
+    ctx_t *c = &x->c;
+    size_t pos = c->i;
+    char ch = c->s[pos];
+    if (!ch) { set_error(err,1,pos,"Unexpected end of input"); return -1; }
+    if (ch == '"') {
+        const char *p;
+        size_t n;
+        if (scan_string(c, err, &p, &n) != 0) return -1;
+        return (x->h->string && x->h->string(x->user, p, n)) ? sax_abort(err, pos) : 0;
+    }
+    if (ch == '-' || (ch >= '0' && ch <= '9')) {
+        double d;
+        if (scan_number(c, err, &d, NULL, NULL) != 0) return -1;
+        return (x->h->number && x->h->number(x->user, d, c->s + pos, c->i - pos)) ? sax_abort(err, pos) : 0;
+    }
+    if (ch == 't' || ch == 'f' || ch == 'n') {
+        int b = 0;
+        int type = scan_literal(c, err, &b);
+        if (type < 0) return -1;
+        if (type == FOSSIL_MEDIA_JSON_BOOL) return (x->h->boolean && x->h->boolean(x->user, b)) ? sax_abort(err, pos) : 0;
+        return (x->h->null && x->h->null(x->user)) ? sax_abort(err, pos) : 0;
+    }
+    set_error(err,1,pos,"Unexpected token '%c'", ch);
+    return -1;
+}
+
+/* One value with the same loop structure as parse_value() */
+static int sax_value(sax_t *x, fossil_media_json_error_t *err) {
+    ctx_t *c = &x->c;
+    const fossil_media_json_sax_handler_t *h = x->h;
+    for (;;) {
+        skip_ws(c);
+        size_t pos = c->i;
+        char ch = c->s[pos];
+        if (ch == '[' || ch == '{') {
+            int obj = ch == '{';
+            if (x->depth == x->kinds_cap) {
+                size_t cap = x->kinds_cap ? x->kinds_cap * 2 : 64;
+                unsigned char *tmp = fm_realloc(x->kinds, cap);
+                if (!tmp) { set_error(err,1,pos,"OOM"); return -1; }
+                x->kinds = tmp;
+                x->kinds_cap = cap;
+            }
+            x->kinds[x->depth++] = (unsigned char)obj;
+            c->i++;
+            if (obj ? (h->start_object && h->start_object(x->user)) : (h->start_array && h->start_array(x->user)))
+                return sax_abort(err, pos);
+            skip_ws(c);
+            if (c->s[c->i] != (obj ? '}' : ']')) {
+                if (obj && sax_key(x, err) != 0) return -1;
+                continue;
+            }
+        } else if (sax_scalar(x, err) != 0) {
+            return -1;
+        }
+
+        /* A value ended: continue or close the enclosing containers */
+        for (;;) {
+            if (!x->depth) return 0;
+            int obj = x->kinds[x->depth - 1];
+            skip_ws(c);
+            if (c->s[c->i] == ',') {
+                c->i++;
+                skip_ws(c);
+                if (c->s[c->i] == (obj ? '}' : ']')) {
+                    set_error(err,1,c->i, obj ? "Trailing comma in object" : "Trailing comma in array");
+                    return -1;
+                }
+                if (obj && sax_key(x, err) != 0) return -1;
+                break;
+            }
+            if (c->s[c->i] != (obj ? '}' : ']')) {
+                set_error(err,1,c->i, obj ? "Expected ',' or '}' in object" : "Expected ',' or ']' in array");
+                return -1;
+            }
+            pos = c->i++;
+            x->depth--;
+            if (obj ? (h->end_object && h->end_object(x->user)) : (h->end_array && h->end_array(x->user)))
+                return sax_abort(err, pos);
+        }
+    }
+}
+
+int fossil_media_json_parse_sax(const char *json_text,
+                                const fossil_media_json_sax_handler_t *handler,
+                                void *user,
+                                fossil_media_json_error_t *err_out) {
+    fossil_media_json_error_t errtmp = {0,0,""};
+    if (!json_text || !handler) { set_error(&errtmp,1,0,"NULL input"); if (err_out) *err_out = errtmp; return -1; }
+    sax_t x;
+    memset(&x, 0, sizeof(x));
+    x.c.s = json_text;
+    x.h = handler;
+    x.user = user;
+    int rc = sax_value(&x, &errtmp);
+    if (rc == 0) {
+        skip_ws(&x.c);
+        if (x.c.s[x.c.i] != '\0') {
+            set_error(&errtmp,1,x.c.i,"Trailing characters after JSON value");
+            rc = -1;
+        }
+    }
+    fm_free(x.c.sbuf);
+    fm_free(x.kinds);
+    if (err_out) *err_out = errtmp;
+    return rc;
+}
+
+// -----------------------------------------------------------------------------
+// Validation
+// -----------------------------------------------------------------------------
+//
+// A pure scanner over the same grammar, reporting the same messages at the
+// same positions as the parser. Nesting is tracked in a bit stack (one bit
+// per level: object or array) that lives on the C stack for the first
+// JSON_VALIDATE_INLINE_DEPTH levels, so validation performs no allocations
+// unless an unlimited max_depth is actually exceeded by the input. Strings
+// are checked for well-formed UTF-8 (RFC 3629: no overlongs, surrogates or
+// code points above U+10FFFF) instead of being decoded.
+
+#define JSON_VALIDATE_INLINE_DEPTH 4096
+
+/* Length of the UTF-8 sequence at p (lead byte >= 0x80), 0 if malformed */
+static size_t utf8_sequence(const unsigned char *p) {
+    unsigned char c = p[0];
+    unsigned char lo = 0x80, hi = 0xBF;
+    size_t n;
+    if (c >= 0xC2 && c <= 0xDF) n = 2;
+    else if (c >= 0xE0 && c <= 0xEF) {
+        n = 3;
+        if (c == 0xE0) lo = 0xA0;
+        else if (c == 0xED) hi = 0x9F;
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        n = 4;
+        if (c == 0xF0) lo = 0x90;
+        else if (c == 0xF4) hi = 0x8F;
+    } else return 0;
+    if (p[1] < lo || p[1] > hi) return 0;
+    for (size_t k = 2; k < n; ++k)
+        if (p[k] < 0x80 || p[k] > 0xBF) return 0;
+    return n;
+}
+
+/* Index just past the string opened at s[i], or 0 with *err set (mirrors scan_string) */
+static size_t validate_string(const char *s, size_t i, int utf8, fossil_media_json_error_t *err) {
+    const unsigned char *u = (const unsigned char *)s;
+    size_t start = ++i;
+    for (;;) {
+        i += json_plain_run(s + i, utf8 ? JSON_RUN_HIGH : 0);
+        unsigned char ch = u[i];
+        if (ch == '"') return i + 1;
+        if (!ch) break;
+        if (ch == '\\') {
+            char esc = s[i + 1];
+            if (!esc) break;
+            i += 2;
+            if (esc == 'u') {
+                for (int k = 0; k < 4; ++k) {
+                    char h = s[i++];
+                    if (!h) { set_error(err, 1, i, "Truncated \\u escape"); return 0; }
+                    if (!isxdigit((unsigned char)h)) { set_error(err, 1, i, "Invalid \\u hex digit"); return 0; }
+                }
+            } else if (!strchr("\"\\/bfnrt", esc)) {
+                set_error(err, 1, i, "Invalid escape \\%c", esc);
+                return 0;
+            }
+        } else if (ch < 0x80 || !utf8) {
+            i++;
+        } else {
+            size_t n = utf8_sequence(u + i);
+            if (!n) { set_error(err, 1, i, "Invalid UTF-8"); return 0; }
+            i += n;
+        }
+    }
+    set_error(err, 1, start, "Unterminated string");
+    return 0;
+}
+
+/* Index just past the number at s[i], or 0 if it does not match the grammar */
+static size_t validate_number(const char *s, size_t i) {
+    if (s[i] == '-') i++;
+    if (s[i] == '0') i++;
+    else if (s[i] >= '1' && s[i] <= '9') while (s[i] >= '0' && s[i] <= '9') i++;
+    else return 0;
+    if (s[i] == '.') {
+        i++;
+        if (s[i] < '0' || s[i] > '9') return 0;
+        while (s[i] >= '0' && s[i] <= '9') i++;
+    }
+    if (s[i] == 'e' || s[i] == 'E') {
+        i++;
+        if (s[i] == '+' || s[i] == '-') i++;
+        if (s[i] < '0' || s[i] > '9') return 0;
+        while (s[i] >= '0' && s[i] <= '9') i++;
+    }
+    return i;
+}
+
+static size_t validate_ws(const char *s, size_t i) {
+    while (s[i] == ' ' || s[i] == '\n' || s[i] == '\r' || s[i] == '\t') i++;
+    return i;
+}
+
+int fossil_media_json_validate_ex(const char *json_text,
+                                  const fossil_media_json_validate_options_t *opts,
+                                  fossil_media_json_error_t *err_out) {
+    fossil_media_json_error_t errtmp = {0,0,""};
+    fossil_media_json_error_t *err = &errtmp;
+    if (!json_text) { set_error(err,1,0,"NULL input"); if (err_out) *err_out = errtmp; return 1; }
+    size_t max_depth = opts ? opts->max_depth : 0;
+    int utf8 = !(opts && (opts->flags & FOSSIL_MEDIA_JSON_VALIDATE_NO_UTF8));
+    if (opts && opts->max_size && !memchr(json_text, '\0', opts->max_size + 1)) {
+        set_error(err, 1, opts->max_size, "Input exceeds maximum size");
+        if (err_out) *err_out = errtmp;
+        return 1;
+    }
+
+    const char *s = json_text;
+    uint64_t inline_bits[JSON_VALIDATE_INLINE_DEPTH / 64];
+    uint64_t *bits = inline_bits;
+    size_t bits_cap = JSON_VALIDATE_INLINE_DEPTH;
+    size_t depth = 0, i = 0, next;
+    int rc = 1;
+#define JSON_IN_OBJECT() ((bits[(depth - 1) >> 6] >> ((depth - 1) & 63)) & 1)
+
+value:
+    i = validate_ws(s, i);
+    switch (s[i]) {
+        case '\0':
+            set_error(err,1,i,"Unexpected end of input");
+            goto out;
+        case '"':
+            if (!(next = validate_string(s, i, utf8, err))) goto out;
+            i = next;
+            goto after_value;
+        case '-': case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9':
+            if (!(next = validate_number(s, i))) { set_error(err,1,i,"Invalid number"); goto out; }
+            i = next;
+            goto after_value;
+        case 't': case 'f': case 'n':
+            if (strncmp(s + i, "true", 4) == 0 || strncmp(s + i, "null", 4) == 0) i += 4;
+            else if (strncmp(s + i, "false", 5) == 0) i += 5;
+            else { set_error(err,1,i,"Unexpected token when parsing literal"); goto out; }
+            goto after_value;
+        case '[': case '{': {
+            int object = s[i] == '{';
+            if (max_depth && depth == max_depth) { set_error(err,FOSSIL_MEDIA_JSON_ERROR_DEPTH,i,"Maximum nesting depth exceeded"); goto out; }
+            if (depth == bits_cap) {
+                uint64_t *grown = fm_malloc(bits_cap / 4);
+                if (!grown) { set_error(err,1,i,"OOM"); goto out; }
+                memcpy(grown, bits, bits_cap / 8);
+                if (bits != inline_bits) fm_free(bits);
+                bits = grown;
+                bits_cap *= 2;
+            }
+            uint64_t bit = (uint64_t)1 << (depth & 63);
+            if (object) bits[depth >> 6] |= bit;
+            else bits[depth >> 6] &= ~bit;
+            depth++;
+            i = validate_ws(s, i + 1);
+            if (s[i] == (object ? '}' : ']')) { i++; depth--; goto after_value; }
+            if (object) goto key;
+            goto value;
+        }
+        default:
+            set_error(err,1,i,"Unexpected token '%c'", s[i]);
+            goto out;
+    }
+
+key:
+    i = validate_ws(s, i);
+    if (s[i] != '"') { set_error(err,1,i,"Expected string key"); goto out; }
+    if (!(next = validate_string(s, i, utf8, err))) goto out;
+    i = validate_ws(s, next);
+    if (s[i] != ':') { set_error(err,1,i,"Expected ':' after key"); goto out; }
+    i++;
+    goto value;
+
+after_value:
+    if (depth == 0) {
+        i = validate_ws(s, i);
+        if (s[i] != '\0') { set_error(err,1,i,"Trailing characters after JSON value"); goto out; }
+        rc = 0;
+        goto out;
+    }
+    i = validate_ws(s, i);
+    if (JSON_IN_OBJECT()) {
+        if (s[i] == ',') {
+            i = validate_ws(s, i + 1);
+            if (s[i] == '}') { set_error(err,1,i,"Trailing comma in object"); goto out; }
+            goto key;
+        }
+        if (s[i] != '}') { set_error(err,1,i,"Expected ',' or '}' in object"); goto out; }
+    } else {
+        if (s[i] == ',') {
+            i = validate_ws(s, i + 1);
+            if (s[i] == ']') { set_error(err,1,i,"Trailing comma in array"); goto out; }
+            goto value;
+        }
+        if (s[i] != ']') { set_error(err,1,i,"Expected ',' or ']' in array"); goto out; }
+    }
+    i++;
+    depth--;
+    goto after_value;
+
+#undef JSON_IN_OBJECT
+out:
+    if (bits != inline_bits) fm_free(bits);
+    if (err_out) *err_out = errtmp;
+    return rc;
+}
+
+int fossil_media_json_validate(const char *json_text, fossil_media_json_error_t *err_out) {
+    return fossil_media_json_validate_ex(json_text, NULL, err_out);
+}
+
+// -----------------------------------------------------------------------------
+// Incremental parsing
+// -----------------------------------------------------------------------------
+//
+// The stream tracks just enough lexical state (nesting depth, string/escape
+// state, top-level scalar) to find where each top-level value ends, whatever
+// the chunking. Bytes of the value in progress are buffered; once the value
+// is complete the buffer goes through the regular parser.
+
+enum { JSON_STREAM_IDLE, JSON_STREAM_CONTAINER, JSON_STREAM_STRING, JSON_STREAM_SCALAR };
+
+struct fossil_media_json_stream {
+    fossil_media_json_parse_options_t opts;
+    fossil_media_json_stream_fn cb;
+    void *user;
+    char *buf;               /* bytes of the value in progress */
+    size_t len;
+    size_t cap;
+    size_t offset;           /* stream offset of the next chunk */
+    size_t start;            /* stream offset of the value in progress */
+    size_t depth;
+    int state;
+    int in_string;
+    int escaped;
+    int failed;
+    fossil_media_json_error_t err;
+};
+
+fossil_media_json_stream_t *fossil_media_json_stream_create(const fossil_media_json_parse_options_t *opts,
+                                                            fossil_media_json_stream_fn cb,
+                                                            void *user) {
+    if (!cb) return NULL;
+    fossil_media_json_stream_t *st = fm_malloc(sizeof(*st));
+    if (!st) return NULL;
+    memset(st, 0, sizeof(*st));
+    if (opts) st->opts = *opts;
+    st->cb = cb;
+    st->user = user;
+    return st;
+}
+
+void fossil_media_json_stream_free(fossil_media_json_stream_t *st) {
+    if (!st) return;
+    fm_free(st->buf);
+    fm_free(st);
+}
+
+static int stream_fail(fossil_media_json_stream_t *st, fossil_media_json_error_t *err) {
+    st->failed = 1;
+    if (err) *err = st->err;
+    return -1;
+}
+
+static int stream_append(fossil_media_json_stream_t *st, const char *p, size_t n) {
+    if (st->len + n + 1 > st->cap) {
+        size_t cap = st->cap ? st->cap : 256;
+        while (cap < st->len + n + 1) cap *= 2;
+        char *nb = fm_realloc(st->buf, cap);
+        if (!nb) return -1;
+        st->buf = nb;
+        st->cap = cap;
+    }
+    memcpy(st->buf + st->len, p, n);
+    st->len += n;
+    return 0;
+}
+
+/* Parse the buffered value; NULL with st->err set if it is malformed */
+static fossil_media_json_value_t *stream_parse(fossil_media_json_stream_t *st) {
+    st->buf[st->len] = '\0';
+    fossil_media_json_error_t perr = {0, 0, ""};
+    fossil_media_json_value_t *v = fossil_media_json_parse_ex(st->buf, &st->opts, &perr);
+    st->len = 0;
+    st->state = JSON_STREAM_IDLE;
+    if (!v) {
+        st->err = perr;
+        st->err.position += st->start;
+    }
+    return v;
+}
+
+/* Parse the buffered value and hand it to the callback */
+static int stream_emit(fossil_media_json_stream_t *st) {
+    fossil_media_json_value_t *v = stream_parse(st);
+    if (!v) return -1;
+    if (st->cb(v, st->user) != 0) {
+        set_error(&st->err, 1, st->start, "Stream stopped by callback");
+        return -1;
+    }
+    return 0;
+}
+
+int fossil_media_json_stream_feed(fossil_media_json_stream_t *st,
+                                  const char *data, size_t len,
+                                  fossil_media_json_error_t *err_out) {
+    if (!st) return -1;
+    if (st->failed) return stream_fail(st, err_out);
+    if (!data && len) { set_error(&st->err, 1, st->offset, "NULL input"); return stream_fail(st, err_out); }
+    size_t i = 0;
+    size_t seg = 0;          /* first byte of this chunk not yet buffered */
+    while (i < len) {
+        char ch = data[i];
+        if (ch == '\0') { set_error(&st->err, 1, st->offset + i, "Unexpected NUL byte"); return stream_fail(st, err_out); }
+        switch (st->state) {
+        case JSON_STREAM_IDLE:
+            if (ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t') { i++; continue; }
+            if (ch == '}' || ch == ']' || ch == ',' || ch == ':') {
+                set_error(&st->err, 1, st->offset + i, "Unexpected token '%c'", ch);
+                return stream_fail(st, err_out);
+            }
+            seg = i;
+            st->start = st->offset + i;
+            st->depth = 0;
+            st->in_string = st->escaped = 0;
+            if (ch == '{' || ch == '[') { st->state = JSON_STREAM_CONTAINER; st->depth = 1; }
+            else if (ch == '"') { st->state = JSON_STREAM_STRING; st->in_string = 1; }
+            else st->state = JSON_STREAM_SCALAR;
+            i++;
+            continue;
+        case JSON_STREAM_SCALAR:
+            if (ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t') {
+                /* The whitespace belongs to whatever follows */
+                if (stream_append(st, data + seg, i - seg) != 0) {
+                    set_error(&st->err, 1, st->offset + i, "OOM");
+                    return stream_fail(st, err_out);
+                }
+                if (stream_emit(st) != 0) return stream_fail(st, err_out);
+                continue;
+            }
+            if (ch == '{' || ch == '[' || ch == '}' || ch == ']' || ch == ',' || ch == ':' || ch == '"') {
+                /* Numbers and literals need whitespace before the next value */
+                if (stream_append(st, data + seg, i - seg) != 0) {
+                    set_error(&st->err, 1, st->offset + i, "OOM");
+                    return stream_fail(st, err_out);
+                }
+                fossil_media_json_value_t *v = stream_parse(st);
+                if (!v) return stream_fail(st, err_out);
+                fossil_media_json_free(v);
+                set_error(&st->err, 1, st->offset + i, "Unexpected token '%c'", ch);
+                return stream_fail(st, err_out);
+            }
+            i++;
+            continue;
+        default:
+            break;
+        }
+        /* Container or top-level string */
+        int done = 0;
+        while (i < len) {
+            ch = data[i++];
+            if (st->in_string) {
+                if (st->escaped) st->escaped = 0;
+                else if (ch == '\\') st->escaped = 1;
+                else if (ch == '"') { st->in_string = 0; if (st->depth == 0) { done = 1; break; } }
+                else if (ch == '\0') { i--; break; }
+            } else if (ch == '"') st->in_string = 1;
+            else if (ch == '{' || ch == '[') st->depth++;
+            else if (ch == '}' || ch == ']') { if (--st->depth == 0) { done = 1; break; } }
+            else if (ch == '\0') { i--; break; }
+        }
+        if (done) {
+            if (stream_append(st, data + seg, i - seg) != 0) {
+                set_error(&st->err, 1, st->offset + i, "OOM");
+                return stream_fail(st, err_out);
+            }
+            if (stream_emit(st) != 0) return stream_fail(st, err_out);
+        }
+    }
+    if (st->state != JSON_STREAM_IDLE && stream_append(st, data + seg, len - seg) != 0) {
+        set_error(&st->err, 1, st->offset + len, "OOM");
+        return stream_fail(st, err_out);
+    }
+    st->offset += len;
+    if (err_out) { err_out->code = 0; err_out->position = 0; err_out->message[0] = '\0'; }
+    return 0;
+}
+
+int fossil_media_json_stream_finish(fossil_media_json_stream_t *st, fossil_media_json_error_t *err_out) {
+    if (!st) return -1;
+    if (st->failed) return stream_fail(st, err_out);
+    /* A trailing scalar completes here; an unfinished value reports its error */
+    if (st->state != JSON_STREAM_IDLE && stream_emit(st) != 0) return stream_fail(st, err_out);
+    if (err_out) { err_out->code = 0; err_out->position = 0; err_out->message[0] = '\0'; }
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+// NDJSON batches
+// -----------------------------------------------------------------------------
+//
+// The input is cut into batches of roughly JSON_NDJSON_BATCH bytes, always at
+// a newline, and workers claim batches in order and parse their lines into a
+// ring of result slots. The calling thread drains the ring in batch order and
+// runs the callback, so records arrive in input order while at most `window`
+// batches are parsed ahead of the consumer.
+
+#define JSON_NDJSON_BATCH   ((size_t)256 * 1024)
+#define JSON_NDJSON_AHEAD   4         /* batches in flight per worker */
+#define JSON_NDJSON_THREADS 64
+
+typedef struct {
+    fossil_media_json_value_t *value;
+    fossil_media_json_error_t *err;   /* NULL when the line parsed */
+    size_t line;                      /* line number within the batch */
+    size_t offset;                    /* input offset of the line */
+} json_ndjson_rec_t;
+
+typedef struct {
+    size_t begin, end;                /* whole lines of the input */
+    json_ndjson_rec_t *recs;
+    size_t count, cap;
+    size_t lines;                     /* lines in the batch, blank ones included */
+    int ready;
+    int oom;
+} json_ndjson_batch_t;
+
+typedef struct {
+    const char *data;
+    size_t len;
+    fossil_media_json_parse_options_t opts;
+    json_mutex_t lock;
+    json_cond_t ready;                /* a batch finished */
+    json_cond_t room;                 /* the consumer freed a slot */
+    json_ndjson_batch_t *ring;
+    size_t window;
+    size_t next;                      /* input offset of the next unclaimed batch */
+    size_t claimed;                   /* batches handed to workers */
+    size_t delivered;                 /* batches drained by the consumer */
+    int stop;
+} json_ndjson_t;
+
+static size_t json_cpu_count(void) {
+#if defined(_WIN32)
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return si.dwNumberOfProcessors ? (size_t)si.dwNumberOfProcessors : 1;
+#elif defined(_SC_NPROCESSORS_ONLN)
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (size_t)n : 1;
+#else
+    return 1;
+#endif
+}
+
+/* End of the batch starting at `begin`: the first newline past the target size */
+static size_t ndjson_cut(const json_ndjson_t *nd, size_t begin) {
+    if (nd->len - begin <= JSON_NDJSON_BATCH) return nd->len;
+    const char *nl = memchr(nd->data + begin + JSON_NDJSON_BATCH - 1, '\n', nd->len - begin - JSON_NDJSON_BATCH + 1);
+    return nl ? (size_t)(nl - nd->data) + 1 : nd->len;
+}
+
+static void ndjson_batch_clear(json_ndjson_batch_t *b) {
+    for (size_t k = 0; k < b->count; ++k) {
+        fossil_media_json_free(b->recs[k].value);
+        fm_free(b->recs[k].err);
+    }
+    fm_free(b->recs);
+    memset(b, 0, sizeof(*b));
+}
+
+static int ndjson_blank(const char *p, size_t n) {
+    for (size_t k = 0; k < n; ++k)
+        if (p[k] != ' ' && p[k] != '\t' && p[k] != '\r') return 0;
+    return 1;
+}
+
+/* Parse one line into `r`; `scratch` is the thread's line buffer. -1 on OOM. */
+static int ndjson_parse_line(const json_ndjson_t *nd, const char *p, size_t n,
+                             char **scratch, size_t *scap, json_ndjson_rec_t *r) {
+    fossil_media_json_error_t e = {0, 0, ""};
+    const char *nul = memchr(p, '\0', n);
+    r->value = NULL;
+    r->err = NULL;
+    if (nul) {
+        set_error(&e, 1, (size_t)(nul - p), "Unexpected NUL byte");
+    } else {
+        if (n + 1 > *scap) {
+            size_t cap = *scap ? *scap : 4096;
+            while (cap < n + 1) cap *= 2;
+            char *tmp = fm_realloc(*scratch, cap);
+            if (!tmp) return -1;
+            *scratch = tmp;
+            *scap = cap;
+        }
+        memcpy(*scratch, p, n);
+        (*scratch)[n] = '\0';
+        r->value = parse_document(*scratch, &nd->opts, 0, &e);
+    }
+    if (!r->value) {
+        if (!(r->err = fm_malloc(sizeof(*r->err)))) return -1;
+        *r->err = e;
+    }
+    return 0;
+}
+
+/* Parse every line of b->begin..b->end into b->recs */
+static void ndjson_parse_batch(const json_ndjson_t *nd, json_ndjson_batch_t *b, char **scratch, size_t *scap) {
+    size_t at = b->begin;
+    while (at < b->end) {
+        const char *p = nd->data + at;
+        const char *nl = memchr(p, '\n', b->end - at);
+        size_t n = nl ? (size_t)(nl - p) : b->end - at;
+        size_t line = b->lines++;
+        size_t offset = at;
+        at += n + (nl != NULL);
+        if (ndjson_blank(p, n)) continue;
+
+        if (b->count == b->cap) {
+            size_t cap = b->cap ? b->cap * 2 : 256;
+            json_ndjson_rec_t *tmp = fm_realloc(b->recs, sizeof(*tmp) * cap);
+            if (!tmp) { b->oom = 1; return; }
+            b->recs = tmp;
+            b->cap = cap;
+        }
+        json_ndjson_rec_t *r = &b->recs[b->count];
+        r->line = line;
+        r->offset = offset;
+        if (ndjson_parse_line(nd, p, n, scratch, scap, r) != 0) { fm_free(r->err); b->oom = 1; return; }
+        b->count++;
+    }
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI ndjson_worker(LPVOID arg)
+#else
+static void *ndjson_worker(void *arg)
+#endif
+{
+    json_ndjson_t *nd = arg;
+    char *scratch = NULL;
+    size_t scap = 0;
+    json_mutex_lock(&nd->lock);
+    for (;;) {
+        while (!nd->stop && nd->next < nd->len && nd->claimed - nd->delivered >= nd->window)
+            json_cond_wait(&nd->room, &nd->lock);
+        if (nd->stop || nd->next >= nd->len) break;
+        json_ndjson_batch_t *b = &nd->ring[nd->claimed % nd->window];
+        b->begin = nd->next;
+        b->end = nd->next = ndjson_cut(nd, nd->next);
+        nd->claimed++;
+        json_mutex_unlock(&nd->lock);
+
+        ndjson_parse_batch(nd, b, &scratch, &scap);
+
+        json_mutex_lock(&nd->lock);
+        b->ready = 1;
+        json_cond_broadcast(&nd->ready);
+    }
+    json_mutex_unlock(&nd->lock);
+    fm_free(scratch);
+#if defined(_WIN32)
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+/* Hand one record to the callback; returns nonzero to stop */
+static int ndjson_emit(json_ndjson_rec_t *r, size_t line_base, fossil_media_json_ndjson_fn cb, void *user,
+                       fossil_media_json_error_t *first, int *failed) {
+    if (r->err && !*failed) {
+        *first = *r->err;
+        first->position += r->offset;
+        *failed = 1;
+    }
+    int rc = cb(r->value, line_base + r->line + 1, r->err, user);
+    r->value = NULL;
+    /* A malformed line reported earlier stays the recorded error */
+    if (rc != 0 && !*failed) set_error(first, 1, r->offset, "NDJSON stopped by callback");
+    return rc;
+}
+
+/* Hand a finished batch to the callback and recycle it */
+static int ndjson_deliver(json_ndjson_batch_t *b, size_t *line_base, fossil_media_json_ndjson_fn cb, void *user,
+                          fossil_media_json_error_t *first, int *failed) {
+    int rc = 0;
+    for (size_t k = 0; k < b->count && rc == 0; ++k) rc = ndjson_emit(&b->recs[k], *line_base, cb, user, first, failed);
+    if (rc == 0 && b->oom) {
+        if (!*failed) set_error(first, 1, b->begin, "OOM");
+        rc = -1;
+    }
+    *line_base += b->lines;
+    ndjson_batch_clear(b);
+    return rc;
+}
+
+int fossil_media_json_parse_ndjson(const char *data, size_t len,
+                                   const fossil_media_json_ndjson_options_t *opts,
+                                   fossil_media_json_ndjson_fn cb, void *user,
+                                   fossil_media_json_error_t *err_out) {
+    fossil_media_json_error_t errtmp = {0,0,""};
+    if ((!data && len) || !cb) { set_error(&errtmp,1,0,"NULL input"); if (err_out) *err_out = errtmp; return -1; }
+    json_ndjson_t nd;
+    memset(&nd, 0, sizeof(nd));
+    nd.data = data;
+    nd.len = len;
+    nd.opts.flags = opts ? opts->flags : 0;
+    nd.opts.max_depth = opts ? opts->max_depth : 0;
+    size_t threads = opts && opts->threads ? opts->threads : json_cpu_count();
+    size_t batches = len / JSON_NDJSON_BATCH + 1;
+    if (threads > batches) threads = batches;
+    if (threads > JSON_NDJSON_THREADS) threads = JSON_NDJSON_THREADS;
+
+    size_t line_base = 0;
+    int failed = 0, stopped = 0;
+    json_thread_t workers[JSON_NDJSON_THREADS];
+    size_t started = 0;
+    if (threads > 1) {
+        /* Settle the indexer on this thread before any worker can need it */
+        select_classifier();
+        nd.window = threads * JSON_NDJSON_AHEAD;
+        nd.ring = fm_malloc(sizeof(*nd.ring) * nd.window);
+        if (nd.ring) {
+            memset(nd.ring, 0, sizeof(*nd.ring) * nd.window);
+            json_mutex_init(&nd.lock);
+            json_cond_init(&nd.ready);
+            json_cond_init(&nd.room);
+            for (; started < threads; ++started) {
+#if defined(_WIN32)
+                if (!(workers[started] = CreateThread(NULL, 0, ndjson_worker, &nd, 0, NULL))) break;
+#else
+                if (pthread_create(&workers[started], NULL, ndjson_worker, &nd) != 0) break;
+#endif
+            }
+        }
+    }
+
+    if (started) {
+        json_mutex_lock(&nd.lock);
+        while (!stopped && (nd.delivered < nd.claimed || nd.next < nd.len)) {
+            json_ndjson_batch_t *b = &nd.ring[nd.delivered % nd.window];
+            if (nd.delivered == nd.claimed || !b->ready) { json_cond_wait(&nd.ready, &nd.lock); continue; }
+            json_mutex_unlock(&nd.lock);
+            stopped = ndjson_deliver(b, &line_base, cb, user, &errtmp, &failed) != 0;
+            json_mutex_lock(&nd.lock);
+            nd.delivered++;
+            if (stopped) nd.stop = 1;
+            json_cond_broadcast(&nd.room);
+        }
+        json_mutex_unlock(&nd.lock);
+        for (size_t k = 0; k < started; ++k) {
+#if defined(_WIN32)
+            WaitForSingleObject(workers[k], INFINITE);
+            CloseHandle(workers[k]);
+#else
+            pthread_join(workers[k], NULL);
+#endif
+        }
+        for (; nd.delivered < nd.claimed; ++nd.delivered) ndjson_batch_clear(&nd.ring[nd.delivered % nd.window]);
+    } else {
+        /* One thread (or no threads available): parse and deliver line by line */
+        char *scratch = NULL;
+        size_t scap = 0;
+        json_ndjson_rec_t r;
+        for (size_t at = 0; !stopped && at < len;) {
+            const char *p = data + at;
+            const char *nl = memchr(p, '\n', len - at);
+            size_t n = nl ? (size_t)(nl - p) : len - at;
+            r.line = line_base;
+            r.offset = at;
+            at += n + (nl != NULL);
+            line_base++;
+            if (ndjson_blank(p, n)) continue;
+            if (ndjson_parse_line(&nd, p, n, &scratch, &scap, &r) != 0) {
+                if (!failed) set_error(&errtmp, 1, r.offset, "OOM");
+                stopped = 1;
+                break;
+            }
+            stopped = ndjson_emit(&r, 0, cb, user, &errtmp, &failed) != 0;
+            fm_free(r.err);
+        }
+        fm_free(scratch);
+    }
+    if (threads > 1 && nd.ring) {
+        json_cond_destroy(&nd.room);
+        json_cond_destroy(&nd.ready);
+        json_mutex_destroy(&nd.lock);
+        fm_free(nd.ring);
+    }
+    if (err_out) *err_out = errtmp;
+    return stopped || failed ? -1 : 0;
+}
+
+// -----------------------------------------------------------------------------
+// Number formatting
+// -----------------------------------------------------------------------------
+//
+// Doubles print as the shortest decimal that parses back to the same bits,
+// choosing the closest such decimal and breaking ties to even (Giulietti's
+// Schubfach), so 0.1 prints as "0.1" rather than "0.10000000000000001".
+// Integral values below 2^53 skip the search and go straight to the integer
+// formatter. Layout follows ECMAScript: plain notation for decimal exponents
+// in [-6, 20], scientific otherwise.
+
+#define JSON_G_MIN (-292)
+#define JSON_G_MAX 324
+
+/* floor(10^e * 2^-r) + 1 for e in [JSON_G_MIN, JSON_G_MAX], with
+   r = floor(e * log2(10)) - 125 so every entry has 126 bits; {high, low} */
+static const uint64_t json_pow10_126[][2] = {
+    {0x3fddec7f2faf3713u,0xc97a3a2704eec3dfu}, {0x27eab3cf7dcd826cu,0x5dec645863153a6cu},
+    {0x31e560c35d40e307u,0x75677d6e7bda8906u}, {0x3e5eb8f434911bc9u,0x52c15cca1ad12b48u},
+    {0x26fb3398a0dab15du,0xd3b8d9fe50c2bb0du}, {0x30ba007ec9115db5u,0x48a7107de4f369d0u},
+    {0x3ce8809e7b55b522u,0x9ad0d49d5e304444u}, {0x261150630d159135u,0xa0c284e25ade2aabu},
+    {0x2f95a47bd05af583u,0x08f3261af195b555u}, {0x3b7b0d9ac471b2e3u,0xcb2fefa1adfb22abu},
+    {0x252ce880bac70fceu,0x5efdf5c50cbcf5abu}, {0x2e7822a0e978d3c1u,0xf6bd73364fec3315u},
+    {0x3a162b4923d708b2u,0x746cd003e3e73fdbu}, {0x244ddb0db666656fu,0x88c402026e7087e9u},
+    {0x2d6151d123fffecbu,0x6af502830a0ca9e3u}, {0x38b9a6456cfffe7eu,0x45b24323cc8fd45cu},
+    {0x237407eb641fff0eu,0xeb8f69f65fd9e4b9u}, {0x2c5109e63d27fed2u,0xa6734473f7d05de8u},
+    {0x37654c5fcc71fe87u,0x50101590f5c47561u}, {0x229f4fbbdfc73f14u,0x920a0d7a999ac95du},
+    {0x2b4723aad7b90ed9u,0xb68c90d940017bb4u}, {0x3618ec958da75290u,0x242fb50f9001daa1u},
+    {0x21cf93dd7888939au,0x169dd129ba0128a5u}, {0x2a4378d4d6aab880u,0x9c454574288172ceu},
+    {0x34d4570a0c5566a0u,0xc35696d132a1cf81u}, {0x2104b66647b56024u,0x7a161e42bfa521b1u},
+    {0x2945e3ffd9a2b82du,0x989ba5d36f8e6a1du}, {0x33975cffd00b6638u,0xfec28f484b7204a4u},
+    {0x203e9a1fe2071fe3u,0x9f39998d2f2742e7u}, {0x284e40a7da88e7dcu,0x8707fff07af113a1u},
+    {0x3261d0d1d12b21d3u,0xa8c9ffec99ad5889u}, {0x3efa45064575ea48u,0x92fc7fe7c018aeabu},
+    {0x275c6b23eb69b26du,0x5bddcff0d80f6d2bu}, {0x313385ece6441f08u,0xb2d543ed0e134875u},
+    {0x3d8067681fd526cau,0xdf8a94e851981a93u}, {0x267040a113e5383eu,0xcbb69d1132ff109cu},
+    {0x300c50c958de864eu,0x7ea444557fbed4c3u}, {0x3c0f64fbaf1627e2u,0x1e4d556adfae89f3u},
+    {0x25899f1d4d6dd8edu,0x52f05562cbcd1638u}, {0x2eec06e4a0c94f28u,0xa7ac6abb7ec05bc6u},
+    {0x3aa7089dc8fba2f2u,0xd197856a5e7072b8u}, {0x24a865629d9d45d7u,0xc2feb3627b0647b3u},
+    {0x2dd27ebb4504974du,0xb3be603b19c7d99fu}, {0x39471e6a1645bd21u,0x20adf849e039d007u},
+    {0x23cc73024deb9634u,0xb46cbb2e2c242205u}, {0x2cbf8fc2e1667bc1u,0xe187e9f9b72d2a86u},
+    {0x37ef73b399c01ab2u,0x59e9e47824f87527u}, {0x22f5a850401810afu,0x78322ecb171b4939u},
+    {0x2bb31264501e14dbu,0x563eba7ddce21b87u}, {0x369fd6fd64259a12u,0x2bce691d541aa268u},
+    {0x2223e65e5e97804bu,0x5b6101b25490a581u}, {0x2aacdff5f63d605eu,0x3239421ee9b4cee1u},
+    {0x355817f373ccb875u,0xbec792a6a422029au}, {0x21570ef8285ff349u,0x973cbba8269541a0u},
+    {0x29acd2b63277f01bu,0xfd0bea92303a9208u}, {0x34180763bf15ec22u,0xfc4ee536bc49368au},
+    {0x208f049e576db395u,0xddb14f4235adc217u}, {0x28b2c5c5ed49207bu,0x551da312c319329cu},
+    {0x32df7737689b689au,0x2a650bd773df7f43u}, {0x3f97550542c242c0u,0xb4fe4ecd50d75f14u},
+    {0x27be952349b969b8u,0x711ef14052869b6cu}, {0x31ae3a6c1c27c426u,0x8d66ad9067284247u},
+    {0x3e19c9072331b530u,0x30c058f480f252d9u}, {0x26d01da475ff113eu,0x1e783798d09773c8u},
+    {0x3084250d937ed58du,0xa616457f04bd50bau}, {0x3ca52e50f85e8af1u,0x0f9bd6dec5eca4e8u},
+    {0x25e73cf29b3b16d6u,0xa9c1664b3bb3e711u}, {0x2f610c2f4209dc8cu,0x5431bfde0aa0e0d5u},
+    {0x3b394f3b128c53afu,0x693e2fd58d49190bu}, {0x2503d184eb97b44du,0xa1c6dde5784dafa7u},
+    {0x2e44c5e6267da161u,0x0a38955ed6611b90u}, {0x39d5f75fb01d09b9u,0x4cc6bab68bf96274u},
+    {0x2425ba9bce122613u,0xcffc34b2177bdd89u}, {0x2d2f2942c196af98u,0xc3fb41de9d5ad4ebu},
+    {0x387af39371fc5b7eu,0xf4fa125644b18a26u}, {0x234cd83c273db92fu,0x591c4b75eaeef658u},
+    {0x2c200e4b310d277bu,0x2f635e5365aab3edu}, {0x372811ddfd507159u,0xfb3c35e83f1560e9u},
+    {0x22790b2abe5246d8u,0x3d05a1b1276d5c92u}, {0x2b174df56de6d88eu,0x4c470a1d7148b3b6u},
+    {0x35dd2172c9608eb1u,0xdf58cca4cd9ae0a3u}, {0x21aa34e7bddc592fu,0x2b977fe70080cc66u},
+    {0x2a14c221ad536f7au,0xf67d5fe0c0a0ff80u}, {0x3499f2aa18a84b59u,0xb41cb7d8f0c93f5fu},
+    {0x20e037aa4f692f18u,0x1091f2e7967dc79cu}, {0x29184594e3437adeu,0x14b66fa17c1d3983u},
+    {0x335e56fa1c145995u,0x99e40b89db2487e3u}, {0x201af65c518cb7fdu,0x802e873628f6d4eeu},
+    {0x2821b3f365efe5fcu,0xe03a2903b3348a2au}, {0x322a20f03f6bdf7cu,0x1848b344a001acb4u},
+    {0x3eb4a92c4f46d75bu,0x1e5ae015c80217e1u}, {0x2730e9bbb18c4698u,0xf2f8cc0d9d014eedu},
+    {0x30fd242a9def583fu,0x2fb6ff110441a2a8u}, {0x3d3c6d35456b2e4eu,0xfba4bed545520b52u},
+    {0x2645c4414b62fcf1u,0x5d46f7454b534713u}, {0x2fd735519e3bbc2du,0xb498b5169e2818d8u},
+    {0x3bcd02a605caab39u,0x21bee25c45b21f0eu}, {0x256021a7c39eab03u,0xb5174d79ab8f5369u},
+    {0x2eb82a11b48655c4u,0xa25d20d816732843u}, {0x3a66349621a7eb35u,0xcaf4690e1c0ff253u},
+    {0x247fe0ddd508f301u,0x9ed8c1a8d189f774u}, {0x2d9fd9154a4b2fc2u,0x068ef21305ec7551u},
+    {0x3907cf5a9cddfbb2u,0x8832ae97c76792a5u}, {0x23a4e198a20abd4fu,0x951fad1edca0bba8u},
+    {0x2c8e19feca8d6ca3u,0x7a67986693c8ea91u}, {0x37b1a07e7d30c7ccu,0x59017e8038bb2536u},
+    {0x22cf044f0e3e7cdfu,0xb7a0ef102374f742u}, {0x2b82c562d1ce1c17u,0xa5892ad42c523512u},
+    {0x366376bb8641a31du,0x8eeb75893766c256u}, {0x21fe2a3533e905f2u,0x79532975c2a03976u},
+    {0x2a7db4c280e3476fu,0x17a7f3d3334847d4u}, {0x351d21f3211c194au,0xdd91f0c8001a59c8u},
+    {0x21323537f4b18fceu,0xca7b367d0010781du}, {0x297ec285f1ddf3c2u,0x7d1a041c40149625u},
+    {0x33de73276e5570b3u,0x1c6085235019bbaeu}, {0x206b07f8a4f5666fu,0xf1bc53361210154du},
+    {0x2885c9f6ce32c00bu,0xee2b680396941aa0u}, {0x32a73c7481bf700eu,0xe9b642047c392148u},
+    {0x3f510b91a22f4c12u,0xa423d2859b476999u}, {0x2792a73b055d8f8bu,0xa6966393810ca200u},
+    {0x31775109c6b4f36eu,0x903bfc78614fca80u}, {0x3dd5254c3862304au,0x344afb9679a3bd20u},
+    {0x26a5374fa33d5e2eu,0x60aedd3e0c065634u}, {0x304e85238c0cb5b9u,0xf8da948d8f07ebc1u},
+    {0x3c62266c6f0fe328u,0x771139b0f2c9e6b1u}, {0x25bd5803c569edf9u,0x4a6ac40e97be302fu},
+    {0x2f2cae04b6c46977u,0x9d0575123dadbc3au}, {0x3af7d985e47583d5u,0x8446d256cd192b49u},
+    {0x24dae7f3aec97265u,0x72ac4376402fbb0eu}, {0x2e11a1f09a7bcefeu,0xcf575453d03ba9d1u},
+    {0x39960a6cc11ac2beu,0x832d2968c44a9445u}, {0x23fdc683f8b0b9b7u,0x11fc39e17aae9cabu},
+    {0x2cfd3824f6dce824u,0xd67b4859d95a43d6u}, {0x383c862e3494222eu,0x0c1a1a704fb0d4ccu},
+    {0x2325d3dce0dc955cu,0xc790508631ce84ffu}, {0x2bef48d41913bab3u,0xf97464a7be42263fu},
+    {0x36eb1b091f58a960u,0xf7d17dd1add2afcfu}, {0x2252f0e5b39769dcu,0x9ae2eea30ca3ade1u},
+    {0x2ae7ad1f207d4453u,0xc19baa4bcfcc995au}, {0x35a19866e89c9568u,0xb20294dec3bfbfb0u},
+    {0x2184ff405161dd61u,0x6f419d0b3a57d7ceu}, {0x29e63f1065ba54b9u,0xcb12044e08edcdc2u},
+    {0x345fced47f28e9e8u,0x3dd685618b294132u}, {0x20bbe144cf799231u,0x26a6135cf6f9c8bfu},
+    {0x28ead9960357f6bdu,0x704f983434b83aefu}, {0x33258ffb842df46cu,0xcc637e4141e649abu},
+    {0x3feef3fa65397187u,0xff7c5dd1925fdc15u}, {0x27f5587c7f43e6f4u,0xffadbaa2fb7be98du},
+    {0x31f2ae9b9f14e0b2u,0x3f99294bba5ae3f1u}, {0x3e6f5a4286da18deu,0xcf7f739ea8f19cedu},
+    {0x2705986994484f8bu,0x41afa84329970214u}, {0x30c6fe83f95a636eu,0x121b9253f3fcc299u},
+    {0x3cf8be24f7b0fc49u,0x96a276e8f0fbf33fu}, {0x261b76d71ace9dadu,0xfe258a51969d7808u},
+    {0x2fa2548ce1824519u,0x7daeece5fc44d609u}, {0x3b8ae9b019e2d65fu,0xdd1aa81f7b560b8cu},
+    {0x2536d20e102dc5fbu,0xea30a913ad15c738u}, {0x2e8486919439377au,0xe4bcd358985b3905u},
+    {0x3a25a835f9478559u,0x9dec082ebe720746u}, {0x24578921bbccb358u,0x02b3851d3707448cu},
+    {0x2d6d6b6a2abfe02eu,0x0360666484c915afu}, {0x38c8c644b56fd839u,0x84387ffda5fb5b1bu},
+    {0x237d7beaf165e723u,0xf2a34ffe87bd18f1u}, {0x2c5cdae5adbf60ecu,0xef4c23fe29ac5f2du},
+    {0x3774119f192f3928u,0x2b1f2cfdb41776f8u}, {0x22a88b036fbd83b9u,0x1af37c1e908eaa5bu},
+    {0x2b52adc44bace4a7u,0x61b05b2634b254f2u}, {0x362759355e981dd1u,0x3a1c71efc1deea2eu},
+    {0x21d897c15b1f12a2u,0xc451c735d92b525du}, {0x2a4ebdb1b1e6d74bu,0x756639034f7626f4u},
+    {0x34e26d1e1e608d1eu,0x52bfc7442353b0b1u}, {0x210d8432d2fc5832u,0xf3b7dc8a96144e6fu},
+    {0x2950e53f87bb6e3fu,0xb0a5d3ad3b99620bu}, {0x33a51e8f69aa49cfu,0x9ccf48988a7fba8du},
+    {0x20473319a20a6e21u,0xc2018d5f568fd498u}, {0x2858ffe00a8d09aau,0x3281f0b72c33c9beu},
+    {0x326f3fd80d304c14u,0xbf226ce4f740bc2eu}, {0x3f0b0fce107c5f19u,0xeeeb081e3510eb39u},
+    {0x2766e9e0ca4dbb70u,0x3552e512e12a9304u}, {0x3140a458fce12a4cu,0x42a79e57997537c5u},
+    {0x3d90cd6f3c1974dfu,0x535185ed7fd285b6u}, {0x267a8065858fe90bu,0x9412f3b46fe39392u},
+    {0x3019207ee6f3e34eu,0x7917b0a18bdc7876u}, {0x3c1f689ea0b0dc22u,0x175d9cc9eed39694u},
+    {0x2593a163246e8995u,0x4e9a81fe35443e1cu}, {0x2ef889bbed8a2bfau,0xa241227dc2954da3u},
+    {0x3ab6ac2ae8ecb6f9u,0x4ad16b1d333aa10cu}, {0x24b22b9ad193f25bu,0xcec2e2f24004a4a8u},
+    {0x2ddeb68185f8eef2u,0xc2739baed005cdd2u}, {0x39566421e7772aafu,0x7310829a84074146u},
+    {0x23d5fe9530aa7aadu,0xa7ea51a0928488ccu}, {0x2ccb7e3a7cd51959u,0x11e4e608b725aaffu},
+    {0x37fe5dc91c0a5fafu,0x565e1f8ae4ef15beu}, {0x22fefa9db1867bcdu,0x95fad3b6cf156d97u},
+    {0x2bbeb9451de81ac0u,0xfb7988a482dac8fdu}, {0x36ae679665622171u,0x3a57eacda3917b3cu},
+    {0x222d00bdff5d54e6u,0xc476f2c0863aed06u}, {0x2ab840ed7f34aa20u,0x7594af70a7c9a847u},
+    {0x35665128df01d4a8u,0x92f9db4cd1bc1258u}, {0x215ff2b98b6124e9u,0x5bdc291003158b77u},
+    {0x29b7ef67ee396e23u,0xb2d3335403daee55u}, {0x3425eb41e9c7c9acu,0x9f88002904d1a9eau},
+    {0x2097b309321cde0bu,0xe3b50019a3030a33u}, {0x28bd9fcb7ea4158eu,0xdca240200bc3ccbfu},
+    {0x32ed07be5e4d1af2u,0x93cad0280eb4bfefu}, {0x3fa849adf5e061afu,0x38bd84321261efebu},
+    {0x27c92e0cb9ac3d0du,0x8376729f4b7d35f3u}, {0x31bb798fe8174c50u,0xe4540f471e5c836fu},
+    {0x3e2a57f3e21d1f65u,0x1d691318e5f3a44bu}, {0x26da76f86d52339fu,0x3261abef8fb846afu},
+    {0x309114b688a6c086u,0xfefa16eb73a6585bu}, {0x3cb559e42ad070a8u,0xbeb89ca6508fee71u},
+    {0x25f1582e9ac24669u,0x773361e7f259f507u}, {0x2f6dae3a4172d803u,0xd5003a61eef07249u},
+    {0x3b4919c8d1cf8e04u,0xca4048fa6aac8edbu}, {0x250db01d8321b8c2u,0xfe682d9c82abd949u},
+    {0x2e511c24e3ea26f3u,0xbe023903a356cf9bu}, {0x39e5632e1ce4b0b0u,0xad82c7448c2c8382u},
+    {0x242f5dfcd20eee6eu,0x6c71bc8ad79bd231u}, {0x2d3b357c0692aa0au,0x078e2bad8d82c6bdu},
+    {0x388a02db0837548cu,0x8971b698f0e3786du}, {0x235641c8e52294d7u,0xd5e7121f968e2b44u},
+    {0x2c2bd23b1e6b3a0du,0xcb60d6a77c31b615u}, {0x3736c6c9e6060891u,0x3e390c515b3e239au},
+    {0x22823c3e2fc3c55au,0xc6e3a7b2d906d640u}, {0x2b22cb4dbbb4b6b1u,0x789c919f8f488bd0u},
+    {0x35eb7e212aa1e45du,0xd6c3b607731aaec4u}, {0x21b32ed4baa52ebau,0xa63a51c4a7f0ad3bu},
+    {0x2a1ffa89e94e7a69u,0x4fc8e635d1ecd88au}, {0x34a7f92c63a21903u,0xa3bb1fc346680eacu},
+    {0x20e8fbbbbe454fa2u,0x4654f3da0c01092cu}, {0x29233aaaadd6a38au,0xd7ea30d08f014b76u},
+    {0x336c0955594c4c6du,0x8de4bd04b2c19e54u}, {0x202385d557cfafc4u,0x78aef622efb902f5u},
+    {0x282c674aadc39bb5u,0x96dab3ababa743b2u}, {0x3237811d593482a2u,0xfc9160969691149eu},
+    {0x3ec56164af81a34bu,0xbbb5b8bc3c3559c5u}, {0x273b5cdeedb1060fu,0x55519375a5a1581bu},
+    {0x310a3416a91d4793u,0x2aa5f8530f09ae22u}, {0x3d4cc11c53649977u,0xf54f7667d2cc19abu},
+    {0x264ff8b1b41edfeau,0xf951aa00e3bf900bu}, {0x2fe3f6de212697e5u,0xb7a614811caf740du},
+    {0x3bdcf495a9703ddfu,0x258f99a163db5111u}, {0x256a18dd89e626abu,0x7779c004de6912abu},
+    {0x2ec49f14ec5fb056u,0x5558300616035755u}, {0x3a75c6da27779c6bu,0xeaae3c079b842d2au},
+    {0x24899c4858aac1c3u,0x72ace584c1329c3bu}, {0x2dac035a6ed57234u,0x4f581ee5f17f4349u},
+    {0x391704310a8acec1u,0x632e269f6ddf141bu}, {0x23ae629ea696c138u,0xddfcd823a4ab6c91u},
+    {0x2c99fb46503c7187u,0x157c0e2c8dd647b5u}, {0x37c07a17e44b8de8u,0xdadb11b7b14bd9a3u},
+    {0x22d84c4eeeaf38b1u,0x88c8eb12cecf6806u}, {0x2b8e5f62aa5b06ddu,0xeafb25d782834207u},
+    {0x3671f73b54f1c895u,0x65b9ef4d63241289u}, {0x22073a8515171d5du,0x5f9435905df68b96u},
+    {0x2a8909265a5ce4b4u,0xb77942f475742e7bu}, {0x352b4b6ff0f41de1u,0xe55793b192d13a1au},
+    {0x213b0f25f69892adu,0x2f56bc4efbc2c450u}, {0x2989d2ef743eb758u,0x7b2c6b62bab37564u},
+    {0x33ec47ab514e652eu,0x99f7863b696052bdu}, {0x2073accb12d0ff3du,0x203ab3e521dc33b6u},
+    {0x289097fdd7853f0cu,0x684960de6a5340a4u}, {0x32b4bdfd4d668ecfu,0x825bb91604e810cdu},
+    {0x3f61ed7ca0c03283u,0x62f2a75b86221500u}, {0x279d346de4781f92u,0x1dd7a89933d54d20u},
+    {0x318481895d962776u,0xa54d92bf80caa068u}, {0x3de5a1ebb4fbb154u,0x4ea0f76f60fd4882u},
+    {0x26af8533511d4ed4u,0xb1249aa59c9e4d51u}, {0x305b66802564a289u,0xdd6dc14f03c5e0a5u},
+    {0x3c7240202ebdcb2cu,0x54c931a2c4b758cfu}, {0x25c768141d369efbu,0xb4fdbf05baf29781u},
+    {0x2f394219248446bau,0xa23d2ec729af3d62u}, {0x3b07929f6da55869u,0x4acc7a78f41b0cbau},
+    {0x24e4bba3a4875741u,0xcebfcc8b9890e7f4u}, {0x2e1dea8c8da92d12u,0x426fbfae7eb521f1u},
+    {0x39a5652fb1137856u,0xd30baf9a1e626a6du}, {0x24075f3dceac2b36u,0x43e74dc052fd8285u},
+    {0x2d09370d42573603u,0xd4e1213067bce326u}, {0x384b84d092ed0384u,0xca19697c81ac1befu},
+    {0x232f33025bd42232u,0xfe4fe1edd10b9175u}, {0x2bfaffc2f2c92abfu,0xbde3da69454e75d3u},
+    {0x36f9bfb3af7b756fu,0xad5cd10396a21347u}, {0x225c17d04dad2965u,0xcc5a02a23e254c0du},
+    {0x2af31dc4611873bfu,0x3f70834acdae9f10u}, {0x35afe535795e90afu,0x0f4ca41d811a46d4u},
+    {0x218def416bdb1a6du,0x698fe69270b06c44u}, {0x29f16b11c6d1e108u,0xc3f3e0370cdc8755u},
+    {0x346dc5d63886594au,0xf4f0d844d013a92bu}, {0x20c49ba5e353f7ceu,0xd916872b020c49bbu},
+    {0x28f5c28f5c28f5c2u,0x8f5c28f5c28f5c29u}, {0x3333333333333333u,0x3333333333333334u},
+    {0x2000000000000000u,0x0000000000000001u}, {0x2800000000000000u,0x0000000000000001u},
+    {0x3200000000000000u,0x0000000000000001u}, {0x3e80000000000000u,0x0000000000000001u},
+    {0x2710000000000000u,0x0000000000000001u}, {0x30d4000000000000u,0x0000000000000001u},
+    {0x3d09000000000000u,0x0000000000000001u}, {0x2625a00000000000u,0x0000000000000001u},
+    {0x2faf080000000000u,0x0000000000000001u}, {0x3b9aca0000000000u,0x0000000000000001u},
+    {0x2540be4000000000u,0x0000000000000001u}, {0x2e90edd000000000u,0x0000000000000001u},
+    {0x3a35294400000000u,0x0000000000000001u}, {0x246139ca80000000u,0x0000000000000001u},
+    {0x2d79883d20000000u,0x0000000000000001u}, {0x38d7ea4c68000000u,0x0000000000000001u},
+    {0x2386f26fc1000000u,0x0000000000000001u}, {0x2c68af0bb1400000u,0x0000000000000001u},
+    {0x3782dace9d900000u,0x0000000000000001u}, {0x22b1c8c1227a0000u,0x0000000000000001u},
+    {0x2b5e3af16b188000u,0x0000000000000001u}, {0x3635c9adc5dea000u,0x0000000000000001u},
+    {0x21e19e0c9bab2400u,0x0000000000000001u}, {0x2a5a058fc295ed00u,0x0000000000000001u},
+    {0x34f086f3b33b6840u,0x0000000000000001u}, {0x2116545850052128u,0x0000000000000001u},
+    {0x295be96e64066972u,0x0000000000000001u}, {0x33b2e3c9fd0803ceu,0x8000000000000001u},
+    {0x204fce5e3e250261u,0x1000000000000001u}, {0x2863c1f5cdae42f9u,0x5400000000000001u},
+    {0x327cb2734119d3b7u,0xa900000000000001u}, {0x3f1bdf10116048a5u,0x9340000000000001u},
+    {0x27716b6a0adc2d67u,0x7c08000000000001u}, {0x314dc6448d9338c1u,0x5b0a000000000001u},
+    {0x3da137d5b0f806f1u,0xb1cc800000000001u}, {0x2684c2e58e9b0457u,0x0f1fd00000000001u},
+    {0x3025f39ef241c56cu,0xd2e7c40000000001u}, {0x3c2f7086aed236c8u,0x07a1b50000000001u},
+    {0x259da6542d43623du,0x04c5112000000001u}, {0x2f050fe938943accu,0x45f6556800000001u},
+    {0x3ac653e386b9497fu,0x5773eac200000001u}, {0x24bbf46e3433cdefu,0x96a872b940000001u},
+    {0x2deaf189c140c16bu,0x7c528f6790000001u}, {0x3965adec3190f1c6u,0x5b67334174000001u},
+    {0x23df8cb39efa971bu,0xf9208008e8800001u}, {0x2cd76fe086b93ce2u,0xf768a00b22a00001u},
+    {0x380d4bd8a8678c1bu,0xb542c80deb480001u}, {0x23084f676940b791u,0x5149bd08b30d0001u},
+    {0x2bca63414390e575u,0xa59c2c4adfd04001u}, {0x36bcfc1194751ed3u,0x0f03375d97c45001u},
+    {0x22361d8afcc93343u,0xe962029a7edab201u}, {0x2ac3a4edbbfb8014u,0xe3ba83411e915e81u},
+    {0x35748e292afa601au,0x1ca924116635b621u}, {0x2168d8d9badc7c10u,0x51e9b68adfe191d5u},
+    {0x29c30f1029939b14u,0x6664242d97d9f64au}, {0x3433d2d433f881d9u,0x7ffd2d38fdd073dcu},
+    {0x20a063c4a07b5127u,0xeffe3c439ea2486au}, {0x28c87cb5c89a2571u,0xebfdcb54864ada84u},
+    {0x32fa9be33ac0aeceu,0x66fd3e29a7dd9125u}, {0x3fb942dc0970da82u,0x00bc8db411d4f56eu},
+    {0x27d3c9c985e68891u,0x4075d8908b251965u}, {0x31c8bc3be7602ab5u,0x90934eb4adee5fbeu},
+    {0x3e3aeb4ae1383562u,0xf4b82261d969f7adu}, {0x26e4d30eccc3215du,0xd8f3157d27e23accu},
+    {0x309e07d27ff3e9b5u,0x4f2fdadc71dac97fu}, {0x3cc589c71ff0e422u,0xa2fbd1938e517bdfu},
+    {0x25fb761c73f68e95u,0xa5dd62fc38f2ed6cu}, {0x2f7a53a390f4323bu,0x0f54bbbb472fa8c6u},
+    {0x3b58e88c75313ec9u,0xd329eaaa18fb92f8u}, {0x25179157c93ec73eu,0x23fa32aa4f9d3bdbu},
+    {0x2e5d75adbb8e790du,0xacf8bf54e3848ad2u}, {0x39f4d3192a721751u,0x1836ef2a1c65ad86u},
+    {0x243903efba874e92u,0xaf22557a51bf8c74u}, {0x2d4744eba9292237u,0x5aeaead8e62f6f91u},
+    {0x3899162693736ac5u,0x31a5a58f1fbb4b75u}, {0x235fadd81c2822bbu,0x3f07877973d50f29u},
+    {0x2c37994e23322b6au,0x0ec96957d0ca52f3u}, {0x37457fa1abfeb644u,0x927bc3adc4fce7b0u},
+    {0x228b6fc50b7f31eau,0xdb8d5a4c9b1e10ceu}, {0x2b2e4bb64e5efe65u,0x9270b0dfc1e59502u},
+    {0x35f9dea3e1f6bdfeu,0xf70cdd17b25efa42u}, {0x21bc2b266d3a36bfu,0x5a680a2ecf7b5c69u},
+    {0x2a2b35f00888c46fu,0x31020cba835a3384u}, {0x34b6036c0aaaf58au,0xfd428fe92430c065u},
+    {0x20f1c22386aad976u,0xde4999f1b69e783fu}, {0x292e32ac68558fd4u,0x95dc006e2446164fu},
+    {0x3379bf57826af3c9u,0xbb530089ad579be2u}, {0x202c1796b182d85eu,0x1513e0560c56c16eu},
+    {0x28371d7c5de38e75u,0x9a58d86b8f6c71c9u}, {0x3244e4db755c7213u,0x00ef0e8673478e3bu},
+    {0x3ed61e1252b38e97u,0xc12ad228101971c9u}, {0x2745d2cb73b0391eu,0xd8bac3590a0fe71eu},
+    {0x3117477e509c4766u,0x8ee9742f4c93e0e6u}, {0x3d5d195de4c35940u,0x32a3d13b1fb8d91fu},
+    {0x265a2fdaaefa17c8u,0x1fa662c4f3d387b3u}, {0x2ff0bbd15ab89dbau,0x278ffb7630c869a0u},
+    {0x3beceac5b166c528u,0xb173fa53bcfa8408u}, {0x257412bb8ee03b39u,0x6ee87c74561c9285u},
+    {0x2ed1176a72984a07u,0xcaa29b916ba3b726u}, {0x3a855d450f3e5c89u,0xbd4b4275c68ca4f0u},
+    {0x24935a4b2986f9d6u,0x164f09899c17e716u}, {0x2db830ddf3e8b84bu,0x9be2cbec031de0dcu},
+    {0x39263d1570e2e65eu,0x82db7ee703e55912u}, {0x23b7e62d668dcffbu,0x11c92f50626f57acu},
+    {0x2ca5dfb8c03143f9u,0xd63b7b247b0b2d96u}, {0x37cf57a6f03d94f8u,0x4bca59ed99cdf8fcu},
+    {0x22e196c856267d1bu,0x2f5e78348020bb9eu}, {0x2b99fc7a6bb01c61u,0xfb361641a028ea85u},
+    {0x36807b99069c237au,0x7a039bd208332526u}, {0x22104d3fa421962cu,0x8c424163451ff738u},
+    {0x2a94608f8d29fbb7u,0xaf52d1bc1667f506u}, {0x353978b370747aa5u,0x9b27862b1c01f247u},
+    {0x2143eb702648cca7u,0x80f8b3daf181376du}, {0x2994e64c2fdaffd1u,0x6136e0d1ade18548u},
+    {0x33fa1fdf3bd1bfc5u,0xb98499061959e699u}, {0x207c53eb856317dbu,0x93f2dfa3cfd83020u},
+    {0x289b68e666bbddd2u,0x78ef978cc3ce3c28u}, {0x32c24320006ad547u,0x172b7d6ff4c1cb32u},
+    {0x3f72d3e800858a98u,0xdcf65ccbf1f23dfeu}, {0x27a7c4710053769fu,0x8a19f9ff773766bfu},
+    {0x3191b58d40685447u,0x6ca0787f5505406fu}, {0x3df622f090826959u,0x47c8969f2a46908au},
+    {0x26b9d5d65a5181d7u,0xccdd5e237a6c1a57u}, {0x30684b4bf0e5e24du,0xc014b5ac590720ecu},
+    {0x3c825e1eed1f5ae1u,0x3019e3176f48e927u}, {0x25d17ad3543398ccu,0xbe102deea58d91b9u},
+    {0x2f45d98829407effu,0xed94396a4ef0f627u}, {0x3b174fea33909ebfu,0xe8f947c4e2ad33b0u},
+    {0x24ee91f2603a6337u,0xf19bccdb0dac404eu}, {0x2e2a366ef848fc05u,0xee02c011d1175062u},
+    {0x39b4c40ab65b3b07u,0x69837016455d247au}, {0x2410fa86b1f904e4u,0xa1f2260deb5a36ccu},
+    {0x2d1539285e77461du,0xca6eaf916630c47fu}, {0x385a8772761517a5u,0x3d0a5b75bfbcf59fu},
+    {0x233894a789cd2ec7u,0x4626792997d61984u}, {0x2c06b9d16c407a79u,0x17b01773fdcb9fe4u},
+    {0x37086845c7509917u,0x5d9c1d50fd3e87ddu}, {0x2265412b9c925faeu,0x9a8192529e4714ebu},
+    {0x2afe917683b6f79au,0x4121f6e745d8da25u}, {0x35be35d424a4b580u,0xd16a74a1174f10aeu},
+    {0x2196e1a496e6f170u,0x82e288e4ae916a6du}, {0x29fc9a0dbca0adccu,0xa39b2b1dda35c508u},
+    {0x347bc0912bc8d93fu,0xcc81f5e550c3364au}, {0x20cd585abb5d87c7u,0xdfd139af527a01efu},
+    {0x2900ae716a34e9b9u,0xd7c5881b2718826au}, {0x3340da0dc4c22428u,0x4db6ea21f0dea304u},
+    {0x200888489af95699u,0x30925255368b25e3u}, {0x280aaa5ac1b7ac3fu,0x7cb6e6ea842def5cu},
+    {0x320d54f17225974fu,0x5be4a0a525396b32u}, {0x3e90aa2dceaefd23u,0x32ddc8ce6e87c5ffu},
+    {0x271a6a5ca12d5e35u,0xffca9d810514dbbfu}, {0x30e104f3c978b5c3u,0x7fbd44e1465a12afu},
+    {0x3d194630bbd6e334u,0x5fac961997f0975bu}, {0x262fcbde75664e00u,0xbbcbddcffef65e99u},
+    {0x2fbbbed612bfe180u,0xeabed543feb3f63fu}, {0x3baaae8b976fd9e1u,0x256e8a94fe60f3cfu},
+    {0x254aad173ea5e82cu,0xb765169d1efc9861u}, {0x2e9d585d0e4f6237u,0xe53e5c4466bbbe7au},
+    {0x3a44ae7451e33ac5u,0xde8df355806aae18u}, {0x246aed08b32e04bbu,0xab18b8157042accfu},
+    {0x2d85a84adff985eau,0x95dee61acc535803u}, {0x38e7125d97f7e765u,0x3b569fa17f682e03u},
+    {0x23906b7a7efaf09fu,0x451623c4efa11cc2u}, {0x2c7486591eb9acc7u,0x165bacb62b8963f3u},
+    {0x3791a7ef666817f8u,0xdbf297e3b66bbcefu}, {0x22bb08f5a0010efbu,0x89779eee52035616u},
+    {0x2b69cb33080152bau,0x6bd586a9e6842b9bu}, {0x36443dffca01a769u,0x06cae85460253682u},
+    {0x21eaa6bfde4108a1u,0xa43ed134bc174211u}, {0x2a65506fd5d14acau,0x0d4e8581eb1d1295u},
+    {0x34fea48bcb459d7cu,0x90a226e265e4573bu}, {0x211f26d75f0b826du,0xda65584d7faeb685u},
+    {0x2966f08d36ce6309u,0x50feae60df9a6426u}, {0x33c0acb08481fbcbu,0xa53e59f91780fd2fu},
+    {0x20586bee52d13d5fu,0x4746f83baeb09e3eu}, {0x286e86e9e7858cb7u,0x1918b64a9a5cc5cdu},
+    {0x328a28a46166efe4u,0xdf5ee3dd40f3f740u}, {0x3f2cb2cd79c0abdeu,0x17369cd49130f510u},
+    {0x277befc06c186b6au,0xce822204dabe992au}, {0x315aebb0871e8645u,0x8222aa86116e3f75u},
+    {0x3db1a69ca8e627d6u,0xe2ab552795c9cf52u}, {0x268f0821e98fd8e6u,0x4dab1538bd9e2193u},
+    {0x3032ca2a63f3cf1fu,0xe115da86ed05a9f8u}, {0x3c3f7cb4fcf0c2e7u,0xd95b5128a8471476u},
+    {0x25a7adf11e1679d0u,0xe7d912b9692c6ccau}, {0x2f11996d659c1845u,0x21cf5767c37787fcu},
+    {0x3ad5ffc8bf031e56u,0x6a432d41b45569fbu}, {0x24c5bfdd7761f2f6u,0x0269fc4910b5623du},
+    {0x2df72fd4d53a6fb3u,0x83047b5b54e2baccu}, {0x3974fbca0a890ba0u,0x63c59a322a1b697fu},
+    {0x23e91d5e4695a744u,0x3e5b805f5a5121f0u}, {0x2ce364b5d83b1115u,0x4df2607730e56a6cu},
+    {0x381c3de34e49d55au,0xa16ef894fd1ec506u}, {0x2311a6ae10ee2558u,0xa4e55b5d1e333b24u},
+    {0x2bd610599529aeaeu,0xce1eb23465c009edu}, {0x36cb946ffa741a5au,0x81a65ec17f300c68u},
+    {0x223f3cc5fc889078u,0x9107fb38ef7e07c1u}, {0x2acf0bf77baab496u,0xb549fa072b5d89b1u},
+    {0x3582cef55a9561bcu,0x629c7888f634ec1eu}, {0x2171c159589d5d15u,0xbda1cb5599e11393u},
+    {0x29ce31afaec4b45bu,0x2d0a3e2b00595877u}, {0x3441be1b9a75e171u,0xf84ccdb5c06fae95u},
+    {0x20a916d14089ace7u,0x3b3000919845cd1du}, {0x28d35c8590ac1821u,0x09fc00b5fe574065u},
+    {0x330833a6f4d71e29u,0x4c7b00e37ded107eu}, {0x3fca4090b20ce5b3u,0x9f99c11c5d68549du},
+    {0x27de685a6f480f90u,0x43c018b1ba6134e2u}, {0x31d602710b1a1374u,0x54b01ede28f9821bu},
+    {0x3e4b830d4de09851u,0x69dc2695b337e2a1u}, {0x26ef31e850ac5f32u,0xe229981d9002eda5u},
+    {0x30aafe6264d776ffu,0x9ab3fe24f403a90eu}, {0x3cd5bdfafe0d54bfu,0x8160fdae31049351u},
+    {0x260596bcdec854f7u,0xb0dc9e8cdea2dc13u}, {0x2f86fc6c167a6a35u,0x9d13c630164b9318u},
+    {0x3b68bb871c1904c3u,0x0458b7bc1bde77ddu}, {0x25217534718fa2f9u,0xe2b772d5916b0aebu},
+    {0x2e69d2818df38bb8u,0x5b654f8af5c5cda5u}, {0x3a044721f1706ea6u,0x723ea36db337410eu},
+    {0x2442ac7536e64528u,0x07672624900288a9u}, {0x2d535792849fd672u,0x0940efadb4032ad3u},
+    {0x38a82d7725c7cc0eu,0x8b912b992103f588u}, {0x23691c6a779cdf89u,0x173abb3fb4a27975u},
+    {0x2c4363851584176bu,0x5d096a0fa1cb17d2u}, {0x37543c665ae51d46u,0x344bc4938a3dddc7u},
+    {0x2294a5bff8cf324bu,0xe0af5adc3666aa9cu}, {0x2b39cf2ff702fedeu,0xd8db319344005543u},
+    {0x360842fbf4c3be96u,0x8f11fdf815006a94u}, {0x21c529dd78fa571eu,0x196b3ebb0d20429du},
+    {0x2a367454d738ece5u,0x9fc60e69d0685344u}, {0x34c4116a0d07281fu,0x07b7920444826815u},
+    {0x20fa8ae248247913u,0x64d2bb42aad1810du}, {0x29392d9ada2d9758u,0x3e076a135585e150u},
+    {0x3387790190b8fd2eu,0x4d8944982ae759a4u}, {0x2034aba0fa739e3cu,0xf075cadf1ad09807u},
+    {0x2841d689391085ccu,0x2c933d96e184be08u}, {0x32524c2b8754a73fu,0x37b80cfc99e5ed8au},
+    {0x3ee6df366929d10fu,0x05a6103bc05f68edu}, {0x27504b8201ba22a9u,0x6387ca25583ba194u},
+    {0x31245e628228ab53u,0xbc69bcaeae4a89f9u}, {0x3d6d75fb22b2d628u,0xab842bda59dd2c77u},
+    {0x266469bcf5afc5d9u,0x6b329b68782a3bcbu}, {0x2ffd842c331bb74fu,0xc5ff42429634cabdu},
+    {0x3bfce5373fe2a523u,0xb77f12d33bc1fd6du}, {0x257e0f4287eda736u,0x52af6bc405593e64u},
+    {0x2edd931329e91103u,0xe75b46b506af8dfdu}, {0x3a94f7d7f4635544u,0xe1321862485b717cu},
+    {0x249d1ae6f8be154bu,0x0cbf4f3d6d3926eeu}, {0x2dc461a0b6ed9a9du,0xcfef230cc88770a9u},
+    {0x39357a08e4a90145u,0x43eaebcffaa94cd3u}, {0x23c16c458ee9a0cbu,0x4a72d361fca9d004u},
+    {0x2cb1c756f2a408feu,0x1d0f883a7bd44405u}, {0x37de392caf4d0b3du,0xa4536a491ac95506u},
+    {0x22eae3bbed902706u,0x86b4226db0bdd524u}, {0x2ba59caae8f430c8u,0x28612b091ced4a6du},
+    {0x368f03d5a3313cfau,0x327975cb64289d08u}, {0x2219626585fec61cu,0x5f8be99f1e996225u},
+    {0x2a9fbafee77e77a3u,0x776ee406e63fbaaeu}, {0x3547a9bea15e158cu,0x554a9d089fcfa95au},
+    {0x214cca1724dacd77u,0xb54ea22563e1c9d8u}, {0x299ffc9cee1180d5u,0xa2a24aaebcda3c4eu},
+    {0x3407fbc42995e10bu,0x0b4add5a6c10cb62u}, {0x2084fd5a99fdaca6u,0xe70eca58838a7f1du},
+    {0x28a63cb1407d17d0u,0xa0d27ceea46d1ee4u}, {0x32cfcbdd909c5dc4u,0xc9071c2a4d88669du},
+    {0x3f83bed4f4c37535u,0xfb48e334e0ea8045u}, {0x27b2574518fa2941u,0xbd0d8e010c92902bu},
+    {0x319eed165f38b392u,0x2c50f1814fb73436u}, {0x3e06a85bf706e076u,0xb7652de1a3a50143u},
+    {0x26c429397a644c4au,0x329f3cad064720cau}, {0x30753387d8fd5f5cu,0xbf470bd847d8e8fdu},
+    {0x3c928069cf3cb733u,0xef18cece59cf233cu}, {0x25db90422185f280u,0x756f8140f8217605u},
+    {0x2f527452a9e76f20u,0x92cb61913629d387u}, {0x3b27116754614ae8u,0xb77e39f583b44868u},
+    {0x24f86ae094bcced1u,0x72aee4397250ad41u}, {0x2e368598b9ec0285u,0xcf5a9d47cee4d891u},
+    {0x39c426fee8670327u,0x43314499c29e0eb6u}, {0x241a985f514061f8u,0x89fecae019a2c932u},
+    {0x2d213e7725907a76u,0xac7e7d98200b7b7eu}, {0x38698e14eef49914u,0x579e1cfe280e5a5du},
+    {0x2341f8cd1558dfacu,0xb6c2d21ed908f87bu}, {0x2c1277005aaf1797u,0xe47386a68f4b3699u},
+    {0x371714c0715add7du,0xdd906850331e043fu}, {0x226e6cf846d8ca6eu,0xaa7a41321ff2c2a8u},
+    {0x2b0a0836588efd0au,0x5518d17ea7ef7352u}, {0x35cc8a43eeb2bc4cu,0xea5f05de51eb5026u},
+    {0x219fd66a752fb5b0u,0x127b63aaf3331218u}, {0x2a07cc05127ba31cu,0x171a3c95afffd69eu},
+    {0x3489bf06571a8be3u,0x1ce0cbbb1bffcc45u}, {0x20d61763f670976du,0xf20c7f54f17fdfabu},
+    {0x290b9d3cf40cbd49u,0x6e8f9f2a2ddfd796u}, {0x334e848c310fec9bu,0xca3386f4b957cd7bu},
+    {0x201112d79ea9f3e1u,0x5e603458f3d6e06du}, {0x2815578d865470d9u,0xb5f8416f30cc9888u},
+    {0x321aad70e7e98d10u,0x237651cafcffbeaau}, {0x3ea158cd21e3f054u,0x2c53e63dbc3fae55u},
+    {0x2724d780352e7634u,0x9bb46fe695a7ccf5u}, {0x30ee0d60427a13c1u,0xc2a18be03b11c033u},
+    {0x3d2990b8531898b2u,0x3349eed849d6303fu}, {0x2639fa7333ef5f6fu,0x600e35472e25de28u},
+    {0x2fc8791000eb374bu,0x3811c298f9af55b1u}, {0x3bba97540126051eu,0x0616333f381b2b1eu},
+    {0x25549e9480b7c332u,0xc3cde0078310faf3u}, {0x2ea9c639a0e5b3ffu,0x74c1580963d539afu},
+    {0x3a5437c8091f20ffu,0x51f1ae0bbcca881bu}, {0x2474a2dd05b3749fu,0x93370cc755fe9511u},
+    {0x2d91cb94472051c7u,0x7804cff92b7e3a55u}, {0x38f63e7958e86639u,0x560603f7765dc8eau},
+    {0x2399e70bd7913fe3u,0xd5c3c27aa9fa9d93u}, {0x2c8060cecd758fdcu,0xcb34b319547944f7u},
+    {0x37a0790280d2f3d3u,0xfe01dfdfa9979635u}, {0x22c44ba19083d864u,0x7ec12bebc9febde1u},
+    {0x2b755e89f4a4ce7du,0x9e7176e6bc7e6d59u}, {0x3652b62c71ce021du,0x060dd4a06b9e08b0u},
+    {0x21f3b1dbc720c152u,0x23c8a4e44342c56eu}, {0x2a709e52b8e8f1a6u,0xacbace1d541376c9u},
+    {0x350cc5e767232e10u,0x57e981a4a918547bu}, {0x2127fbb0a075fccau,0x36f1f106e9af34cdu},
+    {0x2971fa9cc8937bfcu,0xc4ae6d48a41b0201u}, {0x33ce7943fab85afbu,0xf5da089acd21c281u},
+    {0x20610bca7cb338ddu,0x79a84560c0351991u}, {0x28794ebd1be00714u,0xd81256b8f0425ff5u},
+    {0x3297a26c62d808dau,0x0e16ec672c52f7f2u}, {0x3f3d8b077b8e0b10u,0x919ca780f767b5eeu},
+    {0x278676e4ad38c6eau,0x5b01e8b09aa0d1b5u}
+};
+
+static const char json_digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/* Writes the decimal digits of v (at most 20) to out, returns the count */
+static size_t json_format_u64(char *out, uint64_t v) {
+    char tmp[20];
+    size_t n = sizeof(tmp);
+    while (v >= 100) {
+        unsigned r = (unsigned)(v % 100);
+        v /= 100;
+        n -= 2;
+        memcpy(tmp + n, json_digit_pairs + 2 * r, 2);
+    }
+    if (v >= 10) { n -= 2; memcpy(tmp + n, json_digit_pairs + 2 * v, 2); }
+    else tmp[--n] = (char)('0' + v);
+    memcpy(out, tmp + n, sizeof(tmp) - n);
+    return sizeof(tmp) - n;
+}
+
+/* floor(q * log10(2)), floor(q * log10(3/4 * 2)) and floor(e * log2(10)) */
+static int json_flog10_pow2(int q) { return (int)(((int64_t)q * 661971961083LL) >> 41); }
+static int json_flog10_three_quarters_pow2(int q) { return (int)(((int64_t)q * 661971961083LL - 274743187321LL) >> 41); }
+static int json_flog2_pow10(int e) { return (int)(((int64_t)e * 913124641741LL) >> 38); }
+
+/* floor(g * cp / 2^127), with the low bit set when the result is inexact */
+static uint64_t json_round_to_odd(const uint64_t *g, uint64_t cp) {
+    uint64_t lo_lo, hi_lo;
+    uint64_t lo_hi = json_mul128(g[1], cp, &lo_lo);
+    uint64_t hi_hi = json_mul128(g[0], cp, &hi_lo);
+    uint64_t mid = hi_lo + lo_hi;
+    hi_hi += mid < lo_hi;
+    (void)lo_lo;
+    return (hi_hi << 1 | mid >> 63) | ((mid & 0x7fffffffffffffffu) != 0);
+}
+
+/* Shortest f * 10^e that rounds to the positive finite double with these bits */
+static uint64_t json_shortest_decimal(uint64_t bits, int *e10) {
+    const uint64_t hidden = (uint64_t)1 << 52;
+    int bq = (int)(bits >> 52);
+    uint64_t c = bits & (hidden - 1);
+    int q = bq ? bq - 1075 : -1074;
+    if (bq) c |= hidden;
+    else if (c < 3) {
+        /* The two smallest subnormals are below the scheme's precision */
+        *e10 = c == 1 ? -324 : -323;
+        return c == 1 ? 5 : 1;
+    }
+
+    uint64_t out = c & 1, cb = c << 2, cbr = cb + 2, cbl;
+    int k;
+    if (c != hidden || q == -1074) { cbl = cb - 2; k = json_flog10_pow2(q); }
+    else { cbl = cb - 1; k = json_flog10_three_quarters_pow2(q); }
+    int h = q + json_flog2_pow10(-k) + 2;
+    const uint64_t *g = json_pow10_126[-k - JSON_G_MIN];
+    uint64_t vb = json_round_to_odd(g, cb << h);
+    uint64_t vbl = json_round_to_odd(g, cbl << h);
+    uint64_t vbr = json_round_to_odd(g, cbr << h);
+
+    /* One digit fewer than the interval width allows, if it fits */
+    uint64_t s = vb >> 2;
+    *e10 = k;
+    if (s >= 10) {
+        uint64_t sp10 = s / 10 * 10, tp10 = sp10 + 10;
+        int upin = vbl + out <= sp10 << 2;
+        int wpin = (tp10 << 2) + out <= vbr;
+        if (upin != wpin) return upin ? sp10 : tp10;
+    }
+    /* Otherwise the closer of s and s + 1, ties to even */
+    uint64_t t = s + 1;
+    int uin = vbl + out <= s << 2;
+    int win = (t << 2) + out <= vbr;
+    if (uin != win) return uin ? s : t;
+    int64_t cmp = (int64_t)(vb - ((s + t) << 1));
+    return cmp < 0 || (cmp == 0 && !(s & 1)) ? s : t;
+}
+
+/* Writes the shortest round-trip text for a finite double (at most 25 bytes) */
+static size_t json_format_double(char *out, double d) {
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    size_t n = 0;
+    if (bits >> 63) { out[n++] = '-'; bits &= 0x7fffffffffffffffu; d = -d; }
+    if (d < 9007199254740992.0 && d == (double)(uint64_t)d)
+        return n + json_format_u64(out + n, (uint64_t)d);
+
+    int e;
+    uint64_t f = json_shortest_decimal(bits, &e);
+    while (f % 10 == 0) { f /= 10; e++; }
+    char dig[20];
+    int len = (int)json_format_u64(dig, f);
+    int point = len + e;
+    if (point > 0 && point <= 21) {
+        if (e >= 0) {
+            memcpy(out + n, dig, (size_t)len); n += (size_t)len;
+            memset(out + n, '0', (size_t)e); n += (size_t)e;
+        } else {
+            memcpy(out + n, dig, (size_t)point); n += (size_t)point;
+            out[n++] = '.';
+            memcpy(out + n, dig + point, (size_t)(len - point)); n += (size_t)(len - point);
+        }
+    } else if (point > -6 && point <= 0) {
+        out[n++] = '0';
+        out[n++] = '.';
+        memset(out + n, '0', (size_t)-point); n += (size_t)-point;
+        memcpy(out + n, dig, (size_t)len); n += (size_t)len;
+    } else {
+        out[n++] = dig[0];
+        if (len > 1) {
+            out[n++] = '.';
+            memcpy(out + n, dig + 1, (size_t)(len - 1)); n += (size_t)(len - 1);
+        }
+        out[n++] = 'e';
+        int x = point - 1;
+        if (x < 0) { out[n++] = '-'; x = -x; }
+        n += json_format_u64(out + n, (uint64_t)x);
+    }
+    return n;
+}
+
+// -----------------------------------------------------------------------------
+// Tree walks
+// -----------------------------------------------------------------------------
+//
+// Serialization, clone, equals, hashing and debug dumps visit the tree depth first
+// with an explicit stack of open containers: a few frames inline, the rest
+// on the heap, so nesting depth costs memory instead of C stack.
+
+#define JSON_WALK_INLINE 32
+
+typedef struct {
+    const fossil_media_json_value_t *v;     /* container being visited */
+    const fossil_media_json_value_t *peer;  /* equals: the container compared with v */
+    fossil_media_json_value_t *out;         /* clone: the copy being filled */
+    size_t next;                            /* next child */
+    int mode;                               /* per-walk detail (match by key, indent) */
+    uint64_t acc;                           /* hash: children folded so far */
+} json_walk_frame_t;
+
+typedef struct {
+    json_walk_frame_t *frames;
+    size_t depth, cap;
+    json_walk_frame_t inline_frames[JSON_WALK_INLINE];
+} json_walk_t;
+
+static void walk_init(json_walk_t *w) {
+    w->frames = w->inline_frames;
+    w->depth = 0;
+    w->cap = JSON_WALK_INLINE;
+}
+
+static void walk_release(json_walk_t *w) {
+    if (w->frames != w->inline_frames) fm_free(w->frames);
+}
+
+/* Push a zeroed frame for `v`; NULL when out of memory */
+static json_walk_frame_t *walk_push(json_walk_t *w, const fossil_media_json_value_t *v) {
+    if (w->depth == w->cap) {
+        json_walk_frame_t *tmp = fm_malloc(sizeof(*tmp) * w->cap * 2);
+        if (!tmp) return NULL;
+        memcpy(tmp, w->frames, sizeof(*tmp) * w->depth);
+        walk_release(w);
+        w->frames = tmp;
+        w->cap *= 2;
+    }
+    json_walk_frame_t *f = &w->frames[w->depth++];
+    memset(f, 0, sizeof(*f));
+    f->v = v;
+    return f;
+}
+
+static size_t walk_count(const fossil_media_json_value_t *v) {
+    if (v->type == FOSSIL_MEDIA_JSON_ARRAY) return v->u.array.count;
+    return v->type == FOSSIL_MEDIA_JSON_OBJECT ? v->u.object.count : 0;
+}
+
+static const fossil_media_json_value_t *walk_child(const fossil_media_json_value_t *v, size_t i) {
+    return v->type == FOSSIL_MEDIA_JSON_ARRAY ? v->u.array.items[i] : v->u.object.values[i];
+}
+
+// -----------------------------------------------------------------------------
+// Serialization
+// -----------------------------------------------------------------------------
+//
+// All output goes through json_out_t. Without a sink it is a growable buffer
+// (stringify); with a sink it is a fixed buffer handed to the sink each time
+// it fills, so a writer never needs a contiguous copy of the document.
+
+#define JSON_WRITER_BUFFER 65536
+
+typedef struct {
+    char *buf;
+    size_t len, cap;
+    size_t flushed;                     /* bytes already handed to the sink */
+    fossil_media_json_sink_fn sink;     /* NULL: grow buf instead of flushing */
+    void *user;
+    int failed;
+} json_out_t;
+
+static int out_flush(json_out_t *o) {
+    if (o->failed) return -1;
+    if (o->len && o->sink(o->user, o->buf, o->len) != 0) { o->failed = 1; return -1; }
+    o->flushed += o->len;
+    o->len = 0;
+    return 0;
+}
+
+/* Slow path of the writes below: make room for n more bytes */
+static int out_reserve(json_out_t *o, size_t n) {
+    if (o->failed) return -1;
+    if (o->sink) return out_flush(o);
+    size_t cap = o->cap ? o->cap : 256;
+    while (cap < o->len + n) cap *= 2;
+    char *p = fm_realloc(o->buf, cap);
+    if (!p) { o->failed = 1; return -1; }
+    o->buf = p;
+    o->cap = cap;
+    return 0;
+}
+
+static void out_write(json_out_t *o, const char *p, size_t n) {
+    if (o->len + n > o->cap) {
+        if (out_reserve(o, n) != 0) return;
+        if (n > o->cap) {
+            /* Larger than the sink buffer: pass straight through */
+            if (o->sink(o->user, p, n) != 0) o->failed = 1;
+            else o->flushed += n;
+            return;
+        }
+    }
+    memcpy(o->buf + o->len, p, n);
+    o->len += n;
+}
+
+static void out_byte(json_out_t *o, char ch) {
+    if (o->len == o->cap && out_reserve(o, 1) != 0) return;
+    o->buf[o->len++] = ch;
+}
+
+/* Escape letter for each control character; 'u' means \\u00XX */
+static const char json_ctl_escape[33] = "uuuuuuuubtnufruuuuuuuuuuuuuuuuuu";
+
+/* Quoted string; runs without escapes are copied in one piece */
+static void out_string(json_out_t *o, const char *s) {
+    static const char hex[] = "0123456789abcdef";
+    out_byte(o, '"');
+    for (;;) {
+        size_t n = json_plain_run(s, JSON_RUN_CTL);
+        out_write(o, s, n);
+        s += n;
+        unsigned char c = (unsigned char)*s++;
+        if (!c) break;
+        char esc[6] = {'\\', c < 0x20 ? json_ctl_escape[c] : (char)c, '0', '0', hex[c >> 4], hex[c & 15]};
+        out_write(o, esc, esc[1] == 'u' ? 6 : 2);
+    }
+    out_byte(o, '"');
+}
+
+static void out_integer(json_out_t *o, const fossil_media_json_value_t *v) {
+    if (o->cap - o->len < 24 && out_reserve(o, 24) != 0) return;
+    uint64_t mag = v->u.integer.exact.u64;
+    if (number_kind(v) == JSON_FLAG_INT64 && v->u.integer.exact.i64 < 0) {
+        o->buf[o->len++] = '-';
+        mag = 0 - mag;
+    }
+    o->len += json_format_u64(o->buf + o->len, mag);
+}
+
+static void out_number(json_out_t *o, double d) {
+    /* JSON has no spelling for NaN or infinity */
+    if (!isfinite(d)) { out_write(o, "null", 4); return; }
+    if (o->cap - o->len < 32 && out_reserve(o, 32) != 0) return;
+    o->len += json_format_double(o->buf + o->len, d);
+}
+
+// -----------------------------------------------------------------------------
+// Streaming writer
+// -----------------------------------------------------------------------------
+
+#define JSON_W_OBJECT   0x1     /* container is an object (else an array) */
+#define JSON_W_NONEMPTY 0x2     /* container has at least one member */
+
+struct fossil_media_json_writer {
+    json_out_t out;
+    int pretty;
+    unsigned char *stack;       /* JSON_W_* bits per open container */
+    size_t depth, stack_cap;
+    int after_key;              /* an object key is waiting for its value */
+    int done;                   /* the top-level value is complete */
+    int failed;
+    fossil_media_json_error_t err;
+    size_t threads;             /* > 1: split large containers across threads */
+    size_t split_min;           /* fewest children worth splitting */
+};
+
+static void writer_init(fossil_media_json_writer_t *w, fossil_media_json_sink_fn sink, void *user, int pretty) {
+    memset(w, 0, sizeof(*w));
+    w->out.sink = sink;
+    w->out.user = user;
+    w->pretty = pretty ? 1 : 0;
+}
+
+static int writer_fail(fossil_media_json_writer_t *w, const char *msg) {
+    if (!w->failed) {
+        set_error(&w->err, 1, w->out.flushed + w->out.len, "%s", msg);
+        w->failed = 1;
+    }
+    return -1;
+}
+
+/* Sticky result of the last call: output errors surface here */
+static int writer_status(fossil_media_json_writer_t *w) {
+    if (w->out.failed) return writer_fail(w, w->out.sink ? "Write failed" : "OOM");
+    return w->failed ? -1 : 0;
+}
+
+static void writer_indent(fossil_media_json_writer_t *w, size_t depth) {
+    out_byte(&w->out, '\n');
+    for (size_t d = 0; d < depth; ++d) out_byte(&w->out, '\t');
+}
+
+/* Separator and indentation ahead of a key, or of a value not following a key */
+static int writer_prefix(fossil_media_json_writer_t *w, int is_key) {
+    if (w->failed) return -1;
+    if (w->depth == 0) {
+        if (is_key) return writer_fail(w, "Key outside of an object");
+        return w->done ? writer_fail(w, "Multiple top-level values") : 0;
+    }
+    unsigned char *top = &w->stack[w->depth - 1];
+    if (*top & JSON_W_OBJECT) {
+        if (w->after_key) {
+            if (is_key) return writer_fail(w, "Expected value after key");
+            w->after_key = 0;
+            return 0;
+        }
+        if (!is_key) return writer_fail(w, "Expected key in object");
+    } else if (is_key) {
+        return writer_fail(w, "Key outside of an object");
+    }
+    if (*top & JSON_W_NONEMPTY) out_byte(&w->out, ',');
+    *top |= JSON_W_NONEMPTY;
+    if (w->pretty) writer_indent(w, w->depth);
+    return 0;
+}
+
+static int writer_scalar_done(fossil_media_json_writer_t *w) {
+    if (w->depth == 0) w->done = 1;
+    return writer_status(w);
+}
+
+static int writer_begin(fossil_media_json_writer_t *w, unsigned char kind, char open) {
+    if (writer_prefix(w, 0) != 0) return -1;
+    if (w->depth == w->stack_cap) {
+        size_t cap = w->stack_cap ? w->stack_cap * 2 : 32;
+        unsigned char *s = fm_realloc(w->stack, cap);
+        if (!s) return writer_fail(w, "OOM");
+        w->stack = s;
+        w->stack_cap = cap;
+    }
+    w->stack[w->depth++] = kind;
+    out_byte(&w->out, open);
+    return writer_status(w);
+}
+
+static int writer_end(fossil_media_json_writer_t *w, unsigned char kind, char close) {
+    if (w->failed) return -1;
+    if (w->depth == 0 || (w->stack[w->depth - 1] & JSON_W_OBJECT) != kind)
+        return writer_fail(w, "Mismatched end of container");
+    if (w->after_key) return writer_fail(w, "Expected value after key");
+    unsigned char top = w->stack[--w->depth];
+    if (w->pretty && (top & JSON_W_NONEMPTY)) writer_indent(w, w->depth);
+    out_byte(&w->out, close);
+    return writer_scalar_done(w);
+}
+
+static int writer_split(fossil_media_json_writer_t *w, const fossil_media_json_value_t *v);
+
+static int writer_emit(fossil_media_json_writer_t *w, const fossil_media_json_value_t *v) {
+    json_walk_t walk;
+    walk_init(&walk);
+    int rc = 0;
+    for (;;) {
+        if (!v) { rc = writer_fail(w, "NULL value"); break; }
+        switch (v->type) {
+            case FOSSIL_MEDIA_JSON_NULL:
+                rc = fossil_media_json_writer_null(w);
+                break;
+            case FOSSIL_MEDIA_JSON_BOOL:
+                rc = fossil_media_json_writer_bool(w, v->u.boolean);
+                break;
+            case FOSSIL_MEDIA_JSON_NUMBER:
+                if (!number_kind(v)) { rc = fossil_media_json_writer_number(w, v->u.number); break; }
+                if ((rc = writer_prefix(w, 0)) != 0) break;
+                out_integer(&w->out, v);
+                rc = writer_scalar_done(w);
+                break;
+            case FOSSIL_MEDIA_JSON_STRING:
+                rc = fossil_media_json_writer_string(w, v->u.string ? v->u.string : "");
+                break;
+            case FOSSIL_MEDIA_JSON_ARRAY:
+            case FOSSIL_MEDIA_JSON_OBJECT: {
+                int obj = v->type == FOSSIL_MEDIA_JSON_OBJECT;
+                rc = writer_begin(w, obj ? JSON_W_OBJECT : 0, obj ? '{' : '[');
+                if (rc == 0 && !walk_push(&walk, v)) rc = writer_fail(w, "OOM");
+                else if (rc == 0 && w->threads > 1 && walk_count(v) >= w->split_min) {
+                    /* Children written elsewhere; the frame is left only to close */
+                    rc = writer_split(w, v);
+                    walk.frames[walk.depth - 1].next = walk_count(v);
+                }
+                break;
+            }
+            default:
+                rc = writer_fail(w, "Invalid value type");
+                break;
+        }
+        if (rc != 0) break;
+
+        /* Next child of the innermost container, closing the finished ones */
+        int more = 0;
+        while (walk.depth && !more) {
+            json_walk_frame_t *f = &walk.frames[walk.depth - 1];
+            int obj = f->v->type == FOSSIL_MEDIA_JSON_OBJECT;
+            if (f->next < walk_count(f->v)) {
+                size_t i = f->next++;
+                if (obj && (rc = fossil_media_json_writer_key(w, f->v->u.object.keys[i])) != 0) break;
+                v = walk_child(f->v, i);
+                more = 1;
+            } else {
+                walk.depth--;
+                if ((rc = writer_end(w, obj ? JSON_W_OBJECT : 0, obj ? '}' : ']')) != 0) break;
+            }
+        }
+        if (rc != 0 || !more) break;
+    }
+    walk_release(&walk);
+    return rc;
+}
+
+// -----------------------------------------------------------------------------
+// Parallel serialization
+// -----------------------------------------------------------------------------
+//
+// A container with at least `split_min` children is cut into runs of
+// children, and workers write each run into its own buffer through a writer
+// whose stack is a copy of the main one, so separators and indentation come
+// out exactly as they would in place. The calling thread appends finished
+// runs in order, while at most `window` runs are written ahead of it.
+// Containers inside a run are written serially.
+
+#define JSON_SPLIT_MIN_ITEMS  4096      /* default split_min */
+#define JSON_SPLIT_CHUNKS     8         /* runs per thread */
+#define JSON_SPLIT_AHEAD      4         /* runs in flight per worker */
+#define JSON_SPLIT_THREADS    64
+
+typedef struct {
+    fossil_media_json_writer_t w;       /* the run's text is in w.out.buf */
+    int ready;
+} json_split_run_t;
+
+typedef struct {
+    const fossil_media_json_writer_t *parent;
+    const fossil_media_json_value_t *v;
+    size_t count, per_run, runs;
+    size_t claimed, delivered, window;
+    int stop;
+    json_split_run_t *ring;
+    json_mutex_t lock;
+    json_cond_t ready;                  /* a run finished */
+    json_cond_t room;                   /* the caller took a run */
+} json_split_t;
+
+static void split_write_run(const json_split_t *sp, json_split_run_t *r, size_t k) {
+    const fossil_media_json_writer_t *parent = sp->parent;
+    fossil_media_json_writer_t *w = &r->w;
+    writer_init(w, NULL, NULL, parent->pretty);
+    if (!(w->stack = fm_malloc(parent->depth))) { writer_fail(w, "OOM"); return; }
+    memcpy(w->stack, parent->stack, parent->depth);
+    w->depth = w->stack_cap = parent->depth;
+    if (k) w->stack[w->depth - 1] |= JSON_W_NONEMPTY;
+    int obj = sp->v->type == FOSSIL_MEDIA_JSON_OBJECT;
+    size_t end = (k + 1) * sp->per_run < sp->count ? (k + 1) * sp->per_run : sp->count;
+    for (size_t i = k * sp->per_run; i < end; ++i) {
+        if (obj && fossil_media_json_writer_key(w, sp->v->u.object.keys[i]) != 0) break;
+        if (writer_emit(w, walk_child(sp->v, i)) != 0) break;
+    }
+    writer_status(w);
+    fm_free(w->stack);
+    w->stack = NULL;
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI split_worker(LPVOID arg)
+#else
+static void *split_worker(void *arg)
+#endif
+{
+    json_split_t *sp = arg;
+    json_mutex_lock(&sp->lock);
+    for (;;) {
+        while (!sp->stop && sp->claimed < sp->runs && sp->claimed - sp->delivered >= sp->window)
+            json_cond_wait(&sp->room, &sp->lock);
+        if (sp->stop || sp->claimed >= sp->runs) break;
+        size_t k = sp->claimed++;
+        json_split_run_t *r = &sp->ring[k % sp->window];
+        json_mutex_unlock(&sp->lock);
+
+        split_write_run(sp, r, k);
+
+        json_mutex_lock(&sp->lock);
+        r->ready = 1;
+        json_cond_broadcast(&sp->ready);
+    }
+    json_mutex_unlock(&sp->lock);
+#if defined(_WIN32)
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+/* Append a finished run; a failure inside it is reported at its position */
+static int split_deliver(fossil_media_json_writer_t *w, json_split_run_t *r) {
+    int rc = 0;
+    if (r->w.failed) {
+        if (!w->failed) {
+            w->err = r->w.err;
+            w->err.position += w->out.flushed + w->out.len;
+            w->failed = 1;
+        }
+        rc = -1;
+    } else {
+        out_write(&w->out, r->w.out.buf, r->w.out.len);
+        rc = writer_status(w);
+    }
+    fm_free(r->w.out.buf);
+    r->w.out.buf = NULL;
+    r->ready = 0;
+    return rc;
+}
+
+/* Write every child of `v`, which writer_begin() has just opened */
+static int writer_split(fossil_media_json_writer_t *w, const fossil_media_json_value_t *v) {
+    json_split_t sp;
+    memset(&sp, 0, sizeof(sp));
+    sp.parent = w;
+    sp.v = v;
+    sp.count = walk_count(v);
+    size_t threads = w->threads;
+    sp.per_run = sp.count / (threads * JSON_SPLIT_CHUNKS);
+    if (sp.per_run == 0) sp.per_run = 1;
+    sp.runs = (sp.count + sp.per_run - 1) / sp.per_run;
+    if (threads > sp.runs) threads = sp.runs;
+    sp.window = threads * JSON_SPLIT_AHEAD;
+    if (!(sp.ring = fm_malloc(sizeof(*sp.ring) * sp.window))) return writer_fail(w, "OOM");
+    memset(sp.ring, 0, sizeof(*sp.ring) * sp.window);
+    json_mutex_init(&sp.lock);
+    json_cond_init(&sp.ready);
+    json_cond_init(&sp.room);
+
+    json_thread_t workers[JSON_SPLIT_THREADS];
+    size_t started = 0;
+    for (; started < threads; ++started) {
+#if defined(_WIN32)
+        if (!(workers[started] = CreateThread(NULL, 0, split_worker, &sp, 0, NULL))) break;
+#else
+        if (pthread_create(&workers[started], NULL, split_worker, &sp) != 0) break;
+#endif
+    }
+
+    int rc = 0;
+    if (started) {
+        json_mutex_lock(&sp.lock);
+        while (rc == 0 && sp.delivered < sp.runs) {
+            json_split_run_t *r = &sp.ring[sp.delivered % sp.window];
+            if (sp.delivered == sp.claimed || !r->ready) { json_cond_wait(&sp.ready, &sp.lock); continue; }
+            json_mutex_unlock(&sp.lock);
+            rc = split_deliver(w, r);
+            json_mutex_lock(&sp.lock);
+            sp.delivered++;
+            if (rc != 0) sp.stop = 1;
+            json_cond_broadcast(&sp.room);
+        }
+        json_mutex_unlock(&sp.lock);
+        for (size_t k = 0; k < started; ++k) {
+#if defined(_WIN32)
+            WaitForSingleObject(workers[k], INFINITE);
+            CloseHandle(workers[k]);
+#else
+            pthread_join(workers[k], NULL);
+#endif
+        }
+        for (; sp.delivered < sp.claimed; ++sp.delivered) fm_free(sp.ring[sp.delivered % sp.window].w.out.buf);
+    } else {
+        /* No threads available: the same runs, one after another */
+        for (size_t k = 0; rc == 0 && k < sp.runs; ++k) {
+            split_write_run(&sp, &sp.ring[0], k);
+            rc = split_deliver(w, &sp.ring[0]);
+        }
+    }
+    json_cond_destroy(&sp.room);
+    json_cond_destroy(&sp.ready);
+    json_mutex_destroy(&sp.lock);
+    fm_free(sp.ring);
+    if (rc == 0) w->stack[w->depth - 1] |= JSON_W_NONEMPTY;
+    return rc;
+}
+
+static void writer_set_parallel(fossil_media_json_writer_t *w, const fossil_media_json_parallel_options_t *opts) {
+    size_t threads = opts ? (opts->threads ? opts->threads : json_cpu_count()) : 1;
+    w->threads = threads > JSON_SPLIT_THREADS ? JSON_SPLIT_THREADS : threads;
+    w->split_min = opts && opts->min_items ? opts->min_items : JSON_SPLIT_MIN_ITEMS;
+}
+
+int fossil_media_json_sink_file(void *file, const char *data, size_t len) {
+    return fwrite(data, 1, len, (FILE *)file) == len ? 0 : -1;
+}
+
+fossil_media_json_writer_t *fossil_media_json_writer_create(fossil_media_json_sink_fn sink, void *user, int pretty) {
+    if (!sink) return NULL;
+    fossil_media_json_writer_t *w = fm_malloc(sizeof(*w));
+    if (!w) return NULL;
+    writer_init(w, sink, user, pretty);
+    w->out.buf = fm_malloc(JSON_WRITER_BUFFER);
+    if (!w->out.buf) { fm_free(w); return NULL; }
+    w->out.cap = JSON_WRITER_BUFFER;
+    return w;
+}
+
+int fossil_media_json_writer_begin_object(fossil_media_json_writer_t *w) {
+    return w ? writer_begin(w, JSON_W_OBJECT, '{') : -1;
+}
+
+int fossil_media_json_writer_end_object(fossil_media_json_writer_t *w) {
+    return w ? writer_end(w, JSON_W_OBJECT, '}') : -1;
+}
+
+int fossil_media_json_writer_begin_array(fossil_media_json_writer_t *w) {
+    return w ? writer_begin(w, 0, '[') : -1;
+}
+
+int fossil_media_json_writer_end_array(fossil_media_json_writer_t *w) {
+    return w ? writer_end(w, 0, ']') : -1;
+}
+
+int fossil_media_json_writer_key(fossil_media_json_writer_t *w, const char *key) {
+    if (!w) return -1;
+    if (!key) return writer_fail(w, "NULL key");
+    if (writer_prefix(w, 1) != 0) return -1;
+    out_string(&w->out, key);
+    out_byte(&w->out, ':');
+    if (w->pretty) out_byte(&w->out, '\t');
+    w->after_key = 1;
+    return writer_status(w);
+}
+
+int fossil_media_json_writer_string(fossil_media_json_writer_t *w, const char *s) {
+    if (!w) return -1;
+    if (!s) return writer_fail(w, "NULL string");
+    if (writer_prefix(w, 0) != 0) return -1;
+    out_string(&w->out, s);
+    return writer_scalar_done(w);
+}
+
+int fossil_media_json_writer_number(fossil_media_json_writer_t *w, double value) {
+    if (!w || writer_prefix(w, 0) != 0) return -1;
+    out_number(&w->out, value);
+    return writer_scalar_done(w);
+}
+
+int fossil_media_json_writer_int(fossil_media_json_writer_t *w, long long value) {
+    if (!w || writer_prefix(w, 0) != 0) return -1;
+    fossil_media_json_value_t tmp;
+    tmp.flags = 0;
+    set_int64(&tmp, value);
+    out_integer(&w->out, &tmp);
+    return writer_scalar_done(w);
+}
+
+int fossil_media_json_writer_uint(fossil_media_json_writer_t *w, unsigned long long value) {
+    if (!w || writer_prefix(w, 0) != 0) return -1;
+    fossil_media_json_value_t tmp;
+    tmp.flags = 0;
+    set_uint64(&tmp, value);
+    out_integer(&w->out, &tmp);
+    return writer_scalar_done(w);
+}
+
+int fossil_media_json_writer_bool(fossil_media_json_writer_t *w, int value) {
+    if (!w || writer_prefix(w, 0) != 0) return -1;
+    if (value) out_write(&w->out, "true", 4);
+    else out_write(&w->out, "false", 5);
+    return writer_scalar_done(w);
+}
+
+int fossil_media_json_writer_null(fossil_media_json_writer_t *w) {
+    if (!w || writer_prefix(w, 0) != 0) return -1;
+    out_write(&w->out, "null", 4);
+    return writer_scalar_done(w);
+}
+
+int fossil_media_json_writer_value(fossil_media_json_writer_t *w, const fossil_media_json_value_t *v) {
+    return w ? writer_emit(w, v) : -1;
+}
+
+int fossil_media_json_writer_set_parallel(fossil_media_json_writer_t *w,
+                                          const fossil_media_json_parallel_options_t *opts) {
+    if (!w) return -1;
+    writer_set_parallel(w, opts);
+    return 0;
+}
+
+int fossil_media_json_writer_flush(fossil_media_json_writer_t *w) {
+    if (!w || w->failed) return -1;
+    out_flush(&w->out);
+    return writer_status(w);
+}
+
+int fossil_media_json_writer_finish(fossil_media_json_writer_t *w, fossil_media_json_error_t *err_out) {
+    if (!w) return -1;
+    if (!w->failed && (w->depth || !w->done)) writer_fail(w, "Incomplete document");
+    if (!w->failed) fossil_media_json_writer_flush(w);
+    if (err_out) {
+        if (w->failed) *err_out = w->err;
+        else { err_out->code = 0; err_out->position = 0; err_out->message[0] = '\0'; }
+    }
+    return w->failed ? -1 : 0;
+}
+
+void fossil_media_json_writer_free(fossil_media_json_writer_t *w) {
+    if (!w) return;
+    fm_free(w->out.buf);
+    fm_free(w->stack);
+    fm_free(w);
+}
+
+char *fossil_media_json_stringify(const fossil_media_json_value_t *v, int pretty, fossil_media_json_error_t *err_out) {
+    return fossil_media_json_stringify_ex(v, pretty, NULL, err_out);
+}
+
+char *fossil_media_json_stringify_ex(const fossil_media_json_value_t *v, int pretty,
+                                     const fossil_media_json_parallel_options_t *opts,
+                                     fossil_media_json_error_t *err_out) {
+    fossil_media_json_error_t errtmp = {0,0,""};
+    if (!v) { set_error(&errtmp,1,0,"NULL value"); if (err_out) *err_out = errtmp; return NULL; }
+    /* A writer without a sink accumulates into one growing buffer */
+    fossil_media_json_writer_t w;
+    writer_init(&w, NULL, NULL, pretty);
+    writer_set_parallel(&w, opts);
+    int rc = writer_emit(&w, v);
+    fm_free(w.stack);
+    if (rc == 0) out_byte(&w.out, '\0');
+    if (rc != 0 || w.out.failed) {
+        fm_free(w.out.buf);
+        /* Report what the writer recorded, as the streaming writer would */
+        if (!w.failed) writer_status(&w);
+        if (err_out) *err_out = w.err;
+        return NULL;
+    }
+    if (err_out) *err_out = errtmp;
+    return w.out.buf;
+}
+
+char *fossil_media_json_roundtrip(const char *json_text, int pretty, fossil_media_json_error_t *err_out) {
+    fossil_media_json_error_t err = {0,0,""};
+    fossil_media_json_value_t *v = fossil_media_json_parse(json_text, &err);
+    if (!v) { if (err_out) *err_out = err; return NULL; }
+    char *s = fossil_media_json_stringify(v, pretty, &err);
+    fossil_media_json_free(v);
+    if (err_out) *err_out = err;
+    return s;
+}
+
+const char *fossil_media_json_type_name(fossil_media_json_type_t t) {
+    switch (t) {
+        case FOSSIL_MEDIA_JSON_NULL: return "null";
+        case FOSSIL_MEDIA_JSON_BOOL: return "bool";
+        case FOSSIL_MEDIA_JSON_NUMBER: return "number";
+        case FOSSIL_MEDIA_JSON_STRING: return "string";
+        case FOSSIL_MEDIA_JSON_ARRAY: return "array";
+        case FOSSIL_MEDIA_JSON_OBJECT: return "object";
+        default: return "unknown";
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Structural hashing
+// -----------------------------------------------------------------------------
+//
+// A 64-bit hash that agrees with fossil_media_json_equals(): numbers hash by
+// numeric value (1, 1.0 and 1e0 alike), arrays in order, and object members
+// in any order. Of duplicate keys only the first counts, as for lookups;
+// equals also compares the shadowed ones, which only makes it stricter.
+// Read-only (arena) containers keep their hash in the word in front of their
+// child slots once computed; mutable trees have no parent links to
+// invalidate such a cache, so they are hashed afresh on every call.
+
+#define JSON_HASH_K     0x9E3779B97F4A7C15ull
+#define JSON_HASH_NULL  0x6E756C6C00000001ull
+#define JSON_HASH_BOOL  0x626F6F6C00000002ull
+#define JSON_HASH_NUM   0x6E756D0000000003ull
+#define JSON_HASH_NEG   0x6E65670000000004ull
+#define JSON_HASH_REAL  0x7265616C00000005ull
+#define JSON_HASH_STR   0x7374720000000006ull
+#define JSON_HASH_KEY   0x6B65790000000007ull
+#define JSON_HASH_ARRAY 0x6172720000000008ull
+#define JSON_HASH_OBJ   0x6F626A0000000009ull
+
+/* splitmix64 finalizer */
+static uint64_t hash_mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+/* Bytes are read little-endian so the hash does not depend on the host */
+static uint64_t hash_bytes(const char *s, uint64_t seed) {
+    const unsigned char *p = (const unsigned char *)s;
+    size_t n = strlen(s);
+    uint64_t h = seed ^ ((uint64_t)n * JSON_HASH_K);
+    for (; n >= 8; p += 8, n -= 8) {
+        uint64_t w = 0;
+        for (int k = 7; k >= 0; --k) w = (w << 8) | p[k];
+        h = hash_mix(h ^ w) * JSON_HASH_K;
+    }
+    uint64_t w = 0;
+    while (n--) w = (w << 8) | p[n];
+    return hash_mix(h ^ w);
+}
+
+/* Integral doubles hash like the integer they equal */
+static uint64_t hash_number(const fossil_media_json_value_t *v) {
+    unsigned kind = number_kind(v);
+    if (kind == JSON_FLAG_UINT64) return hash_mix(JSON_HASH_NUM ^ v->u.integer.exact.u64);
+    if (kind == JSON_FLAG_INT64) {
+        int64_t i = v->u.integer.exact.i64;
+        return hash_mix((i < 0 ? JSON_HASH_NEG : JSON_HASH_NUM) ^ (uint64_t)i);
+    }
+    double d = v->u.number;
+    if (d >= -9223372036854775808.0 && d < 9223372036854775808.0 && (double)(int64_t)d == d) {
+        int64_t i = (int64_t)d;
+        return hash_mix((i < 0 ? JSON_HASH_NEG : JSON_HASH_NUM) ^ (uint64_t)i);
+    }
+    if (d >= 0 && d < 18446744073709551616.0 && (double)(uint64_t)d == d)
+        return hash_mix(JSON_HASH_NUM ^ (uint64_t)d);
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    return hash_mix(JSON_HASH_REAL ^ bits);
+}
+
+/* Hashes are never 0, which marks an empty cache slot */
+static uint64_t hash_final(uint64_t h) {
+    return h ? h : 1;
+}
+
+/* Scalars and empty containers */
+static uint64_t hash_leaf(const fossil_media_json_value_t *v) {
+    switch (v->type) {
+    case FOSSIL_MEDIA_JSON_NULL: return hash_final(hash_mix(JSON_HASH_NULL));
+    case FOSSIL_MEDIA_JSON_BOOL: return hash_final(hash_mix(JSON_HASH_BOOL + (v->u.boolean != 0)));
+    case FOSSIL_MEDIA_JSON_NUMBER: return hash_final(hash_number(v));
+    case FOSSIL_MEDIA_JSON_STRING: return hash_final(hash_bytes(v->u.string ? v->u.string : "", JSON_HASH_STR));
+    case FOSSIL_MEDIA_JSON_ARRAY: return hash_final(hash_mix(JSON_HASH_ARRAY));
+    case FOSSIL_MEDIA_JSON_OBJECT: return hash_final(hash_mix(JSON_HASH_OBJ));
+    default: return 1;
+    }
+}
+
+/* Cache word of a non-empty read-only container, else NULL */
+static uint64_t *hash_slot(const fossil_media_json_value_t *v) {
+    if (!JSON_IS_ARENA(v) || !walk_count(v)) return NULL;
+    return (uint64_t *)(void *)(v->type == FOSSIL_MEDIA_JSON_ARRAY ? v->u.array.items : v->u.object.values) - 1;
+}
+
+/* Cached hash, or 0. Concurrent readers may fill the same slot; they store the same value. */
+static uint64_t hash_peek(const fossil_media_json_value_t *v) {
+    uint64_t *slot = hash_slot(v);
+    if (!slot) return 0;
+#if defined(__GNUC__) || defined(__clang__)
+    return __atomic_load_n(slot, __ATOMIC_RELAXED);
+#else
+    return *(volatile uint64_t *)slot;
+#endif
+}
+
+static void hash_store(const fossil_media_json_value_t *v, uint64_t h) {
+    uint64_t *slot = hash_slot(v);
+    if (!slot) return;
+#if defined(__GNUC__) || defined(__clang__)
+    __atomic_store_n(slot, h, __ATOMIC_RELAXED);
+#else
+    *(volatile uint64_t *)slot = h;
+#endif
+}
+
+/* Fold the hash of child i into its parent's frame */
+static void hash_fold(json_walk_frame_t *f, size_t i, uint64_t h) {
+    if (f->v->type == FOSSIL_MEDIA_JSON_ARRAY) {
+        f->acc = hash_mix(f->acc + h) * JSON_HASH_K;
+    } else {
+        /* Members are summed, so their order does not matter */
+        f->acc += hash_mix(hash_bytes(f->v->u.object.keys[i], JSON_HASH_KEY) + h * JSON_HASH_K);
+    }
+}
+
+uint64_t fossil_media_json_hash(const fossil_media_json_value_t *v) {
+    if (!v) return 0;
+    if (!walk_count(v)) return hash_leaf(v);
+    uint64_t h = hash_peek(v);
+    if (h) return h;
+
+    json_walk_t walk;
+    walk_init(&walk);
+    walk_push(&walk, v);
+    while (walk.depth) {
+        json_walk_frame_t *f = &walk.frames[walk.depth - 1];
+        size_t n = walk_count(f->v);
+        if (f->next == n) {
+            const fossil_media_json_value_t *done = f->v;
+            uint64_t tag = done->type == FOSSIL_MEDIA_JSON_ARRAY ? JSON_HASH_ARRAY : JSON_HASH_OBJ;
+            h = hash_final(hash_mix(f->acc ^ tag));
+            hash_store(done, h);
+            if (--walk.depth == 0) break;
+            f = &walk.frames[walk.depth - 1];
+            hash_fold(f, f->next - 1, h);
+            continue;
+        }
+        size_t i = f->next++;
+        /* A shadowed duplicate key is invisible to lookups and to equals */
+        if (f->v->type == FOSSIL_MEDIA_JSON_OBJECT && object_find(f->v, f->v->u.object.keys[i]) != (ptrdiff_t)i)
+            continue;
+        const fossil_media_json_value_t *child = walk_child(f->v, i);
+        uint64_t ch = walk_count(child) ? hash_peek(child) : hash_leaf(child);
+        if (ch) {
+            hash_fold(f, i, ch);
+        } else if (!walk_push(&walk, child)) {
+            h = 0;
+            break;
+        }
+    }
+    walk_release(&walk);
+    return h;
+}
+
+// -----------------------------------------------------------------------------
+// Clone & Equality
+// -----------------------------------------------------------------------------
+
+/* Copy of one node; containers come back empty and are filled by the caller */
+static fossil_media_json_value_t *clone_node(const fossil_media_json_value_t *src) {
+    if (!src) return NULL;
+
+    fossil_media_json_value_t *copy = NULL;
+    switch (src->type) {
+    case FOSSIL_MEDIA_JSON_NULL:
+        copy = fossil_media_json_new_null();
+        break;
+    case FOSSIL_MEDIA_JSON_BOOL:
+        copy = fossil_media_json_new_bool(src->u.boolean);
+        break;
+    case FOSSIL_MEDIA_JSON_NUMBER:
+        copy = fossil_media_json_new_number(src->u.number);
+        if (copy && number_kind(src) == JSON_FLAG_INT64) set_int64(copy, src->u.integer.exact.i64);
+        else if (copy && number_kind(src) == JSON_FLAG_UINT64) set_uint64(copy, src->u.integer.exact.u64);
+        break;
+    case FOSSIL_MEDIA_JSON_STRING:
+        copy = fossil_media_json_new_string(src->u.string);
+        break;
+    case FOSSIL_MEDIA_JSON_ARRAY:
+        copy = fossil_media_json_new_array();
+        break;
+    case FOSSIL_MEDIA_JSON_OBJECT:
+        copy = fossil_media_json_new_object();
+        break;
+    default:
+        break;
+    }
+    return copy;
+}
+
+static fossil_media_json_value_t *fossil_media_json_clone_internal(const fossil_media_json_value_t *src) {
+    fossil_media_json_value_t *root = clone_node(src);
+    if (!root || !walk_count(src)) return root;
+
+    json_walk_t walk;
+    walk_init(&walk);
+    walk_push(&walk, src)->out = root;
+    while (walk.depth) {
+        json_walk_frame_t *f = &walk.frames[walk.depth - 1];
+        if (f->next == walk_count(f->v)) { walk.depth--; continue; }
+        size_t i = f->next++;
+        const fossil_media_json_value_t *child = walk_child(f->v, i);
+        fossil_media_json_value_t *copy = clone_node(child);
+        int rc = !copy ? -1
+               : f->v->type == FOSSIL_MEDIA_JSON_OBJECT ? fossil_media_json_object_set(f->out, f->v->u.object.keys[i], copy)
+               : fossil_media_json_array_append(f->out, copy);
+        if (rc != 0) fossil_media_json_free(copy);
+        /* A filled child is walked next; the copy is already in place */
+        if (rc == 0 && walk_count(child)) {
+            json_walk_frame_t *g = walk_push(&walk, child);
+            if (g) g->out = copy;
+            else rc = -1;
+        }
+        if (rc != 0) {
+            fossil_media_json_free(root);
+            root = NULL;
+            break;
+        }
+    }
+    walk_release(&walk);
+    return root;
+}
+
+fossil_media_json_value_t *
+fossil_media_json_clone(const fossil_media_json_value_t *src) {
+    return fossil_media_json_clone_internal(src);
+}
+
+/* Numeric equality that stays exact for integers beyond 2^53 */
+static int number_equals(const fossil_media_json_value_t *a, const fossil_media_json_value_t *b) {
+    unsigned ka = number_kind(a), kb = number_kind(b);
+    if (ka && kb) return ka == kb && a->u.integer.exact.u64 == b->u.integer.exact.u64;
+    if (a->u.number != b->u.number) return 0;
+    if (!ka && !kb) return 1;
+    /* Integer vs double: the double must be that very integer */
+    const fossil_media_json_value_t *i = ka ? a : b;
+    double d = ka ? b->u.number : a->u.number;
+    if ((ka | kb) == JSON_FLAG_UINT64) return d < 18446744073709551616.0 && (uint64_t)d == i->u.integer.exact.u64;
+    return d >= -9223372036854775808.0 && d < 9223372036854775808.0 && (int64_t)d == i->u.integer.exact.i64;
+}
+
+/* 0 = different, 1 = equal, 2 = containers of equal size whose children still need comparing */
+static int equals_node(const fossil_media_json_value_t *a, const fossil_media_json_value_t *b) {
+    if (!a || !b) return !a && !b;
+    if (a == b) return 1;
+    if (a->type != b->type) return 0;
+
+    switch (a->type) {
+    case FOSSIL_MEDIA_JSON_NULL:
+        return 1;
+    case FOSSIL_MEDIA_JSON_BOOL:
+        return a->u.boolean == b->u.boolean;
+    case FOSSIL_MEDIA_JSON_NUMBER:
+        return number_equals(a, b);
+    case FOSSIL_MEDIA_JSON_STRING:
+        if (!a->u.string && !b->u.string) return 1;
+        if (!a->u.string || !b->u.string) return 0;
+        return strcmp(a->u.string, b->u.string) == 0;
+    case FOSSIL_MEDIA_JSON_ARRAY:
+    case FOSSIL_MEDIA_JSON_OBJECT: {
+        if (walk_count(a) != walk_count(b)) return 0;
+        if (!walk_count(a)) return 1;
+        /* Hashes already cached on both sides settle most mismatches at once */
+        uint64_t ha = hash_peek(a), hb = ha ? hash_peek(b) : 0;
+        return ha && hb && ha != hb ? 0 : 2;
+    }
+    default:
+        break;
+    }
+    return 0;
+}
+
+/*
+ * Member of `obj` paired with member i of `of`: the same key, and among
+ * duplicates of that key the occurrence of the same rank. NULL if absent.
+ */
+static const fossil_media_json_value_t *object_peer(const fossil_media_json_value_t *of, size_t i,
+                                                    const fossil_media_json_value_t *obj) {
+    char **keys = of->u.object.keys;
+    const char *key = keys[i];
+    ptrdiff_t hit = object_find(obj, key);
+    if (hit < 0) return NULL;
+    size_t at = (size_t)object_find(of, key);
+    if (at == i) return obj->u.object.values[hit];
+    /* A shadowed duplicate: count its rank, then step to the same rank in obj */
+    size_t rank = 1;
+    for (size_t k = at + 1; k < i; ++k) rank += strcmp(keys[k], key) == 0;
+    for (size_t k = (size_t)hit + 1; k < obj->u.object.count; ++k)
+        if (strcmp(obj->u.object.keys[k], key) == 0 && --rank == 0) return obj->u.object.values[k];
+    return NULL;
+}
+
+int fossil_media_json_equals(const fossil_media_json_value_t *a,
+                             const fossil_media_json_value_t *b) {
+    if (!a && !b) return -1;
+    int rc = equals_node(a, b);
+    if (rc != 2) return rc;
+
+    json_walk_t walk;
+    walk_init(&walk);
+    json_walk_frame_t *f = walk_push(&walk, a);
+    f->peer = b;
+    rc = 1;
+    while (rc && walk.depth) {
+        f = &walk.frames[walk.depth - 1];
+        const fossil_media_json_value_t *x = f->v, *y = f->peer;
+        size_t n = walk_count(x), i = f->next++;
+        if (x->type == FOSSIL_MEDIA_JSON_OBJECT && i == 0) {
+            /* Same interned keys in the same order (homogeneous records): compare member-wise,
+               which pairs duplicates by rank exactly as the keyed path does */
+            size_t same = 0;
+            while (same < n && x->u.object.keys[same] == y->u.object.keys[same]) same++;
+            f->mode = same != n;
+        }
+        if (i == n) { walk.depth--; continue; }
+        const fossil_media_json_value_t *cx = walk_child(x, i), *cy;
+        if (!f->mode) {
+            cy = walk_child(y, i);
+        } else {
+            /* Match by key. The pairing is one-to-one and the counts are equal,
+               so every member of b is matched too */
+            cy = object_peer(x, i, y);
+            if (!cy) { rc = 0; break; }
+        }
+        rc = equals_node(cx, cy);
+        if (rc == 2) {
+            json_walk_frame_t *g = walk_push(&walk, cx);
+            if (!g) { rc = 0; break; }
+            g->peer = cy;
+            rc = 1;
+        }
+    }
+    walk_release(&walk);
+    return rc;
+}
+
+// -----------------------------------------------------------------------------
+// Type Helpers
+// -----------------------------------------------------------------------------
+
+int fossil_media_json_is_null(const fossil_media_json_value_t *v) {
+    return v && v->type == FOSSIL_MEDIA_JSON_NULL;
+}
+
+int fossil_media_json_is_array(const fossil_media_json_value_t *v) {
+    return v && v->type == FOSSIL_MEDIA_JSON_ARRAY;
+}
+
+int fossil_media_json_is_object(const fossil_media_json_value_t *v) {
+    return v && v->type == FOSSIL_MEDIA_JSON_OBJECT;
+}
+
+// -----------------------------------------------------------------------------
+// Memory & Capacity
+// -----------------------------------------------------------------------------
+
+int fossil_media_json_array_reserve(fossil_media_json_value_t *arr, size_t capacity) {
+    if (!arr || arr->type != FOSSIL_MEDIA_JSON_ARRAY || JSON_IS_ARENA(arr)) return -1;
+    if (capacity <= arr->u.array.capacity) return 0;
+
+    fossil_media_json_value_t **new_items =
+        fm_realloc(arr->u.array.items, capacity * sizeof(*new_items));
+    if (!new_items) return -1;
+
+    arr->u.array.items = new_items;
+    arr->u.array.capacity = capacity;
+    return 0;
+}
+
+int fossil_media_json_object_reserve(fossil_media_json_value_t *obj, size_t capacity) {
+    if (!obj || obj->type != FOSSIL_MEDIA_JSON_OBJECT || JSON_IS_ARENA(obj)) return -1;
+    if (capacity <= obj->u.object.capacity) return 0;
+
+    /* Store each block as soon as it moves: realloc has freed the old one */
+    char **new_keys = fm_realloc(obj->u.object.keys, capacity * sizeof(*new_keys));
+    if (!new_keys) return -1;
+    obj->u.object.keys = new_keys;
+    fossil_media_json_value_t **new_vals =
+        fm_realloc(obj->u.object.values, capacity * sizeof(*new_vals));
+    if (!new_vals) {
+        keymap_reserved(obj, obj->u.object.capacity);
+        return -1;
+    }
+    obj->u.object.values = new_vals;
+    obj->u.object.capacity = capacity;
+
+    /* Size the key index for the reserved members up front */
+    keymap_reserved(obj, capacity);
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+// File I/O
+// -----------------------------------------------------------------------------
+
+/* View of a whole file, mapped rather than copied where possible */
+typedef struct {
+    const char *data;
+    size_t len;
+#if defined(_WIN32)
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} json_map_t;
+
+/* A writable mapping is private: writes go to copy-on-write pages, never the file */
+static int json_map_open(json_map_t *m, const char *filename, int writable) {
+    memset(m, 0, sizeof(*m));
+#if defined(_WIN32)
+    m->file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                          FILE_ATTRIBUTE_NORMAL, NULL);
+    if (m->file == INVALID_HANDLE_VALUE) return -1;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m->file, &size) || size.QuadPart <= 0 || (unsigned long long)size.QuadPart > SIZE_MAX) {
+        CloseHandle(m->file);
+        return -1;
+    }
+    m->mapping = CreateFileMappingA(m->file, NULL, writable ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+    void *view = m->mapping ? MapViewOfFile(m->mapping, writable ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!view) {
+        if (m->mapping) CloseHandle(m->mapping);
+        CloseHandle(m->file);
+        return -1;
+    }
+    m->data = view;
+    m->len = (size_t)size.QuadPart;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 || (unsigned long long)st.st_size > SIZE_MAX) {
+        close(fd);
+        return -1;
+    }
+    void *view = mmap(NULL, (size_t)st.st_size, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                      MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) return -1;
+    m->data = view;
+    m->len = (size_t)st.st_size;
+#endif
+    return 0;
+}
+
+static void json_map_close(json_map_t *m) {
+    if (!m->data) return;
+#if defined(_WIN32)
+    UnmapViewOfFile(m->data);
+    CloseHandle(m->mapping);
+    CloseHandle(m->file);
+#else
+    munmap((void *)m->data, m->len);
+#endif
+    m->data = NULL;
+}
+
+static size_t json_page_size(void) {
+#if defined(_WIN32)
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return si.dwPageSize;
+#else
+    long n = sysconf(_SC_PAGESIZE);
+    return n > 0 ? (size_t)n : 4096;
+#endif
+}
+
+/*
+ * A whole file as one NUL-terminated string. The parser needs the terminator,
+ * and a mapping already has one whenever the file ends partway through its
+ * last page, since the rest of that page reads as zeros. Files that fill
+ * their last page exactly, and files that cannot be mapped, are read into a
+ * buffer instead.
+ */
+typedef struct {
+    json_map_t map;
+    char *buf;
+} json_file_text_t;
+
+static char *file_text_open(json_file_text_t *t, const char *filename, int writable) {
+    memset(t, 0, sizeof(*t));
+    if (json_map_open(&t->map, filename, writable) == 0) {
+        if (t->map.len % json_page_size() != 0) return (char *)t->map.data;
+        json_map_close(&t->map);
+    }
+    t->buf = fossil_media_read_file(filename, NULL);
+    return t->buf;
+}
+
+static void file_text_close(json_file_text_t *t) {
+    json_map_close(&t->map);
+    fm_free(t->buf);
+    t->buf = NULL;
+}
+
+static void file_text_release(void *t) {
+    file_text_close(t);
+    fm_free(t);
+}
+
+/*
+ * Parses straight from the mapping. Without PARSE_INSITU the document copies
+ * what it keeps and the mapping is gone before this returns; with it the
+ * mapping is copy-on-write, strings are terminated in place, and the arena
+ * owns the mapping until the document is freed.
+ */
+fossil_media_json_value_t *fossil_media_json_parse_file_ex(const char *filename,
+                                                           const fossil_media_json_parse_options_t *opts,
+                                                           fossil_media_json_error_t *err_out) {
+    fossil_media_json_error_t errtmp = {0,0,""};
+    if (!filename) { set_error(&errtmp,1,0,"NULL input"); if (err_out) *err_out = errtmp; return NULL; }
+    int insitu = opts && (opts->flags & FOSSIL_MEDIA_JSON_PARSE_INSITU);
+    json_file_text_t *t = fm_malloc(sizeof(*t));
+    if (!t) { set_error(&errtmp,1,0,"OOM"); if (err_out) *err_out = errtmp; return NULL; }
+    char *text = file_text_open(t, filename, insitu);
+    if (!text) {
+        fm_free(t);
+        set_error(&errtmp,1,0,"Cannot read file");
+        if (err_out) *err_out = errtmp;
+        return NULL;
+    }
+    fossil_media_json_value_t *v = parse_document(text, opts, insitu, err_out);
+    if (v && insitu) {
+        json_arena_t *a = arena_of_root(v);
+        a->release = file_text_release;
+        a->release_arg = t;
+    } else {
+        file_text_release(t);
+    }
+    return v;
+}
+
+fossil_media_json_value_t *
+fossil_media_json_parse_file(const char *filename, fossil_media_json_error_t *err_out) {
+    return fossil_media_json_parse_file_ex(filename, NULL, err_out);
+}
+
+int fossil_media_json_parse_ndjson_file(const char *filename,
+                                        const fossil_media_json_ndjson_options_t *opts,
+                                        fossil_media_json_ndjson_fn cb, void *user,
+                                        fossil_media_json_error_t *err_out) {
+    size_t size = 0;
+    char *buf = filename ? fossil_media_read_file(filename, &size) : NULL;
+    if (!buf) {
+        if (err_out) set_error(err_out, 1, 0, "Cannot read file");
+        return -1;
+    }
+    int rc = fossil_media_json_parse_ndjson(buf, size, opts, cb, user, err_out);
+    fm_free(buf);
+    return rc;
+}
+
+int fossil_media_json_write_file(const fossil_media_json_value_t *v,
+                                 const char *filename,
+                                 int pretty,
+                                 fossil_media_json_error_t *err_out) {
+    if (!filename || !v) return -1;
+    FILE *f = fopen(filename, "wb");
+    if (!f) return -1;
+
+    /* Stream straight to the file through the writer's fixed buffer */
+    fossil_media_json_writer_t *w = fossil_media_json_writer_create(fossil_media_json_sink_file, f, pretty);
+    if (!w) {
+        fclose(f);
+        return -1;
+    }
+    int rc = fossil_media_json_writer_value(w, v);
+    rc = fossil_media_json_writer_finish(w, err_out) != 0 ? -1 : rc;
+    fossil_media_json_writer_free(w);
+    if (fclose(f) != 0) rc = -1;
+    return rc;
+}
+
+// -----------------------------------------------------------------------------
+// Binary tape
+// -----------------------------------------------------------------------------
+//
+// A tape is a tree flattened into an array of 64-bit words plus a pool of
+// NUL-terminated strings, after a 32-byte header. Each word has a tag in its
+// top byte and a 56-bit payload:
+//
+//   'n' 't' 'f'   null, true, false
+//   'd' 'l' 'u'   double, int64, uint64; the next word holds the bits
+//   's' 'k'       string value, object key; payload = pool offset, next
+//                 word = length
+//   '[' '{'       payload = index of the matching close word
+//   ']' '}'       payload = element or member count
+//
+// An object member is its 'k' pair followed by the value. Every position is
+// relative, so a tape works wherever it is mapped, and skipping a container
+// is one jump to its close word. Identical strings share one pool entry.
+// Loading checks only the header; every read is bounds-checked instead, so a
+// damaged tape gives failed lookups rather than stray reads. Tapes use the
+// host byte order and are rejected on hosts with a different one.
+
+#define JSON_TAPE_HEADER   32
+#define JSON_TAPE_VERSION  1u
+#define JSON_TAPE_ORDER    0x01020304u
+#define JSON_TAPE_PAYLOAD  0x00FFFFFFFFFFFFFFull
+
+#define TAPE_WORD(tag, payload) (((uint64_t)(tag) << 56) | (uint64_t)(payload))
+#define TAPE_TAG(w)             ((int)((w) >> 56))
+
+struct fossil_media_json_tape {
+    const char *words;   /* `count` words, not necessarily aligned */
+    size_t count;
+    const char *pool;
+    size_t pool_len;
+    json_map_t map;      /* backing file for fossil_media_json_tape_open() */
+};
+
+typedef struct {
+    size_t off;          /* pool offset plus one, 0 = empty slot */
+    size_t len;
+    uint32_t hash;
+} json_tape_str_t;
+
+typedef struct {
+    uint64_t *words;
+    size_t count, cap;
+    char *pool;
+    size_t pool_len, pool_cap;
+    json_tape_str_t *strs;   /* pooled strings, open addressing */
+    size_t strs_mask, strs_count;
+    int oom;
+} json_tape_enc_t;
+
+typedef struct {
+    const fossil_media_json_value_t *v;
+    size_t next;         /* next child to emit */
+    size_t open;         /* index of the open word, patched at the close */
+} json_tape_frame_t;
+
+static void tape_emit(json_tape_enc_t *e, uint64_t w) {
+    if (e->oom) return;
+    if (e->count == e->cap) {
+        size_t cap = e->cap ? e->cap * 2 : 256;
+        uint64_t *tmp = fm_realloc(e->words, cap * sizeof(*tmp));
+        if (!tmp) { e->oom = 1; return; }
+        e->words = tmp;
+        e->cap = cap;
+    }
+    e->words[e->count++] = w;
+}
+
+static int tape_strs_grow(json_tape_enc_t *e) {
+    size_t slots = e->strs ? (e->strs_mask + 1) * 2 : 256;
+    json_tape_str_t *tmp = fm_malloc(slots * sizeof(*tmp));
+    if (!tmp) return -1;
+    memset(tmp, 0, slots * sizeof(*tmp));
+    for (size_t i = 0; e->strs && i <= e->strs_mask; ++i) {
+        if (!e->strs[i].off) continue;
+        size_t at = e->strs[i].hash & (slots - 1);
+        while (tmp[at].off) at = (at + 1) & (slots - 1);
+        tmp[at] = e->strs[i];
+    }
+    fm_free(e->strs);
+    e->strs = tmp;
+    e->strs_mask = slots - 1;
+    return 0;
+}
+
+/* Pool offset of a string, storing each distinct string once */
+static size_t tape_intern(json_tape_enc_t *e, const char *s, size_t len) {
+    if (e->oom) return 0;
+    if ((!e->strs || (e->strs_count + 1) * 2 > e->strs_mask + 1) && tape_strs_grow(e) != 0) {
+        e->oom = 1;
+        return 0;
+    }
+    uint32_t h = keymap_hash_n(s, len);
+    size_t at = h & e->strs_mask;
+    for (; e->strs[at].off; at = (at + 1) & e->strs_mask) {
+        const json_tape_str_t *x = &e->strs[at];
+        if (x->hash == h && x->len == len && memcmp(e->pool + x->off - 1, s, len) == 0) return x->off - 1;
+    }
+    if (len + 1 > e->pool_cap - e->pool_len) {
+        size_t cap = e->pool_cap ? e->pool_cap : 4096;
+        while (len + 1 > cap - e->pool_len) cap *= 2;
+        char *tmp = fm_realloc(e->pool, cap);
+        if (!tmp) { e->oom = 1; return 0; }
+        e->pool = tmp;
+        e->pool_cap = cap;
+    }
+    size_t off = e->pool_len;
+    memcpy(e->pool + off, s, len);
+    e->pool[off + len] = '\0';
+    e->pool_len += len + 1;
+    e->strs[at].off = off + 1;
+    e->strs[at].len = len;
+    e->strs[at].hash = h;
+    e->strs_count++;
+    return off;
+}
+
+static void tape_emit_string(json_tape_enc_t *e, int tag, const char *s) {
+    if (!s) s = "";
+    size_t len = strlen(s);
+    tape_emit(e, TAPE_WORD(tag, tape_intern(e, s, len)));
+    tape_emit(e, (uint64_t)len);
+}
+
+static void tape_emit_scalar(json_tape_enc_t *e, const fossil_media_json_value_t *v) {
+    uint64_t bits;
+    switch (v ? v->type : FOSSIL_MEDIA_JSON_NULL) {
+    case FOSSIL_MEDIA_JSON_BOOL:
+        tape_emit(e, TAPE_WORD(v->u.boolean ? 't' : 'f', 0));
+        break;
+    case FOSSIL_MEDIA_JSON_NUMBER:
+        if (number_kind(v) == JSON_FLAG_INT64) {
+            tape_emit(e, TAPE_WORD('l', 0));
+            bits = (uint64_t)v->u.integer.exact.i64;
+        } else if (number_kind(v) == JSON_FLAG_UINT64) {
+            tape_emit(e, TAPE_WORD('u', 0));
+            bits = v->u.integer.exact.u64;
+        } else {
+            tape_emit(e, TAPE_WORD('d', 0));
+            memcpy(&bits, &v->u.number, sizeof(bits));
+        }
+        tape_emit(e, bits);
+        break;
+    case FOSSIL_MEDIA_JSON_STRING:
+        tape_emit_string(e, 's', v->u.string);
+        break;
+    default:
+        tape_emit(e, TAPE_WORD('n', 0));
+        break;
+    }
+}
+
+/* Depth-first walk with an explicit stack, so deep trees cannot overflow it */
+static int tape_encode(json_tape_enc_t *e, const fossil_media_json_value_t *root) {
+    json_tape_frame_t *stack = NULL;
+    size_t depth = 0, cap = 0;
+    const fossil_media_json_value_t *v = root;
+    int pending = 1;
+    while (!e->oom) {
+        if (pending) {
+            pending = 0;
+            if (v && (v->type == FOSSIL_MEDIA_JSON_ARRAY || v->type == FOSSIL_MEDIA_JSON_OBJECT)) {
+                if (depth == cap) {
+                    size_t n = cap ? cap * 2 : 32;
+                    json_tape_frame_t *tmp = fm_realloc(stack, n * sizeof(*tmp));
+                    if (!tmp) { e->oom = 1; break; }
+                    stack = tmp;
+                    cap = n;
+                }
+                stack[depth].v = v;
+                stack[depth].next = 0;
+                stack[depth].open = e->count;
+                depth++;
+                tape_emit(e, 0);
+            } else {
+                tape_emit_scalar(e, v);
+            }
+        }
+        if (!depth) break;
+        json_tape_frame_t *f = &stack[depth - 1];
+        int obj = f->v->type == FOSSIL_MEDIA_JSON_OBJECT;
+        size_t n = obj ? f->v->u.object.count : f->v->u.array.count;
+        if (f->next < n) {
+            size_t i = f->next++;
+            if (obj) tape_emit_string(e, 'k', f->v->u.object.keys[i]);
+            v = obj ? f->v->u.object.values[i] : f->v->u.array.items[i];
+            pending = 1;
+        } else {
+            if (!e->oom) e->words[f->open] = TAPE_WORD(obj ? '{' : '[', e->count);
+            tape_emit(e, TAPE_WORD(obj ? '}' : ']', n));
+            depth--;
+        }
+    }
+    fm_free(stack);
+    return e->oom ? -1 : 0;
+}
+
+void *fossil_media_json_tape_encode(const fossil_media_json_value_t *v, size_t *len_out,
+                                    fossil_media_json_error_t *err_out) {
+    fossil_media_json_error_t errtmp = {0,0,""};
+    if (!v) { set_error(&errtmp,1,0,"NULL value"); if (err_out) *err_out = errtmp; return NULL; }
+    json_tape_enc_t e;
+    memset(&e, 0, sizeof(e));
+    char *out = NULL;
+    if (tape_encode(&e, v) == 0) {
+        size_t total = JSON_TAPE_HEADER + e.count * sizeof(uint64_t) + e.pool_len;
+        out = fm_malloc(total);
+        if (out) {
+            uint32_t head[4] = { 0, JSON_TAPE_ORDER, JSON_TAPE_VERSION, 0 };
+            uint64_t sizes[2] = { e.count, e.pool_len };
+            memcpy(head, "FMJT", 4);
+            memcpy(out, head, sizeof(head));
+            memcpy(out + 16, sizes, sizeof(sizes));
+            memcpy(out + JSON_TAPE_HEADER, e.words, e.count * sizeof(uint64_t));
+            if (e.pool_len) memcpy(out + JSON_TAPE_HEADER + e.count * sizeof(uint64_t), e.pool, e.pool_len);
+            if (len_out) *len_out = total;
+        }
+    }
+    fm_free(e.words);
+    fm_free(e.pool);
+    fm_free(e.strs);
+    if (!out) set_error(&errtmp, 1, 0, "OOM");
+    if (err_out) *err_out = errtmp;
+    return out;
+}
+
+int fossil_media_json_tape_write_file(const fossil_media_json_value_t *v, const char *filename,
+                                      fossil_media_json_error_t *err_out) {
+    size_t len = 0;
+    if (!filename) {
+        if (err_out) set_error(err_out, 1, 0, "NULL input");
+        return -1;
+    }
+    void *tape = fossil_media_json_tape_encode(v, &len, err_out);
+    if (!tape) return -1;
+    FILE *f = fopen(filename, "wb");
+    int rc = f && fwrite(tape, 1, len, f) == len ? 0 : -1;
+    if (f && fclose(f) != 0) rc = -1;
+    fm_free(tape);
+    if (rc != 0 && err_out) set_error(err_out, 1, 0, "Cannot write file");
+    return rc;
+}
+
+static uint64_t tape_at(const fossil_media_json_tape_t *t, size_t i) {
+    uint64_t w;
+    memcpy(&w, t->words + i * sizeof(w), sizeof(w));
+    return w;
+}
+
+static fossil_media_json_tape_ref_t tape_ref(const fossil_media_json_tape_t *t, size_t pos) {
+    fossil_media_json_tape_ref_t r;
+    r.tape = t;
+    r.pos = pos;
+    return r;
+}
+
+/* Words taken by the value at `pos`, or 0 if it is malformed or runs past `limit` */
+static size_t tape_width(const fossil_media_json_tape_t *t, size_t pos, size_t limit) {
+    if (pos >= limit) return 0;
+    uint64_t w = tape_at(t, pos);
+    switch (TAPE_TAG(w)) {
+    case 'n': case 't': case 'f':
+        return 1;
+    case 'd': case 'l': case 'u': case 's':
+        return pos + 1 < limit ? 2 : 0;
+    case '[': case '{': {
+        uint64_t end = w & JSON_TAPE_PAYLOAD;
+        if (end <= pos || end >= limit) return 0;
+        int close = TAPE_TAG(w) == '[' ? ']' : '}';
+        return TAPE_TAG(tape_at(t, (size_t)end)) == close ? (size_t)end - pos + 1 : 0;
+    }
+    default:
+        return 0;
+    }
+}
+
+/* Pool string of the 's'/'k' pair at `pos` (pos + 1 must be on the tape) */
+static const char *tape_str(const fossil_media_json_tape_t *t, size_t pos, size_t *len_out) {
+    uint64_t off = tape_at(t, pos) & JSON_TAPE_PAYLOAD, len = tape_at(t, pos + 1);
+    if (off >= t->pool_len || len >= t->pool_len - off || t->pool[off + len] != '\0') return NULL;
+    if (len_out) *len_out = (size_t)len;
+    return t->pool + off;
+}
+
+/* Contents [begin, end) of the container at `r` if it opens with `open` */
+static int tape_span(fossil_media_json_tape_ref_t r, int open, size_t *begin, size_t *end) {
+    if (!r.tape || r.pos >= r.tape->count || TAPE_TAG(tape_at(r.tape, r.pos)) != open) return 0;
+    size_t w = tape_width(r.tape, r.pos, r.tape->count);
+    if (!w) return 0;
+    *begin = r.pos + 1;
+    *end = r.pos + w - 1;
+    return 1;
+}
+
+static fossil_media_json_tape_t *tape_attach(fossil_media_json_tape_t *t, const char *data, size_t len,
+                                             fossil_media_json_error_t *err) {
+    uint32_t head[4];
+    uint64_t sizes[2];
+    if (len < JSON_TAPE_HEADER) { set_error(err, 1, 0, "Truncated tape"); return NULL; }
+    memcpy(head, data, sizeof(head));
+    memcpy(sizes, data + 16, sizeof(sizes));
+    if (memcmp(data, "FMJT", 4) != 0) { set_error(err, 1, 0, "Not a JSON tape"); return NULL; }
+    if (head[1] != JSON_TAPE_ORDER) { set_error(err, 1, 4, "Tape byte order mismatch"); return NULL; }
+    if (head[2] != JSON_TAPE_VERSION) { set_error(err, 1, 8, "Unsupported tape version"); return NULL; }
+    size_t room = len - JSON_TAPE_HEADER;
+    if (sizes[0] == 0 || sizes[0] > room / sizeof(uint64_t) || sizes[1] != room - sizes[0] * sizeof(uint64_t)) {
+        set_error(err, 1, 16, "Truncated tape");
+        return NULL;
+    }
+    t->words = data + JSON_TAPE_HEADER;
+    t->count = (size_t)sizes[0];
+    t->pool = t->words + t->count * sizeof(uint64_t);
+    t->pool_len = (size_t)sizes[1];
+    if (tape_width(t, 0, t->count) != t->count) { set_error(err, 1, JSON_TAPE_HEADER, "Malformed tape"); return NULL; }
+    return t;
+}
+
+fossil_media_json_tape_t *fossil_media_json_tape_load(const void *data, size_t len,
+                                                      fossil_media_json_error_t *err_out) {
+    fossil_media_json_error_t errtmp = {0,0,""};
+    fossil_media_json_tape_t *t = NULL;
+    if (!data) set_error(&errtmp, 1, 0, "NULL input");
+    else if (!(t = fm_malloc(sizeof(*t)))) set_error(&errtmp, 1, 0, "OOM");
+    else {
+        memset(t, 0, sizeof(*t));
+        if (!tape_attach(t, data, len, &errtmp)) { fm_free(t); t = NULL; }
+    }
+    if (err_out) *err_out = errtmp;
+    return t;
+}
+
+fossil_media_json_tape_t *fossil_media_json_tape_open(const char *filename, fossil_media_json_error_t *err_out) {
+    fossil_media_json_error_t errtmp = {0,0,""};
+    fossil_media_json_tape_t *t = filename ? fm_malloc(sizeof(*t)) : NULL;
+    if (!t) {
+        set_error(&errtmp, 1, 0, filename ? "OOM" : "NULL input");
+    } else if (json_map_open(&t->map, filename, 0) != 0) {
+        set_error(&errtmp, 1, 0, "Cannot read file");
+        fm_free(t);
+        t = NULL;
+    } else if (!tape_attach(t, t->map.data, t->map.len, &errtmp)) {
+        json_map_close(&t->map);
+        fm_free(t);
+        t = NULL;
+    }
+    if (err_out) *err_out = errtmp;
+    return t;
+}
+
+void fossil_media_json_tape_close(fossil_media_json_tape_t *tape) {
+    if (!tape) return;
+    json_map_close(&tape->map);
+    fm_free(tape);
+}
+
+fossil_media_json_tape_ref_t fossil_media_json_tape_root(const fossil_media_json_tape_t *tape) {
+    return tape_ref(tape, 0);
+}
+
+fossil_media_json_type_t fossil_media_json_tape_type(fossil_media_json_tape_ref_t ref) {
+    if (!ref.tape || ref.pos >= ref.tape->count) return FOSSIL_MEDIA_JSON_NULL;
+    switch (TAPE_TAG(tape_at(ref.tape, ref.pos))) {
+    case 't': case 'f': return FOSSIL_MEDIA_JSON_BOOL;
+    case 'd': case 'l': case 'u': return FOSSIL_MEDIA_JSON_NUMBER;
+    case 's': return FOSSIL_MEDIA_JSON_STRING;
+    case '[': return FOSSIL_MEDIA_JSON_ARRAY;
+    case '{': return FOSSIL_MEDIA_JSON_OBJECT;
+    default: return FOSSIL_MEDIA_JSON_NULL;
+    }
+}
+
+size_t fossil_media_json_tape_size(fossil_media_json_tape_ref_t ref) {
+    size_t begin, end;
+    if (!tape_span(ref, '[', &begin, &end) && !tape_span(ref, '{', &begin, &end)) return 0;
+    return (size_t)(tape_at(ref.tape, end) & JSON_TAPE_PAYLOAD);
+}
+
+fossil_media_json_tape_ref_t fossil_media_json_tape_index(fossil_media_json_tape_ref_t arr, size_t index) {
+    size_t p, end;
+    if (!tape_span(arr, '[', &p, &end)) return tape_ref(NULL, 0);
+    while (p < end) {
+        size_t w = tape_width(arr.tape, p, end);
+        if (!w) break;
+        if (index-- == 0) return tape_ref(arr.tape, p);
+        p += w;
+    }
+    return tape_ref(NULL, 0);
+}
+
+fossil_media_json_tape_ref_t fossil_media_json_tape_get(fossil_media_json_tape_ref_t obj, const char *key) {
+    size_t p, end;
+    if (!key || !tape_span(obj, '{', &p, &end)) return tape_ref(NULL, 0);
+    const fossil_media_json_tape_t *t = obj.tape;
+    size_t klen = strlen(key);
+    while (p + 2 < end && TAPE_TAG(tape_at(t, p)) == 'k') {
+        size_t w = tape_width(t, p + 2, end);
+        if (!w) break;
+        /* The length word screens out most members without touching the pool */
+        if (tape_at(t, p + 1) == klen) {
+            const char *k = tape_str(t, p, NULL);
+            if (k && memcmp(k, key, klen) == 0) return tape_ref(t, p + 2);
+        }
+        p += 2 + w;
+    }
+    return tape_ref(NULL, 0);
+}
+
+int fossil_media_json_tape_iter_init(fossil_media_json_tape_ref_t container, fossil_media_json_tape_iter_t *it) {
+    if (!it) return -1;
+    memset(it, 0, sizeof(*it));
+    if (tape_span(container, '[', &it->next, &it->end)) it->object = 0;
+    else if (tape_span(container, '{', &it->next, &it->end)) it->object = 1;
+    else return -1;
+    it->tape = container.tape;
+    return 0;
+}
+
+int fossil_media_json_tape_iter_next(fossil_media_json_tape_iter_t *it) {
+    if (!it) return 0;
+    const fossil_media_json_tape_t *t = it->tape;
+    size_t p = it->next, w = 0;
+    const char *key = NULL;
+    size_t key_len = 0;
+    if (t && p < it->end) {
+        if (!it->object) w = tape_width(t, p, it->end);
+        else if (p + 2 < it->end && TAPE_TAG(tape_at(t, p)) == 'k' && (key = tape_str(t, p, &key_len)))
+            w = tape_width(t, p += 2, it->end);
+    }
+    if (!w) {
+        it->value = tape_ref(NULL, 0);
+        it->key = NULL;
+        it->key_len = 0;
+        it->next = it->end;
+        return 0;
+    }
+    it->value = tape_ref(t, p);
+    it->key = key;
+    it->key_len = key_len;
+    it->next = p + w;
+    return 1;
+}
+
+const char *fossil_media_json_tape_get_string(fossil_media_json_tape_ref_t ref, size_t *len_out) {
+    if (!ref.tape || ref.pos + 1 >= ref.tape->count || TAPE_TAG(tape_at(ref.tape, ref.pos)) != 's') return NULL;
+    return tape_str(ref.tape, ref.pos, len_out);
+}
+
+/* Decode a number into a stack value so the DOM number accessors apply */
+static int tape_number(fossil_media_json_tape_ref_t ref, fossil_media_json_value_t *out) {
+    if (!ref.tape || ref.pos + 1 >= ref.tape->count) return -1;
+    uint64_t bits = tape_at(ref.tape, ref.pos + 1);
+    memset(out, 0, sizeof(*out));
+    out->type = FOSSIL_MEDIA_JSON_NUMBER;
+    switch (TAPE_TAG(tape_at(ref.tape, ref.pos))) {
+    case 'd': memcpy(&out->u.number, &bits, sizeof(bits)); return 0;
+    case 'l': set_int64(out, (int64_t)bits); return 0;
+    case 'u': set_uint64(out, bits); return 0;
+    default: return -1;
+    }
+}
+
+int fossil_media_json_tape_get_number(fossil_media_json_tape_ref_t ref, double *out) {
+    fossil_media_json_value_t n;
+    if (!out || tape_number(ref, &n) != 0) return -1;
+    *out = n.u.number;
+    return 0;
+}
+
+int fossil_media_json_tape_get_int(fossil_media_json_tape_ref_t ref, long long *out) {
+    fossil_media_json_value_t n;
+    if (tape_number(ref, &n) != 0) return -1;
+    return fossil_media_json_get_int(&n, out);
+}
+
+int fossil_media_json_tape_get_uint(fossil_media_json_tape_ref_t ref, unsigned long long *out) {
+    fossil_media_json_value_t n;
+    if (tape_number(ref, &n) != 0) return -1;
+    return fossil_media_json_get_uint(&n, out);
+}
+
+int fossil_media_json_tape_get_bool(fossil_media_json_tape_ref_t ref, int *out) {
+    if (!out || !ref.tape || ref.pos >= ref.tape->count) return -1;
+    int tag = TAPE_TAG(tape_at(ref.tape, ref.pos));
+    if (tag != 't' && tag != 'f') return -1;
+    *out = tag == 't';
+    return 0;
+}
+
+typedef struct {
+    fossil_media_json_value_t *v;
+    size_t end;          /* index of the close word */
+} json_tape_build_t;
+
+fossil_media_json_value_t *fossil_media_json_tape_to_value(fossil_media_json_tape_ref_t ref,
+                                                           fossil_media_json_error_t *err_out) {
+    fossil_media_json_error_t errtmp = {0,0,""};
+    const fossil_media_json_tape_t *t = ref.tape;
+    size_t end = t && ref.pos < t->count ? tape_width(t, ref.pos, t->count) : 0;
+    if (!end) { set_error(&errtmp,1,0,"Invalid tape reference"); if (err_out) *err_out = errtmp; return NULL; }
+    end += ref.pos;
+
+    /* One linear pass over the words; open containers wait on a stack */
+    json_tape_build_t *stack = NULL;
+    size_t depth = 0, cap = 0, p = ref.pos;
+    fossil_media_json_value_t *root = NULL;
+    while (p < end) {
+        json_tape_build_t *top = depth ? &stack[depth - 1] : NULL;
+        if (top && p == top->end) { depth--; p++; continue; }
+        size_t limit = top ? top->end : end;
+        const char *key = NULL;
+        if (top && top->v->type == FOSSIL_MEDIA_JSON_OBJECT) {
+            if (p + 2 >= limit || TAPE_TAG(tape_at(t, p)) != 'k' || !(key = tape_str(t, p, NULL))) {
+                set_error(&errtmp, 1, p, "Malformed tape");
+                break;
+            }
+            p += 2;
+        }
+        size_t w = tape_width(t, p, limit);
+        if (!w) { set_error(&errtmp, 1, p, "Malformed tape"); break; }
+
+        fossil_media_json_value_t *v = NULL;
+        const char *s;
+        switch (TAPE_TAG(tape_at(t, p))) {
+        case 'n': v = fossil_media_json_new_null(); break;
+        case 't': case 'f': v = fossil_media_json_new_bool(TAPE_TAG(tape_at(t, p)) == 't'); break;
+        case 'd': case 'l': case 'u':
+            v = fossil_media_json_new_number(0);
+            if (v) tape_number(tape_ref(t, p), v);
+            break;
+        case 's':
+            if (!(s = tape_str(t, p, NULL))) { set_error(&errtmp, 1, p, "Malformed tape"); goto fail; }
+            v = fossil_media_json_new_string(s);
+            break;
+        case '[': v = fossil_media_json_new_array(); break;
+        default: v = fossil_media_json_new_object(); break;
+        }
+        if (!v) { set_error(&errtmp, 1, p, "OOM"); break; }
+
+        int rc = 0;
+        if (!top) root = v;
+        else if (key) rc = fossil_media_json_object_set(top->v, key, v);
+        else rc = fossil_media_json_array_append(top->v, v);
+        if (rc != 0) { fossil_media_json_free(v); set_error(&errtmp, 1, p, "OOM"); break; }
+
+        if (v->type == FOSSIL_MEDIA_JSON_ARRAY || v->type == FOSSIL_MEDIA_JSON_OBJECT) {
+            if (depth == cap) {
+                size_t n = cap ? cap * 2 : 32;
+                json_tape_build_t *tmp = fm_realloc(stack, n * sizeof(*tmp));
+                if (!tmp) { set_error(&errtmp, 1, p, "OOM"); break; }
+                stack = tmp;
+                cap = n;
+            }
+            stack[depth].v = v;
+            stack[depth].end = p + w - 1;
+            depth++;
+            p++;
+        } else {
+            p += w;
+        }
+    }
+fail:
+    fm_free(stack);
+    if (errtmp.code) {
+        fossil_media_json_free(root);
+        root = NULL;
+    }
+    if (err_out) *err_out = errtmp;
+    return root;
+}
+
+// -----------------------------------------------------------------------------
+// Number Handling
+// -----------------------------------------------------------------------------
+
+fossil_media_json_value_t *fossil_media_json_new_int(long long i) {
+    fossil_media_json_value_t *v = fossil_media_json_new_number(0);
+    if (v) set_int64(v, i);
+    return v;
+}
+
+fossil_media_json_value_t *fossil_media_json_new_uint(unsigned long long u) {
+    fossil_media_json_value_t *v = fossil_media_json_new_number(0);
+    if (v) set_uint64(v, u);
+    return v;
+}
+
+int fossil_media_json_is_integer(const fossil_media_json_value_t *v) {
+    return v && v->type == FOSSIL_MEDIA_JSON_NUMBER && number_kind(v) != 0;
+}
+
+int fossil_media_json_get_int(const fossil_media_json_value_t *v, long long *out) {
+    if (!v || v->type != FOSSIL_MEDIA_JSON_NUMBER || !out) return -1;
+    unsigned kind = number_kind(v);
+    if (kind == JSON_FLAG_INT64) { *out = v->u.integer.exact.i64; return 0; }
+    if (kind == JSON_FLAG_UINT64) return -1;
+    double d = v->u.number;
+    if (!(d >= -9223372036854775808.0 && d < 9223372036854775808.0)) return -1;
+    *out = (long long)d;
+    return 0;
+}
+
+int fossil_media_json_get_uint(const fossil_media_json_value_t *v, unsigned long long *out) {
+    if (!v || v->type != FOSSIL_MEDIA_JSON_NUMBER || !out) return -1;
+    unsigned kind = number_kind(v);
+    if (kind == JSON_FLAG_UINT64) { *out = v->u.integer.exact.u64; return 0; }
+    if (kind == JSON_FLAG_INT64) {
+        if (v->u.integer.exact.i64 < 0) return -1;
+        *out = (unsigned long long)v->u.integer.exact.i64;
+        return 0;
+    }
+    double d = v->u.number;
+    if (!(d > -1.0 && d < 18446744073709551616.0)) return -1;
+    *out = (unsigned long long)d;
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+// Debug & Validation
+// -----------------------------------------------------------------------------
+
+static void dump_node(const fossil_media_json_value_t *v, int indent) {
+    if (!v) {
+        printf("%*s(null)\n", indent, "");
+        return;
+    }
+    const char *type = fossil_media_json_type_name(v->type);
+    printf("%*sType: %s\n", indent, "", type);
+
+    switch (v->type) {
+    case FOSSIL_MEDIA_JSON_BOOL:
+        printf("%*sValue: %s\n", indent + 2, "", v->u.boolean ? "true" : "false");
+        break;
+    case FOSSIL_MEDIA_JSON_NUMBER:
+        if (number_kind(v) == JSON_FLAG_INT64) printf("%*sValue: %lld\n", indent + 2, "", (long long)v->u.integer.exact.i64);
+        else if (number_kind(v) == JSON_FLAG_UINT64) printf("%*sValue: %llu\n", indent + 2, "", (unsigned long long)v->u.integer.exact.u64);
+        else printf("%*sValue: %g\n", indent + 2, "", v->u.number);
+        break;
+    case FOSSIL_MEDIA_JSON_STRING:
+        printf("%*sValue: \"%s\"\n", indent + 2, "", v->u.string ? v->u.string : "(null)");
+        break;
+    default:
+        break;
+    }
+}
+
+void fossil_media_json_debug_dump(const fossil_media_json_value_t *v, int indent) {
+    dump_node(v, indent);
+    if (!v || !walk_count(v)) return;
+    json_walk_t walk;
+    walk_init(&walk);
+    walk_push(&walk, v)->mode = indent;
+    while (walk.depth) {
+        json_walk_frame_t *f = &walk.frames[walk.depth - 1];
+        if (f->next == walk_count(f->v)) { walk.depth--; continue; }
+        size_t i = f->next++;
+        int at = f->mode;
+        if (f->v->type == FOSSIL_MEDIA_JSON_ARRAY) printf("%*s[%lu]\n", at + 2, "", (unsigned long)i);
+        else printf("%*s\"%s\":\n", at + 2, "", f->v->u.object.keys[i]);
+        const fossil_media_json_value_t *child = walk_child(f->v, i);
+        dump_node(child, at + 4);
+        if (child && walk_count(child)) {
+            json_walk_frame_t *g = walk_push(&walk, child);
+            if (!g) break;
+            g->mode = at + 4;
+        }
+    }
+    walk_release(&walk);
+}
+
+// -----------------------------------------------------------------------------
+// Path Access
+// -----------------------------------------------------------------------------
+//
+// Path syntax: dot-separated keys, bracketed array indices, and quoted keys
+// that may contain dots or brackets. Examples:
+//   foo.bar[2].baz
+//   arr[0][1]
+//   "complex.key".arr[1]
+//   foo."key.with.dots"[3]
+// A bare key applied to an array is read as an index. Paths are split into
+// segments once; lookups then walk the tree without allocating.
+
+#define JSON_PATH_NO_INDEX ((size_t)-1)
+
+typedef struct {
+    const char *key;        /* key text (not NUL-terminated), NULL for [index] */
+    size_t len;
+    size_t index;           /* [index], or the key read as an index, else JSON_PATH_NO_INDEX */
+    uint32_t hash;          /* keymap_hash of the key */
+} json_path_seg_t;
+
+struct fossil_media_json_path {
+    size_t count;
+    json_path_seg_t segs[];
+};
+
+/* Index in [p, end), read like strtol; negative or overflowing values match nothing */
+static size_t path_index(const char *p, const char *end, const char **stop) {
+    const char *begin = p;
+    while (p < end && isspace((unsigned char)*p)) p++;
+    int neg = 0;
+    if (p < end && (*p == '+' || *p == '-')) neg = *p++ == '-';
+    const char *digits = p;
+    size_t v = 0;
+    int overflow = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+        size_t d = (size_t)(*p - '0');
+        if (v > (JSON_PATH_NO_INDEX - d) / 10) overflow = 1;
+        else v = v * 10 + d;
+    }
+    if (stop) *stop = p == digits ? begin : p;
+    if (p == digits) return 0;
+    return overflow || (neg && v) ? JSON_PATH_NO_INDEX : v;
+}
+
+/*
+ * Reads the next segment at *p. Returns 1 with *seg filled, 0 at the end of
+ * the path, or -1 on a malformed path with *p at the offending character.
+ */
+static int path_next(const char **p, json_path_seg_t *seg) {
+    const char *s = *p;
+    for (;;) {
+        if (*s == '[') {
+            const char *q = s + 1;
+            while (*q && *q != ']') q++;
+            if (*q != ']') { *p = s; return -1; }
+            seg->key = NULL;
+            seg->len = 0;
+            seg->hash = 0;
+            seg->index = path_index(s + 1, q, NULL);
+            *p = q + 1;
+            return 1;
+        }
+        while (*s == '.') s++;
+        if (!*s) { *p = s; return 0; }
+        const char *start, *q;
+        if (*s == '"') {
+            start = q = s + 1;
+            while (*q && *q != '"') {
+                if (*q == '\\' && q[1]) q++;
+                q++;
+            }
+            if (*q != '"') { *p = s; return -1; }
+            s = q + 1;
+        } else {
+            start = q = s;
+            while (*q && *q != '.' && *q != '[') q++;
+            s = q;
+        }
+        /* An empty key selects nothing and is skipped */
+        if (q == start) continue;
+        const char *stop;
+        seg->key = start;
+        seg->len = (size_t)(q - start);
+        seg->hash = keymap_hash_n(start, seg->len);
+        seg->index = path_index(start, q, &stop);
+        if (stop != q) seg->index = JSON_PATH_NO_INDEX;
+        *p = s;
+        return 1;
+    }
+}
+
+static fossil_media_json_value_t *path_step(const fossil_media_json_value_t *cur, const json_path_seg_t *seg) {
+    if (seg->key && cur->type == FOSSIL_MEDIA_JSON_OBJECT) {
+        ptrdiff_t found = object_find_n(cur, seg->key, seg->len, seg->hash);
+        return found >= 0 ? cur->u.object.values[found] : NULL;
+    }
+    if (cur->type != FOSSIL_MEDIA_JSON_ARRAY || seg->index >= cur->u.array.count) return NULL;
+    return cur->u.array.items[seg->index];
+}
+
+fossil_media_json_value_t *fossil_media_json_get_path_ref(const fossil_media_json_value_t *root, const char *path) {
+    if (!root || !path) return NULL;
+    const fossil_media_json_value_t *cur = root;
+    json_path_seg_t seg;
+    int rc;
+    while ((rc = path_next(&path, &seg)) > 0)
+        if (!(cur = path_step(cur, &seg))) return NULL;
+    return rc == 0 ? (fossil_media_json_value_t *)cur : NULL;
+}
+
+fossil_media_json_value_t *fossil_media_json_get_path(const fossil_media_json_value_t *root, const char *path) {
+    fossil_media_json_value_t *v = fossil_media_json_get_path_ref(root, path);
+    return v ? fossil_media_json_clone(v) : NULL;
+}
+
+fossil_media_json_path_t *fossil_media_json_path_compile(const char *path, fossil_media_json_error_t *err_out) {
+    fossil_media_json_error_t errtmp = {0,0,""};
+    if (!path) { set_error(&errtmp, 1, 0, "NULL path"); if (err_out) *err_out = errtmp; return NULL; }
+
+    /* Count segments, then copy the text so key segments can point into it */
+    size_t count = 0, len = strlen(path);
+    const char *p = path;
+    json_path_seg_t seg;
+    int rc;
+    while ((rc = path_next(&p, &seg)) > 0) count++;
+    if (rc < 0) {
+        set_error(&errtmp, 1, (size_t)(p - path), *p == '[' ? "Unterminated index" : "Unterminated quoted key");
+        if (err_out) *err_out = errtmp;
+        return NULL;
+    }
+    fossil_media_json_path_t *prog = fm_malloc(sizeof(*prog) + count * sizeof(json_path_seg_t) + len + 1);
+    if (!prog) { set_error(&errtmp, 1, 0, "OOM"); if (err_out) *err_out = errtmp; return NULL; }
+    char *text = (char *)(prog->segs + count);
+    memcpy(text, path, len + 1);
+    prog->count = 0;
+    p = text;
+    while (path_next(&p, &prog->segs[prog->count]) > 0) prog->count++;
+    if (err_out) *err_out = errtmp;
+    return prog;
+}
+
+fossil_media_json_value_t *fossil_media_json_path_get(const fossil_media_json_path_t *path, const fossil_media_json_value_t *root) {
+    if (!path || !root) return NULL;
+    const fossil_media_json_value_t *cur = root;
+    for (size_t i = 0; i < path->count && cur; ++i) cur = path_step(cur, &path->segs[i]);
+    return (fossil_media_json_value_t *)cur;
+}
+
+void fossil_media_json_path_free(fossil_media_json_path_t *path) {
+    fm_free(path);
+}
+
+// -----------------------------------------------------------------------------
+// JSONPath Queries
+// -----------------------------------------------------------------------------
+//
+// RFC 9535 JSONPath without function extensions: $ and @ roots, .name and
+// ['name'] members, .* and [*] wildcards, [i] indices (negative from the end),
+// [start:end:step] slices, ..descendant segments and [?filter] selectors with
+// ==, !=, <, <=, >, >=, &&, || and !. Filters may be written ?(...) as well.
+//
+// A query compiles to linked lists of segments and selectors stored in three
+// growable arrays, with names and literals decoded once. Evaluation is depth
+// first: each selected node is handed straight to the next segment, so no
+// intermediate node lists are built. The only allocations while running are
+// the caller's result list and, for .. segments, one shared walk stack.
+// Evaluation recurses once per segment and expression level, so compiled
+// queries are capped at JSON_QUERY_LIMIT of each to bound the C stack.
+
+#define JSON_QUERY_NONE  ((size_t)-1)
+#define JSON_QUERY_LIMIT 256
+#define JSON_QUERY_MAX_INT 9007199254740991LL  /* 2^53 - 1, the I-JSON integer range */
+
+enum { JSON_QSEL_NAME, JSON_QSEL_WILD, JSON_QSEL_INDEX, JSON_QSEL_SLICE, JSON_QSEL_FILTER };
+
+enum {
+    JSON_QEXPR_OR, JSON_QEXPR_AND, JSON_QEXPR_NOT, JSON_QEXPR_EXISTS,
+    JSON_QEXPR_EQ, JSON_QEXPR_NE, JSON_QEXPR_LT, JSON_QEXPR_LE, JSON_QEXPR_GT, JSON_QEXPR_GE,
+    JSON_QEXPR_LITERAL, JSON_QEXPR_QUERY
+};
+
+typedef struct {
+    int kind;                        /* JSON_QSEL_* */
+    size_t next;                     /* next selector of the same segment */
+    fossil_media_json_value_t *lit;  /* NAME: the decoded name as a string value */
+    size_t len;                      /* NAME: strlen of the name */
+    uint32_t hash;                   /* NAME: keymap_hash of the name */
+    int64_t start, end, step;        /* INDEX uses start; SLICE bounds */
+    int has_start, has_end;
+    size_t expr;                     /* FILTER: root of the predicate */
+} json_query_sel_t;
+
+typedef struct {
+    size_t first;                    /* first selector */
+    size_t next;                     /* next segment of the same query */
+    int descendant;                  /* ..[] rather than [] */
+} json_query_seg_t;
+
+typedef struct {
+    int op;                          /* JSON_QEXPR_* */
+    size_t a, b;                     /* operands of logical and comparison nodes */
+    fossil_media_json_value_t *lit;  /* LITERAL */
+    size_t seg;                      /* QUERY: first segment, JSON_QUERY_NONE for a bare root */
+    int absolute;                    /* QUERY: starts at $ rather than @ */
+} json_query_expr_t;
+
+struct fossil_media_json_query {
+    size_t seg;                      /* first segment of the top-level query */
+    json_query_seg_t *segs;
+    json_query_sel_t *sels;
+    json_query_expr_t *exprs;
+    size_t nsegs, nsels, nexprs;
+    size_t segs_cap, sels_cap, exprs_cap;
+};
+
+typedef struct {
+    const char *s;
+    size_t pos;
+    size_t nest;                     /* open brackets, parentheses, ! and chained operators */
+    fossil_media_json_query_t *q;
+    fossil_media_json_error_t *err;
+} json_query_parser_t;
+
+static int qp_fail(json_query_parser_t *p, const char *msg) {
+    set_error(p->err, 1, p->pos, "%s", msg);
+    return -1;
+}
+
+static void qp_ws(json_query_parser_t *p) {
+    while (p->s[p->pos] == ' ' || p->s[p->pos] == '\t' || p->s[p->pos] == '\n' || p->s[p->pos] == '\r') p->pos++;
+}
+
+static int qp_enter(json_query_parser_t *p) {
+    return ++p->nest > JSON_QUERY_LIMIT ? qp_fail(p, "Query nested too deeply") : 0;
+}
+
+static int qp_name_first(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c >= 0x80;
+}
+
+static int qp_name_char(unsigned char c) {
+    return qp_name_first(c) || (c >= '0' && c <= '9');
+}
+
+/* Make room for one more element; returns the (possibly moved) array or NULL */
+static void *query_grow(void *items, size_t count, size_t *cap, size_t size) {
+    if (count < *cap) return items;
+    size_t n = *cap ? *cap * 2 : 8;
+    void *tmp = fm_realloc(items, n * size);
+    if (tmp) *cap = n;
+    return tmp;
+}
+
+static size_t qp_new_seg(json_query_parser_t *p) {
+    fossil_media_json_query_t *q = p->q;
+    if (q->nsegs == JSON_QUERY_LIMIT) { qp_fail(p, "Too many segments"); return JSON_QUERY_NONE; }
+    json_query_seg_t *t = query_grow(q->segs, q->nsegs, &q->segs_cap, sizeof(*t));
+    if (!t) { qp_fail(p, "OOM"); return JSON_QUERY_NONE; }
+    q->segs = t;
+    t[q->nsegs].first = t[q->nsegs].next = JSON_QUERY_NONE;
+    t[q->nsegs].descendant = 0;
+    return q->nsegs++;
+}
+
+static size_t qp_new_sel(json_query_parser_t *p, int kind) {
+    fossil_media_json_query_t *q = p->q;
+    json_query_sel_t *t = query_grow(q->sels, q->nsels, &q->sels_cap, sizeof(*t));
+    if (!t) { qp_fail(p, "OOM"); return JSON_QUERY_NONE; }
+    q->sels = t;
+    memset(&t[q->nsels], 0, sizeof(*t));
+    t[q->nsels].kind = kind;
+    t[q->nsels].next = t[q->nsels].expr = JSON_QUERY_NONE;
+    return q->nsels++;
+}
+
+static size_t qp_new_expr(json_query_parser_t *p, int op) {
+    fossil_media_json_query_t *q = p->q;
+    json_query_expr_t *t = query_grow(q->exprs, q->nexprs, &q->exprs_cap, sizeof(*t));
+    if (!t) { qp_fail(p, "OOM"); return JSON_QUERY_NONE; }
+    q->exprs = t;
+    memset(&t[q->nexprs], 0, sizeof(*t));
+    t[q->nexprs].op = op;
+    t[q->nexprs].a = t[q->nexprs].b = t[q->nexprs].seg = JSON_QUERY_NONE;
+    return q->nexprs++;
+}
+
+/*
+ * Quoted string at p->pos, either quote style. It is respelled as a JSON
+ * string and decoded by the parser, which also checks escapes and UTF-8.
+ */
+static int qp_string(json_query_parser_t *p, fossil_media_json_value_t **out) {
+    const char *s = p->s;
+    char quote = s[p->pos];
+    size_t i = p->pos + 1, n = 0;
+    for (; s[i] && s[i] != quote; i++, n++) {
+        if (s[i] == '\\') {
+            if (!s[i + 1]) break;
+            i++;
+            n++;
+        } else if (s[i] == '"') {
+            n++;
+        }
+    }
+    if (s[i] != quote) return qp_fail(p, "Unterminated string");
+    char *json = fm_malloc(n + 3), *o = json;
+    if (!json) return qp_fail(p, "OOM");
+    *o++ = '"';
+    for (size_t k = p->pos + 1; k < i; k++) {
+        if (s[k] == '\\' && quote == '\'' && s[k + 1] == '\'') {
+            *o++ = s[++k];
+        } else if (s[k] == '\\') {
+            *o++ = s[k++];
+            *o++ = s[k];
         } else {
-            if (len + 2 > cap) { cap = (len + 2) * 2; buf = fm_realloc(buf, cap); if (!buf) return NULL; }
-            buf[len++] = ch;
+            if (s[k] == '"') *o++ = '\\';
+            *o++ = s[k];
         }
     }
-    set_error(err, 1, start, "Unterminated string");
-    fm_free(buf);
-    return NULL;
+    *o++ = '"';
+    *o = '\0';
+    *out = fossil_media_json_parse(json, NULL);
+    fm_free(json);
+    if (!*out) return qp_fail(p, "Invalid string");
+    p->pos = i + 1;
+    return 0;
 }
 
-/* Forward declarations */
-static fossil_media_json_value_t *parse_value(ctx_t *c, fossil_media_json_error_t *err);
-
-static fossil_media_json_value_t *parse_array(ctx_t *c, fossil_media_json_error_t *err) {
-    const char *s = c->s;
-    size_t i = c->i;
-    if (s[i] != '[') { set_error(err,1,i,"Expected '['"); return NULL; }
-    i++;
-    c->i = i;
-    skip_ws(c);
-    fossil_media_json_value_t *arr = fossil_media_json_new_array();
-    if (!arr) { set_error(err,1,c->i,"OOM"); return NULL; }
-    skip_ws(c);
-    if (c->s[c->i] == ']') { c->i++; return arr; }
-    while (1) {
-        skip_ws(c);
-        fossil_media_json_value_t *elem = parse_value(c, err);
-        if (!elem) { fossil_media_json_free(arr); return NULL; }
-        if (fossil_media_json_array_append(arr, elem) != 0) { fossil_media_json_free(elem); fossil_media_json_free(arr); set_error(err,1,c->i,"OOM"); return NULL; }
-        skip_ws(c);
-        if (c->s[c->i] == ',') {
-            c->i++;
-            skip_ws(c);
-            if (c->s[c->i] == ']') { fossil_media_json_free(arr); set_error(err,1,c->i,"Trailing comma in array"); return NULL; }
-            continue;
-        }
-        else if (c->s[c->i] == ']') { c->i++; break; }
-        else { fossil_media_json_free(arr); set_error(err,1,c->i,"Expected ',' or ']' in array"); return NULL; }
+static int qp_int(json_query_parser_t *p, int64_t *out) {
+    const char *s = p->s + p->pos, *q = s;
+    int neg = *q == '-';
+    if (neg) q++;
+    if (*q < '0' || *q > '9') return qp_fail(p, "Expected integer");
+    if (*q == '0' && (neg || (q[1] >= '0' && q[1] <= '9'))) return qp_fail(p, "Invalid integer");
+    int64_t v = 0;
+    for (; *q >= '0' && *q <= '9'; q++) {
+        v = v * 10 + (*q - '0');
+        if (v > JSON_QUERY_MAX_INT) return qp_fail(p, "Integer out of range");
     }
-    return arr;
+    p->pos += (size_t)(q - s);
+    *out = neg ? -v : v;
+    return 0;
 }
 
-static fossil_media_json_value_t *parse_object(ctx_t *c, fossil_media_json_error_t *err) {
-    const char *s = c->s;
-    size_t i = c->i;
-    if (s[i] != '{') { set_error(err,1,i,"Expected '{'"); return NULL; }
-    i++;
-    c->i = i;
-    skip_ws(c);
-    fossil_media_json_value_t *obj = fossil_media_json_new_object();
-    if (!obj) { set_error(err,1,c->i,"OOM"); return NULL; }
-    skip_ws(c);
-    if (c->s[c->i] == '}') { c->i++; return obj; }
-    while (1) {
-        skip_ws(c);
-        if (c->s[c->i] != '"') { fossil_media_json_free(obj); set_error(err,1,c->i,"Expected string key"); return NULL; }
-        fossil_media_json_value_t *keyv = parse_string(c, err);
-        if (!keyv) { fossil_media_json_free(obj); return NULL; }
-        char *key = keyv->u.string;
-        /* keyv was allocated as a string node; we steal the char* and free keyv */
-        fm_free(keyv);
-        skip_ws(c);
-        if (c->s[c->i] != ':') { fm_free(key); fossil_media_json_free(obj); set_error(err,1,c->i,"Expected ':' after key"); return NULL; }
-        c->i++;
-        skip_ws(c);
-        fossil_media_json_value_t *val = parse_value(c, err);
-        if (!val) { fm_free(key); fossil_media_json_free(obj); return NULL; }
-        /* insert key/val */
-        if (obj->u.object.count == obj->u.object.capacity) {
-            size_t newcap = obj->u.object.capacity ? obj->u.object.capacity * 2 : 4;
-            char **nk = fm_realloc(obj->u.object.keys, sizeof(*nk) * newcap);
-            fossil_media_json_value_t **nv = fm_realloc(obj->u.object.values, sizeof(*nv) * newcap);
-            if (!nk || !nv) { fm_free(nk); fm_free(nv); fm_free(key); fossil_media_json_free(val); fossil_media_json_free(obj); set_error(err,1,c->i,"OOM"); return NULL; }
-            obj->u.object.keys = nk;
-            obj->u.object.values = nv;
-            obj->u.object.capacity = newcap;
-        }
-        obj->u.object.keys[obj->u.object.count] = key;
-        obj->u.object.values[obj->u.object.count] = val;
-        obj->u.object.count++;
-        skip_ws(c);
-        if (c->s[c->i] == ',') {
-            c->i++;
-            skip_ws(c);
-            if (c->s[c->i] == '}') { fossil_media_json_free(obj); set_error(err,1,c->i,"Trailing comma in object"); return NULL; }
-            continue;
+static void qp_set_name(fossil_media_json_query_t *q, size_t sel, fossil_media_json_value_t *name) {
+    json_query_sel_t *t = &q->sels[sel];
+    t->lit = name;
+    t->len = strlen(name->u.string);
+    t->hash = keymap_hash_n(name->u.string, t->len);
+}
+
+static int qp_or(json_query_parser_t *p, size_t *out);
+
+/* Index or slice: [start]:[end][:[step]], or a lone integer */
+static int qp_index(json_query_parser_t *p, size_t *out) {
+    int64_t v[3] = {0, 0, 1};
+    int has[3] = {0, 0, 0}, colons = 0;
+    for (;;) {
+        char c = p->s[p->pos];
+        if (c == '-' || (c >= '0' && c <= '9')) {
+            if (qp_int(p, &v[colons])) return -1;
+            has[colons] = 1;
         }
-        else if (c->s[c->i] == '}') { c->i++; break; }
-        else { fossil_media_json_free(obj); set_error(err,1,c->i,"Expected ',' or '}' in object"); return NULL; }
+        qp_ws(p);
+        if (p->s[p->pos] != ':' || colons == 2) break;
+        colons++;
+        p->pos++;
+        qp_ws(p);
     }
-    return obj;
+    if (!colons && !has[0]) return qp_fail(p, "Invalid selector");
+    size_t at = qp_new_sel(p, colons ? JSON_QSEL_SLICE : JSON_QSEL_INDEX);
+    if (at == JSON_QUERY_NONE) return -1;
+    json_query_sel_t *t = &p->q->sels[at];
+    t->start = v[0];
+    t->end = v[1];
+    t->step = v[2];
+    t->has_start = has[0];
+    t->has_end = has[1];
+    *out = at;
+    return 0;
 }
 
-static fossil_media_json_value_t *parse_value(ctx_t *c, fossil_media_json_error_t *err) {
-    skip_ws(c);
-    char ch = c->s[c->i];
-    if (!ch) { set_error(err,1,c->i,"Unexpected end of input"); return NULL; }
-    if (ch == '"') return parse_string(c, err);
-    if (ch == '-' || (ch >= '0' && ch <= '9')) return parse_number(c, err);
-    if (ch == '{') return parse_object(c, err); // supports nested objects
-    if (ch == '[') return parse_array(c, err);  // supports nested arrays
-    /* literals */
-    if (ch == 't' || ch == 'f' || ch == 'n') return parse_literal(c, err);
-    set_error(err,1,c->i,"Unexpected token '%c'", ch);
-    return NULL;
+static int qp_selector(json_query_parser_t *p, size_t *out) {
+    char c = p->s[p->pos];
+    size_t at;
+    if (c == '\'' || c == '"') {
+        fossil_media_json_value_t *name;
+        if (qp_string(p, &name)) return -1;
+        if ((at = qp_new_sel(p, JSON_QSEL_NAME)) == JSON_QUERY_NONE) { fossil_media_json_free(name); return -1; }
+        qp_set_name(p->q, at, name);
+    } else if (c == '*') {
+        if ((at = qp_new_sel(p, JSON_QSEL_WILD)) == JSON_QUERY_NONE) return -1;
+        p->pos++;
+    } else if (c == '?') {
+        size_t expr;
+        p->pos++;
+        qp_ws(p);
+        if (qp_or(p, &expr)) return -1;
+        if ((at = qp_new_sel(p, JSON_QSEL_FILTER)) == JSON_QUERY_NONE) return -1;
+        p->q->sels[at].expr = expr;
+    } else {
+        return qp_index(p, out);
+    }
+    *out = at;
+    return 0;
 }
 
-/* Public parse */
-fossil_media_json_value_t *fossil_media_json_parse(const char *json_text, fossil_media_json_error_t *err_out) {
-    fossil_media_json_error_t errtmp = {0,0,""};
-    if (!json_text) { set_error(&errtmp,1,0,"NULL input"); if (err_out) *err_out = errtmp; return NULL; }
-    ctx_t c = { json_text, 0 };
-    skip_ws(&c);
-    fossil_media_json_value_t *root = parse_value(&c, &errtmp);
-    if (!root) { if (err_out) *err_out = errtmp; return NULL; }
-    skip_ws(&c);
-    if (c.s[c.i] != '\0') {
-        /* trailing garbage */
-        fossil_media_json_free(root);
-        set_error(&errtmp,1,c.i,"Trailing characters after JSON value");
-        if (err_out) *err_out = errtmp;
-        return NULL;
+/* [selector, ...] at p->pos; *out receives the first selector */
+static int qp_bracket(json_query_parser_t *p, size_t *out) {
+    if (qp_enter(p)) return -1;
+    p->pos++;
+    size_t first = JSON_QUERY_NONE, last = JSON_QUERY_NONE;
+    for (;;) {
+        size_t sel;
+        qp_ws(p);
+        if (qp_selector(p, &sel)) return -1;
+        if (last == JSON_QUERY_NONE) first = sel;
+        else p->q->sels[last].next = sel;
+        last = sel;
+        qp_ws(p);
+        if (p->s[p->pos] == ',') { p->pos++; continue; }
+        if (p->s[p->pos] == ']') { p->pos++; break; }
+        return qp_fail(p, "Expected ',' or ']'");
     }
-    if (err_out) *err_out = errtmp;
-    return root;
+    p->nest--;
+    *out = first;
+    return 0;
 }
 
-/* String escaping for stringifier */
-static void append_escaped(char **bufp, size_t *lenp, size_t *cap, const char *s) {
-    while (*s) {
-        unsigned char c = (unsigned char)*s++;
-        const char *esc = NULL;
-        char tmp[7];
-        size_t add = 1;
-        if (c == '"' ) { esc = "\\\""; add = 2; }
-        else if (c == '\\') { esc = "\\\\"; add = 2; }
-        else if (c == '\b') { esc = "\\b"; add = 2; }
-        else if (c == '\f') { esc = "\\f"; add = 2; }
-        else if (c == '\n') { esc = "\\n"; add = 2; }
-        else if (c == '\r') { esc = "\\r"; add = 2; }
-        else if (c == '\t') { esc = "\\t"; add = 2; }
-        else if (c < 0x20) {
-            snprintf(tmp, sizeof(tmp), "\\u%04x", c);
-            esc = tmp;
-            add = 6;
-        }
-        if (esc) {
-            if (*lenp + add + 1 > *cap) { *cap = (*lenp + add + 1) * 2; *bufp = fm_realloc(*bufp, *cap); if (!*bufp) return; }
-            memcpy(*bufp + *lenp, esc, add); *lenp += add; continue;
-        }
-        if (*lenp + 2 > *cap) { *cap = (*lenp + 2) * 2; *bufp = fm_realloc(*bufp, *cap); if (!*bufp) return; }
-        (*bufp)[(*lenp)++] = c;
-    }
-}
-
-/* stringify core */
-static int stringify_value(const fossil_media_json_value_t *v, char **bufp, size_t *lenp, size_t *cap, int pretty, int depth) {
-    if (!v) return -1;
-    if (*bufp == NULL) { *cap = 256; *bufp = fm_malloc(*cap); if (!*bufp) return -1; *lenp = 0; }
-    switch (v->type) {
-        case FOSSIL_MEDIA_JSON_NULL:
-            if (*lenp + 5 > *cap) { *cap = (*lenp + 5) * 2; *bufp = fm_realloc(*bufp, *cap); if (!*bufp) return -1; }
-            memcpy(*bufp + *lenp, "null", 4); *lenp += 4;
-            break;
-        case FOSSIL_MEDIA_JSON_BOOL: {
-            const char *t = v->u.boolean ? "true" : "false";
-            size_t n = v->u.boolean ? 4 : 5;
-            if (*lenp + n + 1 > *cap) { *cap = (*lenp + n + 1) * 2; *bufp = fm_realloc(*bufp, *cap); if (!*bufp) return -1; }
-            memcpy(*bufp + *lenp, t, n); *lenp += n;
-            break;
-        }
-        case FOSSIL_MEDIA_JSON_NUMBER: {
-            char tmp[64];
-            int n = snprintf(tmp, sizeof(tmp), "%.17g", v->u.number);
-            if (n < 0) return -1;
-            if (*lenp + (size_t)n + 1 > *cap) { *cap = (*lenp + n + 1) * 2; *bufp = fm_realloc(*bufp, *cap); if (!*bufp) return -1; }
-            memcpy(*bufp + *lenp, tmp, n); *lenp += n;
-            break;
-        }
-        case FOSSIL_MEDIA_JSON_STRING: {
-            if (*lenp + 3 > *cap) { *cap = (*lenp + 3) * 2; *bufp = fm_realloc(*bufp, *cap); if (!*bufp) return -1; }
-            (*bufp)[(*lenp)++] = '"';
-            append_escaped(bufp, lenp, cap, v->u.string ? v->u.string : "");
-            if (*lenp + 2 > *cap) { *cap = (*lenp + 2) * 2; *bufp = fm_realloc(*bufp, *cap); if (!*bufp) return -1; }
-            (*bufp)[(*lenp)++] = '"';
-            break;
-        }
-        case FOSSIL_MEDIA_JSON_ARRAY: {
-            if (*lenp + 1 > *cap) { *cap = (*lenp + 1) * 2; *bufp = fm_realloc(*bufp, *cap); if (!*bufp) return -1; }
-            (*bufp)[(*lenp)++] = '[';
-            for (size_t i = 0; i < v->u.array.count; ++i) {
-                if (i) {
-                    if (*lenp + 1 > *cap) { *cap = (*lenp + 1) * 2; *bufp = fm_realloc(*bufp, *cap); if (!*bufp) return -1; }
-                    (*bufp)[(*lenp)++] = ',';
-                }
-                if (pretty) {
-                    if (*lenp + 1 > *cap) { *cap = (*lenp + 1) * 2; *bufp = fm_realloc(*bufp, *cap); if (!*bufp) return -1; }
-                    (*bufp)[(*lenp)++] = '\n';
-                    for (int d = 0; d < depth+1; ++d) {
-                        if (*lenp + 2 > *cap) { *cap = (*lenp + 2) * 2; *bufp = fm_realloc(*bufp, *cap); if (!*bufp) return -1; }
-                        (*bufp)[(*lenp)++] = '\t';
-                    }
-                }
-                if (stringify_value(v->u.array.items[i], bufp, lenp, cap, pretty, depth+1) != 0) return -1;
-            }
-            if (pretty && v->u.array.count) {
-                if (*lenp + 1 > *cap) { *cap = (*lenp + 1) * 2; *bufp = fm_realloc(*bufp, *cap); if (!*bufp) return -1; }
-                (*bufp)[(*lenp)++] = '\n';
-                for (int d = 0; d < depth; ++d) {
-                    if (*lenp + 2 > *cap) { *cap = (*lenp + 2) * 2; *bufp = fm_realloc(*bufp, *cap); if (!*bufp) return -1; }
-                    (*bufp)[(*lenp)++] = '\t';
-                }
-            }
-            if (*lenp + 1 > *cap) { *cap = (*lenp + 1) * 2; *bufp = fm_realloc(*bufp, *cap); if (!*bufp) return -1; }
-            (*bufp)[(*lenp)++] = ']';
-            break;
-        }
-        case FOSSIL_MEDIA_JSON_OBJECT: {
-            if (*lenp + 1 > *cap) { *cap = (*lenp + 1) * 2; *bufp = fm_realloc(*bufp, *cap); if (!*bufp) return -1; }
-            (*bufp)[(*lenp)++] = '{';
-            for (size_t i = 0; i < v->u.object.count; ++i) {
-                if (i) {
-                    if (*lenp + 1 > *cap) { *cap = (*lenp + 1) * 2; *bufp = fm_realloc(*bufp, *cap); if (!*bufp) return -1; }
-                    (*bufp)[(*lenp)++] = ',';
-                }
-                if (pretty) {
-                    if (*lenp + 1 > *cap) { *cap = (*lenp + 1) * 2; *bufp = fm_realloc(*bufp, *cap); if (!*bufp) return -1; }
-                    (*bufp)[(*lenp)++] = '\n';
-                    for (int d = 0; d < depth+1; ++d) {
-                        if (*lenp + 2 > *cap) { *cap = (*lenp + 2) * 2; *bufp = fm_realloc(*bufp, *cap); if (!*bufp) return -1; }
-                        (*bufp)[(*lenp)++] = '\t';
-                    }
-                }
-                /* key */
-                if (*lenp + 2 > *cap) { *cap = (*lenp + 2) * 2; *bufp = fm_realloc(*bufp, *cap); if (!*bufp) return -1; }
-                (*bufp)[(*lenp)++] = '"';
-                append_escaped(bufp, lenp, cap, v->u.object.keys[i]);
-                if (*lenp + 3 > *cap) { *cap = (*lenp + 3) * 2; *bufp = fm_realloc(*bufp, *cap); if (!*bufp) return -1; }
-                (*bufp)[(*lenp)++] = '"';
-                (*bufp)[(*lenp)++] = ':';
-                if (pretty) {
-                    (*bufp)[(*lenp)++] = '\t';
-                }
-                if (stringify_value(v->u.object.values[i], bufp, lenp, cap, pretty, depth+1) != 0) return -1;
-            }
-            if (pretty && v->u.object.count) {
-                if (*lenp + 1 > *cap) { *cap = (*lenp + 1) * 2; *bufp = fm_realloc(*bufp, *cap); if (!*bufp) return -1; }
-                (*bufp)[(*lenp)++] = '\n';
-                for (int d = 0; d < depth; ++d) {
-                    if (*lenp + 2 > *cap) { *cap = (*lenp + 2) * 2; *bufp = fm_realloc(*bufp, *cap); if (!*bufp) return -1; }
-                    (*bufp)[(*lenp)++] = '\t';
-                }
+/*
+ * Segments following a $ or @ root. *singular is set when the query can
+ * select at most one node (only single name and index selectors).
+ */
+static int qp_segments(json_query_parser_t *p, size_t *out, int *singular) {
+    size_t first = JSON_QUERY_NONE, last = JSON_QUERY_NONE;
+    int single = 1;
+    for (;;) {
+        size_t save = p->pos, sel;
+        qp_ws(p);
+        const char *s = p->s + p->pos;
+        int desc = s[0] == '.' && s[1] == '.';
+        if (s[0] == '[' || (desc && s[2] == '[')) {
+            p->pos += desc ? 2 : 0;
+            if (qp_bracket(p, &sel)) return -1;
+        } else if (s[0] == '.') {
+            p->pos += desc ? 2 : 1;
+            s = p->s + p->pos;
+            if (*s == '*') {
+                if ((sel = qp_new_sel(p, JSON_QSEL_WILD)) == JSON_QUERY_NONE) return -1;
+                p->pos++;
+            } else if (qp_name_first((unsigned char)*s)) {
+                size_t n = 1;
+                while (qp_name_char((unsigned char)s[n])) n++;
+                char *text = fm_malloc(n + 1);
+                if (!text) return qp_fail(p, "OOM");
+                memcpy(text, s, n);
+                text[n] = '\0';
+                fossil_media_json_value_t *name = fossil_media_json_new_string(text);
+                fm_free(text);
+                if (!name) return qp_fail(p, "OOM");
+                if ((sel = qp_new_sel(p, JSON_QSEL_NAME)) == JSON_QUERY_NONE) { fossil_media_json_free(name); return -1; }
+                qp_set_name(p->q, sel, name);
+                p->pos += n;
+            } else {
+                return qp_fail(p, desc ? "Expected name, '*' or '[' after '..'" : "Expected name or '*' after '.'");
             }
-            if (*lenp + 1 > *cap) { *cap = (*lenp + 1) * 2; *bufp = fm_realloc(*bufp, *cap); if (!*bufp) return -1; }
-            (*bufp)[(*lenp)++] = '}';
+        } else {
+            p->pos = save;
             break;
         }
-        default: return -1;
+        size_t seg = qp_new_seg(p);
+        if (seg == JSON_QUERY_NONE) return -1;
+        json_query_seg_t *g = &p->q->segs[seg];
+        const json_query_sel_t *t = &p->q->sels[sel];
+        g->first = sel;
+        g->descendant = desc;
+        if (desc || t->next != JSON_QUERY_NONE || (t->kind != JSON_QSEL_NAME && t->kind != JSON_QSEL_INDEX)) single = 0;
+        if (last == JSON_QUERY_NONE) first = seg;
+        else p->q->segs[last].next = seg;
+        last = seg;
     }
-    /* ensure NUL at the top-level only (caller will NUL-terminate) */
+    *out = first;
+    if (singular) *singular = single;
     return 0;
 }
 
-char *fossil_media_json_stringify(const fossil_media_json_value_t *v, int pretty, fossil_media_json_error_t *err_out) {
+/* Literal or embedded query; *singular is 0 only for a query that may select several nodes */
+static int qp_comparable(json_query_parser_t *p, size_t *out, int *singular) {
+    const char *s = p->s + p->pos;
+    size_t at = qp_new_expr(p, JSON_QEXPR_LITERAL);
+    if (at == JSON_QUERY_NONE) return -1;
+    fossil_media_json_value_t *lit = NULL;
+    *singular = 1;
+    if (*s == '@' || *s == '$') {
+        size_t seg;
+        p->pos++;
+        if (qp_segments(p, &seg, singular)) return -1;
+        p->q->exprs[at].op = JSON_QEXPR_QUERY;
+        p->q->exprs[at].seg = seg;
+        p->q->exprs[at].absolute = *s == '$';
+    } else if (*s == '\'' || *s == '"') {
+        if (qp_string(p, &lit)) return -1;
+    } else if (*s == '-' || (*s >= '0' && *s <= '9')) {
+        size_t n = 0;
+        while (s[n] == '-' || s[n] == '+' || s[n] == '.' || s[n] == 'e' || s[n] == 'E' || (s[n] >= '0' && s[n] <= '9')) n++;
+        char *text = fm_malloc(n + 1);
+        if (!text) return qp_fail(p, "OOM");
+        memcpy(text, s, n);
+        text[n] = '\0';
+        lit = fossil_media_json_parse(text, NULL);
+        fm_free(text);
+        if (!lit) return qp_fail(p, "Invalid number");
+        p->pos += n;
+    } else if (!strncmp(s, "true", 4) && !qp_name_char((unsigned char)s[4])) {
+        lit = fossil_media_json_new_bool(1);
+        p->pos += 4;
+    } else if (!strncmp(s, "false", 5) && !qp_name_char((unsigned char)s[5])) {
+        lit = fossil_media_json_new_bool(0);
+        p->pos += 5;
+    } else if (!strncmp(s, "null", 4) && !qp_name_char((unsigned char)s[4])) {
+        lit = fossil_media_json_new_null();
+        p->pos += 4;
+    } else {
+        return qp_fail(p, "Expected literal or query");
+    }
+    if (p->q->exprs[at].op == JSON_QEXPR_LITERAL && !(p->q->exprs[at].lit = lit)) return qp_fail(p, "OOM");
+    *out = at;
+    return 0;
+}
+
+static int qp_compare_op(json_query_parser_t *p) {
+    const char *s = p->s + p->pos;
+    int op = -1, len = 2;
+    if (s[0] == '=' && s[1] == '=') op = JSON_QEXPR_EQ;
+    else if (s[0] == '!' && s[1] == '=') op = JSON_QEXPR_NE;
+    else if (s[0] == '<' && s[1] == '=') op = JSON_QEXPR_LE;
+    else if (s[0] == '>' && s[1] == '=') op = JSON_QEXPR_GE;
+    else if (s[0] == '<') { op = JSON_QEXPR_LT; len = 1; }
+    else if (s[0] == '>') { op = JSON_QEXPR_GT; len = 1; }
+    if (op >= 0) p->pos += (size_t)len;
+    return op;
+}
+
+/* Parenthesized expression, comparison, or existence test */
+static int qp_primary(json_query_parser_t *p, size_t *out) {
+    if (p->s[p->pos] == '(') {
+        if (qp_enter(p)) return -1;
+        p->pos++;
+        qp_ws(p);
+        if (qp_or(p, out)) return -1;
+        qp_ws(p);
+        if (p->s[p->pos] != ')') return qp_fail(p, "Expected ')'");
+        p->pos++;
+        p->nest--;
+        return 0;
+    }
+    size_t begin = p->pos, lhs, rhs, at;
+    int single;
+    if (qp_comparable(p, &lhs, &single)) return -1;
+    size_t after = p->pos;
+    qp_ws(p);
+    int op = qp_compare_op(p);
+    if (op < 0) {
+        p->pos = after;
+        if (p->q->exprs[lhs].op != JSON_QEXPR_QUERY) { p->pos = begin; return qp_fail(p, "Expected comparison"); }
+        if ((at = qp_new_expr(p, JSON_QEXPR_EXISTS)) == JSON_QUERY_NONE) return -1;
+        p->q->exprs[at].a = lhs;
+        *out = at;
+        return 0;
+    }
+    if (!single) { p->pos = begin; return qp_fail(p, "Non-singular query in comparison"); }
+    qp_ws(p);
+    begin = p->pos;
+    if (qp_comparable(p, &rhs, &single)) return -1;
+    if (!single) { p->pos = begin; return qp_fail(p, "Non-singular query in comparison"); }
+    if ((at = qp_new_expr(p, op)) == JSON_QUERY_NONE) return -1;
+    p->q->exprs[at].a = lhs;
+    p->q->exprs[at].b = rhs;
+    *out = at;
+    return 0;
+}
+
+static int qp_unary(json_query_parser_t *p, size_t *out) {
+    if (p->s[p->pos] != '!') return qp_primary(p, out);
+    size_t a, at;
+    if (qp_enter(p)) return -1;
+    p->pos++;
+    qp_ws(p);
+    if (qp_unary(p, &a)) return -1;
+    if ((at = qp_new_expr(p, JSON_QEXPR_NOT)) == JSON_QUERY_NONE) return -1;
+    p->q->exprs[at].a = a;
+    p->nest--;
+    *out = at;
+    return 0;
+}
+
+/* Left-assoc chain of `next` terms joined by `tok`; each link nests one level deeper */
+static int qp_chain(json_query_parser_t *p, size_t *out, const char *tok, int op,
+                    int (*next)(json_query_parser_t *, size_t *)) {
+    size_t depth = p->nest;
+    if (next(p, out)) return -1;
+    for (;;) {
+        size_t after = p->pos, rhs, at;
+        qp_ws(p);
+        if (p->s[p->pos] != tok[0] || p->s[p->pos + 1] != tok[1]) { p->pos = after; break; }
+        if (qp_enter(p)) return -1;
+        p->pos += 2;
+        qp_ws(p);
+        if (next(p, &rhs)) return -1;
+        if ((at = qp_new_expr(p, op)) == JSON_QUERY_NONE) return -1;
+        p->q->exprs[at].a = *out;
+        p->q->exprs[at].b = rhs;
+        *out = at;
+    }
+    p->nest = depth;
+    return 0;
+}
+
+static int qp_and(json_query_parser_t *p, size_t *out) {
+    return qp_chain(p, out, "&&", JSON_QEXPR_AND, qp_unary);
+}
+
+static int qp_or(json_query_parser_t *p, size_t *out) {
+    return qp_chain(p, out, "||", JSON_QEXPR_OR, qp_and);
+}
+
+fossil_media_json_query_t *fossil_media_json_query_compile(const char *expr, fossil_media_json_error_t *err_out) {
     fossil_media_json_error_t errtmp = {0,0,""};
-    char *buf = NULL;
-    size_t len = 0, cap = 0;
-    if (!v) { set_error(&errtmp,1,0,"NULL value"); if (err_out) *err_out = errtmp; return NULL; }
-    if (stringify_value(v, &buf, &len, &cap, pretty ? 1 : 0, 0) != 0) { fm_free(buf); set_error(&errtmp,1,0,"Stringify failed"); if (err_out) *err_out = errtmp; return NULL; }
-    /* NUL-terminate */
-    if (len + 1 > cap) { cap = len + 1; buf = fm_realloc(buf, cap); if (!buf) { set_error(&errtmp,1,0,"OOM"); if (err_out) *err_out = errtmp; return NULL; } }
-    buf[len] = '\0';
+    if (!expr) { set_error(&errtmp, 1, 0, "NULL query"); if (err_out) *err_out = errtmp; return NULL; }
+    fossil_media_json_query_t *q = fm_malloc(sizeof(*q));
+    if (!q) { set_error(&errtmp, 1, 0, "OOM"); if (err_out) *err_out = errtmp; return NULL; }
+    memset(q, 0, sizeof(*q));
+    json_query_parser_t p = {expr, 0, 0, q, &errtmp};
+    int rc;
+    if (expr[0] != '$') rc = qp_fail(&p, "Expected '$'");
+    else {
+        p.pos = 1;
+        rc = qp_segments(&p, &q->seg, NULL);
+        if (rc == 0 && expr[p.pos]) rc = qp_fail(&p, "Unexpected character");
+    }
+    if (rc) {
+        fossil_media_json_query_free(q);
+        q = NULL;
+    }
     if (err_out) *err_out = errtmp;
-    return buf;
+    return q;
 }
 
-char *fossil_media_json_roundtrip(const char *json_text, int pretty, fossil_media_json_error_t *err_out) {
-    fossil_media_json_error_t err = {0,0,""};
-    fossil_media_json_value_t *v = fossil_media_json_parse(json_text, &err);
-    if (!v) { if (err_out) *err_out = err; return NULL; }
-    char *s = fossil_media_json_stringify(v, pretty, &err);
-    fossil_media_json_free(v);
-    if (err_out) *err_out = err;
-    return s;
+void fossil_media_json_query_free(fossil_media_json_query_t *query) {
+    if (!query) return;
+    for (size_t i = 0; i < query->nsels; ++i) fossil_media_json_free(query->sels[i].lit);
+    for (size_t i = 0; i < query->nexprs; ++i) fossil_media_json_free(query->exprs[i].lit);
+    fm_free(query->segs);
+    fm_free(query->sels);
+    fm_free(query->exprs);
+    fm_free(query);
 }
 
-const char *fossil_media_json_type_name(fossil_media_json_type_t t) {
-    switch (t) {
-        case FOSSIL_MEDIA_JSON_NULL: return "null";
-        case FOSSIL_MEDIA_JSON_BOOL: return "bool";
-        case FOSSIL_MEDIA_JSON_NUMBER: return "number";
-        case FOSSIL_MEDIA_JSON_STRING: return "string";
-        case FOSSIL_MEDIA_JSON_ARRAY: return "array";
-        case FOSSIL_MEDIA_JSON_OBJECT: return "object";
-        default: return "unknown";
+// Evaluation. Return codes: 0 to go on, 1 when a nested query has found its
+// node and the search can stop, -1 on allocation failure.
+
+typedef struct {
+    const fossil_media_json_value_t *v;
+    size_t next;
+} json_query_frame_t;
+
+/* Walk stack shared by every .. segment of one run; nested walks sit on top */
+typedef struct {
+    json_query_frame_t *frames;
+    size_t depth, cap;
+} json_query_stack_t;
+
+typedef struct json_query_run json_query_run_t;
+
+struct json_query_run {
+    const fossil_media_json_query_t *q;
+    const fossil_media_json_value_t *root;
+    int (*emit)(json_query_run_t *r, const fossil_media_json_value_t *v);
+    fossil_media_json_query_result_t *out;   /* top level: result list */
+    const fossil_media_json_value_t *found;  /* nested: first node selected */
+    json_query_stack_t *stack;
+};
+
+static int query_emit_result(json_query_run_t *r, const fossil_media_json_value_t *v) {
+    fossil_media_json_query_result_t *out = r->out;
+    if (out->count == out->capacity) {
+        size_t cap = out->capacity ? out->capacity * 2 : 16;
+        fossil_media_json_value_t **tmp = fm_realloc(out->items, cap * sizeof(*tmp));
+        if (!tmp) return -1;
+        out->items = tmp;
+        out->capacity = cap;
     }
+    out->items[out->count++] = (fossil_media_json_value_t *)v;
+    return 0;
 }
 
-// -----------------------------------------------------------------------------
-// Clone & Equality
-// -----------------------------------------------------------------------------
+static int query_emit_first(json_query_run_t *r, const fossil_media_json_value_t *v) {
+    r->found = v;
+    return 1;
+}
 
-static fossil_media_json_value_t *fossil_media_json_clone_internal(const fossil_media_json_value_t *src) {
-    if (!src) return NULL;
+static int query_segments(json_query_run_t *r, size_t seg, const fossil_media_json_value_t *v);
+static int query_test(json_query_run_t *r, size_t expr, const fossil_media_json_value_t *cur);
 
-    fossil_media_json_value_t *copy = NULL;
-    switch (src->type) {
-    case FOSSIL_MEDIA_JSON_NULL:
-        copy = fossil_media_json_new_null();
-        break;
-    case FOSSIL_MEDIA_JSON_BOOL:
-        copy = fossil_media_json_new_bool(src->u.boolean);
-        break;
-    case FOSSIL_MEDIA_JSON_NUMBER:
-        copy = fossil_media_json_new_number(src->u.number);
-        break;
-    case FOSSIL_MEDIA_JSON_STRING:
-        copy = fossil_media_json_new_string(src->u.string);
-        break;
-    case FOSSIL_MEDIA_JSON_ARRAY:
-        copy = fossil_media_json_new_array();
-        if (copy) {
-            for (size_t i = 0; i < src->u.array.count; i++) {
-                fossil_media_json_value_t *child = fossil_media_json_clone_internal(src->u.array.items[i]);
-                if (!child || fossil_media_json_array_append(copy, child) != 0) {
-                    fossil_media_json_free(copy);
-                    return NULL;
-                }
-            }
+/* Clamp a slice bound, negative counting from the end, into [lo, hi] */
+static int64_t query_bound(int64_t i, int64_t len, int64_t lo, int64_t hi) {
+    if (i < 0) i += len;
+    return i < lo ? lo : i > hi ? hi : i;
+}
+
+static int query_select(json_query_run_t *r, const json_query_sel_t *sel, size_t next,
+                        const fossil_media_json_value_t *v) {
+    int rc = 0;
+    switch (sel->kind) {
+    case JSON_QSEL_NAME: {
+        if (v->type != FOSSIL_MEDIA_JSON_OBJECT) return 0;
+        ptrdiff_t at = object_find_n(v, sel->lit->u.string, sel->len, sel->hash);
+        return at >= 0 ? query_segments(r, next, v->u.object.values[at]) : 0;
+    }
+    case JSON_QSEL_WILD:
+        for (size_t i = 0, n = walk_count(v); i < n && !rc; ++i) rc = query_segments(r, next, walk_child(v, i));
+        return rc;
+    case JSON_QSEL_INDEX: {
+        if (v->type != FOSSIL_MEDIA_JSON_ARRAY) return 0;
+        int64_t n = (int64_t)v->u.array.count, i = sel->start < 0 ? sel->start + n : sel->start;
+        return i >= 0 && i < n ? query_segments(r, next, v->u.array.items[i]) : 0;
+    }
+    case JSON_QSEL_SLICE: {
+        if (v->type != FOSSIL_MEDIA_JSON_ARRAY || sel->step == 0) return 0;
+        int64_t n = (int64_t)v->u.array.count;
+        if (sel->step > 0) {
+            int64_t lo = sel->has_start ? query_bound(sel->start, n, 0, n) : 0;
+            int64_t hi = sel->has_end ? query_bound(sel->end, n, 0, n) : n;
+            for (int64_t i = lo; i < hi && !rc; i += sel->step) rc = query_segments(r, next, v->u.array.items[i]);
+        } else {
+            int64_t hi = sel->has_start ? query_bound(sel->start, n, -1, n - 1) : n - 1;
+            int64_t lo = sel->has_end ? query_bound(sel->end, n, -1, n - 1) : -1;
+            for (int64_t i = hi; i > lo && !rc; i += sel->step) rc = query_segments(r, next, v->u.array.items[i]);
         }
-        break;
-    case FOSSIL_MEDIA_JSON_OBJECT:
-        copy = fossil_media_json_new_object();
-        if (copy) {
-            for (size_t i = 0; i < src->u.object.count; i++) {
-                fossil_media_json_value_t *child = fossil_media_json_clone_internal(src->u.object.values[i]);
-                if (!child || fossil_media_json_object_set(copy, src->u.object.keys[i], child) != 0) {
-                    fossil_media_json_free(copy);
-                    return NULL;
-                }
-            }
+        return rc;
+    }
+    case JSON_QSEL_FILTER:
+        for (size_t i = 0, n = walk_count(v); i < n && !rc; ++i) {
+            const fossil_media_json_value_t *c = walk_child(v, i);
+            rc = query_test(r, sel->expr, c);
+            if (rc > 0) rc = query_segments(r, next, c);
         }
-        break;
+        return rc;
     default:
-        break;
+        return 0;
     }
-    return copy;
 }
 
-fossil_media_json_value_t *
-fossil_media_json_clone(const fossil_media_json_value_t *src) {
-    return fossil_media_json_clone_internal(src);
+static int query_selectors(json_query_run_t *r, const json_query_seg_t *seg, const fossil_media_json_value_t *v) {
+    int rc = 0;
+    for (size_t i = seg->first; i != JSON_QUERY_NONE && !rc; i = r->q->sels[i].next)
+        rc = query_select(r, &r->q->sels[i], seg->next, v);
+    return rc;
 }
 
-int fossil_media_json_equals(const fossil_media_json_value_t *a,
-                             const fossil_media_json_value_t *b) {
-    if (!a && !b) return -1;
-    if (!a || !b) return 0;
-    if (a->type != b->type) return 0;
+static int query_stack_push(json_query_stack_t *st, const fossil_media_json_value_t *v) {
+    if (st->depth == st->cap) {
+        size_t cap = st->cap ? st->cap * 2 : 32;
+        json_query_frame_t *tmp = fm_realloc(st->frames, cap * sizeof(*tmp));
+        if (!tmp) return -1;
+        st->frames = tmp;
+        st->cap = cap;
+    }
+    st->frames[st->depth].v = v;
+    st->frames[st->depth++].next = 0;
+    return 0;
+}
 
-    switch (a->type) {
-    case FOSSIL_MEDIA_JSON_NULL:
-        return 1;
-    case FOSSIL_MEDIA_JSON_BOOL:
-        return a->u.boolean == b->u.boolean;
-    case FOSSIL_MEDIA_JSON_NUMBER:
-        return a->u.number == b->u.number;
-    case FOSSIL_MEDIA_JSON_STRING:
-        if (!a->u.string && !b->u.string) return 1;
-        if (!a->u.string || !b->u.string) return 0;
-        return strcmp(a->u.string, b->u.string) == 0;
-    case FOSSIL_MEDIA_JSON_ARRAY:
-        if (a->u.array.count != b->u.array.count) return 0;
-        for (size_t i = 0; i < a->u.array.count; i++) {
-            if (!fossil_media_json_equals(a->u.array.items[i], b->u.array.items[i]))
-                return 0;
+static int query_segments(json_query_run_t *r, size_t seg, const fossil_media_json_value_t *v) {
+    if (seg == JSON_QUERY_NONE) return r->emit(r, v);
+    const json_query_seg_t *g = &r->q->segs[seg];
+    int rc = query_selectors(r, g, v);
+    if (!g->descendant || rc || !walk_count(v)) return rc;
+
+    /* ..: the selectors apply to v, then to every descendant in document order */
+    json_query_stack_t *st = r->stack;
+    size_t base = st->depth;
+    rc = query_stack_push(st, v);
+    while (!rc && st->depth > base) {
+        json_query_frame_t *f = &st->frames[st->depth - 1];
+        if (f->next == walk_count(f->v)) { st->depth--; continue; }
+        const fossil_media_json_value_t *c = walk_child(f->v, f->next++);
+        rc = query_selectors(r, g, c);
+        if (!rc && walk_count(c)) rc = query_stack_push(st, c);
+    }
+    st->depth = base;
+    return rc;
+}
+
+/* Resolve a comparison operand to a node, or NULL for a query that selects nothing */
+static int query_operand(json_query_run_t *r, size_t expr, const fossil_media_json_value_t *cur,
+                         const fossil_media_json_value_t **out) {
+    const json_query_expr_t *e = &r->q->exprs[expr];
+    if (e->op == JSON_QEXPR_LITERAL) { *out = e->lit; return 0; }
+    json_query_run_t sub = *r;
+    sub.emit = query_emit_first;
+    sub.found = NULL;
+    int rc = query_segments(&sub, e->seg, e->absolute ? r->root : cur);
+    *out = sub.found;
+    return rc < 0 ? rc : 0;
+}
+
+static int query_number_less(const fossil_media_json_value_t *a, const fossil_media_json_value_t *b) {
+    unsigned ka = number_kind(a), kb = number_kind(b);
+    if (!ka || !kb) return a->u.number < b->u.number;
+    if (ka != kb) return kb == JSON_FLAG_UINT64;
+    if (ka == JSON_FLAG_UINT64) return a->u.integer.exact.u64 < b->u.integer.exact.u64;
+    return a->u.integer.exact.i64 < b->u.integer.exact.i64;
+}
+
+/* Only numbers and strings are ordered; anything else compares false */
+static int query_less(const fossil_media_json_value_t *a, const fossil_media_json_value_t *b) {
+    if (!a || !b || a->type != b->type) return 0;
+    if (a->type == FOSSIL_MEDIA_JSON_NUMBER) return query_number_less(a, b);
+    if (a->type == FOSSIL_MEDIA_JSON_STRING) return strcmp(a->u.string ? a->u.string : "", b->u.string ? b->u.string : "") < 0;
+    return 0;
+}
+
+static int query_equal(const fossil_media_json_value_t *a, const fossil_media_json_value_t *b) {
+    return !a || !b ? !a && !b : fossil_media_json_equals(a, b) == 1;
+}
+
+/* 1 if the predicate holds for `cur`, 0 if not, -1 on allocation failure */
+static int query_test(json_query_run_t *r, size_t expr, const fossil_media_json_value_t *cur) {
+    const json_query_expr_t *e = &r->q->exprs[expr];
+    const fossil_media_json_value_t *a, *b;
+    int rc;
+    switch (e->op) {
+    case JSON_QEXPR_OR:
+        rc = query_test(r, e->a, cur);
+        return rc ? rc : query_test(r, e->b, cur);
+    case JSON_QEXPR_AND:
+        rc = query_test(r, e->a, cur);
+        return rc <= 0 ? rc : query_test(r, e->b, cur);
+    case JSON_QEXPR_NOT:
+        rc = query_test(r, e->a, cur);
+        return rc < 0 ? rc : !rc;
+    case JSON_QEXPR_EXISTS:
+        rc = query_operand(r, e->a, cur, &a);
+        return rc < 0 ? rc : a != NULL;
+    default:
+        if (query_operand(r, e->a, cur, &a) < 0 || query_operand(r, e->b, cur, &b) < 0) return -1;
+        switch (e->op) {
+        case JSON_QEXPR_EQ: return query_equal(a, b);
+        case JSON_QEXPR_NE: return !query_equal(a, b);
+        case JSON_QEXPR_LT: return query_less(a, b);
+        case JSON_QEXPR_LE: return query_less(a, b) || query_equal(a, b);
+        case JSON_QEXPR_GT: return query_less(b, a);
+        case JSON_QEXPR_GE: return query_less(b, a) || query_equal(a, b);
+        default: return 0;
         }
-        return 1;
-    case FOSSIL_MEDIA_JSON_OBJECT:
-        if (a->u.object.count != b->u.object.count) return 0;
-        for (size_t i = 0; i < a->u.object.count; i++) {
-            fossil_media_json_value_t *val_b = fossil_media_json_object_get(b, a->u.object.keys[i]);
-            if (!val_b || !fossil_media_json_equals(a->u.object.values[i], val_b))
-                return 0;
+    }
+}
+
+int fossil_media_json_query_run(const fossil_media_json_query_t *query,
+                                const fossil_media_json_value_t *root,
+                                fossil_media_json_query_result_t *out,
+                                fossil_media_json_error_t *err_out) {
+    fossil_media_json_error_t errtmp = {0,0,""};
+    if (!query || !root || !out) { set_error(&errtmp, 1, 0, "NULL input"); if (err_out) *err_out = errtmp; return -1; }
+    json_query_stack_t stack = {NULL, 0, 0};
+    json_query_run_t r = {query, root, query_emit_result, out, NULL, &stack};
+    out->count = 0;
+    int rc = query_segments(&r, query->seg, root);
+    fm_free(stack.frames);
+    if (rc < 0) set_error(&errtmp, 1, 0, "OOM");
+    if (err_out) *err_out = errtmp;
+    return rc < 0 ? -1 : 0;
+}
+
+void fossil_media_json_query_result_free(fossil_media_json_query_result_t *result) {
+    if (!result) return;
+    fm_free(result->items);
+    result->items = NULL;
+    result->count = result->capacity = 0;
+}
+
+// -----------------------------------------------------------------------------
+// On-demand navigation
+// -----------------------------------------------------------------------------
+//
+// A lazy document is just the borrowed text plus refs holding byte offsets.
+// Looking up a member or element walks the enclosing container and skips
+// every other value with a bracket-matching scan that classifies 64 bytes
+// at a time, the way stage 1 of the structural index does, and only counts
+// brackets outside strings. Skipped values are only checked for balanced
+// brackets and terminated strings. Values that are actually read go through
+// the parser's own lexers (or parse_value() for to_value) and are fully
+// checked. Navigation allocates nothing; only strings with escapes and
+// materialised subtrees do.
+
+struct fossil_media_json_lazy {
+    const char *text;    /* borrowed, NUL-terminated */
+    size_t root;         /* offset of the top-level value */
+};
+
+#ifdef JSON_SIMD_X86
+/*
+ * Offset just past the array or object opened at s[i], or 0 if it is cut
+ * short. Works on aligned 64-byte blocks, which never cross a page, so it
+ * may read before s[i] and past the terminating NUL (see "String runs" for
+ * why that is safe and unsanitized); those bits are masked off. Strings are masked out with the same
+ * prefix XOR as the structural index, and a block whose closing brackets
+ * cannot bring the depth to zero is settled with two popcounts.
+ */
+JSON_NO_SANITIZE
+static size_t lazy_skip_container(const char *s, size_t i) {
+    const __m128i c_quote = _mm_set1_epi8('"'), c_bslash = _mm_set1_epi8('\\');
+    const __m128i c_open = _mm_set1_epi8('{'), c_close = _mm_set1_epi8('}');
+    const __m128i c_case = _mm_set1_epi8(0x20), zero = _mm_setzero_si128();
+    size_t off = (size_t)((uintptr_t)(s + i) & 63);
+    const char *blk = s + i - off;
+    uint64_t live = ~(uint64_t)0 << off;
+    uint64_t esc_carry = 0, str_carry = 0;
+    size_t depth = 0;
+    for (;; blk += 64, live = ~(uint64_t)0) {
+        uint64_t quote = 0, bslash = 0, open = 0, close = 0, nul = 0;
+        for (int k = 0; k < 4; ++k) {
+            __m128i v = _mm_load_si128((const __m128i *)(const void *)(blk + 16 * k));
+            /* Setting bit 5 folds '[' onto '{' and ']' onto '}' */
+            __m128i folded = _mm_or_si128(v, c_case);
+            int sh = 16 * k;
+            quote |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, c_quote)) << sh;
+            bslash |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, c_bslash)) << sh;
+            open |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(folded, c_open)) << sh;
+            close |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(folded, c_close)) << sh;
+            nul |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) << sh;
         }
-        for (size_t i = 0; i < b->u.object.count; i++) {
-            fossil_media_json_value_t *val_a = fossil_media_json_object_get(a, b->u.object.keys[i]);
-            if (!val_a || !fossil_media_json_equals(b->u.object.values[i], val_a))
-                return 0;
+        quote &= live & ~json_escaped_bits(bslash & live, &esc_carry);
+        uint64_t outside = live & ~json_string_bits(quote, &str_carry);
+        open &= outside;
+        close &= outside;
+        nul &= live;
+        if (nul) {
+            uint64_t before = (nul & (0 - nul)) - 1;
+            open &= before;
+            close &= before;
+        } else if (json_popcount64(close) < depth) {
+            depth += json_popcount64(open);
+            depth -= json_popcount64(close);
+            continue;
+        }
+        for (uint64_t ev = open | close; ev; ev &= ev - 1) {
+            unsigned k = json_ctz64(ev);
+            if (open >> k & 1) depth++;
+            else if (--depth == 0) return (size_t)(blk - s) + k + 1;
+        }
+        if (nul) return 0;
+    }
+}
+#else
+static size_t lazy_skip_container(const char *s, size_t i) {
+    size_t depth = 0;
+    for (;; ++i) {
+        switch (s[i]) {
+        case '"':
+            while (s[++i] != '"') {
+                if (!s[i]) return 0;
+                if (s[i] == '\\' && !s[++i]) return 0;
+            }
+            break;
+        case '[': case '{':
+            depth++;
+            break;
+        case ']': case '}':
+            if (--depth == 0) return i + 1;
+            break;
+        case '\0':
+            return 0;
+        default:
+            break;
         }
-        return 1;
-    default:
-        break;
     }
-    return 0;
 }
+#endif
 
-// -----------------------------------------------------------------------------
-// Type Helpers
-// -----------------------------------------------------------------------------
+/* Offset just past the string opened at s[i], or 0 if it is unterminated */
+static size_t lazy_skip_string(const char *s, size_t i) {
+    for (i++;;) {
+        i += json_plain_run(s + i, 0);
+        if (s[i] == '"') return i + 1;
+        if (!s[i] || !s[i + 1]) return 0;
+        i += 2;
+    }
+}
 
-int fossil_media_json_is_null(const fossil_media_json_value_t *v) {
-    return v && v->type == FOSSIL_MEDIA_JSON_NULL;
+/* Offset just past the value at s[i], or 0 if it is cut short or unbalanced */
+static size_t lazy_skip(const char *s, size_t i) {
+    char ch = s[i];
+    if (ch == '"') return lazy_skip_string(s, i);
+    if (ch == '[' || ch == '{') return lazy_skip_container(s, i);
+    size_t start = i;
+    while (!idx_scalar_end(s[i]) && s[i] != ':') i++;
+    return i > start ? i : 0;
 }
 
-int fossil_media_json_is_array(const fossil_media_json_value_t *v) {
-    return v && v->type == FOSSIL_MEDIA_JSON_ARRAY;
+static fossil_media_json_lazy_ref_t lazy_ref(const fossil_media_json_lazy_t *doc, size_t pos) {
+    fossil_media_json_lazy_ref_t ref = {doc, pos};
+    return ref;
 }
 
-int fossil_media_json_is_object(const fossil_media_json_value_t *v) {
-    return v && v->type == FOSSIL_MEDIA_JSON_OBJECT;
+fossil_media_json_lazy_t *fossil_media_json_lazy_open(const char *json_text, fossil_media_json_error_t *err_out) {
+    fossil_media_json_error_t errtmp = {0,0,""};
+    fossil_media_json_lazy_t *doc = NULL;
+    size_t i = json_text ? validate_ws(json_text, 0) : 0;
+    if (!json_text) set_error(&errtmp, 1, 0, "NULL input");
+    else if (!json_text[i]) set_error(&errtmp, 1, i, "Unexpected end of input");
+    else if (!strchr("{[\"-0123456789tfn", json_text[i])) set_error(&errtmp, 1, i, "Unexpected token '%c'", json_text[i]);
+    else if (!(doc = fm_malloc(sizeof(*doc)))) set_error(&errtmp, 1, 0, "OOM");
+    else {
+        doc->text = json_text;
+        doc->root = i;
+    }
+    if (err_out) *err_out = errtmp;
+    return doc;
 }
 
-// -----------------------------------------------------------------------------
-// Memory & Capacity
-// -----------------------------------------------------------------------------
+void fossil_media_json_lazy_close(fossil_media_json_lazy_t *doc) {
+    fm_free(doc);
+}
 
-int fossil_media_json_array_reserve(fossil_media_json_value_t *arr, size_t capacity) {
-    if (!arr || arr->type != FOSSIL_MEDIA_JSON_ARRAY) return -1;
-    if (capacity <= arr->u.array.capacity) return 0;
+fossil_media_json_lazy_ref_t fossil_media_json_lazy_root(const fossil_media_json_lazy_t *doc) {
+    return lazy_ref(doc, doc ? doc->root : 0);
+}
 
-    fossil_media_json_value_t **new_items =
-        fm_realloc(arr->u.array.items, capacity * sizeof(*new_items));
-    if (!new_items) return -1;
+fossil_media_json_type_t fossil_media_json_lazy_type(fossil_media_json_lazy_ref_t ref) {
+    if (!ref.doc) return FOSSIL_MEDIA_JSON_NULL;
+    switch (ref.doc->text[ref.pos]) {
+    case '{': return FOSSIL_MEDIA_JSON_OBJECT;
+    case '[': return FOSSIL_MEDIA_JSON_ARRAY;
+    case '"': return FOSSIL_MEDIA_JSON_STRING;
+    case 't': case 'f': return FOSSIL_MEDIA_JSON_BOOL;
+    case 'n': return FOSSIL_MEDIA_JSON_NULL;
+    default: return FOSSIL_MEDIA_JSON_NUMBER;
+    }
+}
 
-    arr->u.array.items = new_items;
-    arr->u.array.capacity = capacity;
+int fossil_media_json_lazy_iter_init(fossil_media_json_lazy_ref_t container, fossil_media_json_lazy_iter_t *it) {
+    if (!it) return -1;
+    memset(it, 0, sizeof(*it));
+    if (!container.doc) return -1;
+    char ch = container.doc->text[container.pos];
+    if (ch != '[' && ch != '{') return -1;
+    it->doc = container.doc;
+    it->object = ch == '{';
+    it->next = container.pos + 1;
     return 0;
 }
 
-int fossil_media_json_object_reserve(fossil_media_json_value_t *obj, size_t capacity) {
-    if (!obj || obj->type != FOSSIL_MEDIA_JSON_OBJECT) return -1;
-    if (capacity <= obj->u.object.capacity) return 0;
-
-    char **new_keys = fm_realloc(obj->u.object.keys, capacity * sizeof(*new_keys));
-    fossil_media_json_value_t **new_vals =
-        fm_realloc(obj->u.object.values, capacity * sizeof(*new_vals));
-    if (!new_keys || !new_vals) return -1;
-
-    obj->u.object.keys = new_keys;
-    obj->u.object.values = new_vals;
-    obj->u.object.capacity = capacity;
+/* Items are found by skipping their predecessors; malformed input just ends the walk */
+int fossil_media_json_lazy_iter_next(fossil_media_json_lazy_iter_t *it) {
+    if (!it || !it->doc) return 0;
+    const char *s = it->doc->text;
+    size_t i = validate_ws(s, it->next), end;
+    if (it->value.doc) {
+        if (s[i] != ',') goto done;
+        i = validate_ws(s, i + 1);
+    }
+    if (it->object) {
+        if (s[i] != '"' || !(end = lazy_skip_string(s, i))) goto done;
+        it->key = s + i + 1;
+        it->key_len = end - i - 2;
+        i = validate_ws(s, end);
+        if (s[i] != ':') goto done;
+        i = validate_ws(s, i + 1);
+    }
+    if (!(end = lazy_skip(s, i))) goto done;
+    it->value = lazy_ref(it->doc, i);
+    it->next = end;
+    return 1;
+done:
+    it->doc = NULL;
+    it->value.doc = NULL;
+    it->key = NULL;
+    it->key_len = 0;
     return 0;
 }
 
-// -----------------------------------------------------------------------------
-// File I/O
-// -----------------------------------------------------------------------------
+/* Whether the member key under `it` decodes to key[0, len) */
+static int lazy_key_equals(const fossil_media_json_lazy_iter_t *it, const char *key, size_t len) {
+    if (!memchr(it->key, '\\', it->key_len)) return it->key_len == len && memcmp(it->key, key, len) == 0;
+    /* Escaped keys are rare: decode with the parser's lexer */
+    ctx_t c;
+    const char *p;
+    size_t n;
+    memset(&c, 0, sizeof(c));
+    c.s = it->doc->text;
+    c.i = (size_t)(it->key - 1 - c.s);
+    int eq = scan_string(&c, NULL, &p, &n) == 0 && n == len && memcmp(p, key, len) == 0;
+    fm_free(c.sbuf);
+    return eq;
+}
 
-fossil_media_json_value_t *
-fossil_media_json_parse_file(const char *filename, fossil_media_json_error_t *err_out) {
-    if (!filename) return NULL;
-    FILE *f = fopen(filename, "rb");
-    if (!f) return NULL;
+static fossil_media_json_lazy_ref_t lazy_find(fossil_media_json_lazy_ref_t obj, const char *key, size_t len) {
+    fossil_media_json_lazy_iter_t it;
+    if (fossil_media_json_lazy_type(obj) == FOSSIL_MEDIA_JSON_OBJECT && fossil_media_json_lazy_iter_init(obj, &it) == 0) {
+        while (fossil_media_json_lazy_iter_next(&it))
+            if (lazy_key_equals(&it, key, len)) return it.value;
+    }
+    return lazy_ref(NULL, 0);
+}
 
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    rewind(f);
+fossil_media_json_lazy_ref_t fossil_media_json_lazy_get(fossil_media_json_lazy_ref_t obj, const char *key) {
+    return key ? lazy_find(obj, key, strlen(key)) : lazy_ref(NULL, 0);
+}
 
-    char *buf = (char *)fm_malloc(size + 1);
-    if (!buf) {
-        fclose(f);
-        return NULL;
-    }
-    if (fread(buf, 1, size, f) != (size_t)size) {
-        fm_free(buf);
-        fclose(f);
-        return NULL;
+fossil_media_json_lazy_ref_t fossil_media_json_lazy_index(fossil_media_json_lazy_ref_t arr, size_t index) {
+    fossil_media_json_lazy_iter_t it;
+    if (fossil_media_json_lazy_type(arr) == FOSSIL_MEDIA_JSON_ARRAY && fossil_media_json_lazy_iter_init(arr, &it) == 0) {
+        for (size_t k = 0; fossil_media_json_lazy_iter_next(&it); ++k)
+            if (k == index) return it.value;
     }
-    buf[size] = '\0';
-    fclose(f);
+    return lazy_ref(NULL, 0);
+}
 
-    fossil_media_json_value_t *v = fossil_media_json_parse(buf, err_out);
-    fm_free(buf);
-    return v;
+size_t fossil_media_json_lazy_size(fossil_media_json_lazy_ref_t ref) {
+    fossil_media_json_lazy_iter_t it;
+    size_t n = 0;
+    if (fossil_media_json_lazy_iter_init(ref, &it) == 0)
+        while (fossil_media_json_lazy_iter_next(&it)) n++;
+    return n;
 }
 
-int fossil_media_json_write_file(const fossil_media_json_value_t *v,
-                                 const char *filename,
-                                 int pretty,
-                                 fossil_media_json_error_t *err_out) {
-    if (!filename || !v) return -1;
-    FILE *f = fopen(filename, "wb");
-    if (!f) return -1;
+fossil_media_json_lazy_ref_t fossil_media_json_lazy_get_path(fossil_media_json_lazy_ref_t ref, const char *path) {
+    if (!ref.doc || !path) return lazy_ref(NULL, 0);
+    json_path_seg_t seg;
+    int rc;
+    while ((rc = path_next(&path, &seg)) > 0) {
+        if (seg.key && fossil_media_json_lazy_type(ref) == FOSSIL_MEDIA_JSON_OBJECT)
+            ref = lazy_find(ref, seg.key, seg.len);
+        else if (seg.index != JSON_PATH_NO_INDEX)
+            ref = fossil_media_json_lazy_index(ref, seg.index);
+        else
+            ref = lazy_ref(NULL, 0);
+        if (!ref.doc) return ref;
+    }
+    return rc == 0 ? ref : lazy_ref(NULL, 0);
+}
 
-    char *s = fossil_media_json_stringify(v, pretty, err_out);
-    if (!s) {
-        fclose(f);
+/* Lex the scalar at ref into a stack node; 0 on success */
+static int lazy_scalar(fossil_media_json_lazy_ref_t ref, fossil_media_json_value_t *v) {
+    if (!ref.doc) return -1;
+    ctx_t c;
+    memset(&c, 0, sizeof(c));
+    memset(v, 0, sizeof(*v));
+    c.s = ref.doc->text;
+    c.i = ref.pos;
+    char ch = c.s[c.i];
+    if (ch == '-' || (ch >= '0' && ch <= '9')) {
+        uint64_t mag = 0;
+        int kind = 0;
+        if (scan_number(&c, NULL, &v->u.number, &mag, &kind) != 0) return -1;
+        v->type = FOSSIL_MEDIA_JSON_NUMBER;
+        if (kind > 0) set_uint64(v, mag);
+        else if (kind < 0) set_int64(v, mag > (uint64_t)INT64_MAX ? INT64_MIN : -(int64_t)mag);
+    } else if (ch == 't' || ch == 'f' || ch == 'n') {
+        int type = scan_literal(&c, NULL, &v->u.boolean);
+        if (type < 0) return -1;
+        v->type = (fossil_media_json_type_t)type;
+    } else {
         return -1;
     }
-    fputs(s, f);
-    fm_free(s);
-    fclose(f);
+    return idx_scalar_end(c.s[c.i]) ? 0 : -1;
+}
+
+int fossil_media_json_lazy_get_number(fossil_media_json_lazy_ref_t ref, double *out) {
+    fossil_media_json_value_t v;
+    if (!out || lazy_scalar(ref, &v) != 0 || v.type != FOSSIL_MEDIA_JSON_NUMBER) return -1;
+    *out = v.u.number;
     return 0;
 }
 
-// -----------------------------------------------------------------------------
-// Number Handling
-// -----------------------------------------------------------------------------
+int fossil_media_json_lazy_get_int(fossil_media_json_lazy_ref_t ref, long long *out) {
+    fossil_media_json_value_t v;
+    return lazy_scalar(ref, &v) == 0 ? fossil_media_json_get_int(&v, out) : -1;
+}
 
-fossil_media_json_value_t *fossil_media_json_new_int(long long i) {
-    return fossil_media_json_new_number((double)i);
+int fossil_media_json_lazy_get_uint(fossil_media_json_lazy_ref_t ref, unsigned long long *out) {
+    fossil_media_json_value_t v;
+    return lazy_scalar(ref, &v) == 0 ? fossil_media_json_get_uint(&v, out) : -1;
 }
 
-int fossil_media_json_get_int(const fossil_media_json_value_t *v, long long *out) {
-    if (!v || v->type != FOSSIL_MEDIA_JSON_NUMBER || !out) return -1;
-    *out = (long long)v->u.number;
+int fossil_media_json_lazy_get_bool(fossil_media_json_lazy_ref_t ref, int *out) {
+    fossil_media_json_value_t v;
+    if (!out || lazy_scalar(ref, &v) != 0 || v.type != FOSSIL_MEDIA_JSON_BOOL) return -1;
+    *out = v.u.boolean;
     return 0;
 }
 
+char *fossil_media_json_lazy_get_string(fossil_media_json_lazy_ref_t ref, size_t *len_out) {
+    if (!ref.doc || ref.doc->text[ref.pos] != '"') return NULL;
+    ctx_t c;
+    const char *p;
+    size_t n;
+    char *out = NULL;
+    memset(&c, 0, sizeof(c));
+    c.s = ref.doc->text;
+    c.i = ref.pos;
+    if (scan_string(&c, NULL, &p, &n) == 0 && (out = fm_malloc(n + 1)) != NULL) {
+        memcpy(out, p, n);
+        out[n] = '\0';
+        if (len_out) *len_out = n;
+    }
+    fm_free(c.sbuf);
+    return out;
+}
+
+fossil_media_json_value_t *fossil_media_json_lazy_to_value(fossil_media_json_lazy_ref_t ref,
+                                                           fossil_media_json_error_t *err_out) {
+    fossil_media_json_error_t errtmp = {0,0,""};
+    if (!ref.doc) { set_error(&errtmp, 1, 0, "Invalid reference"); if (err_out) *err_out = errtmp; return NULL; }
+    ctx_t c;
+    memset(&c, 0, sizeof(c));
+    c.s = ref.doc->text;
+    c.i = ref.pos;
+    fossil_media_json_value_t *v = parse_value(&c, &errtmp);
+    fm_free(c.stack);
+    fm_free(c.frames);
+    fm_free(c.sbuf);
+    if (err_out) *err_out = errtmp;
+    return v;
+}
+
 // -----------------------------------------------------------------------------
-// Debug & Validation
+// Patching
 // -----------------------------------------------------------------------------
+//
+// Merge patches (RFC 7386) and JSON Patch documents (RFC 6902) edit the
+// target tree in place. Only values taken from the patch are copied; moved
+// members are relinked, not cloned. A JSON Patch records the inverse of each
+// step in an undo log, so a failing operation rolls the target back to its
+// state before the call. Removed and replaced values are released only once
+// every operation has succeeded.
 
-void fossil_media_json_debug_dump(const fossil_media_json_value_t *v, int indent) {
-    if (!v) {
-        printf("%*s(null)\n", indent, "");
-        return;
+/* Make `dst` hold the contents of heap node `src`; `src` keeps the old contents */
+static void value_swap(fossil_media_json_value_t *dst, fossil_media_json_value_t *src) {
+    fossil_media_json_value_t tmp = *dst;
+    *dst = *src;
+    *src = tmp;
+}
+
+/* Insert `val` at items[pos], growing through the public reserve helper */
+static int array_insert(fossil_media_json_value_t *arr, size_t pos, fossil_media_json_value_t *val) {
+    size_t count = arr->u.array.count;
+    if (count == arr->u.array.capacity &&
+        fossil_media_json_array_reserve(arr, count ? count * 2 : 4) != 0) return -1;
+    fossil_media_json_value_t **items = arr->u.array.items;
+    memmove(items + pos + 1, items + pos, (count - pos) * sizeof(*items));
+    items[pos] = val;
+    arr->u.array.count++;
+    return 0;
+}
+
+static fossil_media_json_value_t *array_take(fossil_media_json_value_t *arr, size_t pos) {
+    fossil_media_json_value_t **items = arr->u.array.items;
+    fossil_media_json_value_t *val = items[pos];
+    memmove(items + pos, items + pos + 1, (arr->u.array.count - pos - 1) * sizeof(*items));
+    arr->u.array.count--;
+    return val;
+}
+
+/* Insert member (key, val) at position pos; the object takes the heap key */
+static int object_insert(fossil_media_json_value_t *obj, size_t pos, char *key, fossil_media_json_value_t *val) {
+    size_t count = obj->u.object.count;
+    if (object_own_keys(obj) != 0) return -1;
+    if (count == obj->u.object.capacity &&
+        fossil_media_json_object_reserve(obj, count ? count * 2 : 4) != 0) return -1;
+    char **keys = obj->u.object.keys;
+    fossil_media_json_value_t **values = obj->u.object.values;
+    memmove(keys + pos + 1, keys + pos, (count - pos) * sizeof(*keys));
+    memmove(values + pos + 1, values + pos, (count - pos) * sizeof(*values));
+    keys[pos] = key;
+    values[pos] = val;
+    obj->u.object.count++;
+    if (pos == count) {
+        keymap_appended(obj);
+    } else {
+        /* Every later position moved; the index is rebuilt on the next lookup */
+        keymap_forget(obj);
     }
-    const char *type = fossil_media_json_type_name(v->type);
-    printf("%*sType: %s\n", indent, "", type);
+    return 0;
+}
 
-    switch (v->type) {
-    case FOSSIL_MEDIA_JSON_NULL:
-        break;
-    case FOSSIL_MEDIA_JSON_BOOL:
-        printf("%*sValue: %s\n", indent + 2, "", v->u.boolean ? "true" : "false");
-        break;
-    case FOSSIL_MEDIA_JSON_NUMBER:
-        printf("%*sValue: %g\n", indent + 2, "", v->u.number);
-        break;
-    case FOSSIL_MEDIA_JSON_STRING:
-        printf("%*sValue: \"%s\"\n", indent + 2, "", v->u.string ? v->u.string : "(null)");
-        break;
-    case FOSSIL_MEDIA_JSON_ARRAY:
-        for (size_t i = 0; i < v->u.array.count; i++) {
-            printf("%*s[%lu]\n", indent + 2, "", (unsigned long)i);
-            fossil_media_json_debug_dump(v->u.array.items[i], indent + 4);
+/* Detach member pos; the caller owns the returned value and *key_out */
+static fossil_media_json_value_t *object_take(fossil_media_json_value_t *obj, size_t pos, char **key_out) {
+    if (object_own_keys(obj) != 0) return NULL;
+    char **keys = obj->u.object.keys;
+    fossil_media_json_value_t **values = obj->u.object.values;
+    fossil_media_json_value_t *val = values[pos];
+    char *key = keys[pos];
+    size_t tail = obj->u.object.count - pos - 1;
+    memmove(keys + pos, keys + pos + 1, tail * sizeof(*keys));
+    memmove(values + pos, values + pos + 1, tail * sizeof(*values));
+    obj->u.object.count--;
+    keymap_removed(obj, pos, key);
+    *key_out = key;
+    return val;
+}
+
+/* Merge patches */
+
+int fossil_media_json_apply_merge_patch(fossil_media_json_value_t *target,
+                                        const fossil_media_json_value_t *patch,
+                                        fossil_media_json_error_t *err_out) {
+    fossil_media_json_error_t errtmp = {0, 0, ""};
+    if (!target || !patch) {
+        set_error(&errtmp, FOSSIL_MEDIA_JSON_ERROR, 0, "NULL value");
+        if (err_out) *err_out = errtmp;
+        return -1;
+    }
+    if (JSON_IS_ARENA(target)) {
+        set_error(&errtmp, FOSSIL_MEDIA_JSON_ERROR, 0, "Target is read-only");
+        if (err_out) *err_out = errtmp;
+        return -1;
+    }
+
+    /* A non-object patch replaces the target; an object patch needs an object */
+    if (patch->type != FOSSIL_MEDIA_JSON_OBJECT || target->type != FOSSIL_MEDIA_JSON_OBJECT) {
+        fossil_media_json_value_t *fresh = patch->type == FOSSIL_MEDIA_JSON_OBJECT
+            ? fossil_media_json_new_object() : fossil_media_json_clone(patch);
+        if (!fresh) {
+            set_error(&errtmp, FOSSIL_MEDIA_JSON_ERROR, 0, "OOM");
+            if (err_out) *err_out = errtmp;
+            return -1;
         }
-        break;
-    case FOSSIL_MEDIA_JSON_OBJECT:
-        for (size_t i = 0; i < v->u.object.count; i++) {
-            printf("%*s\"%s\":\n", indent + 2, "", v->u.object.keys[i]);
-            fossil_media_json_debug_dump(v->u.object.values[i], indent + 4);
+        value_swap(target, fresh);
+        fossil_media_json_free(fresh);
+        if (patch->type != FOSSIL_MEDIA_JSON_OBJECT) {
+            if (err_out) *err_out = errtmp;
+            return 0;
         }
-        break;
     }
-}
 
-int fossil_media_json_validate(const char *json_text, fossil_media_json_error_t *err_out) {
-    fossil_media_json_error_t errtmp = {0,0,""};
-    fossil_media_json_value_t *v = fossil_media_json_parse(json_text, &errtmp);
-    if (!v) {
-        if (err_out) *err_out = errtmp;
-        return 1;
+    json_walk_t walk;
+    walk_init(&walk);
+    walk_push(&walk, patch)->out = target;
+    int rc = 0;
+    while (walk.depth) {
+        json_walk_frame_t *f = &walk.frames[walk.depth - 1];
+        if (f->next == f->v->u.object.count) { walk.depth--; continue; }
+        size_t i = f->next++;
+        const char *key = f->v->u.object.keys[i];
+        const fossil_media_json_value_t *pv = f->v->u.object.values[i];
+        fossil_media_json_value_t *out = f->out;
+        if (pv->type == FOSSIL_MEDIA_JSON_NULL) {
+            ptrdiff_t found = object_find(out, key);
+            if (found >= 0) {
+                char *k;
+                fossil_media_json_value_t *old = object_take(out, (size_t)found, &k);
+                if (!old) { rc = -1; break; }
+                fm_free(k);
+                fossil_media_json_free(old);
+            }
+        } else if (pv->type == FOSSIL_MEDIA_JSON_OBJECT) {
+            /* Descend into the member, creating or replacing it with an object */
+            fossil_media_json_value_t *t = fossil_media_json_object_get(out, key);
+            if (!t || t->type != FOSSIL_MEDIA_JSON_OBJECT) {
+                t = fossil_media_json_new_object();
+                if (!t || fossil_media_json_object_set(out, key, t) != 0) {
+                    fossil_media_json_free(t);
+                    rc = -1;
+                    break;
+                }
+            }
+            if (pv->u.object.count) {
+                json_walk_frame_t *g = walk_push(&walk, pv);
+                if (!g) { rc = -1; break; }
+                g->out = t;
+            }
+        } else {
+            fossil_media_json_value_t *copy = fossil_media_json_clone(pv);
+            if (!copy || fossil_media_json_object_set(out, key, copy) != 0) {
+                fossil_media_json_free(copy);
+                rc = -1;
+                break;
+            }
+        }
     }
-    fossil_media_json_free(v);
+    walk_release(&walk);
+    if (rc != 0) set_error(&errtmp, FOSSIL_MEDIA_JSON_ERROR, 0, "OOM");
     if (err_out) *err_out = errtmp;
+    return rc;
+}
+
+/* JSON Pointer (RFC 6901) */
+
+typedef struct {
+    const char *p;           /* next '/' or the terminating NUL */
+    char *tok;               /* current reference token, unescaped and NUL-terminated */
+    size_t len;
+    char small[64];
+    char *heap;
+} json_pointer_t;
+
+/* -1 if `path` is not a pointer, else 0 */
+static int pointer_init(json_pointer_t *ptr, const char *path) {
+    ptr->p = path;
+    ptr->heap = NULL;
+    ptr->tok = ptr->small;
+    ptr->len = 0;
+    if (*path && *path != '/') return -1;
+    size_t n = strlen(path);
+    if (n >= sizeof(ptr->small)) {
+        /* An unescaped token is never longer than the pointer itself */
+        if (!(ptr->heap = fm_malloc(n + 1))) return -1;
+        ptr->tok = ptr->heap;
+    }
     return 0;
 }
 
-// -----------------------------------------------------------------------------
-// Path Access
-// -----------------------------------------------------------------------------
+static void pointer_release(json_pointer_t *ptr) {
+    fm_free(ptr->heap);
+}
 
-/**
- * Enhanced path getter: supports dot notation, array indices, quoted keys, and escapes.
- * Example paths:
- *   foo.bar[2].baz
- *   arr[0][1]
- *   "complex.key".arr[1]
- *   foo."key.with.dots"[3]
+/* Decode the next token: 1 = token ready, 0 = end, -1 = bad '~' escape */
+static int pointer_next(json_pointer_t *ptr) {
+    const char *s = ptr->p;
+    if (!*s) return 0;
+    size_t n = 0;
+    for (++s; *s && *s != '/'; ++s) {
+        char ch = *s;
+        if (ch == '~') {
+            if (s[1] == '0') ch = '~';
+            else if (s[1] == '1') ch = '/';
+            else return -1;
+            ++s;
+        }
+        ptr->tok[n++] = ch;
+    }
+    ptr->tok[n] = '\0';
+    ptr->len = n;
+    ptr->p = s;
+    return 1;
+}
+
+/* Array index token: "0" or digits without a leading zero; JSON_PATH_NO_INDEX if invalid */
+static size_t pointer_index(const json_pointer_t *ptr) {
+    const char *t = ptr->tok;
+    if (ptr->len == 0 || (t[0] == '0' && ptr->len > 1)) return JSON_PATH_NO_INDEX;
+    size_t v = 0;
+    for (size_t k = 0; k < ptr->len; ++k) {
+        if (t[k] < '0' || t[k] > '9') return JSON_PATH_NO_INDEX;
+        size_t d = (size_t)(t[k] - '0');
+        if (v > (JSON_PATH_NO_INDEX - 1 - d) / 10) return JSON_PATH_NO_INDEX;
+        v = v * 10 + d;
+    }
+    return v;
+}
+
+/* Child of a container named by the current token, or NULL */
+static fossil_media_json_value_t *pointer_child(fossil_media_json_value_t *v, const json_pointer_t *ptr) {
+    if (v->type == FOSSIL_MEDIA_JSON_OBJECT) {
+        ptrdiff_t found = object_find(v, ptr->tok);
+        return found >= 0 ? v->u.object.values[found] : NULL;
+    }
+    if (v->type == FOSSIL_MEDIA_JSON_ARRAY) {
+        size_t i = pointer_index(ptr);
+        return i < v->u.array.count ? v->u.array.items[i] : NULL;
+    }
+    return NULL;
+}
+
+/*
+ * Resolve all tokens but the last. Returns the parent container with the
+ * last token left in ptr, NULL with *msg set when the path is bad, or the
+ * root itself with ptr->len == 0 and *is_root set for the empty pointer.
  */
-fossil_media_json_value_t *fossil_media_json_get_path(const fossil_media_json_value_t *root, const char *path) {
-    if (!root || !path) return NULL;
+static fossil_media_json_value_t *pointer_parent(fossil_media_json_value_t *root, json_pointer_t *ptr,
+                                                 int *is_root, const char **msg) {
+    fossil_media_json_value_t *cur = root;
+    *is_root = 0;
+    int rc = pointer_next(ptr);
+    if (rc == 0) { *is_root = 1; return root; }
+    while (rc > 0 && *ptr->p) {
+        if (!(cur = pointer_child(cur, ptr))) { *msg = "Path not found"; return NULL; }
+        rc = pointer_next(ptr);
+    }
+    if (rc < 0) { *msg = "Invalid pointer"; return NULL; }
+    if (cur->type != FOSSIL_MEDIA_JSON_OBJECT && cur->type != FOSSIL_MEDIA_JSON_ARRAY) {
+        *msg = "Path not found";
+        return NULL;
+    }
+    if (JSON_IS_ARENA(cur)) { *msg = "Target is read-only"; return NULL; }
+    return cur;
+}
 
-    const fossil_media_json_value_t *cur = root;
-    const char *p = path;
-    size_t path_len = strlen(path);
-    char *buf = fm_malloc(path_len + 1);
-    if (!buf) return NULL;
+/* Value at `path`, or NULL with *msg set */
+static fossil_media_json_value_t *pointer_get(fossil_media_json_value_t *root, const char *path, const char **msg) {
+    json_pointer_t ptr;
+    if (pointer_init(&ptr, path) != 0) { *msg = "Invalid pointer"; return NULL; }
+    fossil_media_json_value_t *cur = root;
+    int rc = 0;
+    while (cur && (rc = pointer_next(&ptr)) > 0) cur = pointer_child(cur, &ptr);
+    pointer_release(&ptr);
+    if (cur && rc < 0) { *msg = "Invalid pointer"; return NULL; }
+    if (!cur) *msg = "Path not found";
+    return cur;
+}
 
-    while (*p && cur) {
-        // Parse next token (object key or array index)
-        size_t toklen = 0;
+/* JSON Patch */
 
-        // Skip dots
-        while (*p == '.') p++;
+enum {
+    JSON_UNDO_TAKE,          /* undo an insert: detach node[pos] */
+    JSON_UNDO_PUT,           /* undo a removal: insert value (and key) back at pos */
+    JSON_UNDO_SWAP,          /* undo a replacement: put value back into slot pos */
+    JSON_UNDO_ROOT           /* undo a root replacement: value holds the old root */
+};
 
-        // Quoted key support
-        if (*p == '"') {
-            p++;
-            const char *q = p;
-            while (*q && *q != '"') {
-                if (*q == '\\' && *(q+1)) q++; // skip escaped char
-                q++;
+typedef struct {
+    int kind;
+    int moved;                          /* the value inserted or removed came from a move */
+    fossil_media_json_value_t *node;    /* container (or the root) */
+    size_t pos;
+    char *key;                          /* JSON_UNDO_PUT on objects */
+    fossil_media_json_value_t *value;
+    fossil_media_json_value_t *shell;   /* JSON_UNDO_ROOT: node that held the new root */
+} json_undo_t;
+
+typedef struct {
+    json_undo_t *log;
+    size_t count, cap;
+} json_undo_log_t;
+
+static json_undo_t *undo_push(json_undo_log_t *u, int kind, fossil_media_json_value_t *node, size_t pos) {
+    if (u->count == u->cap) {
+        size_t cap = u->cap ? u->cap * 2 : 8;
+        json_undo_t *tmp = fm_realloc(u->log, cap * sizeof(*tmp));
+        if (!tmp) return NULL;
+        u->log = tmp;
+        u->cap = cap;
+    }
+    json_undo_t *e = &u->log[u->count++];
+    memset(e, 0, sizeof(*e));
+    e->kind = kind;
+    e->node = node;
+    e->pos = pos;
+    return e;
+}
+
+/* Success: release what the operations removed or replaced */
+static void undo_commit(json_undo_log_t *u) {
+    for (size_t k = 0; k < u->count; ++k) {
+        json_undo_t *e = &u->log[k];
+        fm_free(e->key);
+        if (e->kind == JSON_UNDO_ROOT) {
+            fossil_media_json_free(e->value);
+            fm_free(e->shell);
+        } else if (e->kind == JSON_UNDO_SWAP || (e->kind == JSON_UNDO_PUT && !e->moved)) {
+            fossil_media_json_free(e->value);
+        }
+    }
+    fm_free(u->log);
+}
+
+/* Failure: replay the inverse steps newest first */
+static void undo_rollback(json_undo_log_t *u) {
+    for (size_t k = u->count; k-- > 0;) {
+        json_undo_t *e = &u->log[k];
+        fossil_media_json_value_t *n = e->node;
+        fossil_media_json_value_t *gone = NULL;
+        switch (e->kind) {
+        case JSON_UNDO_TAKE:
+            if (n->type == FOSSIL_MEDIA_JSON_ARRAY) {
+                gone = array_take(n, e->pos);
+            } else {
+                char *key;
+                gone = object_take(n, e->pos, &key);
+                fm_free(key);
             }
-            if (*q != '"') { fm_free(buf); return NULL; }
-            toklen = (size_t)(q - p);
-            if (toklen > 0) strncpy(buf, p, toklen);
-            buf[toklen] = '\0';
-            p = q + 1;
+            break;
+        case JSON_UNDO_PUT:
+            /* Capacity for the slot was there before the removal */
+            if (n->type == FOSSIL_MEDIA_JSON_ARRAY) array_insert(n, e->pos, e->value);
+            else object_insert(n, e->pos, e->key, e->value);
+            e->key = NULL;
+            break;
+        case JSON_UNDO_SWAP: {
+            fossil_media_json_value_t **slot = n->type == FOSSIL_MEDIA_JSON_ARRAY
+                ? &n->u.array.items[e->pos] : &n->u.object.values[e->pos];
+            gone = *slot;
+            *slot = e->value;
+            break;
+        }
+        case JSON_UNDO_ROOT:
+            value_swap(e->shell, n);
+            value_swap(n, e->value);
+            fm_free(e->value);
+            gone = e->shell;
+            break;
+        default:
+            break;
+        }
+        if (!e->moved) fossil_media_json_free(gone);
+    }
+    fm_free(u->log);
+}
+
+/* Detach the value at `path`, logging its reinsertion */
+static fossil_media_json_value_t *patch_remove(fossil_media_json_value_t *root, const char *path,
+                                               json_undo_log_t *u, int moved, const char **msg) {
+    json_pointer_t ptr;
+    if (pointer_init(&ptr, path) != 0) { *msg = "Invalid pointer"; return NULL; }
+    int is_root;
+    fossil_media_json_value_t *parent = pointer_parent(root, &ptr, &is_root, msg);
+    fossil_media_json_value_t *val = NULL;
+    if (parent && is_root) {
+        *msg = "Cannot remove the document root";
+    } else if (parent) {
+        size_t pos = 0;
+        if (parent->type == FOSSIL_MEDIA_JSON_ARRAY) {
+            pos = pointer_index(&ptr);
+            if (pos >= parent->u.array.count) *msg = "Path not found";
         } else {
-            // Unquoted key or array index
-            const char *q = p;
-            while (*q && *q != '.' && *q != '[') q++;
-            toklen = (size_t)(q - p);
-            if (toklen > 0) strncpy(buf, p, toklen);
-            buf[toklen] = '\0';
-            p = q;
-        }
-
-        // Handle object key
-        if (toklen > 0) {
-            if (cur->type == FOSSIL_MEDIA_JSON_OBJECT) {
-                cur = fossil_media_json_object_get(cur, buf);
-                if (!cur) { fm_free(buf); return NULL; }
-            } else if (cur->type == FOSSIL_MEDIA_JSON_ARRAY) {
-                // Try numeric index
-                char *endptr;
-                long idx = strtol(buf, &endptr, 10);
-                if (*endptr == '\0') {
-                    cur = fossil_media_json_array_get(cur, (size_t)idx);
-                    if (!cur) { fm_free(buf); return NULL; }
-                } else {
-                    fm_free(buf);
-                    return NULL;
-                }
-            } else {
-                fm_free(buf);
-                return NULL;
+            ptrdiff_t found = object_find(parent, ptr.tok);
+            if (found < 0) *msg = "Path not found";
+            else pos = (size_t)found;
+        }
+        json_undo_t *e = *msg ? NULL : undo_push(u, JSON_UNDO_PUT, parent, pos);
+        if (e) {
+            e->moved = moved;
+            val = parent->type == FOSSIL_MEDIA_JSON_ARRAY ? array_take(parent, pos) : object_take(parent, pos, &e->key);
+            if (!val) u->count--;
+            e->value = val;
+        }
+        if (!val && !*msg) *msg = "OOM";
+    }
+    pointer_release(&ptr);
+    return val;
+}
+
+/* Insert or replace at `path`; `val` is owned by the document unless this fails */
+static int patch_add(fossil_media_json_value_t *root, const char *path, fossil_media_json_value_t *val,
+                     int replace, json_undo_log_t *u, int moved, const char **msg) {
+    json_pointer_t ptr;
+    if (pointer_init(&ptr, path) != 0) { *msg = "Invalid pointer"; return -1; }
+    int is_root;
+    fossil_media_json_value_t *parent = pointer_parent(root, &ptr, &is_root, msg);
+    json_undo_t *e = NULL;
+    if (!parent) {
+        /* message set by pointer_parent */
+    } else if (is_root) {
+        /* The root node stays in place: it takes over val's contents and a
+           fresh node keeps the old ones until commit or rollback */
+        fossil_media_json_value_t *old = alloc_value();
+        if (old && (e = undo_push(u, JSON_UNDO_ROOT, root, 0)) != NULL) {
+            value_swap(old, root);
+            value_swap(root, val);
+            e->value = old;
+            e->shell = val;
+            e->moved = moved;
+        } else {
+            fm_free(old);
+        }
+    } else if (parent->type == FOSSIL_MEDIA_JSON_ARRAY) {
+        size_t count = parent->u.array.count;
+        size_t pos = ptr.len == 1 && ptr.tok[0] == '-' ? count : pointer_index(&ptr);
+        if (replace ? pos >= count : pos > count) {
+            *msg = "Path not found";
+        } else if (replace) {
+            if ((e = undo_push(u, JSON_UNDO_SWAP, parent, pos)) != NULL) {
+                e->value = parent->u.array.items[pos];
+                parent->u.array.items[pos] = val;
             }
+        } else if ((e = undo_push(u, JSON_UNDO_TAKE, parent, pos)) != NULL) {
+            if (array_insert(parent, pos, val) != 0) { u->count--; e = NULL; }
         }
+    } else {
+        ptrdiff_t found = object_find(parent, ptr.tok);
+        if (found >= 0) {
+            if ((e = undo_push(u, JSON_UNDO_SWAP, parent, (size_t)found)) != NULL) {
+                e->value = parent->u.object.values[found];
+                parent->u.object.values[found] = val;
+            }
+        } else if (replace) {
+            *msg = "Path not found";
+        } else if ((e = undo_push(u, JSON_UNDO_TAKE, parent, parent->u.object.count)) != NULL) {
+            if (fossil_media_json_object_set(parent, ptr.tok, val) != 0) { u->count--; e = NULL; }
+        }
+    }
+    if (e) e->moved = moved;
+    pointer_release(&ptr);
+    if (!e && !*msg) *msg = "OOM";
+    return e ? 0 : -1;
+}
 
-        // Handle array indices (may be chained: arr[1][2])
-        while (*p == '[' && cur) {
-            p++;
-            const char *q = p;
-            while (*q && *q != ']') q++;
-            if (*q != ']') { fm_free(buf); return NULL; }
-            strncpy(buf, p, (size_t)(q - p));
-            buf[q - p] = '\0';
-            long idx = strtol(buf, NULL, 10);
-            if (cur->type != FOSSIL_MEDIA_JSON_ARRAY) { fm_free(buf); return NULL; }
-            cur = fossil_media_json_array_get(cur, (size_t)idx);
-            if (!cur) { fm_free(buf); return NULL; }
-            p = q + 1;
+/* 1 if pointer `prefix` names an ancestor of pointer `path` */
+static int pointer_is_ancestor(const char *prefix, const char *path) {
+    size_t n = strlen(prefix);
+    return strncmp(prefix, path, n) == 0 && path[n] == '/';
+}
+
+/* One operation object; 0 on success, else -1 with *msg set */
+static int patch_apply_one(fossil_media_json_value_t *root, const fossil_media_json_value_t *op,
+                           json_undo_log_t *u, const char **msg) {
+    if (op->type != FOSSIL_MEDIA_JSON_OBJECT) { *msg = "Operation must be an object"; return -1; }
+    const fossil_media_json_value_t *name = fossil_media_json_object_get(op, "op");
+    const fossil_media_json_value_t *path = fossil_media_json_object_get(op, "path");
+    if (!name || name->type != FOSSIL_MEDIA_JSON_STRING) { *msg = "Missing op"; return -1; }
+    if (!path || path->type != FOSSIL_MEDIA_JSON_STRING) { *msg = "Missing path"; return -1; }
+    const char *kind = name->u.string;
+    const fossil_media_json_value_t *value = fossil_media_json_object_get(op, "value");
+    const fossil_media_json_value_t *from = fossil_media_json_object_get(op, "from");
+
+    if (strcmp(kind, "add") == 0 || strcmp(kind, "replace") == 0) {
+        if (!value) { *msg = "Missing value"; return -1; }
+        fossil_media_json_value_t *copy = fossil_media_json_clone(value);
+        if (!copy) { *msg = "OOM"; return -1; }
+        if (patch_add(root, path->u.string, copy, kind[0] == 'r', u, 0, msg) != 0) {
+            fossil_media_json_free(copy);
+            return -1;
         }
+        return 0;
+    }
+    if (strcmp(kind, "remove") == 0)
+        return patch_remove(root, path->u.string, u, 0, msg) ? 0 : -1;
+    if (strcmp(kind, "test") == 0) {
+        if (!value) { *msg = "Missing value"; return -1; }
+        const fossil_media_json_value_t *cur = pointer_get(root, path->u.string, msg);
+        if (!cur) return -1;
+        if (fossil_media_json_equals(cur, value) != 1) { *msg = "Test failed"; return -1; }
+        return 0;
     }
+    if (strcmp(kind, "move") != 0 && strcmp(kind, "copy") != 0) { *msg = "Unknown op"; return -1; }
+    if (!from || from->type != FOSSIL_MEDIA_JSON_STRING) { *msg = "Missing from"; return -1; }
 
-    fossil_media_json_value_t *result = cur ? fossil_media_json_clone(cur) : NULL;
-    fm_free(buf);
-    return result;
+    if (kind[0] == 'c') {
+        const fossil_media_json_value_t *src = pointer_get(root, from->u.string, msg);
+        if (!src) return -1;
+        fossil_media_json_value_t *copy = fossil_media_json_clone(src);
+        if (!copy) { *msg = "OOM"; return -1; }
+        if (patch_add(root, path->u.string, copy, 0, u, 0, msg) != 0) {
+            fossil_media_json_free(copy);
+            return -1;
+        }
+        return 0;
+    }
+    if (strcmp(from->u.string, path->u.string) == 0) {
+        /* Moving a value onto itself only has to find it */
+        return pointer_get(root, from->u.string, msg) ? 0 : -1;
+    }
+    if (pointer_is_ancestor(from->u.string, path->u.string) || !*from->u.string) {
+        *msg = "Cannot move a value into itself";
+        return -1;
+    }
+    fossil_media_json_value_t *val = patch_remove(root, from->u.string, u, 1, msg);
+    if (!val) return -1;
+    /* On failure the logged removal puts val back during rollback */
+    return patch_add(root, path->u.string, val, 0, u, 1, msg);
+}
+
+int fossil_media_json_apply_patch(fossil_media_json_value_t *target,
+                                  const fossil_media_json_value_t *patch,
+                                  fossil_media_json_error_t *err_out) {
+    fossil_media_json_error_t errtmp = {0, 0, ""};
+    if (!target || !patch) {
+        set_error(&errtmp, FOSSIL_MEDIA_JSON_ERROR, 0, "NULL value");
+        if (err_out) *err_out = errtmp;
+        return -1;
+    }
+    if (patch->type != FOSSIL_MEDIA_JSON_ARRAY) {
+        set_error(&errtmp, FOSSIL_MEDIA_JSON_ERROR, 0, "Patch must be an array");
+        if (err_out) *err_out = errtmp;
+        return -1;
+    }
+    if (JSON_IS_ARENA(target)) {
+        set_error(&errtmp, FOSSIL_MEDIA_JSON_ERROR, 0, "Target is read-only");
+        if (err_out) *err_out = errtmp;
+        return -1;
+    }
+
+    json_undo_log_t undo = {NULL, 0, 0};
+    for (size_t i = 0; i < patch->u.array.count; ++i) {
+        const char *msg = NULL;
+        if (patch_apply_one(target, patch->u.array.items[i], &undo, &msg) != 0) {
+            undo_rollback(&undo);
+            set_error(&errtmp, FOSSIL_MEDIA_JSON_ERROR, i, "%s", msg);
+            if (err_out) *err_out = errtmp;
+            return -1;
+        }
+    }
+    undo_commit(&undo);
+    if (err_out) *err_out = errtmp;
+    return 0;
 }
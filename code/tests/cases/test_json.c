@@ -24,6 +24,12 @@
  */
 #include <fossil/maip/framework.h>
 #include "fossil/media/framework.h"
+#include <math.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
 
 
 // * * * * * * * * * * * * * * * * * * * * * * * *
@@ -151,6 +157,73 @@ FOSSIL_TEST(c_test_json_equals_not_equal) {
     fossil_media_json_free(val2);
 }
 
+FOSSIL_TEST(c_test_json_hash) {
+    /* Each group holds equal values; different groups must hash apart */
+    static const char *groups[][3] = {
+        {"1", "1.0", "1e0"},
+        {"-7", "-7.0", "-0.7e1"},
+        {"9007199254740993", "9007199254740993", "9007199254740993"},
+        {"18446744073709551615", "18446744073709551615", "18446744073709551615"},
+        {"0.5", "5e-1", "0.50"},
+        {"0", "-0", "0.0"},
+        {"\"1\"", "\"\\u0031\"", "\"1\""},
+        {"[1,2]", "[1.0,2]", "[1,2e0]"},
+        {"[2,1]", "[2,1]", "[2,1]"},
+        {"{\"a\":1,\"b\":[true,null]}", "{\"b\":[true,null],\"a\":1}", "{\"b\":[true,null],\"a\":1.0}"},
+        {"{\"a\":2,\"b\":[true,null]}", "{\"a\":2,\"b\":[true,null]}", "{\"a\":2,\"b\":[true,null]}"},
+        {"{\"ab\":1}", "{\"ab\":1}", "{\"ab\":1}"},
+        {"{\"a\":\"b1\"}", "{\"a\":\"b1\"}", "{\"a\":\"b1\"}"},
+        {"null", "null", "null"},
+        {"false", "false", "false"},
+        {"[]", "[]", "[ ]"},
+        {"{}", "{}", "{ }"},
+        {"\"a long string that spans several words\"", "\"a long string that spans several words\"",
+         "\"a long string that spans several words\""},
+    };
+    size_t n = sizeof(groups) / sizeof(groups[0]);
+    uint64_t first[sizeof(groups) / sizeof(groups[0])];
+    fossil_media_json_parse_options_t arena = {FOSSIL_MEDIA_JSON_PARSE_ARENA, NULL, 0};
+    fossil_media_json_error_t err = {0};
+    for (size_t g = 0; g < n; ++g) {
+        for (int k = 0; k < 3; ++k) {
+            fossil_media_json_value_t *heap = fossil_media_json_parse(groups[g][k], &err);
+            fossil_media_json_value_t *ro = fossil_media_json_parse_ex(groups[g][k], &arena, &err);
+            ASSUME_NOT_CNULL(heap);
+            ASSUME_NOT_CNULL(ro);
+            uint64_t h = fossil_media_json_hash(heap);
+            ASSUME_ITS_TRUE(h != 0);
+            if (k == 0) first[g] = h;
+            ASSUME_ITS_TRUE(h == first[g]);
+            /* Read-only documents cache the hash; the value is the same */
+            ASSUME_ITS_TRUE(fossil_media_json_hash(ro) == h);
+            ASSUME_ITS_TRUE(fossil_media_json_hash(ro) == h);
+            fossil_media_json_free(heap);
+            fossil_media_json_free(ro);
+        }
+        for (size_t o = 0; o < g; ++o) ASSUME_ITS_TRUE(first[o] != first[g]);
+    }
+    ASSUME_ITS_TRUE(fossil_media_json_hash(NULL) == 0);
+
+    /* Mutable trees are rehashed, so edits show up */
+    fossil_media_json_value_t *doc = fossil_media_json_parse("{\"a\":{\"b\":1}}", &err);
+    uint64_t before = fossil_media_json_hash(doc);
+    fossil_media_json_object_set(fossil_media_json_object_get(doc, "a"), "b", fossil_media_json_new_number(2));
+    ASSUME_ITS_TRUE(fossil_media_json_hash(doc) != before);
+    fossil_media_json_free(doc);
+
+    /* Cached hashes let equals reject without a walk, and never change its answer */
+    fossil_media_json_value_t *x = fossil_media_json_parse_ex("[{\"k\":[1,2,3]},{\"k\":[4]}]", &arena, &err);
+    fossil_media_json_value_t *y = fossil_media_json_parse_ex("[{\"k\":[1,2,3]},{\"k\":[5]}]", &arena, &err);
+    fossil_media_json_value_t *z = fossil_media_json_parse_ex("[{\"k\":[1,2,3.0]},{\"k\":[4]}]", &arena, &err);
+    ASSUME_ITS_TRUE(fossil_media_json_hash(x) != fossil_media_json_hash(y));
+    ASSUME_ITS_TRUE(fossil_media_json_hash(x) == fossil_media_json_hash(z));
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_equals(x, y), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_equals(x, z), 1);
+    fossil_media_json_free(x);
+    fossil_media_json_free(y);
+    fossil_media_json_free(z);
+}
+
 FOSSIL_TEST(c_test_json_new_null) {
     fossil_media_json_value_t *val = fossil_media_json_new_null();
     ASSUME_NOT_CNULL(val);
@@ -239,6 +312,54 @@ FOSSIL_TEST(c_test_json_validate) {
     ASSUME_ITS_EQUAL_I32(invalid, 1);
 }
 
+FOSSIL_TEST(c_test_json_validate_limits) {
+    fossil_media_json_error_t verr = {0}, perr = {0};
+
+    /* Same message and position as the parser */
+    const char *bad[] = {"[1,2,]", "{\"a\" 1}", "\"ab\\x\"", "[1 2]", "{\"k\":tru}", "[\"abc", "  ", "[01]"};
+    for (size_t k = 0; k < sizeof(bad) / sizeof(bad[0]); ++k) {
+        ASSUME_ITS_TRUE(fossil_media_json_validate(bad[k], &verr) != 0);
+        ASSUME_ITS_CNULL(fossil_media_json_parse(bad[k], &perr));
+        ASSUME_ITS_EQUAL_CSTR(verr.message, perr.message);
+        ASSUME_ITS_EQUAL_SIZE(verr.position, perr.position);
+    }
+
+    /* Strings must be well-formed UTF-8 unless the check is disabled */
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_validate("[\"caf\xc3\xa9 \xf0\x9f\x98\x80\"]", &verr), 0);
+    ASSUME_ITS_TRUE(fossil_media_json_validate("[\"ab\xc0\xaf\"]", &verr) != 0);
+    ASSUME_ITS_EQUAL_CSTR(verr.message, "Invalid UTF-8");
+    ASSUME_ITS_EQUAL_SIZE(verr.position, 4);
+    ASSUME_ITS_TRUE(fossil_media_json_validate("\"\xed\xa0\x80\"", &verr) != 0);
+    fossil_media_json_validate_options_t opts = {0, 0, FOSSIL_MEDIA_JSON_VALIDATE_NO_UTF8};
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_validate_ex("[\"ab\xc0\xaf\"]", &opts, &verr), 0);
+
+    /* Depth and size limits */
+    opts.flags = 0;
+    opts.max_depth = 2;
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_validate_ex("{\"a\":[1]}", &opts, &verr), 0);
+    ASSUME_ITS_TRUE(fossil_media_json_validate_ex("{\"a\":[[1]]}", &opts, &verr) != 0);
+    ASSUME_ITS_EQUAL_CSTR(verr.message, "Maximum nesting depth exceeded");
+    ASSUME_ITS_EQUAL_SIZE(verr.position, 6);
+    opts.max_depth = 0;
+    opts.max_size = 8;
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_validate_ex("[1,2,3] ", &opts, &verr), 0);
+    ASSUME_ITS_TRUE(fossil_media_json_validate_ex("[1,2,3,4]", &opts, &verr) != 0);
+    ASSUME_ITS_EQUAL_CSTR(verr.message, "Input exceeds maximum size");
+
+    /* Unlimited depth goes past the inline nesting stack */
+    size_t n = 10000;
+    char *deep = malloc(2 * n + 1);
+    ASSUME_NOT_CNULL(deep);
+    memset(deep, '[', n);
+    memset(deep + n, ']', n);
+    deep[2 * n] = '\0';
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_validate(deep, &verr), 0);
+    deep[2 * n - 1] = '\0';
+    ASSUME_ITS_TRUE(fossil_media_json_validate(deep, &verr) != 0);
+    ASSUME_ITS_EQUAL_CSTR(verr.message, "Expected ',' or ']' in array");
+    free(deep);
+}
+
 FOSSIL_TEST(c_test_json_get_path) {
     fossil_media_json_error_t err = {0};
     const char *json = "{\"user\":{\"name\":\"alice\",\"items\":[10,20],\"complex.key\":{\"foo\":42}}}";
@@ -276,6 +397,361 @@ FOSSIL_TEST(c_test_json_get_path) {
     fossil_media_json_free(val);
 }
 
+FOSSIL_TEST(c_test_json_path_compile) {
+    fossil_media_json_error_t err = {0};
+    fossil_media_json_value_t *doc = fossil_media_json_parse(
+        "{\"user\":{\"items\":[{\"id\":1},{\"id\":2}],\"a.b\":true}}", &err);
+    ASSUME_NOT_CNULL(doc);
+    fossil_media_json_value_t *items = fossil_media_json_object_get(fossil_media_json_object_get(doc, "user"), "items");
+
+    /* Borrowed lookups return the node itself */
+    fossil_media_json_value_t *second = fossil_media_json_get_path_ref(doc, "user.items[1]");
+    ASSUME_ITS_TRUE(second == fossil_media_json_array_get(items, 1));
+    ASSUME_ITS_TRUE(fossil_media_json_get_path_ref(doc, "user.\"a.b\"")->u.boolean == 1);
+    ASSUME_ITS_CNULL(fossil_media_json_get_path_ref(doc, "user.items[2]"));
+    ASSUME_ITS_CNULL(fossil_media_json_get_path_ref(doc, "user.items[1"));
+
+    /* A compiled path is reusable and matches the string form */
+    fossil_media_json_path_t *path = fossil_media_json_path_compile("user.items.1.id", &err);
+    ASSUME_NOT_CNULL(path);
+    ASSUME_ITS_TRUE(fossil_media_json_path_get(path, doc) == fossil_media_json_get_path_ref(doc, "user.items[1].id"));
+    fossil_media_json_value_t *other = fossil_media_json_parse("{\"user\":{\"items\":[0,{\"id\":\"x\"}]}}", NULL);
+    ASSUME_ITS_EQUAL_CSTR(fossil_media_json_path_get(path, other)->u.string, "x");
+    fossil_media_json_free(other);
+    fossil_media_json_path_free(path);
+
+    ASSUME_ITS_CNULL(fossil_media_json_path_compile("user.\"open", &err));
+    ASSUME_ITS_EQUAL_CSTR(err.message, "Unterminated quoted key");
+    ASSUME_ITS_EQUAL_SIZE(err.position, 5);
+    ASSUME_ITS_CNULL(fossil_media_json_path_compile("items[3", &err));
+    ASSUME_ITS_EQUAL_CSTR(err.message, "Unterminated index");
+    fossil_media_json_free(doc);
+}
+
+/* Run a query and return its results as a compact JSON array, or NULL if it does not compile */
+static char *query_text(const fossil_media_json_value_t *doc, const char *expr, fossil_media_json_error_t *err) {
+    fossil_media_json_query_t *q = fossil_media_json_query_compile(expr, err);
+    if (!q) return NULL;
+    fossil_media_json_query_result_t res = {0};
+    fossil_media_json_value_t *list = fossil_media_json_new_array();
+    if (fossil_media_json_query_run(q, doc, &res, err) == 0) {
+        for (size_t i = 0; i < res.count; ++i) fossil_media_json_array_append(list, fossil_media_json_clone(res.items[i]));
+    }
+    char *out = fossil_media_json_stringify(list, 0, NULL);
+    fossil_media_json_free(list);
+    fossil_media_json_query_result_free(&res);
+    fossil_media_json_query_free(q);
+    return out;
+}
+
+FOSSIL_TEST(c_test_json_query) {
+    static const struct { const char *expr, *expected; } cases[] = {
+        {"$.store.book[*].id", "[1,2,3,4]"},
+        {"$..id", "[1,2,3,4]"},
+        {"$.store..price", "[8.95,12.99,8.99,22.99,399]"},
+        {"$.store.book[-1].id", "[4]"},
+        {"$.store.book[1:3].id", "[2,3]"},
+        {"$.store.book[::-2].id", "[4,2]"},
+        {"$.store.book[0, 2]['id']", "[1,3]"},
+        {"$.store.book[?@.isbn].id", "[3,4]"},
+        {"$.store.book[?@.price > 10].id", "[2,4]"},
+        {"$.store.book[?(@.price < 10 && @.category == 'fiction')].id", "[3]"},
+        {"$.store.book[?!@.isbn || @.price >= 22.99].id", "[1,2,4]"},
+        {"$.store.book[?@.price == $.store.book[0].price].id", "[1]"},
+        {"$.store.book[?@.missing == @.absent].id", "[1,2,3,4]"},
+        {"$..[?@.color].price", "[399]"},
+        {"$.store.book[7]", "[]"},
+    };
+    fossil_media_json_error_t err = {0};
+    fossil_media_json_value_t *doc = fossil_media_json_parse(
+        "{\"store\":{\"book\":["
+        "{\"id\":1,\"category\":\"reference\",\"price\":8.95},"
+        "{\"id\":2,\"category\":\"fiction\",\"price\":12.99},"
+        "{\"id\":3,\"category\":\"fiction\",\"isbn\":\"0-553-21311-3\",\"price\":8.99},"
+        "{\"id\":4,\"category\":\"fiction\",\"isbn\":\"0-395-19395-8\",\"price\":22.99}],"
+        "\"bicycle\":{\"color\":\"red\",\"price\":399}}}", &err);
+    ASSUME_NOT_CNULL(doc);
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        char *out = query_text(doc, cases[i].expr, &err);
+        ASSUME_NOT_CNULL(out);
+        ASSUME_ITS_EQUAL_CSTR(out, cases[i].expected);
+        free(out);
+    }
+
+    /* Results are borrowed, and one compiled query serves many documents */
+    fossil_media_json_query_t *q = fossil_media_json_query_compile("$.store.bicycle", &err);
+    ASSUME_NOT_CNULL(q);
+    fossil_media_json_query_result_t res = {0};
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_query_run(q, doc, &res, &err), 0);
+    ASSUME_ITS_EQUAL_SIZE(res.count, 1);
+    ASSUME_ITS_TRUE(res.items[0] == fossil_media_json_get_path_ref(doc, "store.bicycle"));
+    fossil_media_json_value_t *other = fossil_media_json_parse("{\"store\":[]}", NULL);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_query_run(q, other, &res, &err), 0);
+    ASSUME_ITS_EQUAL_SIZE(res.count, 0);
+    fossil_media_json_free(other);
+    fossil_media_json_query_result_free(&res);
+    fossil_media_json_query_free(q);
+
+    ASSUME_ITS_CNULL(fossil_media_json_query_compile("store.book", &err));
+    ASSUME_ITS_EQUAL_CSTR(err.message, "Expected '$'");
+    ASSUME_ITS_CNULL(fossil_media_json_query_compile("$.book[?@.* == 1]", &err));
+    ASSUME_ITS_EQUAL_CSTR(err.message, "Non-singular query in comparison");
+    ASSUME_ITS_EQUAL_SIZE(err.position, 8);
+    ASSUME_ITS_CNULL(fossil_media_json_query_compile("$.book[01]", &err));
+    ASSUME_ITS_EQUAL_CSTR(err.message, "Invalid integer");
+    ASSUME_ITS_CNULL(fossil_media_json_query_compile("$['open]", &err));
+    ASSUME_ITS_EQUAL_CSTR(err.message, "Unterminated string");
+    fossil_media_json_free(doc);
+}
+
+FOSSIL_TEST(c_test_json_lazy) {
+    const char *text =
+        " {\"skip\":{\"deep\":[[1,{\"x\":\"]}\\\"\"}],2]},"
+        "\"k\\u0065y\":7,\"name\":\"caf\\u00e9\",\"ok\":true,"
+        "\"items\":[10,-20,{\"id\":18446744073709551615}],\"pi\":3.5,\"none\":null}";
+    fossil_media_json_error_t err = {0};
+    fossil_media_json_lazy_t *doc = fossil_media_json_lazy_open(text, &err);
+    ASSUME_NOT_CNULL(doc);
+    fossil_media_json_lazy_ref_t root = fossil_media_json_lazy_root(doc);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_lazy_type(root), FOSSIL_MEDIA_JSON_OBJECT);
+    ASSUME_ITS_EQUAL_SIZE(fossil_media_json_lazy_size(root), 7);
+
+    /* Keys are compared decoded, and skipped strings may hold brackets */
+    long long n = 0;
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_lazy_get_int(fossil_media_json_lazy_get(root, "key"), &n), 0);
+    ASSUME_ITS_EQUAL_I32(n, 7);
+    size_t len = 0;
+    char *name = fossil_media_json_lazy_get_string(fossil_media_json_lazy_get(root, "name"), &len);
+    ASSUME_NOT_CNULL(name);
+    ASSUME_ITS_EQUAL_CSTR(name, "caf\xc3\xa9");
+    ASSUME_ITS_EQUAL_SIZE(len, 5);
+    free(name);
+    int b = 0;
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_lazy_get_bool(fossil_media_json_lazy_get(root, "ok"), &b), 0);
+    ASSUME_ITS_EQUAL_I32(b, 1);
+    double d = 0;
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_lazy_get_number(fossil_media_json_lazy_get(root, "pi"), &d), 0);
+    ASSUME_ITS_TRUE(d == 3.5);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_lazy_type(fossil_media_json_lazy_get(root, "none")), FOSSIL_MEDIA_JSON_NULL);
+    ASSUME_ITS_TRUE(fossil_media_json_lazy_get_bool(fossil_media_json_lazy_get(root, "pi"), &b) != 0);
+    ASSUME_ITS_CNULL(fossil_media_json_lazy_get(root, "missing").doc);
+
+    unsigned long long u = 0;
+    fossil_media_json_lazy_ref_t id = fossil_media_json_lazy_get_path(root, "items[2].id");
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_lazy_get_uint(id, &u), 0);
+    ASSUME_ITS_TRUE(u == 18446744073709551615ULL);
+    ASSUME_ITS_TRUE(fossil_media_json_lazy_get_int(id, &n) != 0);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_lazy_get_int(fossil_media_json_lazy_get_path(root, "skip.deep[1]"), &n), 0);
+    ASSUME_ITS_EQUAL_I32(n, 2);
+    ASSUME_ITS_CNULL(fossil_media_json_lazy_index(fossil_media_json_lazy_get(root, "items"), 3).doc);
+
+    fossil_media_json_lazy_iter_t it;
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_lazy_iter_init(fossil_media_json_lazy_get(root, "items"), &it), 0);
+    long long sum = 0;
+    while (fossil_media_json_lazy_iter_next(&it))
+        if (fossil_media_json_lazy_get_int(it.value, &n) == 0) sum += n;
+    ASSUME_ITS_EQUAL_I32(sum, -10);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_lazy_iter_init(root, &it), 0);
+    ASSUME_ITS_TRUE(fossil_media_json_lazy_iter_next(&it));
+    ASSUME_ITS_EQUAL_SIZE(it.key_len, 4);
+    ASSUME_ITS_TRUE(strncmp(it.key, "skip", 4) == 0);
+
+    /* A subtree converts to an ordinary tree */
+    fossil_media_json_value_t *v = fossil_media_json_lazy_to_value(fossil_media_json_lazy_get(root, "skip"), &err);
+    ASSUME_NOT_CNULL(v);
+    char *out = fossil_media_json_stringify(v, 0, NULL);
+    ASSUME_ITS_EQUAL_CSTR(out, "{\"deep\":[[1,{\"x\":\"]}\\\"\"}],2]}");
+    free(out);
+    fossil_media_json_free(v);
+    fossil_media_json_lazy_close(doc);
+
+    /* Unread values are only skipped; what is read is still checked */
+    doc = fossil_media_json_lazy_open("{\"a\":[1,,{}],\"b\":tru,\"c\":2}", &err);
+    ASSUME_NOT_CNULL(doc);
+    root = fossil_media_json_lazy_root(doc);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_lazy_get_int(fossil_media_json_lazy_get(root, "c"), &n), 0);
+    ASSUME_ITS_EQUAL_I32(n, 2);
+    ASSUME_ITS_TRUE(fossil_media_json_lazy_get_bool(fossil_media_json_lazy_get(root, "b"), &b) != 0);
+    ASSUME_ITS_CNULL(fossil_media_json_lazy_to_value(fossil_media_json_lazy_get(root, "a"), &err));
+    fossil_media_json_lazy_close(doc);
+    doc = fossil_media_json_lazy_open("{\"a\":[1,2,\"c\":2}", &err);
+    ASSUME_NOT_CNULL(doc);
+    ASSUME_ITS_CNULL(fossil_media_json_lazy_get(fossil_media_json_lazy_root(doc), "c").doc);
+    fossil_media_json_lazy_close(doc);
+
+    /* Skipped containers spanning many 64-byte blocks */
+    char big[2048];
+    size_t at = (size_t)sprintf(big, "{\"list\":[");
+    for (int i = 0; i < 60; ++i)
+        at += (size_t)sprintf(big + at, "%s[[%d],{\"s\":\"]}\\\\\"}]", i ? "," : "", i);
+    sprintf(big + at, "],\"tail\":5}");
+    doc = fossil_media_json_lazy_open(big, &err);
+    ASSUME_NOT_CNULL(doc);
+    root = fossil_media_json_lazy_root(doc);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_lazy_get_int(fossil_media_json_lazy_get(root, "tail"), &n), 0);
+    ASSUME_ITS_EQUAL_I32(n, 5);
+    ASSUME_ITS_EQUAL_SIZE(fossil_media_json_lazy_size(fossil_media_json_lazy_get(root, "list")), 60);
+    fossil_media_json_lazy_close(doc);
+
+    ASSUME_ITS_CNULL(fossil_media_json_lazy_open("  ", &err));
+    ASSUME_ITS_EQUAL_CSTR(err.message, "Unexpected end of input");
+    ASSUME_ITS_CNULL(fossil_media_json_lazy_open("]", &err));
+}
+
+/* Apply a patch given as text and return the compact result, or NULL on failure */
+static char *patch_text(const char *doc_text, const char *patch, int merge, fossil_media_json_error_t *err) {
+    fossil_media_json_value_t *doc = fossil_media_json_parse(doc_text, NULL);
+    fossil_media_json_value_t *p = fossil_media_json_parse(patch, NULL);
+    char *out = NULL;
+    if (doc && p) {
+        int rc = merge ? fossil_media_json_apply_merge_patch(doc, p, err) : fossil_media_json_apply_patch(doc, p, err);
+        out = fossil_media_json_stringify(doc, 0, NULL);
+        if (rc != 0) {
+            /* A failed JSON Patch must leave the document as it was */
+            if (!merge && strcmp(out, doc_text) != 0) out[0] = '!';
+            else { free(out); out = NULL; }
+        }
+    }
+    fossil_media_json_free(doc);
+    fossil_media_json_free(p);
+    return out;
+}
+
+FOSSIL_TEST(c_test_json_merge_patch) {
+    static const char *cases[][3] = {
+        /* RFC 7386 appendix A */
+        {"{\"a\":\"b\"}", "{\"a\":\"c\"}", "{\"a\":\"c\"}"},
+        {"{\"a\":\"b\"}", "{\"b\":\"c\"}", "{\"a\":\"b\",\"b\":\"c\"}"},
+        {"{\"a\":\"b\"}", "{\"a\":null}", "{}"},
+        {"{\"a\":\"b\",\"b\":\"c\"}", "{\"a\":null}", "{\"b\":\"c\"}"},
+        {"{\"a\":[\"b\"]}", "{\"a\":\"c\"}", "{\"a\":\"c\"}"},
+        {"{\"a\":\"c\"}", "{\"a\":[\"b\"]}", "{\"a\":[\"b\"]}"},
+        {"{\"a\":{\"b\":\"c\"}}", "{\"a\":{\"b\":\"d\",\"c\":null}}", "{\"a\":{\"b\":\"d\"}}"},
+        {"{\"a\":[{\"b\":\"c\"}]}", "{\"a\":[1]}", "{\"a\":[1]}"},
+        {"[\"a\",\"b\"]", "[\"c\",\"d\"]", "[\"c\",\"d\"]"},
+        {"{\"a\":\"b\"}", "[\"c\"]", "[\"c\"]"},
+        {"{\"a\":\"foo\"}", "null", "null"},
+        {"{\"a\":\"foo\"}", "\"bar\"", "\"bar\""},
+        {"{\"e\":null}", "{\"a\":1}", "{\"e\":null,\"a\":1}"},
+        {"[1,2]", "{\"a\":\"b\",\"c\":null}", "{\"a\":\"b\"}"},
+        {"{}", "{\"a\":{\"bb\":{\"ccc\":null}}}", "{\"a\":{\"bb\":{}}}"},
+    };
+    fossil_media_json_error_t err = {0};
+    for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); ++k) {
+        char *out = patch_text(cases[k][0], cases[k][1], 1, &err);
+        ASSUME_NOT_CNULL(out);
+        ASSUME_ITS_EQUAL_CSTR(out, cases[k][2]);
+        free(out);
+    }
+
+    /* The target node itself is updated, even when its type changes */
+    fossil_media_json_value_t *doc = fossil_media_json_parse("{\"a\":1}", &err);
+    fossil_media_json_value_t *patch = fossil_media_json_parse("[true]", &err);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_apply_merge_patch(doc, patch, &err), 0);
+    ASSUME_ITS_TRUE(fossil_media_json_is_array(doc));
+    fossil_media_json_free(doc);
+
+    fossil_media_json_parse_options_t opts = {FOSSIL_MEDIA_JSON_PARSE_ARENA, NULL, 0};
+    doc = fossil_media_json_parse_ex("{}", &opts, &err);
+    ASSUME_ITS_TRUE(fossil_media_json_apply_merge_patch(doc, patch, &err) != 0);
+    ASSUME_ITS_EQUAL_CSTR(err.message, "Target is read-only");
+    fossil_media_json_free(doc);
+    fossil_media_json_free(patch);
+}
+
+FOSSIL_TEST(c_test_json_patch) {
+    static const char *cases[][3] = {
+        /* RFC 6902 appendix A */
+        {"{\"foo\":\"bar\"}", "[{\"op\":\"add\",\"path\":\"/baz\",\"value\":\"qux\"}]", "{\"foo\":\"bar\",\"baz\":\"qux\"}"},
+        {"{\"foo\":[\"bar\",\"baz\"]}", "[{\"op\":\"add\",\"path\":\"/foo/1\",\"value\":\"qux\"}]", "{\"foo\":[\"bar\",\"qux\",\"baz\"]}"},
+        {"{\"baz\":\"qux\",\"foo\":\"bar\"}", "[{\"op\":\"remove\",\"path\":\"/baz\"}]", "{\"foo\":\"bar\"}"},
+        {"{\"foo\":[\"bar\",\"qux\",\"baz\"]}", "[{\"op\":\"remove\",\"path\":\"/foo/1\"}]", "{\"foo\":[\"bar\",\"baz\"]}"},
+        {"{\"baz\":\"qux\",\"foo\":\"bar\"}", "[{\"op\":\"replace\",\"path\":\"/baz\",\"value\":\"boo\"}]", "{\"baz\":\"boo\",\"foo\":\"bar\"}"},
+        {"{\"foo\":{\"bar\":\"baz\",\"waldo\":\"fred\"},\"qux\":{\"corge\":\"grault\"}}",
+         "[{\"op\":\"move\",\"from\":\"/foo/waldo\",\"path\":\"/qux/thud\"}]",
+         "{\"foo\":{\"bar\":\"baz\"},\"qux\":{\"corge\":\"grault\",\"thud\":\"fred\"}}"},
+        {"{\"foo\":[\"all\",\"grass\",\"cows\",\"eat\"]}", "[{\"op\":\"move\",\"from\":\"/foo/1\",\"path\":\"/foo/3\"}]",
+         "{\"foo\":[\"all\",\"cows\",\"eat\",\"grass\"]}"},
+        {"{\"baz\":\"qux\",\"foo\":[\"a\",2,\"c\"]}",
+         "[{\"op\":\"test\",\"path\":\"/baz\",\"value\":\"qux\"},{\"op\":\"test\",\"path\":\"/foo/1\",\"value\":2}]",
+         "{\"baz\":\"qux\",\"foo\":[\"a\",2,\"c\"]}"},
+        {"{\"foo\":\"bar\"}", "[{\"op\":\"add\",\"path\":\"/child\",\"value\":{\"grandchild\":{}}}]",
+         "{\"foo\":\"bar\",\"child\":{\"grandchild\":{}}}"},
+        {"{\"foo\":[\"bar\"]}", "[{\"op\":\"add\",\"path\":\"/foo/-\",\"value\":[\"abc\",\"def\"]}]",
+         "{\"foo\":[\"bar\",[\"abc\",\"def\"]]}"},
+        {"{\"/\":9,\"~1\":10}", "[{\"op\":\"test\",\"path\":\"/~01\",\"value\":10},{\"op\":\"copy\",\"from\":\"/~1\",\"path\":\"/c\"}]",
+         "{\"/\":9,\"~1\":10,\"c\":9}"},
+        /* Whole-document operations keep the root node */
+        {"{\"a\":1}", "[{\"op\":\"replace\",\"path\":\"\",\"value\":[1]}]", "[1]"},
+        {"{\"a\":{\"b\":2}}", "[{\"op\":\"move\",\"from\":\"/a\",\"path\":\"\"}]", "{\"b\":2}"},
+    };
+    fossil_media_json_error_t err = {0};
+    for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); ++k) {
+        char *out = patch_text(cases[k][0], cases[k][1], 0, &err);
+        ASSUME_NOT_CNULL(out);
+        ASSUME_ITS_EQUAL_CSTR(out, cases[k][2]);
+        free(out);
+    }
+
+    /* Failures roll back every earlier operation of the same patch */
+    static const char *bad[][3] = {
+        {"[{\"op\":\"add\",\"path\":\"/x\",\"value\":1},{\"op\":\"test\",\"path\":\"/a\",\"value\":2}]", "Test failed", "1"},
+        {"[{\"op\":\"remove\",\"path\":\"/a\"},{\"op\":\"remove\",\"path\":\"/a\"}]", "Path not found", "1"},
+        {"[{\"op\":\"move\",\"from\":\"/b\",\"path\":\"/b/0/q\"}]", "Cannot move a value into itself", "0"},
+        {"[{\"op\":\"move\",\"from\":\"/b/0\",\"path\":\"/a\"},{\"op\":\"add\",\"path\":\"/b/05\",\"value\":0}]", "Path not found", "1"},
+        {"[{\"op\":\"replace\",\"path\":\"/b/1\",\"value\":0},{\"op\":\"add\",\"path\":\"/q/r\",\"value\":0}]", "Path not found", "1"},
+        {"[{\"op\":\"copy\",\"from\":\"/b\",\"path\":\"\"},{\"op\":\"remove\",\"path\":\"\"}]", "Cannot remove the document root", "1"},
+        {"[{\"op\":\"add\",\"path\":\"a\",\"value\":0}]", "Invalid pointer", "0"},
+        {"[{\"op\":\"add\",\"path\":\"/~2\",\"value\":0}]", "Invalid pointer", "0"},
+        {"[{\"op\":\"frob\",\"path\":\"/a\"}]", "Unknown op", "0"},
+        {"[{\"path\":\"/a\"}]", "Missing op", "0"},
+        {"[{\"op\":\"add\",\"path\":\"/a\"}]", "Missing value", "0"},
+        {"{\"op\":\"add\"}", "Patch must be an array", "0"},
+    };
+    const char *doc_text = "{\"a\":1,\"b\":[{\"q\":1},2,3]}";
+    for (size_t k = 0; k < sizeof(bad) / sizeof(bad[0]); ++k) {
+        char *out = patch_text(doc_text, bad[k][0], 0, &err);
+        ASSUME_ITS_CNULL(out);
+        free(out);
+        ASSUME_ITS_EQUAL_CSTR(err.message, bad[k][1]);
+        ASSUME_ITS_EQUAL_SIZE(err.position, (size_t)atoi(bad[k][2]));
+    }
+
+    /* Moves relink the node instead of copying it */
+    fossil_media_json_value_t *doc = fossil_media_json_parse(doc_text, &err);
+    fossil_media_json_value_t *node = fossil_media_json_get_path_ref(doc, "b[0]");
+    fossil_media_json_value_t *patch = fossil_media_json_parse(
+        "[{\"op\":\"move\",\"from\":\"/b/0\",\"path\":\"/c\"}]", &err);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_apply_patch(doc, patch, &err), 0);
+    ASSUME_ITS_TRUE(fossil_media_json_object_get(doc, "c") == node);
+    fossil_media_json_free(patch);
+    fossil_media_json_free(doc);
+
+    /* Running out of memory at any step also rolls back; full containers make every add grow one */
+    const char *full = "{\"a\":1,\"b\":[{\"q\":1},2,3],\"o\":{\"m\":1,\"n\":2,\"p\":3,\"r\":4}}";
+    const char *ops = "[{\"op\":\"add\",\"path\":\"/c\",\"value\":[1]},{\"op\":\"move\",\"from\":\"/b/0\",\"path\":\"/o/x\"},"
+                      "{\"op\":\"add\",\"path\":\"/b/-\",\"value\":{\"k\":1}},{\"op\":\"remove\",\"path\":\"/a\"},"
+                      "{\"op\":\"add\",\"path\":\"/o/y\",\"value\":2}]";
+    int applied = 0;
+    for (long budget = 0; budget < 200 && !applied; ++budget) {
+        doc = fossil_media_json_parse(full, NULL);
+        patch = fossil_media_json_parse(ops, NULL);
+        ASSUME_NOT_CNULL(doc);
+        ASSUME_NOT_CNULL(patch);
+        fossil_media_json_debug_fail_alloc(budget);
+        applied = fossil_media_json_apply_patch(doc, patch, NULL) == 0;
+        fossil_media_json_debug_fail_alloc(-1);
+        char *out = fossil_media_json_stringify(doc, 0, NULL);
+        ASSUME_NOT_CNULL(out);
+        ASSUME_ITS_EQUAL_CSTR(out, applied ? "{\"b\":[2,3,{\"k\":1}],\"o\":{\"m\":1,\"n\":2,\"p\":3,\"r\":4,"
+                                             "\"x\":{\"q\":1},\"y\":2},\"c\":[1]}" : full);
+        free(out);
+        fossil_media_json_free(patch);
+        fossil_media_json_free(doc);
+    }
+    ASSUME_ITS_TRUE(applied);
+}
+
 FOSSIL_TEST(c_test_json_parse_empty_array) {
     fossil_media_json_error_t err = {0};
     const char *json = "[]";
@@ -392,6 +868,41 @@ FOSSIL_TEST(c_test_json_equals_nulls) {
     ASSUME_ITS_EQUAL_I32(eq, -1);
 }
 
+FOSSIL_TEST(c_test_json_equals_duplicate_keys) {
+    /* Duplicates pair up in order, whether keys are shared (member-wise) or not (by key) */
+    static const struct { const char *a, *b; int eq; } cases[] = {
+        {"{\"a\":1,\"a\":2}", "{\"a\":1,\"a\":2}", 1},
+        {"{\"a\":1,\"a\":2}", "{\"a\":1,\"a\":3}", 0},
+        {"{\"a\":1,\"a\":2}", "{\"a\":2,\"a\":1}", 0},
+        {"{\"a\":1,\"b\":0,\"a\":2}", "{\"b\":0,\"a\":1,\"a\":2}", 1},
+        {"{\"a\":1,\"a\":1,\"a\":2}", "{\"a\":1,\"a\":2,\"a\":2}", 0},
+    };
+    fossil_media_json_error_t err = {0};
+    fossil_media_json_keys_t *keys = fossil_media_json_keys_create();
+    ASSUME_NOT_CNULL(keys);
+    fossil_media_json_parse_options_t opts = {0};
+    opts.keys = keys;
+    for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); ++k) {
+        fossil_media_json_value_t *sa = fossil_media_json_parse_ex(cases[k].a, &opts, &err);
+        fossil_media_json_value_t *sb = fossil_media_json_parse_ex(cases[k].b, &opts, &err);
+        fossil_media_json_value_t *pa = fossil_media_json_parse(cases[k].a, &err);
+        fossil_media_json_value_t *pb = fossil_media_json_parse(cases[k].b, &err);
+        ASSUME_NOT_CNULL(sa);
+        ASSUME_NOT_CNULL(sb);
+        ASSUME_NOT_CNULL(pa);
+        ASSUME_NOT_CNULL(pb);
+        ASSUME_ITS_EQUAL_I32(fossil_media_json_equals(sa, sb), cases[k].eq);
+        ASSUME_ITS_EQUAL_I32(fossil_media_json_equals(pa, pb), cases[k].eq);
+        ASSUME_ITS_EQUAL_I32(fossil_media_json_equals(sb, sa), cases[k].eq);
+        ASSUME_ITS_EQUAL_I32(fossil_media_json_equals(pb, pa), cases[k].eq);
+        fossil_media_json_free(sa);
+        fossil_media_json_free(sb);
+        fossil_media_json_free(pa);
+        fossil_media_json_free(pb);
+    }
+    fossil_media_json_keys_free(keys);
+}
+
 FOSSIL_TEST(c_test_json_parse_nested_object_array) {
     fossil_media_json_error_t err = {0};
     const char *json = "{\"users\":[{\"id\":1,\"name\":\"Alice\"},{\"id\":2,\"name\":\"Bob\"}]}";
@@ -454,6 +965,1199 @@ FOSSIL_TEST(c_test_json_parse_object_with_array_values) {
     fossil_media_json_free(val);
 }
 
+FOSSIL_TEST(c_test_json_parse_arena) {
+    fossil_media_json_error_t err = {0};
+    fossil_media_json_parse_options_t opts = {0};
+    opts.flags = FOSSIL_MEDIA_JSON_PARSE_ARENA;
+    const char *json = "{\"users\":[{\"id\":1,\"name\":\"Al\\u00e9\"},{\"id\":2,\"name\":\"Bob\"}],\"ok\":true}";
+    fossil_media_json_value_t *arena = fossil_media_json_parse_ex(json, &opts, &err);
+    fossil_media_json_value_t *heap = fossil_media_json_parse(json, &err);
+    ASSUME_NOT_CNULL(arena);
+    ASSUME_NOT_CNULL(heap);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_equals(arena, heap), 1);
+
+    fossil_media_json_value_t *users = fossil_media_json_object_get(arena, "users");
+    ASSUME_NOT_CNULL(users);
+    ASSUME_ITS_EQUAL_SIZE(fossil_media_json_array_size(users), 2);
+
+    char *a = fossil_media_json_stringify(arena, 0, &err);
+    char *h = fossil_media_json_stringify(heap, 0, &err);
+    ASSUME_NOT_CNULL(a);
+    ASSUME_NOT_CNULL(h);
+    ASSUME_ITS_EQUAL_CSTR(a, h);
+    free(a);
+    free(h);
+
+    fossil_media_json_free(heap);
+    fossil_media_json_free(arena);
+}
+
+FOSSIL_TEST(c_test_json_parse_arena_read_only) {
+    fossil_media_json_error_t err = {0};
+    fossil_media_json_parse_options_t opts = {0};
+    opts.flags = FOSSIL_MEDIA_JSON_PARSE_ARENA;
+    fossil_media_json_value_t *doc = fossil_media_json_parse_ex("{\"a\":[1]}", &opts, &err);
+    ASSUME_NOT_CNULL(doc);
+    fossil_media_json_value_t *num = fossil_media_json_new_number(2);
+    ASSUME_ITS_TRUE(fossil_media_json_object_set(doc, "b", num) != 0);
+    ASSUME_ITS_TRUE(fossil_media_json_array_append(fossil_media_json_object_get(doc, "a"), num) != 0);
+    ASSUME_ITS_CNULL(fossil_media_json_object_remove(doc, "a"));
+    fossil_media_json_free(num);
+
+    /* Clones of arena nodes are ordinary heap trees */
+    fossil_media_json_value_t *copy = fossil_media_json_clone(doc);
+    ASSUME_NOT_CNULL(copy);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_object_set(copy, "b", fossil_media_json_new_null()), 0);
+    fossil_media_json_free(copy);
+    fossil_media_json_free(doc);
+}
+
+FOSSIL_TEST(c_test_json_parse_arena_error) {
+    fossil_media_json_error_t err = {0};
+    fossil_media_json_parse_options_t opts = {0};
+    opts.flags = FOSSIL_MEDIA_JSON_PARSE_ARENA;
+    fossil_media_json_value_t *doc = fossil_media_json_parse_ex("[1,{\"a\":\"x\"},]", &opts, &err);
+    ASSUME_ITS_CNULL(doc);
+    ASSUME_ITS_EQUAL_CSTR(err.message, "Trailing comma in array");
+}
+
+FOSSIL_TEST(c_test_json_parse_insitu) {
+    fossil_media_json_error_t err = {0};
+    const char *json = "{\"name\":\"Al\\u00e9 \\\"x\\\"\",\"tags\":[\"a\",\"\"],\"k\\/2\":\"plain\"}";
+    char buf[128];
+    strcpy(buf, json);
+    fossil_media_json_value_t *doc = fossil_media_json_parse_insitu(buf, NULL, &err);
+    fossil_media_json_value_t *heap = fossil_media_json_parse(json, &err);
+    ASSUME_NOT_CNULL(doc);
+    ASSUME_NOT_CNULL(heap);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_equals(doc, heap), 1);
+
+    /* Keys and strings, escaped or not, live inside the buffer */
+    const char *name = fossil_media_json_object_get(doc, "name")->u.string;
+    ASSUME_ITS_EQUAL_CSTR(name, "Al\xc3\xa9 \"x\"");
+    ASSUME_ITS_TRUE(name > buf && name < buf + sizeof(buf));
+    ASSUME_ITS_TRUE(doc->u.object.keys[2] > buf && doc->u.object.keys[2] < buf + sizeof(buf));
+    ASSUME_ITS_EQUAL_CSTR(doc->u.object.keys[2], "k/2");
+    fossil_media_json_value_t *extra = fossil_media_json_new_null();
+    ASSUME_ITS_TRUE(fossil_media_json_object_set(doc, "x", extra) != 0);
+    fossil_media_json_free(extra);
+    fossil_media_json_free(doc);
+
+    /* Large inputs (indexed parser) give the same results and errors as parse */
+    size_t n = 500;
+    char *text = (char *)malloc(n * 48 + 64);
+    char *copy = (char *)malloc(n * 48 + 64);
+    ASSUME_NOT_CNULL(text);
+    ASSUME_NOT_CNULL(copy);
+    size_t len = 0;
+    text[len++] = '[';
+    for (size_t k = 0; k < n; ++k)
+        len += (size_t)sprintf(text + len, "%s{\"id\":%u,\"s\":\"a\\tb\",\"t\":\"word\"}", k ? "," : "", (unsigned)k);
+    text[len++] = ']';
+    text[len] = '\0';
+    memcpy(copy, text, len + 1);
+    doc = fossil_media_json_parse_insitu(copy, NULL, &err);
+    fossil_media_json_free(heap);
+    heap = fossil_media_json_parse(text, &err);
+    ASSUME_NOT_CNULL(doc);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_equals(doc, heap), 1);
+    fossil_media_json_free(doc);
+
+    text[len - 1] = ',';
+    memcpy(copy, text, len + 1);
+    fossil_media_json_error_t ierr = {0};
+    ASSUME_ITS_CNULL(fossil_media_json_parse_insitu(copy, NULL, &ierr));
+    ASSUME_ITS_CNULL(fossil_media_json_parse(text, &err));
+    ASSUME_ITS_EQUAL_CSTR(ierr.message, err.message);
+    ASSUME_ITS_EQUAL_SIZE(ierr.position, err.position);
+    free(copy);
+    free(text);
+    fossil_media_json_free(heap);
+}
+
+FOSSIL_TEST(c_test_json_intern_keys) {
+    const char *json = "[{\"id\":1,\"name\":\"a\",\"t\\u0061g\":[]},{\"id\":2,\"name\":\"b\",\"tag\":{\"id\":3}}]";
+    fossil_media_json_error_t err = {0};
+    fossil_media_json_value_t *plain = fossil_media_json_parse(json, &err);
+    ASSUME_NOT_CNULL(plain);
+
+    /* Per document: one copy of each key, shared by every object */
+    fossil_media_json_parse_options_t opts = {FOSSIL_MEDIA_JSON_PARSE_INTERN_KEYS, NULL, 0};
+    fossil_media_json_value_t *doc = fossil_media_json_parse_ex(json, &opts, &err);
+    ASSUME_NOT_CNULL(doc);
+    fossil_media_json_value_t *a = fossil_media_json_array_get(doc, 0);
+    fossil_media_json_value_t *b = fossil_media_json_array_get(doc, 1);
+    ASSUME_ITS_TRUE(a->u.object.keys[0] == b->u.object.keys[0]);
+    ASSUME_ITS_TRUE(a->u.object.keys[2] == b->u.object.keys[2]);
+    ASSUME_ITS_TRUE(fossil_media_json_object_get(b, "tag")->u.object.keys[0] == a->u.object.keys[0]);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_equals(doc, plain), 1);
+    fossil_media_json_free(doc);
+
+    /* In situ: the first occurrence in the buffer becomes the shared copy */
+    char buf[128];
+    strcpy(buf, json);
+    doc = fossil_media_json_parse_insitu(buf, &opts, &err);
+    ASSUME_NOT_CNULL(doc);
+    a = fossil_media_json_array_get(doc, 0);
+    b = fossil_media_json_array_get(doc, 1);
+    ASSUME_ITS_TRUE(b->u.object.keys[1] == a->u.object.keys[1]);
+    ASSUME_ITS_TRUE(a->u.object.keys[1] > buf && a->u.object.keys[1] < buf + sizeof(buf));
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_equals(doc, plain), 1);
+    fossil_media_json_free(doc);
+
+    /* A caller table is shared across heap documents */
+    fossil_media_json_keys_t *keys = fossil_media_json_keys_create();
+    ASSUME_NOT_CNULL(keys);
+    opts.flags = 0;
+    opts.keys = keys;
+    fossil_media_json_value_t *d1 = fossil_media_json_parse_ex(json, &opts, &err);
+    fossil_media_json_value_t *d2 = fossil_media_json_parse_ex("{\"name\":\"c\",\"extra\":true}", &opts, &err);
+    ASSUME_NOT_CNULL(d1);
+    ASSUME_NOT_CNULL(d2);
+    ASSUME_ITS_EQUAL_SIZE(fossil_media_json_keys_count(keys), 4);
+    const char *name = fossil_media_json_keys_intern(keys, "name");
+    ASSUME_ITS_TRUE(d2->u.object.keys[0] == name);
+    ASSUME_ITS_TRUE(fossil_media_json_array_get(d1, 1)->u.object.keys[1] == name);
+    ASSUME_ITS_EQUAL_CSTR(fossil_media_json_object_get(d2, name)->u.string, "c");
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_equals(fossil_media_json_array_get(d1, 0), fossil_media_json_array_get(d1, 1)), 0);
+
+    /* Heap documents stay mutable; changed objects take private keys */
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_object_set(d2, "more", fossil_media_json_new_null()), 0);
+    fossil_media_json_free(fossil_media_json_object_remove(d2, "extra"));
+    ASSUME_ITS_TRUE(d2->u.object.keys[0] != name);
+    ASSUME_ITS_EQUAL_CSTR(d2->u.object.keys[1], "more");
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_equals(d1, plain), 1);
+    fossil_media_json_free(d1);
+    fossil_media_json_free(d2);
+    ASSUME_ITS_EQUAL_SIZE(fossil_media_json_keys_count(keys), 4);
+    fossil_media_json_keys_free(keys);
+    fossil_media_json_free(plain);
+}
+
+FOSSIL_TEST(c_test_json_parse_large) {
+    /* Inputs past 4 KiB take the indexed parser */
+    size_t n = 1000;
+    char *text = (char *)malloc(n * 40 + 64);
+    ASSUME_NOT_CNULL(text);
+    size_t len = 0;
+    text[len++] = '[';
+    for (size_t k = 0; k < n; ++k) {
+        len += (size_t)sprintf(text + len, "%s\n  {\"id\": %u, \"s\": \"a\\\"b\", \"t\":true}",
+                               k ? "," : "", (unsigned)k);
+    }
+    text[len++] = ']';
+    text[len] = '\0';
+    fossil_media_json_error_t err = {0};
+    fossil_media_json_value_t *arr = fossil_media_json_parse(text, &err);
+    ASSUME_NOT_CNULL(arr);
+    ASSUME_ITS_EQUAL_SIZE(fossil_media_json_array_size(arr), n);
+    fossil_media_json_value_t *last = fossil_media_json_array_get(arr, n - 1);
+    ASSUME_ITS_EQUAL_I32((int)fossil_media_json_object_get(last, "id")->u.number, (int)(n - 1));
+    ASSUME_ITS_EQUAL_CSTR(fossil_media_json_object_get(last, "s")->u.string, "a\"b");
+    fossil_media_json_free(arr);
+
+    /* Errors in large inputs report the same message and position */
+    text[len - 1] = ',';
+    arr = fossil_media_json_parse(text, &err);
+    ASSUME_ITS_CNULL(arr);
+    ASSUME_ITS_EQUAL_CSTR(err.message, "Unexpected end of input");
+    ASSUME_ITS_EQUAL_SIZE(err.position, len);
+    free(text);
+}
+
+typedef struct {
+    fossil_media_json_value_t *values[8];
+    size_t count;
+} stream_sink_t;
+
+static int collect_value(fossil_media_json_value_t *v, void *user) {
+    stream_sink_t *sink = (stream_sink_t *)user;
+    if (sink->count == 8) { fossil_media_json_free(v); return 1; }
+    sink->values[sink->count++] = v;
+    return 0;
+}
+
+static void sink_reset(stream_sink_t *sink) {
+    for (size_t k = 0; k < sink->count; ++k) fossil_media_json_free(sink->values[k]);
+    sink->count = 0;
+}
+
+FOSSIL_TEST(c_test_json_stream_chunked) {
+    const char *text = "{\"a\":\"x\\\"y\\u00e9\",\"b\":[1,-2.5e3]} 42\n\"s\"[true,null]-7";
+    size_t len = strlen(text);
+    /* Every split point, including inside strings, escapes and numbers */
+    for (size_t cut = 0; cut <= len; ++cut) {
+        stream_sink_t sink = {{0}, 0};
+        fossil_media_json_error_t err = {0};
+        fossil_media_json_stream_t *st = fossil_media_json_stream_create(NULL, collect_value, &sink);
+        ASSUME_NOT_CNULL(st);
+        ASSUME_ITS_EQUAL_I32(fossil_media_json_stream_feed(st, text, cut, &err), 0);
+        ASSUME_ITS_EQUAL_I32(fossil_media_json_stream_feed(st, text + cut, len - cut, &err), 0);
+        ASSUME_ITS_EQUAL_I32(fossil_media_json_stream_finish(st, &err), 0);
+        ASSUME_ITS_EQUAL_SIZE(sink.count, 5);
+        ASSUME_ITS_EQUAL_CSTR(fossil_media_json_object_get(sink.values[0], "a")->u.string, "x\"y\xc3\xa9");
+        ASSUME_ITS_TRUE(sink.values[1]->u.number == 42.0);
+        ASSUME_ITS_EQUAL_CSTR(sink.values[2]->u.string, "s");
+        ASSUME_ITS_EQUAL_SIZE(fossil_media_json_array_size(sink.values[3]), 2);
+        ASSUME_ITS_TRUE(sink.values[4]->u.number == -7.0);
+        sink_reset(&sink);
+        fossil_media_json_stream_free(st);
+    }
+}
+
+FOSSIL_TEST(c_test_json_stream_error) {
+    stream_sink_t sink = {{0}, 0};
+    fossil_media_json_error_t err = {0};
+    fossil_media_json_stream_t *st = fossil_media_json_stream_create(NULL, collect_value, &sink);
+    ASSUME_NOT_CNULL(st);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_stream_feed(st, "[1] [2,", 7, &err), 0);
+    ASSUME_ITS_TRUE(fossil_media_json_stream_feed(st, "]", 1, &err) != 0);
+    ASSUME_ITS_EQUAL_CSTR(err.message, "Trailing comma in array");
+    ASSUME_ITS_EQUAL_SIZE(err.position, 7);
+    ASSUME_ITS_TRUE(fossil_media_json_stream_finish(st, &err) != 0);
+    ASSUME_ITS_EQUAL_SIZE(sink.count, 1);
+    sink_reset(&sink);
+    fossil_media_json_stream_free(st);
+
+    st = fossil_media_json_stream_create(NULL, collect_value, &sink);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_stream_feed(st, "{\"a\":", 5, &err), 0);
+    ASSUME_ITS_TRUE(fossil_media_json_stream_finish(st, &err) != 0);
+    ASSUME_ITS_EQUAL_SIZE(sink.count, 0);
+    fossil_media_json_stream_free(st);
+
+    /* A number or literal must be followed by whitespace, in any chunking */
+    static const char *glued[] = {"42\"s\"", "true[1]", "-1{}"};
+    for (size_t k = 0; k < sizeof(glued) / sizeof(glued[0]); ++k) {
+        size_t len = strlen(glued[k]);
+        for (size_t cut = 0; cut <= len; ++cut) {
+            st = fossil_media_json_stream_create(NULL, collect_value, &sink);
+            int rc = fossil_media_json_stream_feed(st, glued[k], cut, &err);
+            if (rc == 0) rc = fossil_media_json_stream_feed(st, glued[k] + cut, len - cut, &err);
+            ASSUME_ITS_TRUE(rc != 0);
+            ASSUME_ITS_EQUAL_SIZE(err.position, strcspn(glued[k], "\"[{"));
+            ASSUME_ITS_EQUAL_SIZE(sink.count, 0);
+            fossil_media_json_stream_free(st);
+        }
+    }
+    st = fossil_media_json_stream_create(NULL, collect_value, &sink);
+    ASSUME_ITS_TRUE(fossil_media_json_stream_feed(st, "tru\"", 4, &err) != 0);
+    ASSUME_ITS_EQUAL_CSTR(err.message, "Unexpected token when parsing literal");
+    fossil_media_json_stream_free(st);
+}
+
+typedef struct {
+    size_t records;
+    size_t errors;
+    size_t last_line;        /* must increase on every call */
+    size_t id_sum;
+    size_t bad_line;
+    size_t stop_after;       /* stop once this many records were seen, 0 = never */
+    int ordered;
+} ndjson_probe_t;
+
+static int count_record(fossil_media_json_value_t *v, size_t line, const fossil_media_json_error_t *err, void *user) {
+    ndjson_probe_t *pr = (ndjson_probe_t *)user;
+    if (line <= pr->last_line) pr->ordered = 0;
+    pr->last_line = line;
+    if (v) {
+        fossil_media_json_value_t *id = fossil_media_json_object_get(v, "id");
+        /* Record n sits on line n + 1 + n / 100 (a blank line after every 100) */
+        if (!id || (size_t)id->u.number + 1 + (size_t)id->u.number / 100 != line) pr->ordered = 0;
+        else pr->id_sum += (size_t)id->u.number;
+        pr->records++;
+        fossil_media_json_free(v);
+    } else {
+        if (!err) pr->ordered = 0;
+        if (!pr->errors++) pr->bad_line = line;
+    }
+    return pr->stop_after && pr->records + pr->errors >= pr->stop_after;
+}
+
+FOSSIL_TEST(c_test_json_ndjson) {
+    /* Several batches' worth of records, CRLF on odd ids, a blank line every 100 */
+    size_t n = 40000;
+    char *text = (char *)malloc(n * 64 + 1);
+    ASSUME_NOT_CNULL(text);
+    size_t len = 0;
+    for (size_t k = 0; k < n; ++k) {
+        len += (size_t)sprintf(text + len, "{\"id\":%u,\"msg\":\"line\\t%u\"}%s\n",
+                               (unsigned)k, (unsigned)k, k % 2 ? "\r" : "");
+        if (k % 100 == 99) text[len++] = '\n';
+    }
+    text[len] = '\0';
+
+    size_t threads[] = {1, 4};
+    for (size_t t = 0; t < 2; ++t) {
+        fossil_media_json_ndjson_options_t opts = {threads[t], 0, 0};
+        ndjson_probe_t pr = {0, 0, 0, 0, 0, 0, 1};
+        fossil_media_json_error_t err = {0};
+        ASSUME_ITS_EQUAL_I32(fossil_media_json_parse_ndjson(text, len, &opts, count_record, &pr, &err), 0);
+        ASSUME_ITS_EQUAL_SIZE(pr.records, n);
+        ASSUME_ITS_EQUAL_SIZE(pr.errors, 0);
+        ASSUME_ITS_EQUAL_SIZE(pr.id_sum, n * (n - 1) / 2);
+        ASSUME_ITS_TRUE(pr.ordered);
+    }
+
+    /* A malformed line is reported in place and the rest still parses */
+    char *bad = strstr(text, "{\"id\":30000,");
+    ASSUME_NOT_CNULL(bad);
+    bad[6] = 'x';
+    fossil_media_json_ndjson_options_t opts = {4, FOSSIL_MEDIA_JSON_PARSE_ARENA, 0};
+    ndjson_probe_t pr = {0, 0, 0, 0, 0, 0, 1};
+    fossil_media_json_error_t err = {0};
+    ASSUME_ITS_TRUE(fossil_media_json_parse_ndjson(text, len, &opts, count_record, &pr, &err) != 0);
+    ASSUME_ITS_EQUAL_SIZE(pr.records, n - 1);
+    ASSUME_ITS_EQUAL_SIZE(pr.errors, 1);
+    ASSUME_ITS_EQUAL_SIZE(pr.bad_line, 30000 + 1 + 300);
+    ASSUME_ITS_EQUAL_CSTR(err.message, "Unexpected token 'x'");
+    ASSUME_ITS_EQUAL_SIZE(err.position, (size_t)(bad - text) + 6);
+    ASSUME_ITS_TRUE(pr.ordered);
+
+    /* The callback can stop the batch early */
+    ndjson_probe_t stop = {0, 0, 0, 0, 0, 0, 1};
+    stop.stop_after = 5000;
+    ASSUME_ITS_TRUE(fossil_media_json_parse_ndjson(text, len, &opts, count_record, &stop, &err) != 0);
+    ASSUME_ITS_EQUAL_SIZE(stop.records, 5000);
+    ASSUME_ITS_EQUAL_CSTR(err.message, "NDJSON stopped by callback");
+
+    /* A stop after a malformed line keeps the earlier error */
+    for (size_t t = 0; t < 2; ++t) {
+        fossil_media_json_ndjson_options_t late = {threads[t], 0, 0};
+        ndjson_probe_t after = {0, 0, 0, 0, 0, 0, 1};
+        after.stop_after = 35000;
+        ASSUME_ITS_TRUE(fossil_media_json_parse_ndjson(text, len, &late, count_record, &after, &err) != 0);
+        ASSUME_ITS_EQUAL_SIZE(after.errors, 1);
+        ASSUME_ITS_EQUAL_CSTR(err.message, "Unexpected token 'x'");
+        ASSUME_ITS_EQUAL_SIZE(err.position, (size_t)(bad - text) + 6);
+    }
+
+    /* max_depth applies to every record on either path */
+    const char *nested = "[[1]]\n[2]\n";
+    for (size_t t = 0; t < 2; ++t) {
+        fossil_media_json_ndjson_options_t shallow = {threads[t], 0, 1};
+        ndjson_probe_t pr_depth = {0, 0, 0, 0, 0, 0, 1};
+        ASSUME_ITS_TRUE(fossil_media_json_parse_ndjson(nested, strlen(nested), &shallow, count_record, &pr_depth, &err) != 0);
+        ASSUME_ITS_EQUAL_SIZE(pr_depth.errors, 1);
+        ASSUME_ITS_EQUAL_I32(err.code, FOSSIL_MEDIA_JSON_ERROR_DEPTH);
+    }
+    free(text);
+}
+
+typedef struct {
+    int events;
+    int depth;
+    int want;                /* next string is the value of key "id" */
+    char id[16];
+} sax_probe_t;
+
+static int probe_open(void *user) { sax_probe_t *p = (sax_probe_t *)user; p->events++; p->depth++; return 0; }
+static int probe_close(void *user) { sax_probe_t *p = (sax_probe_t *)user; p->events++; p->depth--; return 0; }
+
+static int probe_key(void *user, const char *str, size_t len) {
+    sax_probe_t *p = (sax_probe_t *)user;
+    p->events++;
+    p->want = len == 2 && memcmp(str, "id", 2) == 0;
+    return 0;
+}
+
+static int probe_string(void *user, const char *str, size_t len) {
+    sax_probe_t *p = (sax_probe_t *)user;
+    p->events++;
+    if (p->want && len < sizeof(p->id)) { memcpy(p->id, str, len); p->id[len] = '\0'; }
+    p->want = 0;
+    return 0;
+}
+
+static int probe_number(void *user, double value, const char *text, size_t len) {
+    sax_probe_t *p = (sax_probe_t *)user;
+    (void)text;
+    p->events++;
+    p->want = 0;
+    return value == 13.0 && len == 4 ? 1 : 0;   /* "13e0" stops the parse */
+}
+
+FOSSIL_TEST(c_test_json_tape) {
+    fossil_media_json_error_t err = {0};
+    const char *json = "{\"name\":\"fossil\",\"id\":18446744073709551615,\"ratio\":0.25,\"ok\":true,"
+                       "\"tags\":[\"a\",null,{\"name\":\"inner\"},[]],\"empty\":{}}";
+    fossil_media_json_value_t *doc = fossil_media_json_parse(json, &err);
+    ASSUME_NOT_CNULL(doc);
+
+    size_t len = 0;
+    void *bytes = fossil_media_json_tape_encode(doc, &len, &err);
+    ASSUME_NOT_CNULL(bytes);
+    fossil_media_json_tape_t *tape = fossil_media_json_tape_load(bytes, len, &err);
+    ASSUME_NOT_CNULL(tape);
+
+    fossil_media_json_tape_ref_t root = fossil_media_json_tape_root(tape);
+    ASSUME_ITS_TRUE(fossil_media_json_tape_type(root) == FOSSIL_MEDIA_JSON_OBJECT);
+    ASSUME_ITS_EQUAL_SIZE(fossil_media_json_tape_size(root), 6);
+    size_t n = 0;
+    ASSUME_ITS_EQUAL_CSTR(fossil_media_json_tape_get_string(fossil_media_json_tape_get(root, "name"), &n), "fossil");
+    ASSUME_ITS_EQUAL_SIZE(n, 6);
+    unsigned long long u = 0;
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_tape_get_uint(fossil_media_json_tape_get(root, "id"), &u), 0);
+    ASSUME_ITS_TRUE(u == UINT64_MAX);
+    double d = 0;
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_tape_get_number(fossil_media_json_tape_get(root, "ratio"), &d), 0);
+    ASSUME_ITS_TRUE(d == 0.25);
+    int b = 0;
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_tape_get_bool(fossil_media_json_tape_get(root, "ok"), &b), 0);
+    ASSUME_ITS_EQUAL_I32(b, 1);
+    ASSUME_ITS_CNULL(fossil_media_json_tape_get(root, "missing").tape);
+
+    fossil_media_json_tape_ref_t tags = fossil_media_json_tape_get(root, "tags");
+    ASSUME_ITS_EQUAL_SIZE(fossil_media_json_tape_size(tags), 4);
+    fossil_media_json_tape_ref_t inner = fossil_media_json_tape_index(tags, 2);
+    ASSUME_ITS_EQUAL_CSTR(fossil_media_json_tape_get_string(fossil_media_json_tape_get(inner, "name"), NULL), "inner");
+    ASSUME_ITS_TRUE(fossil_media_json_tape_type(fossil_media_json_tape_index(tags, 3)) == FOSSIL_MEDIA_JSON_ARRAY);
+    ASSUME_ITS_CNULL(fossil_media_json_tape_index(tags, 4).tape);
+
+    fossil_media_json_tape_iter_t it;
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_tape_iter_init(root, &it), 0);
+    size_t members = 0;
+    while (fossil_media_json_tape_iter_next(&it)) {
+        ASSUME_NOT_CNULL(it.key);
+        members++;
+    }
+    ASSUME_ITS_EQUAL_SIZE(members, 6);
+    ASSUME_ITS_TRUE(fossil_media_json_tape_iter_init(fossil_media_json_tape_get(root, "ok"), &it) != 0);
+
+    /* Rebuilding keeps every value, including exact integers */
+    fossil_media_json_value_t *back = fossil_media_json_tape_to_value(root, &err);
+    ASSUME_NOT_CNULL(back);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_equals(doc, back), 1);
+    fossil_media_json_free(back);
+    fossil_media_json_tape_close(tape);
+
+    /* Damaged tapes are rejected or fail lookups, never read out of bounds */
+    ASSUME_ITS_CNULL(fossil_media_json_tape_load(bytes, len - 1, &err));
+    ASSUME_ITS_TRUE(err.code != 0);
+    ((char *)bytes)[0] = 'X';
+    ASSUME_ITS_CNULL(fossil_media_json_tape_load(bytes, len, NULL));
+    free(bytes);
+
+    const char *file = "fossil_media_json_tape.bin";
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_tape_write_file(doc, file, &err), 0);
+    tape = fossil_media_json_tape_open(file, &err);
+    ASSUME_NOT_CNULL(tape);
+    back = fossil_media_json_tape_to_value(fossil_media_json_tape_root(tape), &err);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_equals(doc, back), 1);
+    fossil_media_json_free(back);
+    fossil_media_json_tape_close(tape);
+    remove(file);
+    ASSUME_ITS_CNULL(fossil_media_json_tape_open(file, &err));
+    fossil_media_json_free(doc);
+}
+
+FOSSIL_TEST(c_test_json_parse_file) {
+    const char *file = "fossil_media_json_parse_file.json";
+    const char *text = "{\"name\":\"a\\\"b\",\"list\":[1,2.5,\"x\"],\"ok\":true}";
+    fossil_media_json_error_t err = {0, 0, ""};
+    char page[4096];
+    FILE *f = fopen(file, "wb");
+    ASSUME_NOT_CNULL(f);
+    fputs(text, f);
+    fclose(f);
+
+    fossil_media_json_value_t *v = fossil_media_json_parse_file(file, &err);
+    ASSUME_NOT_CNULL(v);
+    char *out = fossil_media_json_stringify(v, 0, &err);
+    ASSUME_ITS_EQUAL_CSTR(out, text);
+    fossil_media_json_free(v);
+    free(out);
+
+    /* In situ, strings live in a private mapping and the file is left alone */
+    fossil_media_json_parse_options_t opts = {FOSSIL_MEDIA_JSON_PARSE_INSITU, NULL, 0};
+    v = fossil_media_json_parse_file_ex(file, &opts, &err);
+    ASSUME_NOT_CNULL(v);
+    ASSUME_ITS_EQUAL_CSTR(fossil_media_json_object_get(v, "name")->u.string, "a\"b");
+    fossil_media_json_value_t *extra = fossil_media_json_new_null();
+    ASSUME_ITS_TRUE(fossil_media_json_object_set(v, "more", extra) != 0);
+    fossil_media_json_free(extra);
+    char *raw = fossil_media_read_file(file, NULL);
+    ASSUME_ITS_EQUAL_CSTR(raw, text);
+    free(raw);
+    fossil_media_json_free(v);
+
+    /* A file that fills its last page has no NUL after the mapping */
+    memset(page, ' ', sizeof(page));
+    memcpy(page, "[true]", 6);
+    f = fopen(file, "wb");
+    ASSUME_NOT_CNULL(f);
+    fwrite(page, 1, sizeof(page), f);
+    fclose(f);
+    v = fossil_media_json_parse_file_ex(file, &opts, &err);
+    ASSUME_NOT_CNULL(v);
+    ASSUME_ITS_EQUAL_SIZE(fossil_media_json_array_size(v), 1);
+    fossil_media_json_free(v);
+
+    /* Parse errors keep their positions; missing files are reported */
+    page[sizeof(page) - 1] = 'x';
+    f = fopen(file, "wb");
+    ASSUME_NOT_CNULL(f);
+    fwrite(page, 1, sizeof(page), f);
+    fclose(f);
+    ASSUME_ITS_CNULL(fossil_media_json_parse_file(file, &err));
+    ASSUME_ITS_EQUAL_SIZE(err.position, sizeof(page) - 1);
+    remove(file);
+    ASSUME_ITS_CNULL(fossil_media_json_parse_file_ex(file, &opts, &err));
+    ASSUME_ITS_EQUAL_CSTR(err.message, "Cannot read file");
+}
+
+FOSSIL_TEST(c_test_json_parse_sax) {
+    fossil_media_json_sax_handler_t h = {0};
+    h.start_object = h.start_array = probe_open;
+    h.end_object = h.end_array = probe_close;
+    h.key = probe_key;
+    h.string = probe_string;
+    h.number = probe_number;
+    sax_probe_t p = {0};
+    fossil_media_json_error_t err = {0};
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_parse_sax("{\"a\":[1,true,null],\"id\":\"x\\\"7\"}", &h, &p, &err), 0);
+    ASSUME_ITS_EQUAL_CSTR(p.id, "x\"7");
+    ASSUME_ITS_EQUAL_I32(p.events, 8);
+    ASSUME_ITS_EQUAL_I32(p.depth, 0);
+
+    /* Same diagnostics as the DOM parser */
+    ASSUME_ITS_TRUE(fossil_media_json_parse_sax("[1,]", &h, &p, &err) != 0);
+    ASSUME_ITS_EQUAL_CSTR(err.message, "Trailing comma in array");
+    ASSUME_ITS_EQUAL_SIZE(err.position, 3);
+
+    /* A handler can stop early */
+    ASSUME_ITS_TRUE(fossil_media_json_parse_sax("[1, 13e0, 2]", &h, &p, &err) != 0);
+    ASSUME_ITS_EQUAL_CSTR(err.message, "Aborted by handler");
+    ASSUME_ITS_EQUAL_SIZE(err.position, 4);
+}
+
+FOSSIL_TEST(c_test_json_max_depth) {
+    fossil_media_json_error_t err = {0, 0, ""};
+    fossil_media_json_parse_options_t opts = {0, NULL, 3};
+    fossil_media_json_value_t *v = fossil_media_json_parse_ex("[[[1]]]", &opts, &err);
+    ASSUME_NOT_CNULL(v);
+    fossil_media_json_free(v);
+    opts.max_depth = 2;
+    ASSUME_ITS_CNULL(fossil_media_json_parse_ex("[[[1]]]", &opts, &err));
+    ASSUME_ITS_EQUAL_I32(err.code, FOSSIL_MEDIA_JSON_ERROR_DEPTH);
+    ASSUME_ITS_EQUAL_CSTR(err.message, "Maximum nesting depth exceeded");
+    ASSUME_ITS_EQUAL_SIZE(err.position, 2);
+
+    /* Deep documents do not consume the C stack */
+    const size_t n = 100000;
+    char *arr = malloc(2 * n + 1);
+    char *obj = malloc(6 * n + 2);
+    ASSUME_NOT_CNULL(arr);
+    ASSUME_NOT_CNULL(obj);
+    memset(arr, '[', n);
+    memset(arr + n, ']', n);
+    arr[2 * n] = '\0';
+    char *o = obj;
+    for (size_t k = 0; k < n; ++k) { memcpy(o, "{\"a\":", 5); o += 5; }
+    *o++ = '1';
+    memset(o, '}', n);
+    o[n] = '\0';
+    const char *deep[2] = {arr, obj};
+    for (int k = 0; k < 2; ++k) {
+        v = fossil_media_json_parse(deep[k], &err);
+        ASSUME_NOT_CNULL(v);
+        char *text = fossil_media_json_stringify(v, 0, &err);
+        ASSUME_NOT_CNULL(text);
+        ASSUME_ITS_EQUAL_CSTR(text, deep[k]);
+        fossil_media_json_value_t *copy = fossil_media_json_clone(v);
+        ASSUME_ITS_TRUE(fossil_media_json_equals(v, copy) == 1);
+        fossil_media_json_free(copy);
+        copy = fossil_media_json_parse(deep[k], &err);
+        ASSUME_ITS_TRUE(fossil_media_json_equals(v, copy) == 1);
+        fossil_media_json_free(copy);
+        fossil_media_json_free(v);
+        free(text);
+
+        opts.max_depth = 1000;
+        ASSUME_ITS_CNULL(fossil_media_json_parse_ex(deep[k], &opts, &err));
+        ASSUME_ITS_EQUAL_I32(err.code, FOSSIL_MEDIA_JSON_ERROR_DEPTH);
+        ASSUME_ITS_EQUAL_SIZE(err.position, k == 0 ? 1000 : 5000);
+    }
+
+    fossil_media_json_sax_handler_t h = {0};
+    h.start_object = h.start_array = probe_open;
+    h.end_object = h.end_array = probe_close;
+    sax_probe_t p = {0};
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_parse_sax(arr, &h, &p, &err), 0);
+    ASSUME_ITS_EQUAL_I32(p.depth, 0);
+
+    fossil_media_json_validate_options_t vopts = {1000, 0, 0};
+    ASSUME_ITS_TRUE(fossil_media_json_validate_ex(arr, &vopts, &err) != 0);
+    ASSUME_ITS_EQUAL_I32(err.code, FOSSIL_MEDIA_JSON_ERROR_DEPTH);
+    free(arr);
+    free(obj);
+}
+
+FOSSIL_TEST(c_test_json_object_large_lookup) {
+    fossil_media_json_value_t *obj = fossil_media_json_new_object();
+    char key[32];
+    for (int k = 0; k < 1000; ++k) {
+        snprintf(key, sizeof(key), "key%d", k);
+        ASSUME_ITS_EQUAL_I32(fossil_media_json_object_set(obj, key, fossil_media_json_new_number(k)), 0);
+    }
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_object_set(obj, "key500", fossil_media_json_new_number(-1)), 0);
+    ASSUME_ITS_EQUAL_SIZE(obj->u.object.count, 1000);
+    ASSUME_ITS_TRUE(fossil_media_json_object_get(obj, "key500")->u.number == -1.0);
+    ASSUME_ITS_TRUE(fossil_media_json_object_get(obj, "key999")->u.number == 999.0);
+    ASSUME_ITS_CNULL(fossil_media_json_object_get(obj, "key1000"));
+
+    fossil_media_json_value_t *gone = fossil_media_json_object_remove(obj, "key10");
+    ASSUME_NOT_CNULL(gone);
+    fossil_media_json_free(gone);
+    ASSUME_ITS_CNULL(fossil_media_json_object_get(obj, "key10"));
+    ASSUME_ITS_TRUE(fossil_media_json_object_get(obj, "key11")->u.number == 11.0);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_object_reserve(obj, 4000), 0);
+    ASSUME_ITS_TRUE(fossil_media_json_object_get(obj, "key998")->u.number == 998.0);
+    /* Insertion order is unchanged */
+    ASSUME_ITS_EQUAL_CSTR(obj->u.object.keys[10], "key11");
+    /* Remove from the back, then from the middle; survivors stay reachable */
+    for (int k = 999; k >= 800; --k) {
+        snprintf(key, sizeof(key), "key%d", k);
+        fossil_media_json_free(fossil_media_json_object_remove(obj, key));
+    }
+    for (int k = 100; k < 300; ++k) {
+        snprintf(key, sizeof(key), "key%d", k);
+        fossil_media_json_free(fossil_media_json_object_remove(obj, key));
+    }
+    ASSUME_ITS_EQUAL_SIZE(obj->u.object.count, 599);
+    for (int k = 0; k < 1000; ++k) {
+        snprintf(key, sizeof(key), "key%d", k);
+        fossil_media_json_value_t *v = fossil_media_json_object_get(obj, key);
+        if (k == 10 || (k >= 100 && k < 300) || k >= 800) ASSUME_ITS_CNULL(v);
+        else ASSUME_ITS_TRUE(v && v->u.number == (k == 500 ? -1.0 : (double)k));
+    }
+    fossil_media_json_free(obj);
+
+    /* Parsed duplicates resolve to the first occurrence, then the next one */
+    char text[1024];
+    size_t len = 0;
+    text[len++] = '{';
+    for (int k = 0; k < 40; ++k) len += (size_t)sprintf(text + len, "\"k%d\":%d,", k % 30, k);
+    text[len - 1] = '}';
+    text[len] = '\0';
+    obj = fossil_media_json_parse(text, NULL);
+    ASSUME_NOT_CNULL(obj);
+    ASSUME_ITS_TRUE(fossil_media_json_object_get(obj, "k5")->u.number == 5.0);
+    gone = fossil_media_json_object_remove(obj, "k5");
+    fossil_media_json_free(gone);
+    ASSUME_ITS_TRUE(fossil_media_json_object_get(obj, "k5")->u.number == 35.0);
+    fossil_media_json_free(obj);
+
+    /* Arena documents carry their index outside the node too */
+    fossil_media_json_parse_options_t opts = {FOSSIL_MEDIA_JSON_PARSE_ARENA, NULL, 0};
+    obj = fossil_media_json_parse_ex(text, &opts, NULL);
+    ASSUME_NOT_CNULL(obj);
+    ASSUME_ITS_TRUE(fossil_media_json_object_get(obj, "k29")->u.number == 29.0);
+    ASSUME_ITS_CNULL(fossil_media_json_object_get(obj, "k30"));
+    fossil_media_json_free(obj);
+    if (sizeof(void *) == 8) ASSUME_ITS_EQUAL_SIZE(sizeof(fossil_media_json_value_t), 40);
+
+    /* Members filled in by hand past the index threshold are still found */
+    obj = fossil_media_json_new_object();
+    for (int k = 0; k < 20; ++k) {
+        snprintf(key, sizeof(key), "key%d", k);
+        fossil_media_json_object_set(obj, key, fossil_media_json_new_number(k));
+    }
+    ASSUME_ITS_TRUE(fossil_media_json_object_get(obj, "key19")->u.number == 19.0);
+    size_t n = obj->u.object.count;
+    obj->u.object.keys = realloc(obj->u.object.keys, (n + 1) * sizeof(char *));
+    obj->u.object.values = realloc(obj->u.object.values, (n + 1) * sizeof(fossil_media_json_value_t *));
+    obj->u.object.keys[n] = malloc(sizeof("manual"));
+    memcpy(obj->u.object.keys[n], "manual", sizeof("manual"));
+    obj->u.object.values[n] = fossil_media_json_new_number(-5);
+    obj->u.object.count = obj->u.object.capacity = n + 1;
+    ASSUME_ITS_TRUE(fossil_media_json_object_get(obj, "manual")->u.number == -5.0);
+    /* A reordered copy of keys[] replaces the stale positions */
+    char **keys = malloc((n + 1) * sizeof(char *));
+    fossil_media_json_value_t **values = malloc((n + 1) * sizeof(fossil_media_json_value_t *));
+    for (size_t k = 0; k <= n; ++k) {
+        keys[k] = obj->u.object.keys[n - k];
+        values[k] = obj->u.object.values[n - k];
+    }
+    free(obj->u.object.keys);
+    free(obj->u.object.values);
+    obj->u.object.keys = keys;
+    obj->u.object.values = values;
+    ASSUME_ITS_TRUE(fossil_media_json_object_get(obj, "key0")->u.number == 0.0);
+    ASSUME_ITS_TRUE(fossil_media_json_object_get(obj, "manual")->u.number == -5.0);
+    fossil_media_json_free(obj);
+}
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t calls;
+} byte_sink_t;
+
+static int append_bytes(void *user, const char *data, size_t len) {
+    byte_sink_t *b = (byte_sink_t *)user;
+    char *grown = realloc(b->data, b->len + len + 1);
+    if (!grown) return -1;
+    memcpy(grown + b->len, data, len);
+    b->data = grown;
+    b->len += len;
+    b->data[b->len] = '\0';
+    b->calls++;
+    return 0;
+}
+
+FOSSIL_TEST(c_test_json_int64) {
+    fossil_media_json_error_t err = {0};
+    const char *json = "{\"id\":9007199254740993,\"ts\":-9223372036854775808,\"max\":18446744073709551615,"
+                       "\"big\":18446744073709551616,\"f\":2.0,\"neg0\":-0,\"small\":-42}";
+    fossil_media_json_value_t *doc = fossil_media_json_parse(json, &err);
+    ASSUME_NOT_CNULL(doc);
+
+    long long i = 0;
+    unsigned long long u = 0;
+    fossil_media_json_value_t *id = fossil_media_json_object_get(doc, "id");
+    ASSUME_ITS_TRUE(fossil_media_json_is_integer(id));
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_get_int(id, &i), 0);
+    ASSUME_ITS_TRUE(i == 9007199254740993LL);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_get_int(fossil_media_json_object_get(doc, "ts"), &i), 0);
+    ASSUME_ITS_TRUE(i == INT64_MIN);
+    fossil_media_json_value_t *max = fossil_media_json_object_get(doc, "max");
+    ASSUME_ITS_TRUE(fossil_media_json_get_int(max, &i) != 0);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_get_uint(max, &u), 0);
+    ASSUME_ITS_TRUE(u == UINT64_MAX);
+    ASSUME_ITS_TRUE(max->u.number == 18446744073709551616.0);
+
+    /* Past 64 bits, fractions, exponents and -0 stay doubles */
+    ASSUME_ITS_TRUE(!fossil_media_json_is_integer(fossil_media_json_object_get(doc, "big")));
+    ASSUME_ITS_TRUE(!fossil_media_json_is_integer(fossil_media_json_object_get(doc, "f")));
+    ASSUME_ITS_TRUE(!fossil_media_json_is_integer(fossil_media_json_object_get(doc, "neg0")));
+    ASSUME_ITS_TRUE(fossil_media_json_get_uint(fossil_media_json_object_get(doc, "small"), &u) != 0);
+
+    char *out = fossil_media_json_stringify(doc, 0, &err);
+    ASSUME_NOT_CNULL(out);
+    ASSUME_ITS_EQUAL_CSTR(out, "{\"id\":9007199254740993,\"ts\":-9223372036854775808,\"max\":18446744073709551615,"
+                               "\"big\":18446744073709552000,\"f\":2,\"neg0\":-0,\"small\":-42}");
+    free(out);
+
+    /* Exact comparison: neighbours that share a double are not equal */
+    fossil_media_json_value_t *a = fossil_media_json_new_int(9007199254740993LL);
+    fossil_media_json_value_t *b = fossil_media_json_new_number(9007199254740992.0);
+    fossil_media_json_value_t *c = fossil_media_json_new_uint(9007199254740993ULL);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_equals(a, b), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_equals(a, c), 1);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_equals(a, id), 1);
+    fossil_media_json_value_t *copy = fossil_media_json_clone(max);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_equals(copy, max), 1);
+    fossil_media_json_free(copy);
+    fossil_media_json_free(a);
+    fossil_media_json_free(b);
+    fossil_media_json_free(c);
+
+    /* Assigning u.number directly retires the exact integer */
+    fossil_media_json_value_t *small = fossil_media_json_object_get(doc, "small");
+    small->u.number = 7.5;
+    ASSUME_ITS_TRUE(!fossil_media_json_is_integer(small));
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_get_int(small, &i), 0);
+    ASSUME_ITS_TRUE(i == 7);
+    id->u.number = 3.0;
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_get_int(id, &i), 0);
+    ASSUME_ITS_TRUE(i == 3);
+    fossil_media_json_value_t *three = fossil_media_json_new_int(3);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_equals(id, three), 1);
+    ASSUME_ITS_TRUE(fossil_media_json_hash(id) == fossil_media_json_hash(three));
+    fossil_media_json_free(three);
+    out = fossil_media_json_stringify(doc, 0, &err);
+    ASSUME_NOT_CNULL(out);
+    ASSUME_ITS_EQUAL_CSTR(out, "{\"id\":3,\"ts\":-9223372036854775808,\"max\":18446744073709551615,"
+                               "\"big\":18446744073709552000,\"f\":2,\"neg0\":-0,\"small\":7.5}");
+    free(out);
+    fossil_media_json_free(doc);
+
+    fossil_media_json_value_t *n = fossil_media_json_new_number(1e300);
+    ASSUME_ITS_TRUE(fossil_media_json_get_int(n, &i) != 0);
+    fossil_media_json_free(n);
+
+    byte_sink_t sink = {NULL, 0, 0};
+    fossil_media_json_writer_t *w = fossil_media_json_writer_create(append_bytes, &sink, 0);
+    ASSUME_NOT_CNULL(w);
+    fossil_media_json_writer_begin_array(w);
+    fossil_media_json_writer_int(w, INT64_MIN);
+    fossil_media_json_writer_uint(w, UINT64_MAX);
+    fossil_media_json_writer_end_array(w);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_writer_finish(w, NULL), 0);
+    ASSUME_ITS_EQUAL_CSTR(sink.data, "[-9223372036854775808,18446744073709551615]");
+    fossil_media_json_writer_free(w);
+    free(sink.data);
+}
+
+FOSSIL_TEST(c_test_json_writer_events) {
+    byte_sink_t out = {NULL, 0, 0};
+    fossil_media_json_writer_t *w = fossil_media_json_writer_create(append_bytes, &out, 0);
+    ASSUME_NOT_CNULL(w);
+    fossil_media_json_value_t *tags = fossil_media_json_parse("[\"a\",{\"b\":null}]", NULL);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_writer_begin_object(w), 0);
+    fossil_media_json_writer_key(w, "id");
+    fossil_media_json_writer_number(w, 7);
+    fossil_media_json_writer_key(w, "name");
+    fossil_media_json_writer_string(w, "x\"y\n");
+    fossil_media_json_writer_key(w, "tags");
+    fossil_media_json_writer_value(w, tags);
+    fossil_media_json_writer_key(w, "ok");
+    fossil_media_json_writer_bool(w, 1);
+    fossil_media_json_writer_key(w, "rows");
+    fossil_media_json_writer_begin_array(w);
+    fossil_media_json_writer_end_array(w);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_writer_end_object(w), 0);
+    /* Nothing reaches the sink until the buffer fills or is flushed */
+    ASSUME_ITS_EQUAL_SIZE(out.calls, 0);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_writer_finish(w, NULL), 0);
+    ASSUME_ITS_EQUAL_CSTR(out.data, "{\"id\":7,\"name\":\"x\\\"y\\n\",\"tags\":[\"a\",{\"b\":null}],\"ok\":true,\"rows\":[]}");
+    fossil_media_json_writer_free(w);
+    fossil_media_json_free(tags);
+    free(out.data);
+
+    /* A large DOM arrives in several sink calls and matches stringify */
+    fossil_media_json_value_t *arr = fossil_media_json_new_array();
+    for (int k = 0; k < 20000; ++k) {
+        fossil_media_json_value_t *o = fossil_media_json_new_object();
+        fossil_media_json_object_set(o, "k", fossil_media_json_new_number(k * 0.5));
+        fossil_media_json_array_append(arr, o);
+    }
+    out.data = NULL; out.len = 0; out.calls = 0;
+    w = fossil_media_json_writer_create(append_bytes, &out, 1);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_writer_value(w, arr), 0);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_writer_finish(w, NULL), 0);
+    ASSUME_ITS_TRUE(out.calls > 1);
+    char *s = fossil_media_json_stringify(arr, 1, NULL);
+    ASSUME_ITS_EQUAL_CSTR(out.data, s);
+    free(s);
+    free(out.data);
+    fossil_media_json_writer_free(w);
+    fossil_media_json_free(arr);
+}
+
+FOSSIL_TEST(c_test_json_writer_errors) {
+    byte_sink_t out = {NULL, 0, 0};
+    fossil_media_json_error_t err = {0};
+    fossil_media_json_writer_t *w = fossil_media_json_writer_create(append_bytes, &out, 0);
+    fossil_media_json_writer_begin_object(w);
+    ASSUME_ITS_TRUE(fossil_media_json_writer_number(w, 1) != 0);
+    /* The first error sticks */
+    ASSUME_ITS_TRUE(fossil_media_json_writer_key(w, "a") != 0);
+    ASSUME_ITS_TRUE(fossil_media_json_writer_finish(w, &err) != 0);
+    ASSUME_ITS_EQUAL_CSTR(err.message, "Expected key in object");
+    fossil_media_json_writer_free(w);
+
+    w = fossil_media_json_writer_create(append_bytes, &out, 0);
+    fossil_media_json_writer_begin_array(w);
+    ASSUME_ITS_TRUE(fossil_media_json_writer_end_object(w) != 0);
+    fossil_media_json_writer_free(w);
+
+    w = fossil_media_json_writer_create(append_bytes, &out, 0);
+    fossil_media_json_writer_begin_array(w);
+    ASSUME_ITS_TRUE(fossil_media_json_writer_finish(w, &err) != 0);
+    ASSUME_ITS_EQUAL_CSTR(err.message, "Incomplete document");
+    fossil_media_json_writer_free(w);
+
+    w = fossil_media_json_writer_create(append_bytes, &out, 0);
+    fossil_media_json_writer_null(w);
+    ASSUME_ITS_TRUE(fossil_media_json_writer_null(w) != 0);
+    fossil_media_json_writer_free(w);
+
+    /* stringify reports the same diagnostics as the streaming writer */
+    fossil_media_json_value_t *arr = fossil_media_json_parse("[1,true]", NULL);
+    fossil_media_json_value_t *bad = fossil_media_json_array_get(arr, 1);
+    fossil_media_json_type_t saved = bad->type;
+    bad->type = (fossil_media_json_type_t)99;
+    w = fossil_media_json_writer_create(append_bytes, &out, 0);
+    ASSUME_ITS_TRUE(fossil_media_json_writer_value(w, arr) != 0);
+    ASSUME_ITS_TRUE(fossil_media_json_writer_finish(w, &err) != 0);
+    fossil_media_json_writer_free(w);
+    fossil_media_json_error_t serr = {0};
+    ASSUME_ITS_TRUE(fossil_media_json_stringify(arr, 0, &serr) == NULL);
+    ASSUME_ITS_EQUAL_CSTR(serr.message, "Invalid value type");
+    ASSUME_ITS_EQUAL_CSTR(serr.message, err.message);
+    ASSUME_ITS_EQUAL_SIZE(serr.position, err.position);
+    ASSUME_ITS_EQUAL_SIZE(serr.position, 2);
+    bad->type = saved;
+    fossil_media_json_free(arr);
+    free(out.data);
+}
+
+FOSSIL_TEST(c_test_json_stringify_parallel) {
+    fossil_media_json_error_t err = {0};
+    fossil_media_json_value_t *doc = fossil_media_json_new_object();
+    fossil_media_json_value_t *list = fossil_media_json_new_array();
+    char name[32];
+    for (int i = 0; i < 500; ++i) {
+        fossil_media_json_value_t *rec = fossil_media_json_new_object();
+        snprintf(name, sizeof(name), "n\"%d\n", i);
+        fossil_media_json_object_set(rec, "name", fossil_media_json_new_string(name));
+        fossil_media_json_object_set(rec, "tags", fossil_media_json_new_array());
+        fossil_media_json_array_append(fossil_media_json_object_get(rec, "tags"), fossil_media_json_new_number(i / 8.0));
+        fossil_media_json_array_append(list, rec);
+    }
+    fossil_media_json_object_set(doc, "list", list);
+    fossil_media_json_object_set(doc, "empty", fossil_media_json_new_array());
+
+    /* Any thread count and split size gives the serial bytes */
+    fossil_media_json_parallel_options_t opts = {4, 3};
+    for (int pretty = 0; pretty < 2; ++pretty) {
+        char *serial = fossil_media_json_stringify(doc, pretty, &err);
+        char *split = fossil_media_json_stringify_ex(doc, pretty, &opts, &err);
+        ASSUME_NOT_CNULL(split);
+        ASSUME_ITS_EQUAL_CSTR(split, serial);
+        free(split);
+
+        byte_sink_t out = {NULL, 0, 0};
+        fossil_media_json_writer_t *w = fossil_media_json_writer_create(append_bytes, &out, pretty);
+        ASSUME_ITS_EQUAL_I32(fossil_media_json_writer_set_parallel(w, &opts), 0);
+        ASSUME_ITS_EQUAL_I32(fossil_media_json_writer_value(w, doc), 0);
+        ASSUME_ITS_EQUAL_I32(fossil_media_json_writer_finish(w, &err), 0);
+        ASSUME_ITS_EQUAL_CSTR(out.data, serial);
+        fossil_media_json_writer_free(w);
+        free(out.data);
+        free(serial);
+    }
+
+    /* A failure inside a run is reported where the serial writer reports it */
+    fossil_media_json_value_t *hole = list->u.array.items[321];
+    list->u.array.items[321] = NULL;
+    fossil_media_json_error_t serial_err = {0};
+    byte_sink_t out = {NULL, 0, 0};
+    fossil_media_json_writer_t *w = fossil_media_json_writer_create(append_bytes, &out, 0);
+    fossil_media_json_writer_value(w, doc);
+    fossil_media_json_writer_finish(w, &serial_err);
+    fossil_media_json_writer_free(w);
+    w = fossil_media_json_writer_create(append_bytes, &out, 0);
+    fossil_media_json_writer_set_parallel(w, &opts);
+    ASSUME_ITS_TRUE(fossil_media_json_writer_value(w, doc) != 0);
+    ASSUME_ITS_TRUE(fossil_media_json_writer_finish(w, &err) != 0);
+    ASSUME_ITS_EQUAL_CSTR(err.message, "NULL value");
+    ASSUME_ITS_EQUAL_SIZE(err.position, serial_err.position);
+    fossil_media_json_writer_free(w);
+    free(out.data);
+    ASSUME_ITS_CNULL(fossil_media_json_stringify_ex(doc, 0, &opts, &err));
+    list->u.array.items[321] = hole;
+    fossil_media_json_free(doc);
+}
+
+FOSSIL_TEST(c_test_json_string_runs) {
+    /* Escapes at every offset around the 16-byte blocks the scanners use */
+    static const char *specials[] = {"\"", "\\", "\n", "\x01", "\x1f", "\xc3\xa9"};
+    char raw[80];
+    fossil_media_json_error_t err = {0};
+    for (size_t n = 0; n < 48; ++n) {
+        for (size_t k = 0; k < sizeof(specials) / sizeof(specials[0]); ++k) {
+            memset(raw, 'a', sizeof(raw));
+            size_t at = n / 2;
+            size_t sl = strlen(specials[k]);
+            memcpy(raw + at, specials[k], sl);
+            raw[n + sl] = '\0';
+            fossil_media_json_value_t *v = fossil_media_json_new_string(raw);
+            char *text = fossil_media_json_stringify(v, 0, &err);
+            ASSUME_NOT_CNULL(text);
+            ASSUME_ITS_EQUAL_I32(fossil_media_json_validate(text, &err), 0);
+            fossil_media_json_value_t *back = fossil_media_json_parse(text, &err);
+            ASSUME_NOT_CNULL(back);
+            ASSUME_ITS_EQUAL_CSTR(back->u.string, raw);
+            fossil_media_json_free(back);
+            fossil_media_json_free(v);
+            free(text);
+        }
+    }
+    fossil_media_json_value_t *v = fossil_media_json_new_string("\x01\x08\x0b\x7f");
+    char *text = fossil_media_json_stringify(v, 0, &err);
+    ASSUME_ITS_EQUAL_CSTR(text, "\"\\u0001\\b\\u000b\x7f\"");
+    free(text);
+    fossil_media_json_free(v);
+    ASSUME_ITS_CNULL(fossil_media_json_parse("\"0123456789abcdef\\x\"", &err));
+    ASSUME_ITS_EQUAL_CSTR(err.message, "Invalid escape \\x");
+    ASSUME_ITS_EQUAL_SIZE(err.position, 19);
+}
+
+FOSSIL_TEST(c_test_json_number_corpus) {
+    /* Correctly rounded results, including halfway, subnormal and overflow cases */
+    static const struct { const char *text; uint64_t bits; } corpus[] = {
+        {"0", 0x0000000000000000u},
+        {"-0", 0x8000000000000000u},
+        {"0.1", 0x3fb999999999999au},
+        {"0.3", 0x3fd3333333333333u},
+        {"9007199254740993", 0x4340000000000000u},
+        {"9007199254740993.0000000000000000001", 0x4340000000000001u},
+        {"18446744073709551615", 0x43f0000000000000u},
+        {"1e23", 0x44b52d02c7e14af6u},
+        {"7.2057594037927933e16", 0x4370000000000000u},
+        {"123456789012345678901234567890e-10", 0x43e56a95319d63e1u},
+        {"1.7976931348623157e308", 0x7fefffffffffffffu},
+        {"1.7976931348623158e308", 0x7fefffffffffffffu},
+        {"2e308", 0x7ff0000000000000u},
+        {"2.2250738585072011e-308", 0x000fffffffffffffu},
+        {"2.2250738585072014e-308", 0x0010000000000000u},
+        {"4.9406564584124654e-324", 0x0000000000000001u},
+        {"2.4703282292062327e-324", 0x0000000000000000u},
+        {"2.4703282292062328e-324", 0x0000000000000001u},
+        {"1E+2", 0x4059000000000000u},
+        {"-1e-400", 0x8000000000000000u}
+    };
+    for (size_t k = 0; k < sizeof(corpus) / sizeof(corpus[0]); ++k) {
+        fossil_media_json_value_t *v = fossil_media_json_parse(corpus[k].text, NULL);
+        ASSUME_NOT_CNULL(v);
+        uint64_t bits;
+        memcpy(&bits, &v->u.number, sizeof(bits));
+        ASSUME_ITS_TRUE(bits == corpus[k].bits);
+        fossil_media_json_free(v);
+    }
+
+    /* Shortest-exact printing of random doubles parses back to the same bits */
+    uint64_t state = 0x9e3779b97f4a7c15u;
+    for (int k = 0; k < 20000; ++k) {
+        state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+        uint64_t bits = state & 0x7fffffffffffffffu;
+        if ((bits >> 52) == 0x7ff) continue;
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        char text[40];
+        snprintf(text, sizeof(text), "%.17g", d);
+        fossil_media_json_value_t *v = fossil_media_json_parse(text, NULL);
+        ASSUME_NOT_CNULL(v);
+        ASSUME_ITS_TRUE(memcmp(&v->u.number, &d, sizeof(d)) == 0);
+        fossil_media_json_free(v);
+    }
+}
+
+FOSSIL_TEST(c_test_json_stringify_numbers) {
+    static const struct { double value; const char *text; } cases[] = {
+        {0.0, "0"},
+        {-0.0, "-0"},
+        {0.1, "0.1"},
+        {0.1 + 0.2, "0.30000000000000004"},
+        {-42.0, "-42"},
+        {9007199254740991.0, "9007199254740991"},
+        {1e20, "100000000000000000000"},
+        {1e21, "1e21"},
+        {1.5e300, "1.5e300"},
+        {0.000001, "0.000001"},
+        {1e-7, "1e-7"},
+        {-2.5e-8, "-2.5e-8"},
+        {5e-324, "5e-324"},
+        {1.7976931348623157e308, "1.7976931348623157e308"},
+        {2.2250738585072014e-308, "2.2250738585072014e-308"}
+    };
+    for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); ++k) {
+        fossil_media_json_value_t *v = fossil_media_json_new_number(cases[k].value);
+        char *s = fossil_media_json_stringify(v, 0, NULL);
+        ASSUME_NOT_CNULL(s);
+        ASSUME_ITS_EQUAL_CSTR(s, cases[k].text);
+        free(s);
+        fossil_media_json_free(v);
+    }
+
+    /* Non-finite values have no JSON spelling */
+    fossil_media_json_value_t *arr = fossil_media_json_new_array();
+    fossil_media_json_array_append(arr, fossil_media_json_new_number(HUGE_VAL));
+    fossil_media_json_array_append(arr, fossil_media_json_new_number(-HUGE_VAL));
+    char *s = fossil_media_json_stringify(arr, 0, NULL);
+    ASSUME_ITS_EQUAL_CSTR(s, "[null,null]");
+    free(s);
+    fossil_media_json_free(arr);
+}
+
+FOSSIL_TEST(c_test_json_number_grammar) {
+    fossil_media_json_error_t err = {0};
+    const char *invalid[] = {"-", "1.", "1.e5", "1e", "1e+", "-.5"};
+    for (size_t k = 0; k < sizeof(invalid) / sizeof(invalid[0]); ++k) {
+        ASSUME_ITS_CNULL(fossil_media_json_parse(invalid[k], &err));
+        ASSUME_ITS_EQUAL_CSTR(err.message, "Invalid number");
+        ASSUME_ITS_EQUAL_SIZE(err.position, 0);
+    }
+    /* A leading zero ends the number */
+    ASSUME_ITS_CNULL(fossil_media_json_parse("[01]", &err));
+    ASSUME_ITS_EQUAL_CSTR(err.message, "Expected ',' or ']' in array");
+    ASSUME_ITS_EQUAL_SIZE(err.position, 2);
+}
+
+FOSSIL_TEST(c_test_json_simd_backend) {
+    const char *name = fossil_media_json_simd_backend();
+    ASSUME_NOT_CNULL(name);
+    ASSUME_ITS_TRUE(strcmp(name, "avx2") == 0 || strcmp(name, "sse2") == 0 || strcmp(name, "scalar") == 0);
+}
+
+typedef struct {
+    const char *text;
+    size_t count;         /* elements parsed */
+    const char *backend;  /* indexer in use afterwards */
+} backend_probe_t;
+
+#if defined(_WIN32)
+static DWORD WINAPI backend_probe(LPVOID arg) {
+#else
+static void *backend_probe(void *arg) {
+#endif
+    backend_probe_t *p = (backend_probe_t *)arg;
+    fossil_media_json_value_t *v = fossil_media_json_parse(p->text, NULL);
+    p->count = fossil_media_json_array_size(v);
+    p->backend = fossil_media_json_simd_backend();
+    fossil_media_json_free(v);
+    return 0;
+}
+
+FOSSIL_TEST(c_test_json_simd_backend_threads) {
+    /* Large enough for the indexed parser, so parsing selects the indexer */
+    size_t len = 0;
+    char *text = (char *)malloc(8192);
+    ASSUME_NOT_CNULL(text);
+    text[len++] = '[';
+    for (int i = 0; i < 1500; ++i) len += (size_t)sprintf(text + len, "%s%d", i ? "," : "", i);
+    text[len++] = ']';
+    text[len] = '\0';
+    const char *detected = fossil_media_json_simd_backend();
+
+    /* Forget the choice each round so the threads race to make it */
+    enum { THREADS = 4 };
+    for (int round = 0; round < 8; ++round) {
+        backend_probe_t probes[THREADS];
+#if defined(_WIN32)
+        HANDLE threads[THREADS];
+#else
+        pthread_t threads[THREADS];
+#endif
+        ASSUME_ITS_EQUAL_I32(fossil_media_json_simd_select(NULL), 0);
+        for (int t = 0; t < THREADS; ++t) {
+            probes[t].text = text;
+            probes[t].count = 0;
+            probes[t].backend = NULL;
+#if defined(_WIN32)
+            threads[t] = CreateThread(NULL, 0, backend_probe, &probes[t], 0, NULL);
+            ASSUME_NOT_CNULL(threads[t]);
+#else
+            ASSUME_ITS_EQUAL_I32(pthread_create(&threads[t], NULL, backend_probe, &probes[t]), 0);
+#endif
+        }
+        for (int t = 0; t < THREADS; ++t) {
+#if defined(_WIN32)
+            WaitForSingleObject(threads[t], INFINITE);
+            CloseHandle(threads[t]);
+#else
+            pthread_join(threads[t], NULL);
+#endif
+            ASSUME_ITS_EQUAL_SIZE(probes[t].count, 1500);
+            ASSUME_ITS_EQUAL_CSTR(probes[t].backend, detected);
+        }
+    }
+
+    /* A forced indexer is used until the choice is forgotten */
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_simd_select("scalar"), 0);
+    ASSUME_ITS_EQUAL_CSTR(fossil_media_json_simd_backend(), "scalar");
+    fossil_media_json_value_t *v = fossil_media_json_parse(text, NULL);
+    ASSUME_ITS_EQUAL_SIZE(fossil_media_json_array_size(v), 1500);
+    fossil_media_json_free(v);
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_simd_select("mmx"), -1);
+    ASSUME_ITS_EQUAL_CSTR(fossil_media_json_simd_backend(), "scalar");
+    ASSUME_ITS_EQUAL_I32(fossil_media_json_simd_select(NULL), 0);
+    ASSUME_ITS_EQUAL_CSTR(fossil_media_json_simd_backend(), detected);
+    free(text);
+}
+
 // * * * * * * * * * * * * * * * * * * * * * * * *
 // * Fossil Logic Test Pool
 // * * * * * * * * * * * * * * * * * * * * * * * *
@@ -467,6 +2171,7 @@ FOSSIL_TEST_GROUP(c_json_tests) {
     FOSSIL_ADD_TEST(c_json_fixture, c_test_json_stringify_roundtrip);
     FOSSIL_ADD_TEST(c_json_fixture, c_test_json_clone_and_equals);
     FOSSIL_ADD_TEST(c_json_fixture, c_test_json_equals_not_equal);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_hash);
     FOSSIL_ADD_TEST(c_json_fixture, c_test_json_new_null);
     FOSSIL_ADD_TEST(c_json_fixture, c_test_json_new_bool);
     FOSSIL_ADD_TEST(c_json_fixture, c_test_json_new_number);
@@ -476,8 +2181,15 @@ FOSSIL_TEST_GROUP(c_json_tests) {
     FOSSIL_ADD_TEST(c_json_fixture, c_test_json_array_reserve);
     FOSSIL_ADD_TEST(c_json_fixture, c_test_json_object_reserve);
     FOSSIL_ADD_TEST(c_json_fixture, c_test_json_new_int_and_get_int);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_int64);
     FOSSIL_ADD_TEST(c_json_fixture, c_test_json_validate);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_validate_limits);
     FOSSIL_ADD_TEST(c_json_fixture, c_test_json_get_path);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_path_compile);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_query);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_lazy);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_merge_patch);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_patch);
     FOSSIL_ADD_TEST(c_json_fixture, c_test_json_parse_empty_array);
     FOSSIL_ADD_TEST(c_json_fixture, c_test_json_parse_empty_object);
     FOSSIL_ADD_TEST(c_json_fixture, c_test_json_parse_invalid_trailing_comma_array);
@@ -493,10 +2205,34 @@ FOSSIL_TEST_GROUP(c_json_tests) {
     FOSSIL_ADD_TEST(c_json_fixture, c_test_json_stringify_null_value);
     FOSSIL_ADD_TEST(c_json_fixture, c_test_json_clone_null);
     FOSSIL_ADD_TEST(c_json_fixture, c_test_json_equals_nulls);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_equals_duplicate_keys);
     FOSSIL_ADD_TEST(c_json_fixture, c_test_json_parse_nested_object_array);
     FOSSIL_ADD_TEST(c_json_fixture, c_test_json_parse_deeply_nested);
     FOSSIL_ADD_TEST(c_json_fixture, c_test_json_parse_mixed_types_array);
     FOSSIL_ADD_TEST(c_json_fixture, c_test_json_parse_object_with_array_values);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_parse_arena);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_parse_arena_read_only);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_parse_arena_error);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_parse_insitu);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_intern_keys);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_parse_large);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_simd_backend);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_simd_backend_threads);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_stream_chunked);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_stream_error);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_ndjson);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_tape);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_parse_file);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_parse_sax);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_max_depth);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_object_large_lookup);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_number_corpus);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_number_grammar);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_stringify_numbers);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_writer_events);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_writer_errors);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_stringify_parallel);
+    FOSSIL_ADD_TEST(c_json_fixture, c_test_json_string_runs);
 
     FOSSIL_ADD_SUITE(c_json_fixture);
 } // end of tests
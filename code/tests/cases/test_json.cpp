@@ -96,6 +96,273 @@ FOSSIL_TEST(cpp_test_json_stringify_roundtrip) {
     ASSUME_ITS_TRUE(out == src || out == "{\"foo\":[1,true,null]}");
 }
 
+FOSSIL_TEST(cpp_test_json_hash) {
+    Json a = Json::parse("{\"id\":1,\"tags\":[\"x\"]}");
+    Json b = Json::parse_arena("{\"tags\":[\"x\"],\"id\":1.0}");
+    ASSUME_ITS_TRUE(a.hash() == b.hash());
+    ASSUME_ITS_TRUE(a.hash() != Json::parse("{\"id\":2,\"tags\":[\"x\"]}").hash());
+}
+
+FOSSIL_TEST(cpp_test_json_parse_arena) {
+    Json j = Json::parse_arena("{\"foo\":[1,true,null]}");
+    ASSUME_ITS_EQUAL_CSTR(j.stringify().c_str(), "{\"foo\":[1,true,null]}");
+    ASSUME_ITS_TRUE(j.equals(Json::parse("{\"foo\":[1,true,null]}")));
+}
+
+FOSSIL_TEST(cpp_test_json_parse_insitu) {
+    char buf[] = "{\"foo\":[\"a\\nb\",true]}";
+    Json j = Json::parse_insitu(buf);
+    ASSUME_ITS_EQUAL_CSTR(j.stringify().c_str(), "{\"foo\":[\"a\\nb\",true]}");
+}
+
+FOSSIL_TEST(cpp_test_json_tape) {
+    const char* file = "fossil_media_json_tape_cpp.bin";
+    Json::parse("{\"ids\":[1,2,3],\"name\":\"x\"}").write_tape(file);
+    {
+        fossil::media::JsonTape tape(file);
+        ASSUME_ITS_EQUAL_SIZE(fossil_media_json_tape_size(fossil_media_json_tape_get(tape.root(), "ids")), 3);
+        ASSUME_ITS_EQUAL_CSTR(tape.to_json().stringify().c_str(), "{\"ids\":[1,2,3],\"name\":\"x\"}");
+    }
+    std::remove(file);
+}
+
+FOSSIL_TEST(cpp_test_json_parse_file) {
+    const char* file = "fossil_media_json_parse_file_cpp.json";
+    Json::parse("{\"name\":\"a\\tb\",\"ids\":[1,2]}").write_file(file);
+    Json j = Json::parse_file(file, FOSSIL_MEDIA_JSON_PARSE_INSITU);
+    ASSUME_ITS_TRUE(j.equals(Json::parse_file(file)));
+    ASSUME_ITS_EQUAL_CSTR(j.stringify().c_str(), "{\"name\":\"a\\tb\",\"ids\":[1,2]}");
+    std::remove(file);
+}
+
+FOSSIL_TEST(cpp_test_json_stringify_parallel) {
+    Json list = Json::new_array();
+    for (int i = 0; i < 5000; ++i) {
+        list.array_append(Json::parse("{\"id\":[1,\"x\"]}"));
+    }
+    ASSUME_ITS_TRUE(list.stringify_parallel(true, 3) == list.stringify(true));
+}
+
+FOSSIL_TEST(cpp_test_json_view) {
+    Json doc = Json::parse("{\"id\":7,\"name\":\"x\",\"ok\":true,\"list\":[1,2,3],\"big\":300}");
+    fossil::media::JsonView v = doc.view();
+    ASSUME_ITS_EQUAL_SIZE(v.size(), 5);
+    ASSUME_ITS_EQUAL_I32(v["id"].as<int>(), 7);
+    ASSUME_ITS_TRUE(v["name"].as<std::string_view>() == "x");
+    ASSUME_ITS_TRUE(v["ok"].as<bool>());
+    ASSUME_ITS_TRUE(v.path("list[2]").as<double>() == 3.0);
+
+    /* Borrowed: the view points at the node in the document */
+    ASSUME_ITS_TRUE(v["list"][1].get() == fossil_media_json_array_get(fossil_media_json_object_get(v.get(), "list"), 1));
+    ASSUME_ITS_EQUAL_I32(v["list"][0].as<int>(), 1);
+    ASSUME_ITS_TRUE(!v["list"][-1]);
+    long sum = 0;
+    for (fossil::media::JsonView item : v["list"]) sum += item.as<long>();
+    ASSUME_ITS_EQUAL_I32(sum, 6);
+    std::string keys;
+    for (auto [key, val] : v.members()) {
+        keys += key;
+        (void)val;
+    }
+    ASSUME_ITS_EQUAL_CSTR(keys.c_str(), "idnameoklistbig");
+
+    /* Missing lookups chain to an empty view; reading one throws */
+    ASSUME_ITS_TRUE(!v["nope"]["deeper"][3]);
+    bool threw = false;
+    try { (void)v["nope"].as<int>(); } catch (const fossil::media::JsonError&) { threw = true; }
+    ASSUME_ITS_TRUE(threw);
+    threw = false;
+    try { (void)v["big"].as<signed char>(); } catch (const fossil::media::JsonError&) { threw = true; }
+    ASSUME_ITS_TRUE(threw);
+    /* Integer types take whole numbers only, as the bindings do */
+    Json nums = Json::parse("[1.5,-0.5,2.0,1e3]");
+    for (size_t k = 0; k < 2; ++k) {
+        threw = false;
+        try { (void)nums.view()[k].as<int>(); } catch (const fossil::media::JsonError&) { threw = true; }
+        ASSUME_ITS_TRUE(threw);
+        threw = false;
+        try { (void)nums.view()[k].as<unsigned>(); } catch (const fossil::media::JsonError&) { threw = true; }
+        ASSUME_ITS_TRUE(threw);
+    }
+    ASSUME_ITS_EQUAL_I32(nums.view()[2].as<int>(), 2);
+    ASSUME_ITS_EQUAL_I32((int)nums.view()[3].as<unsigned>(), 1000);
+    threw = false;
+    try { (void)v.at("nope"); } catch (const fossil::media::JsonError&) { threw = true; }
+    ASSUME_ITS_TRUE(threw);
+
+    /* Mutable references edit the document in place */
+    fossil::media::JsonRef list = doc["list"];
+    ASSUME_ITS_EQUAL_I32(list[0].as<int>(), 1);
+    list.append(Json::new_number(4));
+    doc.ref().set("name", Json::new_string("y"));
+    Json gone = doc.ref().remove("ok");
+    ASSUME_ITS_TRUE(gone.view().as<bool>());
+    ASSUME_ITS_EQUAL_CSTR(doc.stringify().c_str(), "{\"id\":7,\"name\":\"y\",\"list\":[1,2,3,4],\"big\":300}");
+
+    /* array_get() returns a real deep copy of the element */
+    Json arr = Json::parse("[{\"a\":[1]}]");
+    Json first = arr.array_get(0);
+    ASSUME_ITS_TRUE(first.equals(Json::parse("{\"a\":[1]}")));
+    ASSUME_ITS_TRUE(first.view().get() != arr[0].get());
+}
+
+struct BindPoint {
+    int x = 0;
+    int y = 0;
+    static constexpr auto json_fields = std::make_tuple(
+        fossil::media::json_field("x", &BindPoint::x),
+        fossil::media::json_field("y", &BindPoint::y));
+};
+
+struct BindShape {
+    std::string name;
+    bool closed = false;
+    double scale = 1.0;
+    unsigned long long id = 0;
+    std::vector<BindPoint> points;
+    std::optional<std::string> label;
+    static constexpr auto json_fields = std::make_tuple(
+        fossil::media::json_field("name", &BindShape::name),
+        fossil::media::json_field("closed", &BindShape::closed),
+        fossil::media::json_field("scale", &BindShape::scale),
+        fossil::media::json_field("id", &BindShape::id),
+        fossil::media::json_field("points", &BindShape::points),
+        fossil::media::json_field("label", &BindShape::label));
+};
+
+FOSSIL_TEST(cpp_test_json_bind) {
+    using fossil::media::JsonBinding;
+    BindShape s = JsonBinding<BindShape>::parse(
+        "{\"name\":\"tri\",\"extra\":{\"skip\":[1,{\"x\":9}]},\"points\":[{\"x\":1,\"y\":2},{\"y\":4}],"
+        "\"id\":18446744073709551615,\"closed\":true,\"label\":null}");
+    ASSUME_ITS_EQUAL_CSTR(s.name.c_str(), "tri");
+    ASSUME_ITS_TRUE(s.closed);
+    ASSUME_ITS_TRUE(s.scale == 1.0);
+    ASSUME_ITS_TRUE(s.id == 18446744073709551615ull);
+    ASSUME_ITS_EQUAL_SIZE(s.points.size(), 2);
+    ASSUME_ITS_EQUAL_I32(s.points[1].x, 0);
+    ASSUME_ITS_EQUAL_I32(s.points[1].y, 4);
+    ASSUME_ITS_TRUE(!s.label);
+
+    /* Output goes through the writer and reads back through the DOM parser */
+    s.label = "a\"b";
+    std::string text = JsonBinding<BindShape>::stringify(s);
+    ASSUME_ITS_EQUAL_CSTR(text.c_str(),
+        "{\"name\":\"tri\",\"closed\":true,\"scale\":1,\"id\":18446744073709551615,"
+        "\"points\":[{\"x\":1,\"y\":2},{\"x\":0,\"y\":4}],\"label\":\"a\\\"b\"}");
+    ASSUME_ITS_TRUE(Json::parse(JsonBinding<BindShape>::stringify(s, true)).equals(Json::parse(text)));
+    /* NaN has no JSON spelling; writing it fails instead of emitting null */
+    s.scale = std::numeric_limits<double>::quiet_NaN();
+    bool nan_threw = false;
+    try { (void)JsonBinding<BindShape>::stringify(s); } catch (const fossil::media::JsonError&) { nan_threw = true; }
+    ASSUME_ITS_TRUE(nan_threw);
+    s.scale = 1.0;
+    ASSUME_ITS_TRUE(JsonBinding<std::vector<int>>::parse("[3,-4,2.0,1e3]") == std::vector<int>({3, -4, 2, 1000}));
+    std::optional<BindPoint> at = BindPoint{5, 6};
+    JsonBinding<std::optional<BindPoint>>::parse("{\"y\":7}", at);
+    ASSUME_ITS_TRUE(at && at->x == 5 && at->y == 7);
+    JsonBinding<std::optional<BindPoint>>::parse("null", at);
+    ASSUME_ITS_TRUE(!at);
+    JsonBinding<std::optional<BindPoint>>::parse("{\"y\":1}", at);
+    ASSUME_ITS_TRUE(at && at->x == 0 && at->y == 1);
+    std::vector<bool> flags = JsonBinding<std::vector<bool>>::parse("[true,false,true]");
+    ASSUME_ITS_TRUE(flags == std::vector<bool>({true, false, true}));
+    ASSUME_ITS_EQUAL_CSTR(JsonBinding<std::vector<bool>>::stringify(flags).c_str(), "[true,false,true]");
+
+    /* Type mismatches and out-of-range integers name the offending key */
+    const char* bad[] = {"{\"closed\":1}", "{\"points\":[{\"x\":1.5}]}", "{\"points\":{}}",
+                         "{\"id\":-1}", "{\"id\":-1.0}", "[]", "{\"name\":\"x\""};
+    for (const char* in : bad) {
+        bool threw = false;
+        try { (void)JsonBinding<BindShape>::parse(in); } catch (const fossil::media::JsonError&) { threw = true; }
+        ASSUME_ITS_TRUE(threw);
+    }
+    for (const char* in : {"[1]", "[[true]]", "[{}]"}) {
+        bool threw = false;
+        try { (void)JsonBinding<std::vector<bool>>::parse(in); } catch (const fossil::media::JsonError&) { threw = true; }
+        ASSUME_ITS_TRUE(threw);
+    }
+    /* The key named is the one being decoded, never one from a closed object */
+    const char* named[][2] = {
+        {"{\"points\":[{\"x\":\"1\"}]}", "Bind error: expected integer for \"x\""},
+        {"{\"points\":[{\"x\":1},true]}", "Bind error: expected object for an element of \"points\""},
+        {"{\"name\":\"x\",\"points\":[{\"y\":2},[]]}", "Bind error: expected object for an element of \"points\""},
+        {"{\"extra\":{\"skip\":1},\"closed\":0}", "Bind error: expected boolean for \"closed\""}};
+    for (const auto& c : named) {
+        std::string what;
+        try { (void)JsonBinding<BindShape>::parse(c[0]); } catch (const fossil::media::JsonError& e) { what = e.what(); }
+        ASSUME_ITS_EQUAL_CSTR(what.c_str(), c[1]);
+    }
+    std::string what;
+    try {
+        (void)JsonBinding<std::vector<BindPoint>>::parse("[{\"x\":1},2]");
+    } catch (const fossil::media::JsonError& e) {
+        what = e.what();
+    }
+    ASSUME_ITS_EQUAL_CSTR(what.c_str(), "Bind error: expected object");
+}
+
+FOSSIL_TEST(cpp_test_json_query) {
+    Json doc = Json::parse("{\"items\":[{\"id\":1,\"price\":5},{\"id\":2,\"price\":15},{\"id\":3,\"price\":25}]}");
+    fossil::media::JsonQuery query("$.items[?@.price > 10].id");
+    std::vector<fossil::media::JsonView> ids = query.run(doc);
+    ASSUME_ITS_EQUAL_SIZE(ids.size(), 2);
+    ASSUME_ITS_EQUAL_I32(ids[0].as<int>(), 2);
+    ASSUME_ITS_EQUAL_I32(ids[1].as<int>(), 3);
+    ASSUME_ITS_TRUE(ids[1].get() == doc.view().path("items[2].id").get());
+    ASSUME_ITS_TRUE(query.run(Json::parse("{\"items\":{}}")).empty());
+    bool threw = false;
+    try { fossil::media::JsonQuery bad("$.items[?@.price >]"); } catch (const fossil::media::JsonError&) { threw = true; }
+    ASSUME_ITS_TRUE(threw);
+}
+
+FOSSIL_TEST(cpp_test_json_lazy) {
+    fossil::media::JsonLazy doc("{\"meta\":{\"big\":[1,2,3]},\"user\":{\"name\":\"ada\",\"tags\":[\"x\",\"y\"],\"admin\":false}}");
+    ASSUME_ITS_EQUAL_CSTR(doc["user"]["name"].get_string().c_str(), "ada");
+    ASSUME_ITS_EQUAL_CSTR(doc.path("user.tags[1]").get_string().c_str(), "y");
+    ASSUME_ITS_EQUAL_SIZE(doc["user"]["tags"].size(), 2);
+    ASSUME_ITS_EQUAL_CSTR(doc["user"]["tags"][0].get_string().c_str(), "x");
+    fossil::media::JsonLazy list("[10,20]");
+    ASSUME_ITS_EQUAL_I32((int)list[0].get_int(), 10);
+    ASSUME_ITS_TRUE(!doc["user"]["admin"].get_bool());
+    ASSUME_ITS_TRUE(!doc["nobody"]["name"]);
+    ASSUME_ITS_EQUAL_CSTR(doc["meta"].to_json().stringify().c_str(), "{\"big\":[1,2,3]}");
+    bool threw = false;
+    try { doc["user"]["name"].get_int(); } catch (const fossil::media::JsonError&) { threw = true; }
+    ASSUME_ITS_TRUE(threw);
+    threw = false;
+    try { fossil::media::JsonLazy bad("   "); } catch (const fossil::media::JsonError&) { threw = true; }
+    ASSUME_ITS_TRUE(threw);
+}
+
+FOSSIL_TEST(cpp_test_json_patch) {
+    Json doc = Json::parse("{\"a\":{\"b\":1},\"list\":[1,2]}");
+    doc.merge_patch(Json::parse("{\"a\":{\"b\":null,\"c\":2}}"));
+    doc.apply_patch(Json::parse("[{\"op\":\"add\",\"path\":\"/list/0\",\"value\":0}]"));
+    ASSUME_ITS_EQUAL_CSTR(doc.stringify().c_str(), "{\"a\":{\"c\":2},\"list\":[0,1,2]}");
+    bool threw = false;
+    try {
+        doc.apply_patch(Json::parse("[{\"op\":\"remove\",\"path\":\"/a\"},{\"op\":\"test\",\"path\":\"/x\",\"value\":1}]"));
+    } catch (const fossil::media::JsonError&) {
+        threw = true;
+    }
+    ASSUME_ITS_TRUE(threw);
+    ASSUME_ITS_EQUAL_CSTR(doc.stringify().c_str(), "{\"a\":{\"c\":2},\"list\":[0,1,2]}");
+}
+
+FOSSIL_TEST(cpp_test_json_stream) {
+    std::string seen;
+    fossil::media::JsonStream stream([&seen](Json&& j) {
+        seen += j.stringify() + ";";
+        return true;
+    });
+    stream.feed("1 [2");
+    stream.feed("0] \"a");
+    stream.feed("b\"");
+    stream.finish();
+    ASSUME_ITS_EQUAL_CSTR(seen.c_str(), "1;[20];\"ab\";");
+}
+
 // * * * * * * * * * * * * * * * * * * * * * * * *
 // * Fossil Logic Test Pool
 // * * * * * * * * * * * * * * * * * * * * * * * *
@@ -108,6 +375,18 @@ FOSSIL_TEST_GROUP(cpp_json_tests) {
     FOSSIL_ADD_TEST(cpp_json_fixture, cpp_test_json_parse_array);
     FOSSIL_ADD_TEST(cpp_json_fixture, cpp_test_json_parse_object);
     FOSSIL_ADD_TEST(cpp_json_fixture, cpp_test_json_stringify_roundtrip);
+    FOSSIL_ADD_TEST(cpp_json_fixture, cpp_test_json_hash);
+    FOSSIL_ADD_TEST(cpp_json_fixture, cpp_test_json_parse_arena);
+    FOSSIL_ADD_TEST(cpp_json_fixture, cpp_test_json_parse_insitu);
+    FOSSIL_ADD_TEST(cpp_json_fixture, cpp_test_json_tape);
+    FOSSIL_ADD_TEST(cpp_json_fixture, cpp_test_json_parse_file);
+    FOSSIL_ADD_TEST(cpp_json_fixture, cpp_test_json_stringify_parallel);
+    FOSSIL_ADD_TEST(cpp_json_fixture, cpp_test_json_view);
+    FOSSIL_ADD_TEST(cpp_json_fixture, cpp_test_json_bind);
+    FOSSIL_ADD_TEST(cpp_json_fixture, cpp_test_json_query);
+    FOSSIL_ADD_TEST(cpp_json_fixture, cpp_test_json_lazy);
+    FOSSIL_ADD_TEST(cpp_json_fixture, cpp_test_json_patch);
+    FOSSIL_ADD_TEST(cpp_json_fixture, cpp_test_json_stream);
 
     FOSSIL_ADD_SUITE(cpp_json_fixture);
 } // end of tests